@@ -0,0 +1,22 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2025, Olivier MATZ <zer0@droids-corp.org>
+ */
+
+#include <stdio.h>
+#include <time.h>
+
+#include "bench.h"
+
+uint64_t ec_bench_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void ec_bench_report(const char *name, unsigned int count, uint64_t ns)
+{
+	printf("%-40s %8u ops %12.3f us/op\n", name, count, (double)ns / count / 1000);
+}
@@ -0,0 +1,40 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2025, Olivier MATZ <zer0@droids-corp.org>
+ */
+
+/**
+ * @defgroup ecoli_bench Benchmark
+ * @{
+ *
+ * @brief Helpers for benchmarks
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <ecoli.h>
+
+/**
+ * Get a monotonic timestamp.
+ *
+ * @internal
+ * @return
+ *   The current time in nanoseconds.
+ */
+uint64_t ec_bench_now(void);
+
+/**
+ * Print the result of a benchmark.
+ *
+ * @internal
+ * @param name
+ *   The name of the measured operation.
+ * @param count
+ *   The number of operations.
+ * @param ns
+ *   The total duration in nanoseconds.
+ */
+void ec_bench_report(const char *name, unsigned int count, uint64_t ns);
+
+/** @} */
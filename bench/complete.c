@@ -0,0 +1,122 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2025, Olivier MATZ <zer0@droids-corp.org>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench.h"
+
+#define MAX_TOKENS 30
+
+static const char *const keywords[] = {
+	"interface", "address", "route", "vlan", "bridge", "mtu", "neighbor", "protocol",
+};
+
+static const char *const abbrevs[] = {
+	"in", "ad", "ro", "vl", "br", "mt", "ne", "pr",
+};
+
+/* a command made of MAX_TOKENS keywords, each one chosen in a list */
+static struct ec_node *build_grammar(void)
+{
+	struct ec_node *seq = NULL, *or = NULL;
+	unsigned int i, j;
+
+	seq = ec_node("seq", EC_NO_ID);
+	if (seq == NULL)
+		goto fail;
+
+	for (i = 0; i < MAX_TOKENS; i++) {
+		or = ec_node("or", EC_NO_ID);
+		if (or == NULL)
+			goto fail;
+		for (j = 0; j < EC_COUNT_OF(keywords); j++) {
+			if (ec_node_or_add(or, ec_node_str(EC_NO_ID, keywords[j])) < 0)
+				goto fail;
+		}
+		if (ec_node_seq_add(seq, or) < 0) {
+			or = NULL; /* freed */
+			goto fail;
+		}
+		or = NULL;
+	}
+
+	return seq;
+
+fail:
+	ec_node_free(or);
+	ec_node_free(seq);
+	return NULL;
+}
+
+static int bench_expand(const struct ec_node *node, size_t len, unsigned int count)
+{
+	struct ec_strvec *line = NULL, *expanded = NULL, *ref = NULL;
+	char name[64];
+	uint64_t start;
+	unsigned int n;
+	size_t i;
+	int ret = -1;
+
+	line = ec_strvec();
+	ref = ec_strvec();
+	if (line == NULL || ref == NULL)
+		goto out;
+	for (i = 0; i < len; i++) {
+		if (ec_strvec_add(line, abbrevs[i % EC_COUNT_OF(abbrevs)]) < 0)
+			goto out;
+		if (ec_strvec_add(ref, keywords[i % EC_COUNT_OF(keywords)]) < 0)
+			goto out;
+	}
+
+	start = ec_bench_now();
+	for (n = 0; n < count; n++) {
+		ec_strvec_free(expanded);
+		expanded = ec_complete_strvec_expand(node, EC_COMP_FULL, line);
+		if (expanded == NULL)
+			goto out;
+	}
+	snprintf(name, sizeof(name), "expand %zu tokens", len);
+	ec_bench_report(name, count, ec_bench_now() - start);
+
+	if (ec_strvec_cmp(expanded, ref) != 0) {
+		fprintf(stderr, "bad expansion of %zu tokens\n", len);
+		goto out;
+	}
+
+	ret = 0;
+
+out:
+	ec_strvec_free(line);
+	ec_strvec_free(expanded);
+	ec_strvec_free(ref);
+	return ret;
+}
+
+int main(void)
+{
+	static const size_t lengths[] = {5, 10, 20, MAX_TOKENS};
+	struct ec_node *node = NULL;
+	int ret = EXIT_FAILURE;
+	size_t i;
+
+	if (ec_init() < 0)
+		goto out;
+
+	node = build_grammar();
+	if (node == NULL)
+		goto out;
+
+	for (i = 0; i < EC_COUNT_OF(lengths); i++) {
+		if (bench_expand(node, lengths[i], 20) < 0)
+			goto out;
+	}
+
+	ret = EXIT_SUCCESS;
+
+out:
+	ec_node_free(node);
+	ec_exit();
+	return ret;
+}
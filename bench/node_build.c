@@ -0,0 +1,141 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2025, Olivier MATZ <zer0@droids-corp.org>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench.h"
+
+/* about 8 nodes per command */
+#define N_CMDS 12500
+
+/* "show<i> interface [detail|brief] <int>" */
+static struct ec_node *build_cmd(unsigned int i)
+{
+	char name[32];
+
+	snprintf(name, sizeof(name), "show%u", i);
+
+	return EC_NODE_SEQ(
+		EC_NO_ID,
+		ec_node_str(EC_NO_ID, name),
+		ec_node_str(EC_NO_ID, "interface"),
+		ec_node_option(
+			EC_NO_ID,
+			EC_NODE_OR(
+				EC_NO_ID,
+				ec_node_str(EC_NO_ID, "detail"),
+				ec_node_str(EC_NO_ID, "brief")
+			)
+		),
+		ec_node_int(EC_NO_ID, 0, 65535, 10)
+	);
+}
+
+static int bench_build(unsigned int count)
+{
+	struct ec_node *root;
+	uint64_t start;
+	unsigned int i;
+	char name[64];
+
+	start = ec_bench_now();
+	root = ec_node_or(EC_NO_ID);
+	if (root == NULL)
+		return -1;
+	for (i = 0; i < count; i++) {
+		if (ec_node_or_add(root, build_cmd(i)) < 0) {
+			ec_node_free(root);
+			return -1;
+		}
+	}
+	snprintf(name, sizeof(name), "build grammar of %u commands", count);
+	ec_bench_report(name, count, ec_bench_now() - start);
+
+	ec_node_free(root);
+
+	return 0;
+}
+
+/* number of keywords in the shared expression */
+#define N_KEYWORDS 100
+
+/* "value<i> <expr>", all the commands sharing the same expression, which
+ * contains a loop: expr = "(" expr ")" | <int> | <keyword> */
+static int bench_free_shared(unsigned int count)
+{
+	struct ec_node *root = NULL, *expr = NULL, *keywords, *cmd;
+	uint64_t start;
+	unsigned int i;
+	char name[64];
+
+	expr = ec_node_or(EC_NO_ID);
+	if (expr == NULL)
+		goto fail;
+	keywords = ec_node_or(EC_NO_ID);
+	if (ec_node_or_add(expr, keywords) < 0)
+		goto fail;
+	for (i = 0; i < N_KEYWORDS; i++) {
+		snprintf(name, sizeof(name), "keyword%u", i);
+		if (ec_node_or_add(keywords, ec_node_str(EC_NO_ID, name)) < 0)
+			goto fail;
+	}
+	cmd = EC_NODE_SEQ(
+		EC_NO_ID,
+		ec_node_str(EC_NO_ID, "("),
+		ec_node_clone(expr),
+		ec_node_str(EC_NO_ID, ")")
+	);
+	if (ec_node_or_add(expr, cmd) < 0)
+		goto fail;
+	if (ec_node_or_add(expr, ec_node_int(EC_NO_ID, 0, 65535, 10)) < 0)
+		goto fail;
+
+	root = ec_node_or(EC_NO_ID);
+	if (root == NULL)
+		goto fail;
+	for (i = 0; i < count; i++) {
+		snprintf(name, sizeof(name), "value%u", i);
+		cmd = EC_NODE_SEQ(EC_NO_ID, ec_node_str(EC_NO_ID, name), ec_node_clone(expr));
+		if (ec_node_or_add(root, cmd) < 0)
+			goto fail;
+	}
+	ec_node_free(expr);
+	expr = NULL;
+
+	start = ec_bench_now();
+	ec_node_free(root);
+	snprintf(name, sizeof(name), "free grammar of %u shared loops", count);
+	ec_bench_report(name, count, ec_bench_now() - start);
+
+	return 0;
+
+fail:
+	ec_node_free(expr);
+	ec_node_free(root);
+	return -1;
+}
+
+int main(void)
+{
+	int ret = EXIT_FAILURE;
+
+	if (ec_init() < 0)
+		goto out;
+
+	if (bench_build(N_CMDS / 10) < 0)
+		goto out;
+	if (bench_build(N_CMDS) < 0)
+		goto out;
+	if (bench_free_shared(N_CMDS / 10) < 0)
+		goto out;
+	if (bench_free_shared(N_CMDS) < 0)
+		goto out;
+
+	ret = EXIT_SUCCESS;
+
+out:
+	ec_exit();
+	return ret;
+}
@@ -0,0 +1,107 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2025, Olivier MATZ <zer0@droids-corp.org>
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench.h"
+
+#define CMD_COUNT 6000
+
+/*
+ * Build a CLI of CMD_COUNT commands, like at startup. Each command is
+ * built from one of "variants" distinct command strings, with children
+ * shared by the commands using the same string.
+ */
+static int bench_cmd(size_t variants, bool cache, unsigned int count)
+{
+	struct ec_node *children[CMD_COUNT] = {NULL};
+	struct ec_node *cmds[CMD_COUNT] = {NULL};
+	struct ec_node *child;
+	char name[64], cmd_str[128];
+	uint64_t start, total = 0;
+	unsigned int i, n;
+	int ret = -1;
+
+	if (ec_node_cmd_set_cache(cache) < 0)
+		goto out;
+
+	for (n = 0; n < count; n++) {
+		for (i = 0; i < variants; i++) {
+			children[i] = ec_node_int("NUM", 0, 1000, 10);
+			if (children[i] == NULL)
+				goto out;
+		}
+		start = ec_bench_now();
+		for (i = 0; i < CMD_COUNT; i++) {
+			snprintf(
+				cmd_str,
+				sizeof(cmd_str),
+				"show%zu interface NUM [detail|brief] (up|down|all)* "
+				"[vlan, mtu & speed]",
+				i % variants
+			);
+			child = ec_node_clone(children[i % variants]);
+			cmds[i] = EC_NODE_CMD(EC_NO_ID, cmd_str, child);
+			if (cmds[i] == NULL)
+				goto out;
+		}
+		total += ec_bench_now() - start;
+
+		for (i = 0; i < CMD_COUNT; i++) {
+			ec_node_free(cmds[i]);
+			cmds[i] = NULL;
+		}
+		for (i = 0; i < variants; i++) {
+			ec_node_free(children[i]);
+			children[i] = NULL;
+		}
+		/* flush the cache */
+		if (ec_node_cmd_set_cache(false) < 0 || ec_node_cmd_set_cache(cache) < 0)
+			goto out;
+	}
+
+	snprintf(
+		name,
+		sizeof(name),
+		"build cmd, %zu distinct, cache %s",
+		variants,
+		cache ? "on" : "off"
+	);
+	ec_bench_report(name, count * CMD_COUNT, total);
+
+	ret = 0;
+
+out:
+	for (i = 0; i < CMD_COUNT; i++)
+		ec_node_free(cmds[i]);
+	for (i = 0; i < variants; i++)
+		ec_node_free(children[i]);
+	ec_node_cmd_set_cache(false);
+	return ret;
+}
+
+int main(void)
+{
+	int ret = EXIT_FAILURE;
+
+	if (ec_init() < 0)
+		goto out;
+
+	if (bench_cmd(CMD_COUNT, false, 5) < 0)
+		goto out;
+	if (bench_cmd(CMD_COUNT, true, 5) < 0)
+		goto out;
+	if (bench_cmd(100, false, 5) < 0)
+		goto out;
+	if (bench_cmd(100, true, 5) < 0)
+		goto out;
+
+	ret = EXIT_SUCCESS;
+
+out:
+	ec_exit();
+	return ret;
+}
@@ -0,0 +1,120 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2025, Olivier MATZ <zer0@droids-corp.org>
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench.h"
+
+#define N_ARGS 20 /* the maximum allowed by the condition */
+
+/*
+ * A command whose last argument is only allowed for privileged users. The
+ * same grammar without the condition gives the cost of the evaluation.
+ */
+static struct ec_node *build_cmd(bool with_cond)
+{
+	struct ec_node *args, *last;
+
+	args = ec_node_many(
+		EC_NO_ID,
+		EC_NODE_OR(
+			EC_NO_ID, ec_node_str("id_user", "user"), ec_node_re("id_arg", "arg[0-9]+")
+		),
+		0,
+		0
+	);
+	last = ec_node_str(EC_NO_ID, "privileged");
+	if (with_cond)
+		last = ec_node_cond(
+			EC_NO_ID,
+			"and(cmp(eq, count(find(root(), id_user)), 1), "
+			"cmp(le, count(find(root(), id_arg)), 20))",
+			last
+		);
+
+	return EC_NODE_SEQ(EC_NO_ID, ec_node_str(EC_NO_ID, "cmd"), args, last);
+}
+
+static int bench_cmd(bool with_cond, const struct ec_strvec *line, unsigned int count)
+{
+	const char *name = with_cond ? "with condition" : "without condition";
+	struct ec_node *node = NULL;
+	struct ec_pnode *pnode;
+	struct ec_comp *comp;
+	char bench_name[64];
+	uint64_t start;
+	unsigned int i;
+	int ret = -1;
+
+	node = build_cmd(with_cond);
+	if (node == NULL)
+		goto out;
+
+	start = ec_bench_now();
+	for (i = 0; i < count; i++) {
+		pnode = ec_parse_strvec(node, line);
+		if (pnode == NULL)
+			goto out;
+		if (!ec_pnode_matches(pnode)) {
+			fprintf(stderr, "line does not match\n");
+			ec_pnode_free(pnode);
+			goto out;
+		}
+		ec_pnode_free(pnode);
+	}
+	snprintf(bench_name, sizeof(bench_name), "parse %s", name);
+	ec_bench_report(bench_name, count, ec_bench_now() - start);
+
+	start = ec_bench_now();
+	for (i = 0; i < count; i++) {
+		comp = ec_complete_strvec(node, line);
+		if (comp == NULL)
+			goto out;
+		ec_comp_free(comp);
+	}
+	snprintf(bench_name, sizeof(bench_name), "complete %s", name);
+	ec_bench_report(bench_name, count, ec_bench_now() - start);
+
+	ret = 0;
+
+out:
+	ec_node_free(node);
+	return ret;
+}
+
+int main(void)
+{
+	struct ec_strvec *line = NULL;
+	int ret = EXIT_FAILURE;
+	char arg[16];
+	unsigned int i;
+
+	if (ec_init() < 0)
+		goto out;
+
+	line = EC_STRVEC("cmd", "user");
+	if (line == NULL)
+		goto out;
+	for (i = 0; i < N_ARGS; i++) {
+		snprintf(arg, sizeof(arg), "arg%u", i);
+		if (ec_strvec_add(line, arg) < 0)
+			goto out;
+	}
+	if (ec_strvec_add(line, "privileged") < 0)
+		goto out;
+
+	if (bench_cmd(false, line, 10000) < 0)
+		goto out;
+	if (bench_cmd(true, line, 10000) < 0)
+		goto out;
+
+	ret = EXIT_SUCCESS;
+
+out:
+	ec_strvec_free(line);
+	ec_exit();
+	return ret;
+}
@@ -0,0 +1,123 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2025, Olivier MATZ <zer0@droids-corp.org>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench.h"
+
+#define N_NAMES 50000
+
+static struct ec_strvec *get_names(struct ec_pnode *pstate, void *opaque)
+{
+	struct ec_strvec *names;
+	char name[32];
+	size_t i;
+
+	(void)pstate;
+	(void)opaque;
+
+	names = ec_strvec();
+	if (names == NULL)
+		return NULL;
+
+	for (i = 0; i < N_NAMES; i++) {
+		snprintf(name, sizeof(name), "vrf%zu", i);
+		if (ec_strvec_add(names, name) < 0) {
+			ec_strvec_free(names);
+			return NULL;
+		}
+	}
+
+	return names;
+}
+
+static int bench_node(const char *name, struct ec_node *node, unsigned int count)
+{
+	struct ec_pnode *pnode;
+	struct ec_comp *comp;
+	char bench_name[64];
+	uint64_t start;
+	unsigned int i;
+
+	start = ec_bench_now();
+	for (i = 0; i < count; i++) {
+		pnode = ec_parse(node, "vrf49999");
+		if (pnode == NULL)
+			return -1;
+		if (!ec_pnode_matches(pnode)) {
+			fprintf(stderr, "name does not match\n");
+			ec_pnode_free(pnode);
+			return -1;
+		}
+		ec_pnode_free(pnode);
+	}
+	snprintf(bench_name, sizeof(bench_name), "parse %s", name);
+	ec_bench_report(bench_name, count, ec_bench_now() - start);
+
+	start = ec_bench_now();
+	for (i = 0; i < count; i++) {
+		/* 11 completions: vrf4999 and vrf49990 to vrf49999 */
+		comp = ec_complete(node, "vrf4999");
+		if (comp == NULL)
+			return -1;
+		if (ec_comp_count(comp, EC_COMP_FULL) != 11) {
+			fprintf(stderr, "bad number of completions\n");
+			ec_comp_free(comp);
+			return -1;
+		}
+		ec_comp_free(comp);
+	}
+	snprintf(bench_name, sizeof(bench_name), "complete %s", name);
+	ec_bench_report(bench_name, count, ec_bench_now() - start);
+
+	return 0;
+}
+
+int main(void)
+{
+	struct ec_nameset *set = NULL;
+	struct ec_node *node = NULL;
+	int ret = EXIT_FAILURE;
+	char name[32];
+	uint64_t start;
+	size_t i;
+
+	if (ec_init() < 0)
+		goto out;
+
+	node = ec_node_dynlist(EC_NO_ID, get_names, NULL, "vrf[0-9]+", DYNLIST_MATCH_LIST);
+	if (node == NULL)
+		goto out;
+	if (bench_node("strvec callback", node, 10) < 0)
+		goto out;
+	ec_node_free(node);
+	node = NULL;
+
+	start = ec_bench_now();
+	set = ec_nameset();
+	if (set == NULL)
+		goto out;
+	for (i = 0; i < N_NAMES; i++) {
+		snprintf(name, sizeof(name), "vrf%zu", i);
+		if (ec_nameset_add(set, name) < 0)
+			goto out;
+	}
+	ec_nameset_len(set); /* sort */
+	ec_bench_report("fill name set", 1, ec_bench_now() - start);
+
+	node = ec_node_dynlist_nameset(EC_NO_ID, set, "vrf[0-9]+", DYNLIST_MATCH_LIST);
+	if (node == NULL)
+		goto out;
+	if (bench_node("name set", node, 10000) < 0)
+		goto out;
+
+	ret = EXIT_SUCCESS;
+
+out:
+	ec_node_free(node);
+	ec_nameset_free(set);
+	ec_exit();
+	return ret;
+}
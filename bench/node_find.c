@@ -0,0 +1,115 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2025, Olivier MATZ <zer0@droids-corp.org>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench.h"
+
+/* about 5 nodes per command */
+#define N_CMDS 2000
+#define COUNT 1000
+
+/* "show<i> interface <int>", the int having the id "ifindex<i>" */
+static struct ec_node *build_grammar(unsigned int count)
+{
+	struct ec_node *root, *cmd;
+	char name[32], id[32];
+	unsigned int i;
+
+	root = ec_node_or(EC_NO_ID);
+	if (root == NULL)
+		return NULL;
+	for (i = 0; i < count; i++) {
+		snprintf(name, sizeof(name), "show%u", i);
+		snprintf(id, sizeof(id), "ifindex%u", i);
+		cmd = EC_NODE_SEQ(
+			EC_NO_ID,
+			ec_node_str(EC_NO_ID, name),
+			ec_node_str(EC_NO_ID, "interface"),
+			ec_node_int(id, 0, 65535, 10)
+		);
+		if (ec_node_or_add(root, cmd) < 0) {
+			ec_node_free(root);
+			return NULL;
+		}
+	}
+
+	return root;
+}
+
+static int bench_find(struct ec_node *root, const char *id, unsigned int count)
+{
+	char desc[64];
+	uint64_t start;
+	unsigned int i;
+
+	start = ec_bench_now();
+	for (i = 0; i < count; i++) {
+		if (ec_node_find(root, id) == NULL)
+			return -1;
+	}
+	snprintf(desc, sizeof(desc), "find %s", id);
+	ec_bench_report(desc, count, ec_bench_now() - start);
+
+	return 0;
+}
+
+static int bench_index(struct ec_node *root, const char *id, unsigned int count)
+{
+	struct ec_node_index *index;
+	char desc[64];
+	uint64_t start;
+	unsigned int i;
+
+	start = ec_bench_now();
+	index = ec_node_index(root);
+	if (index == NULL)
+		return -1;
+	ec_bench_report("build index", 1, ec_bench_now() - start);
+
+	start = ec_bench_now();
+	for (i = 0; i < count; i++) {
+		if (ec_node_index_find(index, id) == NULL) {
+			ec_node_index_free(index);
+			return -1;
+		}
+	}
+	snprintf(desc, sizeof(desc), "find %s in index", id);
+	ec_bench_report(desc, count, ec_bench_now() - start);
+
+	ec_node_index_free(index);
+
+	return 0;
+}
+
+int main(void)
+{
+	struct ec_node *root = NULL;
+	int ret = EXIT_FAILURE;
+	char id[32];
+
+	if (ec_init() < 0)
+		goto out;
+
+	root = build_grammar(N_CMDS);
+	if (root == NULL)
+		goto out;
+
+	/* the last node of the grammar */
+	snprintf(id, sizeof(id), "ifindex%u", N_CMDS - 1);
+	if (bench_find(root, "ifindex0", COUNT) < 0)
+		goto out;
+	if (bench_find(root, id, COUNT) < 0)
+		goto out;
+	if (bench_index(root, id, COUNT) < 0)
+		goto out;
+
+	ret = EXIT_SUCCESS;
+
+out:
+	ec_node_free(root);
+	ec_exit();
+	return ret;
+}
@@ -0,0 +1,100 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2025, Olivier MATZ <zer0@droids-corp.org>
+ */
+
+#include <malloc.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench.h"
+
+/* 10 nodes per command */
+#define N_CMDS 10000
+
+#define IP_RE "[0-9]{1,3}\\.[0-9]{1,3}\\.[0-9]{1,3}\\.[0-9]{1,3}"
+
+static struct ec_node *intern(struct ec_node *node, bool enabled)
+{
+	if (!enabled)
+		return node;
+	return ec_node_intern(node);
+}
+
+/* "vlan<i> [detail|brief] <vlan-id> ip <ip> up" */
+static struct ec_node *build_cmd(unsigned int i, bool enabled)
+{
+	char name[32];
+
+	snprintf(name, sizeof(name), "vlan%u", i);
+
+	return EC_NODE_SEQ(
+		EC_NO_ID,
+		ec_node_str(EC_NO_ID, name),
+		intern(
+			ec_node_option(
+				EC_NO_ID,
+				intern(
+					EC_NODE_OR(
+						EC_NO_ID,
+						intern(ec_node_str(EC_NO_ID, "detail"), enabled),
+						intern(ec_node_str(EC_NO_ID, "brief"), enabled)
+					),
+					enabled
+				)
+			),
+			enabled
+		),
+		intern(ec_node_int("vlan-id", 0, 4094, 10), enabled),
+		intern(ec_node_str(EC_NO_ID, "ip"), enabled),
+		intern(ec_node_re("ip", IP_RE), enabled),
+		intern(ec_node_str(EC_NO_ID, "up"), enabled)
+	);
+}
+
+static int bench_build(unsigned int count, bool enabled)
+{
+	struct ec_node *root;
+	size_t mem_start;
+	uint64_t start;
+	unsigned int i;
+	char name[64];
+
+	mem_start = mallinfo2().uordblks;
+	start = ec_bench_now();
+	root = ec_node_or(EC_NO_ID);
+	if (root == NULL)
+		return -1;
+	for (i = 0; i < count; i++) {
+		if (ec_node_or_add(root, build_cmd(i, enabled)) < 0) {
+			ec_node_free(root);
+			return -1;
+		}
+	}
+	snprintf(name, sizeof(name), "build %u nodes%s", count * 10, enabled ? " (interned)" : "");
+	ec_bench_report(name, count, ec_bench_now() - start);
+	printf("%-40s %8zu KB\n", "  memory", (mallinfo2().uordblks - mem_start) / 1024);
+
+	ec_node_free(root);
+
+	return 0;
+}
+
+int main(void)
+{
+	int ret = EXIT_FAILURE;
+
+	if (ec_init() < 0)
+		goto out;
+
+	if (bench_build(N_CMDS, false) < 0)
+		goto out;
+	if (bench_build(N_CMDS, true) < 0)
+		goto out;
+
+	ret = EXIT_SUCCESS;
+
+out:
+	ec_exit();
+	return ret;
+}
@@ -0,0 +1,116 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2025, Olivier MATZ <zer0@droids-corp.org>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench.h"
+
+#define N_KEYWORDS 2000
+
+static char keywords[N_KEYWORDS][16];
+
+static struct ec_node *build_or(void)
+{
+	struct ec_node *or;
+	size_t i;
+
+	or = ec_node("or", EC_NO_ID);
+	if (or == NULL)
+		return NULL;
+
+	for (i = 0; i < N_KEYWORDS; i++) {
+		if (ec_node_or_add(or, ec_node_str(EC_NO_ID, keywords[i])) < 0) {
+			ec_node_free(or);
+			return NULL;
+		}
+	}
+
+	return or;
+}
+
+static struct ec_node *build_keywords(void)
+{
+	const char *table[N_KEYWORDS];
+	size_t i;
+
+	for (i = 0; i < N_KEYWORDS; i++)
+		table[i] = keywords[i];
+
+	return ec_node_keywords(EC_NO_ID, table, N_KEYWORDS, false);
+}
+
+static int bench_node(const char *name, struct ec_node *(*build)(void), unsigned int count)
+{
+	struct ec_node *node = NULL;
+	struct ec_pnode *pnode;
+	struct ec_comp *comp;
+	char bench_name[64];
+	uint64_t start;
+	unsigned int n;
+	int ret = -1;
+
+	start = ec_bench_now();
+	node = build();
+	if (node == NULL)
+		goto out;
+	snprintf(bench_name, sizeof(bench_name), "build %s", name);
+	ec_bench_report(bench_name, 1, ec_bench_now() - start);
+
+	start = ec_bench_now();
+	for (n = 0; n < count; n++) {
+		pnode = ec_parse(node, keywords[n % N_KEYWORDS]);
+		if (pnode == NULL || !ec_pnode_matches(pnode)) {
+			ec_pnode_free(pnode);
+			goto out;
+		}
+		ec_pnode_free(pnode);
+	}
+	snprintf(bench_name, sizeof(bench_name), "parse %s", name);
+	ec_bench_report(bench_name, count, ec_bench_now() - start);
+
+	start = ec_bench_now();
+	for (n = 0; n < count; n++) {
+		/* the first 3 chars are shared by 20 keywords */
+		keywords[n % N_KEYWORDS][3] = '\0';
+		comp = ec_complete(node, keywords[n % N_KEYWORDS]);
+		keywords[n % N_KEYWORDS][3] = 'x';
+		if (comp == NULL || ec_comp_count(comp, EC_COMP_FULL) != 20) {
+			ec_comp_free(comp);
+			goto out;
+		}
+		ec_comp_free(comp);
+	}
+	snprintf(bench_name, sizeof(bench_name), "complete %s", name);
+	ec_bench_report(bench_name, count, ec_bench_now() - start);
+
+	ret = 0;
+
+out:
+	ec_node_free(node);
+	return ret;
+}
+
+int main(void)
+{
+	int ret = EXIT_FAILURE;
+	size_t i;
+
+	if (ec_init() < 0)
+		goto out;
+
+	for (i = 0; i < N_KEYWORDS; i++)
+		snprintf(keywords[i], sizeof(keywords[i]), "k%02zux%zu", i % 100, i / 100);
+
+	if (bench_node("or of 2000 str", build_or, 1000) < 0)
+		goto out;
+	if (bench_node("2000 keywords", build_keywords, 1000) < 0)
+		goto out;
+
+	ret = EXIT_SUCCESS;
+
+out:
+	ec_exit();
+	return ret;
+}
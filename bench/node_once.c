@@ -0,0 +1,115 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2025, Olivier MATZ <zer0@droids-corp.org>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench.h"
+
+/* many(or(once(seq("optN", any)), ...)): each option can be given once */
+static struct ec_node *build_options(size_t n)
+{
+	struct ec_node *or, *option;
+	char name[32];
+	size_t i;
+
+	or = ec_node_or(EC_NO_ID);
+	if (or == NULL)
+		return NULL;
+
+	for (i = 0; i < n; i++) {
+		snprintf(name, sizeof(name), "opt%zu", i);
+		option = EC_NODE_SEQ(
+			EC_NO_ID, ec_node_str(EC_NO_ID, name), ec_node_any(EC_NO_ID, NULL)
+		);
+		option = ec_node_once(EC_NO_ID, option);
+		if (ec_node_or_add(or, option) < 0) {
+			ec_node_free(or);
+			return NULL;
+		}
+	}
+
+	return ec_node_many(EC_NO_ID, or, 0, 0);
+}
+
+static int bench_options(size_t n, unsigned int count)
+{
+	struct ec_strvec *line = NULL;
+	struct ec_node *node = NULL;
+	struct ec_pnode *pnode;
+	struct ec_comp *comp;
+	char name[64];
+	uint64_t start;
+	unsigned int i;
+	int ret = -1;
+
+	node = build_options(n);
+	if (node == NULL)
+		goto out;
+
+	/* all the options, in reverse order */
+	line = ec_strvec();
+	if (line == NULL)
+		goto out;
+	for (i = n; i > 0; i--) {
+		snprintf(name, sizeof(name), "opt%u", i - 1);
+		if (ec_strvec_add(line, name) < 0 || ec_strvec_add(line, "value") < 0)
+			goto out;
+	}
+
+	start = ec_bench_now();
+	for (i = 0; i < count; i++) {
+		pnode = ec_parse_strvec(node, line);
+		if (pnode == NULL)
+			goto out;
+		if (ec_pnode_len(pnode) != 2 * n) {
+			fprintf(stderr, "line does not match\n");
+			ec_pnode_free(pnode);
+			goto out;
+		}
+		ec_pnode_free(pnode);
+	}
+	snprintf(name, sizeof(name), "parse %zu options", n);
+	ec_bench_report(name, count, ec_bench_now() - start);
+
+	if (ec_strvec_add(line, "") < 0)
+		goto out;
+
+	start = ec_bench_now();
+	for (i = 0; i < count; i++) {
+		comp = ec_complete_strvec(node, line);
+		if (comp == NULL)
+			goto out;
+		ec_comp_free(comp);
+	}
+	snprintf(name, sizeof(name), "complete %zu options", n);
+	ec_bench_report(name, count, ec_bench_now() - start);
+
+	ret = 0;
+
+out:
+	ec_strvec_free(line);
+	ec_node_free(node);
+	return ret;
+}
+
+int main(void)
+{
+	int ret = EXIT_FAILURE;
+	size_t n;
+
+	if (ec_init() < 0)
+		goto out;
+
+	for (n = 25; n <= 200; n *= 2) {
+		if (bench_options(n, 10) < 0)
+			goto out;
+	}
+
+	ret = EXIT_SUCCESS;
+
+out:
+	ec_exit();
+	return ret;
+}
@@ -0,0 +1,164 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2025, Olivier MATZ <zer0@droids-corp.org>
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench.h"
+
+#define N_CMDS 20
+#define N_ITER 20000
+
+static struct ec_node *str_or(const char *const *strs)
+{
+	struct ec_node *node;
+	unsigned int i;
+
+	node = ec_node_or(EC_NO_ID);
+	for (i = 0; node != NULL && strs[i] != NULL; i++) {
+		if (ec_node_or_add(node, ec_node_str(EC_NO_ID, strs[i])) < 0) {
+			ec_node_free(node);
+			return NULL;
+		}
+	}
+
+	return node;
+}
+
+/*
+ * A command as a code generator would build it, wrapping each element:
+ * "ip<i> (add|del|...) [detail|brief|...] (NUM|all|none|any)
+ * [(up|down|auto) [verbose]]"
+ */
+static struct ec_node *build_cmd(unsigned int i)
+{
+	static const char *const actions[] = {
+		"add", "del", "show", "list", "flush", "set", "get", "reset", NULL,
+	};
+	static const char *const formats[] = {"detail", "brief", "full", "json", "xml", NULL};
+	static const char *const targets[] = {"all", "none", "any", NULL};
+	static const char *const states[] = {"up", "down", "auto", NULL};
+	char name[32];
+
+	snprintf(name, sizeof(name), "ip%u", i);
+
+	return EC_NODE_SEQ(
+		EC_NO_ID,
+		ec_node_str(EC_NO_ID, name),
+		EC_NODE_SEQ(EC_NO_ID, str_or(actions)),
+		ec_node_option(
+			EC_NO_ID,
+			ec_node_option(EC_NO_ID, EC_NODE_SEQ(EC_NO_ID, str_or(formats)))
+		),
+		ec_node_bypass(
+			EC_NO_ID,
+			EC_NODE_OR(EC_NO_ID, ec_node_int("NUM", 0, 1000, 10), str_or(targets))
+		),
+		ec_node_option(
+			EC_NO_ID,
+			EC_NODE_SEQ(
+				EC_NO_ID,
+				EC_NODE_SEQ(EC_NO_ID, str_or(states)),
+				ec_node_option(EC_NO_ID, ec_node_str(EC_NO_ID, "verbose"))
+			)
+		)
+	);
+}
+
+static struct ec_node *build_grammar(void)
+{
+	struct ec_node *root;
+	unsigned int i;
+
+	root = ec_node_or(EC_NO_ID);
+	if (root == NULL)
+		return NULL;
+
+	for (i = 0; i < N_CMDS; i++) {
+		if (ec_node_or_add(root, build_cmd(i)) < 0) {
+			ec_node_free(root);
+			return NULL;
+		}
+	}
+
+	return root;
+}
+
+static int bench_grammar(bool optimize)
+{
+	struct ec_strvec *parse_vec = NULL, *comp_vec = NULL;
+	struct ec_node *node;
+	struct ec_pnode *pnode;
+	struct ec_comp *comp;
+	const char *suffix;
+	char name[64];
+	uint64_t start;
+	unsigned int i;
+	int ret = -1;
+
+	node = build_grammar();
+	if (optimize) {
+		start = ec_bench_now();
+		node = ec_node_optimize(node);
+		ec_bench_report("optimize grammar", 1, ec_bench_now() - start);
+	}
+	if (node == NULL)
+		return -1;
+	suffix = optimize ? " (optimized)" : "";
+
+	parse_vec = EC_STRVEC("ip15", "reset", "xml", "any", "auto", "verbose");
+	comp_vec = EC_STRVEC("ip15", "reset", "");
+	if (parse_vec == NULL || comp_vec == NULL)
+		goto out;
+
+	start = ec_bench_now();
+	for (i = 0; i < N_ITER; i++) {
+		pnode = ec_parse_strvec(node, parse_vec);
+		if (pnode == NULL || !ec_pnode_matches(pnode)) {
+			ec_pnode_free(pnode);
+			goto out;
+		}
+		ec_pnode_free(pnode);
+	}
+	snprintf(name, sizeof(name), "parse %u cmds%s", N_CMDS, suffix);
+	ec_bench_report(name, N_ITER, ec_bench_now() - start);
+
+	start = ec_bench_now();
+	for (i = 0; i < N_ITER; i++) {
+		comp = ec_complete_strvec(node, comp_vec);
+		if (comp == NULL)
+			goto out;
+		ec_comp_free(comp);
+	}
+	snprintf(name, sizeof(name), "complete %u cmds%s", N_CMDS, suffix);
+	ec_bench_report(name, N_ITER, ec_bench_now() - start);
+
+	ret = 0;
+
+out:
+	ec_strvec_free(parse_vec);
+	ec_strvec_free(comp_vec);
+	ec_node_free(node);
+	return ret;
+}
+
+int main(void)
+{
+	int ret = EXIT_FAILURE;
+
+	if (ec_init() < 0)
+		goto out;
+
+	if (bench_grammar(false) < 0)
+		goto out;
+	if (bench_grammar(true) < 0)
+		goto out;
+
+	ret = EXIT_SUCCESS;
+
+out:
+	ec_exit();
+	return ret;
+}
@@ -0,0 +1,114 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2025, Olivier MATZ <zer0@droids-corp.org>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+
+#define IP_REGEXP                                                                                  \
+	"((25[0-5]|2[0-4][0-9]|1[0-9][0-9]|[1-9][0-9]|[0-9])\\.){3}(25[0-5]|2[0-4][0-9]|1[0-9][0-" \
+	"9]|[1-9][0-9]|[0-9])"
+#define MAC_REGEXP "([0-9a-fA-F]{2}:){5}[0-9a-fA-F]{2}"
+
+static int bench_re(const char *pattern, const char *input, unsigned int count)
+{
+	struct ec_node *node = NULL;
+	struct ec_pnode *p;
+	char name[64];
+	uint64_t start;
+	unsigned int i;
+	int ret = -1;
+
+	node = ec_node_re(EC_NO_ID, pattern);
+	if (node == NULL)
+		goto out;
+
+	start = ec_bench_now();
+	for (i = 0; i < count; i++) {
+		p = ec_parse(node, input);
+		if (p == NULL)
+			goto out;
+		ec_pnode_free(p);
+	}
+	snprintf(name, sizeof(name), "parse re <%s>", input);
+	ec_bench_report(name, count, ec_bench_now() - start);
+
+	ret = 0;
+
+out:
+	ec_node_free(node);
+	return ret;
+}
+
+/* a lexer with a few patterns on a long line of words */
+static int bench_re_lex(size_t words, unsigned int count)
+{
+	struct ec_node *node = NULL;
+	struct ec_pnode *p;
+	char *line = NULL;
+	char name[64];
+	uint64_t start;
+	unsigned int i;
+	int ret = -1;
+
+	node = ec_node_re_lex(EC_NO_ID, ec_node_many(EC_NO_ID, ec_node_any(EC_NO_ID, NULL), 0, 0));
+	if (node == NULL)
+		goto out;
+	if (ec_node_re_lex_add(node, "[0-9]+", 1, NULL) < 0)
+		goto out;
+	if (ec_node_re_lex_add(node, "[a-zA-Z]+", 1, NULL) < 0)
+		goto out;
+	if (ec_node_re_lex_add(node, "[ \t]+", 0, NULL) < 0)
+		goto out;
+
+	line = calloc(words, 8);
+	if (line == NULL)
+		goto out;
+	for (i = 0; i < words; i++)
+		strcat(line, i == 0 ? "word" : " word");
+
+	start = ec_bench_now();
+	for (i = 0; i < count; i++) {
+		p = ec_parse(node, line);
+		if (p == NULL)
+			goto out;
+		ec_pnode_free(p);
+	}
+	snprintf(name, sizeof(name), "parse re_lex, %zu words", words);
+	ec_bench_report(name, count, ec_bench_now() - start);
+
+	ret = 0;
+
+out:
+	free(line);
+	ec_node_free(node);
+	return ret;
+}
+
+int main(void)
+{
+	int ret = EXIT_FAILURE;
+
+	if (ec_init() < 0)
+		goto out;
+
+	if (bench_re(IP_REGEXP, "192.168.100.254", 100000) < 0)
+		goto out;
+	if (bench_re(IP_REGEXP, "192.168.100.256", 100000) < 0)
+		goto out;
+	if (bench_re(MAC_REGEXP, "00:1b:21:3a:4f:9c", 100000) < 0)
+		goto out;
+	if (bench_re_lex(10, 10000) < 0)
+		goto out;
+	if (bench_re_lex(1000, 100) < 0)
+		goto out;
+
+	ret = EXIT_SUCCESS;
+
+out:
+	ec_exit();
+	return ret;
+}
@@ -0,0 +1,94 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2025, Olivier MATZ <zer0@droids-corp.org>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench.h"
+
+#define SEQ_LEN 15
+
+/* "cmd" followed by optional arguments, like a long command */
+static struct ec_node *build_seq(void)
+{
+	struct ec_node *seq, *arg;
+	size_t i;
+
+	seq = EC_NODE_SEQ(EC_NO_ID, ec_node_str(EC_NO_ID, "cmd"));
+	if (seq == NULL)
+		return NULL;
+
+	for (i = 1; i < SEQ_LEN; i++) {
+		arg = ec_node_option(EC_NO_ID, ec_node_any(EC_NO_ID, NULL));
+		if (ec_node_seq_add(seq, arg) < 0) {
+			ec_node_free(seq);
+			return NULL;
+		}
+	}
+
+	return seq;
+}
+
+static int bench_seq(size_t args, unsigned int count)
+{
+	struct ec_strvec *line = NULL;
+	struct ec_node *node = NULL;
+	struct ec_comp *comp;
+	char name[64];
+	uint64_t start;
+	unsigned int i;
+	int ret = -1;
+
+	node = build_seq();
+	if (node == NULL)
+		goto out;
+
+	line = EC_STRVEC("cmd");
+	if (line == NULL)
+		goto out;
+	for (i = 0; i < args; i++) {
+		snprintf(name, sizeof(name), "arg%u", i);
+		if (ec_strvec_add(line, name) < 0)
+			goto out;
+	}
+	if (ec_strvec_add(line, "") < 0)
+		goto out;
+
+	start = ec_bench_now();
+	for (i = 0; i < count; i++) {
+		comp = ec_complete_strvec(node, line);
+		if (comp == NULL)
+			goto out;
+		ec_comp_free(comp);
+	}
+	snprintf(name, sizeof(name), "complete seq of %d, %zu args", SEQ_LEN, args);
+	ec_bench_report(name, count, ec_bench_now() - start);
+
+	ret = 0;
+
+out:
+	ec_strvec_free(line);
+	ec_node_free(node);
+	return ret;
+}
+
+int main(void)
+{
+	int ret = EXIT_FAILURE;
+	size_t args;
+
+	if (ec_init() < 0)
+		goto out;
+
+	for (args = 0; args < SEQ_LEN; args += 2) {
+		if (bench_seq(args, 10) < 0)
+			goto out;
+	}
+
+	ret = EXIT_SUCCESS;
+
+out:
+	ec_exit();
+	return ret;
+}
@@ -0,0 +1,102 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2025, Olivier MATZ <zer0@droids-corp.org>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench.h"
+
+/* a subset of n optional filters, like "filterN <value>" */
+static struct ec_node *build_subset(size_t n)
+{
+	struct ec_node *subset, *filter;
+	char name[32];
+	size_t i;
+
+	subset = ec_node_subset(EC_NO_ID);
+	if (subset == NULL)
+		return NULL;
+
+	for (i = 0; i < n; i++) {
+		snprintf(name, sizeof(name), "filter%zu", i);
+		filter = ec_node_option(
+			EC_NO_ID,
+			EC_NODE_SEQ(EC_NO_ID, ec_node_str(EC_NO_ID, name), ec_node_any(EC_NO_ID, NULL))
+		);
+		if (ec_node_subset_add(subset, filter) < 0) {
+			ec_node_free(subset);
+			return NULL;
+		}
+	}
+
+	return subset;
+}
+
+static int bench_subset(size_t n, unsigned int count)
+{
+	struct ec_strvec *line = NULL;
+	struct ec_node *node = NULL;
+	struct ec_pnode *pnode;
+	struct ec_comp *comp;
+	char name[64];
+	uint64_t start;
+	unsigned int i;
+	int ret = -1;
+
+	node = build_subset(n);
+	if (node == NULL)
+		goto out;
+
+	/* a valid filter followed by a bad token */
+	line = EC_STRVEC("filter0", "value", "bad");
+	if (line == NULL)
+		goto out;
+
+	start = ec_bench_now();
+	for (i = 0; i < count; i++) {
+		pnode = ec_parse_strvec(node, line);
+		if (pnode == NULL)
+			goto out;
+		ec_pnode_free(pnode);
+	}
+	snprintf(name, sizeof(name), "parse subset of %zu", n);
+	ec_bench_report(name, count, ec_bench_now() - start);
+
+	start = ec_bench_now();
+	for (i = 0; i < count; i++) {
+		comp = ec_complete_strvec(node, line);
+		if (comp == NULL)
+			goto out;
+		ec_comp_free(comp);
+	}
+	snprintf(name, sizeof(name), "complete subset of %zu", n);
+	ec_bench_report(name, count, ec_bench_now() - start);
+
+	ret = 0;
+
+out:
+	ec_strvec_free(line);
+	ec_node_free(node);
+	return ret;
+}
+
+int main(void)
+{
+	int ret = EXIT_FAILURE;
+	size_t n;
+
+	if (ec_init() < 0)
+		goto out;
+
+	for (n = 4; n <= 16; n += 2) {
+		if (bench_subset(n, 10) < 0)
+			goto out;
+	}
+
+	ret = EXIT_SUCCESS;
+
+out:
+	ec_exit();
+	return ret;
+}
@@ -0,0 +1,58 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2025, Olivier MATZ <zer0@droids-corp.org>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench.h"
+
+#define COUNT 1000000
+
+static int bench_lookup(const char *name, unsigned int count)
+{
+	char desc[64];
+	uint64_t start;
+	unsigned int i;
+
+	start = ec_bench_now();
+	for (i = 0; i < count; i++) {
+		if (ec_node_type_lookup(name) == NULL)
+			return -1;
+	}
+	snprintf(desc, sizeof(desc), "lookup node type %s", name);
+	ec_bench_report(desc, count, ec_bench_now() - start);
+
+	return 0;
+}
+
+int main(void)
+{
+	struct ec_node_type *type, *first = NULL, *last = NULL;
+	int ret = EXIT_FAILURE;
+
+	if (ec_init() < 0)
+		goto out;
+
+	TAILQ_FOREACH (type, &node_type_list, next) {
+		if (first == NULL)
+			first = type;
+		last = type;
+	}
+	if (first == NULL)
+		goto out;
+
+	/* the first and the last types of the registration list */
+	if (bench_lookup(first->name, COUNT) < 0)
+		goto out;
+	if (bench_lookup(last->name, COUNT) < 0)
+		goto out;
+	if (bench_lookup("seq", COUNT) < 0)
+		goto out;
+
+	ret = EXIT_SUCCESS;
+
+out:
+	ec_exit();
+	return ret;
+}
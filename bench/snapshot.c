@@ -0,0 +1,209 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2025, Olivier MATZ <zer0@droids-corp.org>
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "bench.h"
+
+#define CMD_COUNT 2000
+
+/*
+ * Build a CLI of CMD_COUNT commands sharing some nodes, either with cmd
+ * nodes, or with the equivalent seq/or/option/many nodes.
+ */
+static struct ec_node *build_grammar(bool use_cmd)
+{
+	struct ec_node *root = NULL, *name = NULL, *num = NULL, *cmd;
+	char cmd_str[128];
+	unsigned int i;
+
+	root = ec_node("or", EC_NO_ID);
+	name = ec_node_re("NAME", "[a-zA-Z][a-zA-Z0-9_-]*");
+	num = ec_node_int("NUM", 0, 65535, 10);
+	if (root == NULL || name == NULL || num == NULL)
+		goto fail;
+	if (ec_interact_set_help(num, "A number.") < 0)
+		goto fail;
+
+	for (i = 0; i < CMD_COUNT; i++) {
+		if (use_cmd) {
+			snprintf(
+				cmd_str,
+				sizeof(cmd_str),
+				"show%u interface NAME [detail|brief] (up|down|all)* [vlan NUM]",
+				i
+			);
+			cmd = EC_NODE_CMD(
+				EC_NO_ID, cmd_str, ec_node_clone(name), ec_node_clone(num)
+			);
+		} else {
+			snprintf(cmd_str, sizeof(cmd_str), "show%u", i);
+			cmd = EC_NODE_SEQ(
+				EC_NO_ID,
+				ec_node_str(EC_NO_ID, cmd_str),
+				ec_node_str(EC_NO_ID, "interface"),
+				ec_node_clone(name),
+				ec_node_option(
+					EC_NO_ID,
+					EC_NODE_OR(
+						EC_NO_ID,
+						ec_node_str(EC_NO_ID, "detail"),
+						ec_node_str(EC_NO_ID, "brief")
+					)
+				),
+				ec_node_many(
+					EC_NO_ID,
+					EC_NODE_OR(
+						EC_NO_ID,
+						ec_node_str(EC_NO_ID, "up"),
+						ec_node_str(EC_NO_ID, "down"),
+						ec_node_str(EC_NO_ID, "all")
+					),
+					0,
+					0
+				),
+				ec_node_option(
+					EC_NO_ID,
+					EC_NODE_SEQ(
+						EC_NO_ID,
+						ec_node_str(EC_NO_ID, "vlan"),
+						ec_node_clone(num)
+					)
+				)
+			);
+		}
+		if (cmd == NULL)
+			goto fail;
+		if (ec_interact_set_help(cmd, "Show something.") < 0) {
+			ec_node_free(cmd);
+			goto fail;
+		}
+		if (ec_node_or_add(root, cmd) < 0)
+			goto fail;
+	}
+
+	ec_node_free(name);
+	ec_node_free(num);
+	return root;
+
+fail:
+	ec_node_free(root);
+	ec_node_free(name);
+	ec_node_free(num);
+	return NULL;
+}
+
+static FILE *open_tmp(char *path)
+{
+	FILE *f;
+	int fd;
+
+	fd = mkstemp(path);
+	if (fd < 0)
+		return NULL;
+	f = fdopen(fd, "w");
+	if (f == NULL) {
+		close(fd);
+		unlink(path);
+	}
+	return f;
+}
+
+/* Import a grammar, not including the time to free it. */
+static int bench_one(const char *name, const char *path, bool snapshot, unsigned int count)
+{
+	struct ec_node *node;
+	uint64_t start, total = 0;
+	unsigned int i;
+
+	for (i = 0; i < count; i++) {
+		start = ec_bench_now();
+		if (snapshot)
+			node = ec_snapshot_import(path);
+		else
+			node = ec_yaml_import(path);
+		total += ec_bench_now() - start;
+		if (node == NULL)
+			return -1;
+		ec_node_free(node);
+	}
+	ec_bench_report(name, count, total);
+
+	return 0;
+}
+
+static int bench_import(bool use_cmd, unsigned int count)
+{
+	char yaml_path[] = "/tmp/ecoli_bench_yaml_XXXXXX";
+	char snap_path[] = "/tmp/ecoli_bench_snap_XXXXXX";
+	FILE *yaml = NULL, *snap = NULL;
+	struct ec_node *node;
+	char name[64];
+	uint64_t start;
+	int ret = -1;
+
+	node = build_grammar(use_cmd);
+	if (node == NULL)
+		goto out;
+
+	yaml = open_tmp(yaml_path);
+	if (yaml == NULL)
+		goto out;
+	if (ec_yaml_export(yaml, node) < 0)
+		goto out;
+	fclose(yaml);
+	yaml = NULL;
+
+	snap = open_tmp(snap_path);
+	if (snap == NULL)
+		goto out;
+	start = ec_bench_now();
+	if (ec_snapshot_export(snap, node) < 0)
+		goto out;
+	snprintf(name, sizeof(name), "snapshot export, %s", use_cmd ? "cmd" : "seq");
+	ec_bench_report(name, 1, ec_bench_now() - start);
+	fclose(snap);
+	snap = NULL;
+
+	snprintf(name, sizeof(name), "yaml import, %s", use_cmd ? "cmd" : "seq");
+	if (bench_one(name, yaml_path, false, count) < 0)
+		goto out;
+	snprintf(name, sizeof(name), "snapshot import, %s", use_cmd ? "cmd" : "seq");
+	if (bench_one(name, snap_path, true, count) < 0)
+		goto out;
+
+	ret = 0;
+
+out:
+	if (yaml != NULL)
+		fclose(yaml);
+	if (snap != NULL)
+		fclose(snap);
+	unlink(yaml_path);
+	unlink(snap_path);
+	ec_node_free(node);
+	return ret;
+}
+
+int main(void)
+{
+	int ret = EXIT_FAILURE;
+
+	if (ec_init() < 0)
+		goto out;
+
+	if (bench_import(false, 10) < 0)
+		goto out;
+	if (bench_import(true, 10) < 0)
+		goto out;
+
+	ret = EXIT_SUCCESS;
+
+out:
+	ec_exit();
+	return ret;
+}
@@ -0,0 +1,89 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2025, Olivier MATZ <zer0@droids-corp.org>
+ */
+
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+
+#include "bench.h"
+
+#define COUNT 200
+
+extern char **environ;
+
+/* what a small command line tool does: init, build its grammar, parse */
+static int first_parse(void)
+{
+	struct ec_node *node = NULL;
+	struct ec_pnode *p = NULL;
+	int ret = -1;
+
+	if (ec_init() < 0)
+		goto out;
+
+	node = ec_node_sh_lex(
+		EC_NO_ID,
+		EC_NODE_SEQ(
+			EC_NO_ID,
+			ec_node_str(EC_NO_ID, "show"),
+			EC_NODE_OR(
+				EC_NO_ID,
+				ec_node_str(EC_NO_ID, "interface"),
+				ec_node_str(EC_NO_ID, "route")
+			),
+			ec_node_option(EC_NO_ID, ec_node_int(EC_NO_ID, 0, 100, 10))
+		)
+	);
+	if (node == NULL)
+		goto out;
+
+	p = ec_parse(node, "show route 42");
+	if (p == NULL || !ec_pnode_matches(p))
+		goto out;
+
+	ret = 0;
+
+out:
+	ec_pnode_free(p);
+	ec_node_free(node);
+	ec_exit();
+	return ret;
+}
+
+/* time from process start to the end of the first parse, including
+ * the loading of the library and the registration of node types */
+static int bench_startup(const char *prog, unsigned int count)
+{
+	char *argv[] = {(char *)prog, "child", NULL};
+	uint64_t start;
+	unsigned int i;
+	int status;
+	pid_t pid;
+
+	start = ec_bench_now();
+	for (i = 0; i < count; i++) {
+		if (posix_spawn(&pid, "/proc/self/exe", NULL, NULL, argv, environ) != 0)
+			return -1;
+		if (waitpid(pid, &status, 0) < 0)
+			return -1;
+		if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+			return -1;
+	}
+	ec_bench_report("start process and parse a command", count, ec_bench_now() - start);
+
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc == 2 && !strcmp(argv[1], "child"))
+		return first_parse() < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+
+	if (bench_startup(argv[0], COUNT) < 0)
+		return EXIT_FAILURE;
+
+	return EXIT_SUCCESS;
+}
@@ -14,6 +14,7 @@
 #include <ecoli/interact.h>
 #include <ecoli/log.h>
 #include <ecoli/murmurhash.h>
+#include <ecoli/nameset.h>
 #include <ecoli/node.h>
 #include <ecoli/node_any.h>
 #include <ecoli/node_bypass.h>
@@ -26,9 +27,12 @@
 #include <ecoli/node_file.h>
 #include <ecoli/node_helper.h>
 #include <ecoli/node_int.h>
+#include <ecoli/node_intern.h>
+#include <ecoli/node_keywords.h>
 #include <ecoli/node_many.h>
 #include <ecoli/node_none.h>
 #include <ecoli/node_once.h>
+#include <ecoli/node_optimize.h>
 #include <ecoli/node_option.h>
 #include <ecoli/node_or.h>
 #include <ecoli/node_re.h>
@@ -39,6 +43,7 @@
 #include <ecoli/node_str.h>
 #include <ecoli/node_subset.h>
 #include <ecoli/parse.h>
+#include <ecoli/snapshot.h>
 #include <ecoli/string.h>
 #include <ecoli/strvec.h>
 #include <ecoli/utils.h>
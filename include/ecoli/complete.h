@@ -21,6 +21,10 @@
  * lists the possible completions. The completions are grouped into
  * ::ec_comp_group. All completion items of a group share the same parsing
  * state and are issued by the same node.
+ *
+ * Interactive front-ends complete the same line again and again while it
+ * is typed. An ::ec_comp_session remembers the last result, so that only
+ * the last partial token has to be completed again when it is extended.
  */
 
 #pragma once
@@ -41,6 +45,9 @@ struct ec_comp_group;
 /** A list of completion items and groups. */
 struct ec_comp;
 
+/** An incremental completion session. */
+struct ec_comp_session;
+
 /**
  * Completion item type.
  */
@@ -102,6 +109,11 @@ struct ec_comp *ec_complete_strvec(const struct ec_node *node, const struct ec_s
  * Return a new string vector based on the provided one using completion to
  * expand non-ambiguous tokens to their full value.
  *
+ * A token is expanded when the completion of the expanded tokens located
+ * before it, followed by the token itself, returns exactly one item. The
+ * line is completed once per token, so the cost grows with the square of
+ * the number of tokens.
+ *
  * @param node
  *   The grammar graph.
  * @param type
@@ -140,6 +152,108 @@ int ec_complete_child(
 	const struct ec_strvec *strvec
 );
 
+/**
+ * Get the list of completions of a child node, from lexed tokens.
+ *
+ * This function is to be used by lexer nodes (e.g., ec_node_sh_lex())
+ * instead of ec_complete_child(), once the input is split into tokens.
+ * When the completion is done by an ::ec_comp_session and the tokens only
+ * differ from the previous ones by an extension of the last token, the
+ * previous completion groups are completed again with the new last token,
+ * without parsing the other tokens. Otherwise, it behaves like
+ * ec_complete_child().
+ *
+ * @param node
+ *   The child node.
+ * @param comp
+ *   The current completion list to be filled.
+ * @param strvec
+ *   The lexed tokens.
+ * @return
+ *   0 on success, or -1 on error (errno is set).
+ */
+int ec_complete_lexed_child(
+	const struct ec_node *node,
+	struct ec_comp *comp,
+	const struct ec_strvec *strvec
+);
+
+/**
+ * Create an incremental completion session.
+ *
+ * A session completes the input of an interactive line editor, which
+ * usually changes one character at a time. It keeps the result of the
+ * last completion: completing the same input again returns it as is, and
+ * when the last token is only extended, the completion groups of the
+ * previous result are completed again with the new token (see
+ * ec_complete_lexed_child()). Other changes trigger a full completion.
+ *
+ * This assumes that the completions of a node for a token only depend on
+ * the parsing state and on this token, and that a node that does not
+ * complete a token does not complete its extensions either. The grammar
+ * graph must not change during the session, and the nodes that depend on
+ * external data may return stale results: call ec_comp_session_reset()
+ * when this data changes.
+ *
+ * @param node
+ *   The grammar graph. It must not be freed before the session.
+ * @return
+ *   The session on success, or NULL on error (errno is set).
+ */
+struct ec_comp_session *ec_comp_session(const struct ec_node *node);
+
+/**
+ * Free a completion session and its last result.
+ *
+ * @param session
+ *   The session to free.
+ */
+void ec_comp_session_free(struct ec_comp_session *session);
+
+/**
+ * Forget the last result of a completion session.
+ *
+ * The next completion will be a full completion.
+ *
+ * @param session
+ *   The completion session.
+ */
+void ec_comp_session_reset(struct ec_comp_session *session);
+
+/**
+ * Get the list of completions from a string vector input, in a session.
+ *
+ * The result is the same as ec_complete_strvec().
+ *
+ * @param session
+ *   The completion session.
+ * @param strvec
+ *   The input string vector.
+ * @return
+ *   A pointer to the completion list on success, or NULL on error (errno
+ *   is set). It is owned by the session, and is valid until the next call
+ *   to ec_comp_session_complete_strvec(), ec_comp_session_complete(),
+ *   ec_comp_session_reset() or ec_comp_session_free().
+ */
+const struct ec_comp *
+ec_comp_session_complete_strvec(struct ec_comp_session *session, const struct ec_strvec *strvec);
+
+/**
+ * Get the list of completions from a string input, in a session.
+ *
+ * It is equivalent to calling ec_comp_session_complete_strvec() with a
+ * vector that only contains the input string.
+ *
+ * @param session
+ *   The completion session.
+ * @param str
+ *   The input string.
+ * @return
+ *   A pointer to the completion list on success, or NULL on error (errno
+ *   is set). See ec_comp_session_complete_strvec() for its lifetime.
+ */
+const struct ec_comp *ec_comp_session_complete(struct ec_comp_session *session, const char *str);
+
 /**
  * Create an empty completion object (list of completion items).
  *
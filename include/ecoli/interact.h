@@ -105,6 +105,108 @@ int ec_interact_print_cols(FILE *out, unsigned int width, char const *const *mat
  */
 char *ec_interact_append_chars(const struct ec_comp *cmpl);
 
+/**
+ * The result of the analysis of a line, see ec_interact_query().
+ */
+struct ec_interact_query;
+
+/**
+ * Analyze a line for interactive use.
+ *
+ * Parse the line once, and keep the result so that the match status, the
+ * parse tree and the error helps can be retrieved without parsing the same
+ * line again. The error helps are built from the failure report of the
+ * parser (see ec_pnode_get_failure()).
+ *
+ * The completions do not come from the same traversal: they are built by a
+ * second, full ec_complete() on the line, the first time they are needed
+ * (see ec_interact_query_get_comp() and ec_interact_query_get_helps()).
+ * This second pass is done at most once per query.
+ *
+ * @param node
+ *   The pointer to the sh_lex grammar node.
+ * @param line
+ *   The line to analyze.
+ * @return
+ *   The query result on success, to be freed by the caller with
+ *   ec_interact_query_free(), or NULL on error (errno is set).
+ */
+struct ec_interact_query *ec_interact_query(const struct ec_node *node, const char *line);
+
+/**
+ * Free the result of ec_interact_query().
+ *
+ * @param query
+ *   The query result.
+ */
+void ec_interact_query_free(struct ec_interact_query *query);
+
+/**
+ * Check if the queried line matches the grammar.
+ *
+ * @param query
+ *   The query result.
+ * @return
+ *   True if the whole line matches.
+ */
+bool ec_interact_query_matches(const struct ec_interact_query *query);
+
+/**
+ * Get the parse tree of the queried line.
+ *
+ * @param query
+ *   The query result.
+ * @return
+ *   The parse tree, owned by the query.
+ */
+struct ec_pnode *ec_interact_query_get_pnode(const struct ec_interact_query *query);
+
+/**
+ * Get the completions of the queried line.
+ *
+ * The first call runs ec_complete() on the line, which walks the grammar
+ * again independently from the parse done by ec_interact_query(). The
+ * result is kept in the query and returned by the next calls.
+ *
+ * @param query
+ *   The query result.
+ * @return
+ *   The completions, owned by the query, or NULL on error (errno is set).
+ */
+const struct ec_comp *ec_interact_query_get_comp(struct ec_interact_query *query);
+
+/**
+ * Get contextual helps from the queried line.
+ *
+ * @param query
+ *   The query result.
+ * @param helps_out
+ *   The pointer where the helps array will be returned.
+ * @return
+ *   The size of the array on success (>= 0), or -1 on error.
+ */
+ssize_t
+ec_interact_query_get_helps(struct ec_interact_query *query, struct ec_interact_help **helps_out);
+
+/**
+ * Get suggestions after a parsing error for the queried line.
+ *
+ * @param query
+ *   The query result.
+ * @param helps_out
+ *   The pointer where the helps array will be returned.
+ * @param char_idx
+ *   A pointer to an integer where the index of the error in the line string
+ *   is returned.
+ * @return
+ *   The size of the array on success (>= 0), or -1 on error.
+ */
+ssize_t ec_interact_query_get_error_helps(
+	struct ec_interact_query *query,
+	struct ec_interact_help **helps_out,
+	size_t *char_idx
+);
+
 /**
  * Get contextual helps from the current line.
  *
@@ -147,8 +249,9 @@ int ec_interact_print_helps(
 /**
  * Free contextual helps.
  *
- * Free helps generated with ec_interact_get_helps() or
- * ec_interact_get_error_helps().
+ * Free helps generated with ec_interact_get_helps(),
+ * ec_interact_get_error_helps() or the equivalent ec_interact_query
+ * functions.
  *
  * @param helps
  *   The helps array.
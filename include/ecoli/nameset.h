@@ -0,0 +1,138 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2025, Olivier MATZ <zer0@droids-corp.org>
+ */
+
+/**
+ * @defgroup ecoli_nameset Name set
+ * @{
+ *
+ * @brief A sorted set of names, searchable by prefix.
+ *
+ * A name set stores unique strings in lexicographic order, so that a name
+ * is found, and the names starting with a prefix are enumerated, with a
+ * binary search. It can be updated incrementally, and shared between
+ * several nodes using a reference counter: see ec_node_dynlist_nameset().
+ *
+ * Names added in increasing order are appended; other additions are sorted
+ * in a batch at the next lookup.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/** A sorted set of names. */
+struct ec_nameset;
+
+/**
+ * Create an empty name set.
+ *
+ * @return
+ *   The name set, or NULL on error (errno is set).
+ */
+struct ec_nameset *ec_nameset(void);
+
+/**
+ * Get a reference to a name set.
+ *
+ * This increments the reference counter of the set, which is released by
+ * ec_nameset_free().
+ *
+ * @param set
+ *   The name set.
+ * @return
+ *   The name set.
+ */
+struct ec_nameset *ec_nameset_clone(struct ec_nameset *set);
+
+/**
+ * Release a reference to a name set.
+ *
+ * The set is freed when the last reference is released.
+ *
+ * @param set
+ *   The name set.
+ */
+void ec_nameset_free(struct ec_nameset *set);
+
+/**
+ * Add a name in the set.
+ *
+ * Adding a name which is already in the set does nothing.
+ *
+ * @param set
+ *   The name set.
+ * @param name
+ *   The name to add. It is copied.
+ * @return
+ *   0 on success, or -1 on error (errno is set).
+ */
+int ec_nameset_add(struct ec_nameset *set, const char *name);
+
+/**
+ * Remove a name from the set.
+ *
+ * @param set
+ *   The name set.
+ * @param name
+ *   The name to remove.
+ * @return
+ *   0 on success, or -1 on error (errno is set to ENOENT if the name is
+ *   not in the set).
+ */
+int ec_nameset_del(struct ec_nameset *set, const char *name);
+
+/**
+ * Check if a name is in the set.
+ *
+ * @param set
+ *   The name set.
+ * @param name
+ *   The name to search.
+ * @return
+ *   True if the name is in the set.
+ */
+bool ec_nameset_has(struct ec_nameset *set, const char *name);
+
+/**
+ * Get the number of names in the set.
+ *
+ * @param set
+ *   The name set.
+ * @return
+ *   The number of names.
+ */
+size_t ec_nameset_len(struct ec_nameset *set);
+
+/**
+ * Get a name from its index, in lexicographic order.
+ *
+ * The index is invalidated when the set is modified.
+ *
+ * @param set
+ *   The name set.
+ * @param idx
+ *   The index of the name.
+ * @return
+ *   The name, or NULL if the index is out of bounds.
+ */
+const char *ec_nameset_get(struct ec_nameset *set, size_t idx);
+
+/**
+ * Find the names starting with a prefix.
+ *
+ * They are the names whose index is in [*first, *first + count[.
+ *
+ * @param set
+ *   The name set.
+ * @param prefix
+ *   The prefix.
+ * @param first
+ *   The index of the first matching name is returned here.
+ * @return
+ *   The number of matching names.
+ */
+size_t ec_nameset_prefix(struct ec_nameset *set, const char *prefix, size_t *first);
+
+/** @} */
@@ -137,6 +137,24 @@ struct ec_config_schema;
  */
 typedef int (*ec_node_set_config_t)(struct ec_node *node, const struct ec_config *config);
 
+/**
+ * Function type used to build the configuration of a node.
+ *
+ * The function pointer is not called directly, the helper ec_node_get_config()
+ * should be used instead.
+ *
+ * The constructors of some node types fill the private data directly,
+ * without building a generic configuration. In this case, this function
+ * builds the configuration from the private data, the first time it is
+ * requested.
+ *
+ * @param node
+ *   The node.
+ * @return
+ *   The configuration of the node, or NULL on error (errno is set).
+ */
+typedef struct ec_config *(*ec_node_get_config_t)(const struct ec_node *node);
+
 /**
  * Parse a string vector using the given grammar graph.
  *
@@ -325,6 +343,13 @@ struct ec_node_type {
 	/** Get children count. */
 	ec_node_get_children_count_t get_children_count;
 	ec_node_get_child_t get_child; /**< Get the i-th child. */
+	/** Build configuration from private data. */
+	ec_node_get_config_t get_config;
+	/** Set if the parse or completion of the node does not only depend on
+	 *  its input, but also on the parse tree built so far, for instance
+	 *  on the other nodes already matched. The nodes that memoize the
+	 *  results of their children do not do it for such nodes. */
+	bool uses_parse_tree;
 };
 
 /**
@@ -472,6 +497,9 @@ int ec_node_set_config(struct ec_node *node, struct ec_config *config);
  * Get the current node configuration.
  *
  * For a node that supports generic configuration, get its configuration.
+ * If the node was configured by its constructor without a generic
+ * configuration, it is built by this function. The returned pointer is
+ * valid until the node is modified or freed.
  *
  * @param node
  *   The grammar node.
@@ -573,6 +601,98 @@ void ec_node_dump(FILE *out, const struct ec_node *node);
  */
 struct ec_node *ec_node_find(struct ec_node *node, const char *id);
 
+/**
+ * Action returned by a grammar visitor callback.
+ */
+enum ec_node_visit_action {
+	EC_NODE_VISIT_CONTINUE = 0, /**< Continue the traversal. */
+	EC_NODE_VISIT_SKIP, /**< Do not browse the children of the node. */
+	EC_NODE_VISIT_STOP, /**< Stop the traversal. */
+};
+
+/**
+ * Function called on each node by ec_node_visit().
+ *
+ * @param node
+ *   The visited node.
+ * @param parent
+ *   The node from which the visited node was reached, or NULL for the
+ *   root of the traversal.
+ * @param opaque
+ *   The user pointer passed to ec_node_visit().
+ * @return
+ *   An ::ec_node_visit_action, or -1 on error (errno is set), which stops
+ *   the traversal.
+ */
+typedef int (*ec_node_visit_t)(struct ec_node *node, struct ec_node *parent, void *opaque);
+
+/**
+ * Browse a grammar graph in depth-first order.
+ *
+ * Each node reachable from the root is visited once, even if it has
+ * several parents or is part of a loop. The pre-order callback is called
+ * before browsing the children of a node, and can skip them by returning
+ * ::EC_NODE_VISIT_SKIP. The post-order callback is called after the
+ * children are browsed (or skipped).
+ *
+ * The traversal does not modify the nodes, and only allocates memory
+ * when the grammar is large. The grammar must not be modified by the
+ * callbacks.
+ *
+ * @param node
+ *   The root of the grammar graph.
+ * @param pre
+ *   The pre-order callback, can be NULL.
+ * @param post
+ *   The post-order callback, can be NULL.
+ * @param opaque
+ *   A user pointer passed to the callbacks.
+ * @return
+ *   0 if the whole graph was browsed, 1 if a callback returned
+ *   ::EC_NODE_VISIT_STOP, or -1 on error (errno is set).
+ */
+int ec_node_visit(struct ec_node *node, ec_node_visit_t pre, ec_node_visit_t post, void *opaque);
+
+/** An index of the nodes of a grammar by identifier. */
+struct ec_node_index;
+
+/**
+ * Build an index of the nodes of a grammar by identifier.
+ *
+ * When the grammar is not modified anymore, looking up a node in the
+ * index with ec_node_index_find() is faster than browsing the grammar
+ * with ec_node_find(). The index holds a reference to the root of the
+ * grammar, but it is not updated if the grammar is modified.
+ *
+ * @param node
+ *   The root of the grammar graph.
+ * @return
+ *   The index on success, that must be freed using ec_node_index_free().
+ *   Return NULL on error (errno is set).
+ */
+struct ec_node_index *ec_node_index(struct ec_node *node);
+
+/**
+ * Find a node from its identifier string in an index.
+ *
+ * @param index
+ *   The index returned by ec_node_index().
+ * @param id
+ *   The identifier to match.
+ * @return
+ *   The same node than ec_node_find() on the root of the grammar, or NULL
+ *   if there is no node with this identifier.
+ */
+struct ec_node *ec_node_index_find(const struct ec_node_index *index, const char *id);
+
+/**
+ * Free an index of the nodes of a grammar.
+ *
+ * @param index
+ *   The index returned by ec_node_index(), or NULL.
+ */
+void ec_node_index_free(struct ec_node_index *index);
+
 /**
  * Create an iterator on a grammar tree.
  *
@@ -12,6 +12,8 @@
 
 #pragma once
 
+#include <stdbool.h>
+
 #include <ecoli/node.h>
 
 /**
@@ -31,4 +33,29 @@
 
 struct ec_node *__ec_node_cmd(const char *id, const char *cmd_str, ...);
 
+/**
+ * Enable or disable the cache of built commands.
+ *
+ * When enabled, the node graph built from a command string is kept
+ * and shared by the next command nodes created with the same string
+ * and the same children (same node pointers and ids). This speeds up
+ * the creation of grammars that repeat the same commands.
+ *
+ * The cached graphs keep a reference to their children, which are
+ * therefore not freed with the command nodes, but when the cache is
+ * flushed, disabled, or at ec_exit(). The cache is disabled by default.
+ *
+ * The cache is protected by a lock, so that commands can be created from
+ * several threads. However, the command nodes built from the same cached
+ * graph share its nodes, whose reference counts are not atomic: these
+ * command nodes must not be freed while another thread creates or frees
+ * command nodes.
+ *
+ * @param enable
+ *   True to enable the cache, false to disable it.
+ * @return
+ *   0 on success, or -1 on error (errno is set).
+ */
+int ec_node_cmd_set_cache(bool enable);
+
 /** @} */
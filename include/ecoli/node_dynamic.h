@@ -12,6 +12,8 @@
 
 #pragma once
 
+#include <stdint.h>
+
 struct ec_node;
 struct ec_pnode;
 
@@ -24,4 +26,47 @@ typedef struct ec_node *(*ec_node_dynamic_build_t)(struct ec_pnode *pstate, void
  */
 struct ec_node *ec_node_dynamic(const char *id, ec_node_dynamic_build_t build, void *opaque);
 
+/**
+ * Callback returning the generation of the state used to build a cached
+ * dynamic node. It is invoked by parse() or complete(), and must be cheap.
+ */
+typedef uint64_t (*ec_node_dynamic_generation_t)(void *opaque);
+
+/**
+ * Create a dynamic node whose built child is cached.
+ *
+ * The build callback is only invoked when the value returned by the
+ * generation callback differs from the one of the cached child, so the
+ * child must not depend on what is already parsed. The previous child is
+ * released when it is replaced, but it stays valid as long as a parse tree
+ * or a completion uses it.
+ *
+ * Several threads can parse or complete with the node at the same time:
+ * the cache and the references to the child are protected by a lock, which
+ * is also held when the callbacks are invoked.
+ *
+ * Once built, the cached child is reported as the child of the node, so
+ * ec_node_find() or ec_node_visit() browse it: the nodes they reach depend
+ * on the last parse or completion. They must not be called while another
+ * thread uses the grammar.
+ *
+ * @param id
+ *   The node identifier.
+ * @param build
+ *   The callback building the child node.
+ * @param generation
+ *   The callback returning the generation of the state the child is built
+ *   from. The user must change it each time the child would be different.
+ * @param opaque
+ *   A user pointer passed to the callbacks.
+ * @return
+ *   The new dynamic node, or NULL on error (errno is set).
+ */
+struct ec_node *ec_node_dynamic_cached(
+	const char *id,
+	ec_node_dynamic_build_t build,
+	ec_node_dynamic_generation_t generation,
+	void *opaque
+);
+
 /** @} */
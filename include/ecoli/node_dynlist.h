@@ -10,7 +10,8 @@
  * @brief A node that matches names from a dynamic list.
  *
  * This node is able to parse a list of object names, returned by a user-defined
- * function as a string vector.
+ * function as a string vector. For large lists, the names can instead be
+ * searched with user-defined lookup callbacks, or in a name set.
  *
  * Some flags can alter the behavior of parsing and completion:
  * - Match names returned by the user callback.
@@ -20,6 +21,7 @@
 
 #pragma once
 
+struct ec_nameset;
 struct ec_node;
 struct ec_pnode;
 
@@ -84,4 +86,95 @@ struct ec_node *ec_node_dynlist(
 	enum ec_node_dynlist_flags flags
 );
 
+/**
+ * Callback invoked for each name found by an ec_node_dynlist_ops iterator.
+ *
+ * @param name
+ *   The object name.
+ * @param arg
+ *   The argument given to the iterator.
+ * @return
+ *   0 on success, or -1 on error (errno is set), in which case the
+ *   iterator must stop and return -1.
+ */
+typedef int (*ec_node_dynlist_iter_cb_t)(const char *name, void *arg);
+
+/**
+ * Callbacks searching the object names, used instead of building the full
+ * list on each parse or completion.
+ */
+struct ec_node_dynlist_ops {
+	/**
+	 * Check if a name is in the list.
+	 *
+	 * Return 1 if it is, 0 if it is not, or -1 on error (errno is set).
+	 */
+	int (*lookup)(struct ec_pnode *pstate, const char *name, void *opaque);
+
+	/**
+	 * Invoke cb(name, cb_arg) for each name of the list starting with
+	 * prefix.
+	 *
+	 * Return 0 on success, or -1 on error (errno is set).
+	 */
+	int (*iter_prefix)(
+		struct ec_pnode *pstate,
+		const char *prefix,
+		ec_node_dynlist_iter_cb_t cb,
+		void *cb_arg,
+		void *opaque
+	);
+};
+
+/**
+ * Create a dynlist node searching the names with callbacks.
+ *
+ * This behaves like ec_node_dynlist(), but the list is searched with the
+ * provided callbacks.
+ *
+ * @param id
+ *   The node identifier.
+ * @param ops
+ *   The callbacks searching the list. The structure is copied.
+ * @param opaque
+ *   A user pointer passed to the callbacks.
+ * @param re_str
+ *   The regular expression defining the valid pattern for object names.
+ * @param flags
+ *   Customize parsing and completion behavior.
+ * @return
+ *   The dynlist grammar node, or NULL on error (errno is set).
+ */
+struct ec_node *ec_node_dynlist_indexed(
+	const char *id,
+	const struct ec_node_dynlist_ops *ops,
+	void *opaque,
+	const char *re_str,
+	enum ec_node_dynlist_flags flags
+);
+
+/**
+ * Create a dynlist node matching the names of a name set.
+ *
+ * The node holds a reference to the set, which can still be modified by the
+ * application to update the list.
+ *
+ * @param id
+ *   The node identifier.
+ * @param set
+ *   The name set.
+ * @param re_str
+ *   The regular expression defining the valid pattern for object names.
+ * @param flags
+ *   Customize parsing and completion behavior.
+ * @return
+ *   The dynlist grammar node, or NULL on error (errno is set).
+ */
+struct ec_node *ec_node_dynlist_nameset(
+	const char *id,
+	struct ec_nameset *set,
+	const char *re_str,
+	enum ec_node_dynlist_flags flags
+);
+
 /** @} */
@@ -12,25 +12,55 @@
 
 #pragma once
 
-#include <dirent.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <sys/stat.h>
+#include <sys/types.h>
 
 #include <ecoli/node.h>
 
 /** @internal below functions pointers are only useful for test */
 struct ec_node_file_ops {
 	int (*lstat)(const char *pathname, struct stat *buf);
-	DIR *(*opendir)(const char *name);
-	struct dirent *(*readdir)(DIR *dirp);
-	int (*closedir)(DIR *dirp);
-	int (*dirfd)(DIR *dirp);
+	int (*open)(const char *pathname, int flags);
+	ssize_t (*getdents64)(int fd, void *dirp, size_t count);
 	int (*fstatat)(int dirfd, const char *pathname, struct stat *buf, int flags);
+	int (*inotify_init1)(int flags);
+	int (*inotify_add_watch)(int fd, const char *pathname, uint32_t mask);
+	int (*inotify_rm_watch)(int fd, int wd);
+	ssize_t (*read)(int fd, void *buf, size_t count);
+	int (*close)(int fd);
 };
 
 /**
  * Set custom file operations for testing.
+ *
+ * The fields left to NULL use the libc functions. Passing NULL
+ * restores all the libc functions. The directory cache must be
+ * disabled when the operations are changed.
+ *
  * @internal
  */
 void ec_node_file_set_ops(const struct ec_node_file_ops *ops);
 
+/**
+ * Enable or disable the directory listing cache.
+ *
+ * When enabled, the listing of a directory is read once and reused
+ * by the next completions of all file nodes, until an inotify event
+ * reports a change in this directory. This avoids reading large or
+ * remote directories on each completion. Note that inotify does not
+ * report the changes done by other hosts on network filesystems: in
+ * this case, the cache can return a stale listing.
+ *
+ * The cache is disabled by default. Disabling it frees all cached
+ * listings.
+ *
+ * @param enable
+ *   True to enable the cache, false to disable it.
+ * @return
+ *   0 on success, or -1 on error (errno is set).
+ */
+int ec_node_file_set_cache(bool enable);
+
 /** @} */
@@ -0,0 +1,57 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2025, Olivier MATZ <zer0@droids-corp.org>
+ */
+
+/**
+ * @defgroup ecoli_node_intern Node interning
+ * @{
+ *
+ * @brief Share the identical nodes of a grammar.
+ *
+ * Large generated grammars often contain many identical nodes, like the
+ * same keyword, integer range or regular expression repeated in
+ * thousands of commands. When a node is interned, it is replaced by an
+ * identical node that was interned before, if any, so that only one
+ * instance is kept in memory (and, for instance, a regular expression
+ * is compiled once).
+ *
+ * Two nodes are identical if they have the same type, identifier,
+ * configuration and attributes. The children of a node are part of its
+ * configuration and are compared by address: to share identical
+ * subtrees, the children must be interned before their parent.
+ *
+ * Only the nodes whose type has a configuration schema, and that have a
+ * configuration, are interned: the other ones may contain a state that
+ * cannot be compared (a callback for instance).
+ *
+ * Since an interned node can be shared by several parents, it must not
+ * be modified. It must not be interned either if the grammar depends on
+ * its address: for instance, the child of an ec_node_once(), or the
+ * operators of an ec_node_expr().
+ */
+
+#pragma once
+
+struct ec_node;
+
+/**
+ * Intern a grammar node.
+ *
+ * If an identical node was interned and is still in use, the node is
+ * freed and a new reference to the interned node is returned. Else, the
+ * node is interned and returned.
+ *
+ * A node is not interned anymore when it is reconfigured with
+ * ec_node_set_config() or when a child is added to it. The attributes
+ * of an interned node should not be modified.
+ *
+ * @param node
+ *   The node to intern. It is consumed by the function. If it is NULL,
+ *   NULL is returned.
+ * @return
+ *   The interned node, or the node itself if it cannot be interned.
+ *   Return NULL on error (errno is set).
+ */
+struct ec_node *ec_node_intern(struct ec_node *node);
+
+/** @} */
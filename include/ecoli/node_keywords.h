@@ -0,0 +1,107 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2025, Olivier MATZ <zer0@droids-corp.org>
+ */
+
+/**
+ * @defgroup ecoli_node_keywords Keywords node
+ * @ingroup ecoli_nodes
+ * @{
+ *
+ * @brief A node that matches one string among a set of keywords.
+ *
+ * This node behaves like an or node whose children are str nodes, but the
+ * keywords are stored in a sorted array: a token is looked up with a binary
+ * search instead of being compared to each keyword, and the completions of
+ * a token are the contiguous range of keywords starting with it.
+ *
+ * Optionally, a token which is the prefix of only one keyword matches this
+ * keyword, so that unambiguous abbreviations are accepted without going
+ * through ec_node_sh_lex_expand().
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <ecoli/node.h>
+#include <ecoli/utils.h>
+
+/**
+ * Create a keywords node.
+ *
+ * @param id
+ *   The node identifier.
+ * @param keywords
+ *   The array of keywords to match. They are duplicated internally, the
+ *   order does not matter and duplicates are ignored.
+ * @param len
+ *   The number of keywords.
+ * @param unique_prefix
+ *   If true, a token which is the prefix of only one keyword also matches.
+ * @return
+ *   The node, or NULL on error (errno is set).
+ */
+struct ec_node *ec_node_keywords(
+	const char *id,
+	const char *const *keywords,
+	size_t len,
+	bool unique_prefix
+);
+
+/**
+ * Create a keywords node from a list of strings.
+ *
+ * @param id
+ *   The node identifier.
+ * @param unique_prefix
+ *   If true, a token which is the prefix of only one keyword also matches.
+ * @param args
+ *   The keywords.
+ * @return
+ *   The node, or NULL on error (errno is set).
+ */
+#define EC_NODE_KEYWORDS(id, unique_prefix, args...)                                               \
+	({                                                                                         \
+		const char *_arr[] = {args};                                                       \
+		ec_node_keywords(id, _arr, EC_COUNT_OF(_arr), unique_prefix);                      \
+	})
+
+/**
+ * Set the keywords of a keywords node.
+ *
+ * @param node
+ *   The keywords node.
+ * @param keywords
+ *   The array of keywords to match. They are duplicated internally.
+ * @param len
+ *   The number of keywords.
+ * @param unique_prefix
+ *   If true, a token which is the prefix of only one keyword also matches.
+ * @return
+ *   0 on success, -1 on error (errno is set).
+ */
+int ec_node_keywords_set(
+	struct ec_node *node,
+	const char *const *keywords,
+	size_t len,
+	bool unique_prefix
+);
+
+/**
+ * Get the keyword matched by a token.
+ *
+ * This is useful to get the full keyword when a token matched by
+ * unique prefix.
+ *
+ * @param node
+ *   The keywords node.
+ * @param token
+ *   The token.
+ * @return
+ *   The matching keyword, or NULL if the token does not match (errno is
+ *   set).
+ */
+const char *ec_node_keywords_match(const struct ec_node *node, const char *token);
+
+/** @} */
@@ -0,0 +1,57 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2025, Olivier MATZ <zer0@droids-corp.org>
+ */
+
+/**
+ * @defgroup ecoli_node_optimize Grammar optimizer
+ * @{
+ *
+ * @brief Rewrite a grammar into an equivalent one that is cheaper to use.
+ *
+ * Grammars built by ec_node_cmd() or imported from YAML often contain
+ * intermediate nodes that do not change what is matched, but cost a
+ * parse node and a function call at each parse or completion. The
+ * optimizer removes them:
+ *
+ * - a seq node in a seq node is replaced by its children,
+ * - an or node in an or node is replaced by its children,
+ * - a seq or or node with only one child is replaced by its child,
+ * - a bypass node is replaced by its child,
+ * - an option node in an option node is replaced by its child,
+ * - three or more consecutive str children of an or node, matching
+ *   distinct strings, are replaced by a keywords node.
+ *
+ * The nodes that have an identifier or attributes are never removed,
+ * since callbacks or completion helpers may depend on them. The parse
+ * trees of the optimized grammar are the ones of the original grammar,
+ * without the removed nodes.
+ *
+ * The optimizer only rewrites the children of seq, or, option, many and
+ * bypass nodes, and also browses the grammar built by cmd nodes. The
+ * other nodes may depend on the address of their children, or on the
+ * shape of the parse tree (like ec_node_expr()), so they are left
+ * untouched, with everything below them.
+ */
+
+#pragma once
+
+struct ec_node;
+
+/**
+ * Optimize a grammar.
+ *
+ * The nodes of the grammar are modified in place, including the ones
+ * shared with another grammar, which stays equivalent. The grammar must
+ * be complete, and must not be modified afterwards using a reference to
+ * a node that may have been removed (a node without identifier).
+ *
+ * @param node
+ *   The root of the grammar. It is consumed by the function. If it is
+ *   NULL, NULL is returned.
+ * @return
+ *   The root of the optimized grammar, which can be another node if the
+ *   root was removed. Return NULL on error (errno is set).
+ */
+struct ec_node *ec_node_optimize(struct ec_node *node);
+
+/** @} */
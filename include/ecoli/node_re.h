@@ -20,7 +20,9 @@
  * @param id
  *   The node identifier.
  * @param str
- *   The regular expression pattern (POSIX extended regex).
+ *   The regular expression pattern (POSIX extended regex, or PCRE2
+ *   syntax when libecoli is built with libpcre2). The whole token must
+ *   match.
  * @return
  *   The node, or NULL on error (errno is set).
  */
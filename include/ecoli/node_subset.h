@@ -18,6 +18,17 @@
  * Create a subset node from a list of child nodes.
  *
  * A subset node matches any permutation of a subset of its children.
+ * The results are memoized by set of matched children and position in
+ * the input, and a child is completed only once at a given position,
+ * whatever the children matched before it: the completions reached
+ * through several orders or sets of children are only returned once.
+ *
+ * When a child contains a node depending on the parse tree (its type
+ * sets ec_node_type.uses_parse_tree, like cond, dynamic, dynlist or
+ * once), all the permutations are tried instead, which takes a
+ * factorial time in the number of matching children. This is checked
+ * when the child is added, so the grammar below a child must be
+ * complete at this time.
  * All child nodes passed as arguments are consumed and will be freed
  * when the subset node is freed, or immediately on error.
  *
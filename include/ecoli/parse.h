@@ -112,6 +112,21 @@ const struct ec_strvec *ec_pnode_get_strvec(const struct ec_pnode *pnode);
  */
 struct ec_pnode *ec_parse(const struct ec_node *node, const char *str);
 
+/**
+ * Parse a string using a grammar tree, and report the furthest failure.
+ *
+ * This is equivalent to calling ec_parse_strvec_report() on the same
+ * node, with a string vector containing only the argument string str.
+ *
+ * @param node
+ *   The grammar node.
+ * @param str
+ *   The input string.
+ * @return
+ *   A parsing tree, or NULL on error (errno is set).
+ */
+struct ec_pnode *ec_parse_report(const struct ec_node *node, const char *str);
+
 /**
  * Parse a string vector using a grammar tree.
  *
@@ -130,6 +145,9 @@ struct ec_pnode *ec_parse(const struct ec_node *node, const char *str);
  * tree only contains one root node, with no associated string vector.
  * Calling ec_pnode_matches() on this tree returns false.
  *
+ * No failure report is attached to the returned parsing tree, see
+ * ec_parse_strvec_report().
+ *
  * @param node
  *   The grammar node.
  * @param strvec
@@ -139,6 +157,24 @@ struct ec_pnode *ec_parse(const struct ec_node *node, const char *str);
  */
 struct ec_pnode *ec_parse_strvec(const struct ec_node *node, const struct ec_strvec *strvec);
 
+/**
+ * Parse a string vector using a grammar tree, and report the furthest failure.
+ *
+ * This is the same as ec_parse_strvec(), but the furthest failure of the
+ * parse is tracked, and a failure report is attached to the root of the
+ * returned parsing tree, see ec_pnode_get_failure(). The tracking has a
+ * cost, so it should only be requested when the report is used, for
+ * instance to describe an error to the user.
+ *
+ * @param node
+ *   The grammar node.
+ * @param strvec
+ *   The input string vector.
+ * @return
+ *   A parsing tree, or NULL on error (errno is set).
+ */
+struct ec_pnode *ec_parse_strvec_report(const struct ec_node *node, const struct ec_strvec *strvec);
+
 /**
  * Return value of ec_parse_child() when input does not match grammar.
  */
@@ -174,6 +210,113 @@ int ec_parse_child(
 	const struct ec_strvec *strvec
 );
 
+/**
+ * Parse the tokens produced by a lexer, from a parent node.
+ *
+ * This function is to be used by lexer nodes (e.g., ec_node_sh_lex())
+ * instead of ec_parse_child(). It behaves the same, except that the
+ * failure report (see ec_pnode_get_failure()) of the first lexer reached
+ * while parsing describes its tokens instead of its input.
+ *
+ * @param node
+ *   The grammar node.
+ * @param pstate
+ *   The node of the parsing tree.
+ * @param strvec
+ *   The lexed tokens.
+ * @return
+ *   Same as ec_parse_child().
+ */
+int ec_parse_lexed_child(
+	const struct ec_node *node,
+	struct ec_pnode *pstate,
+	const struct ec_strvec *strvec
+);
+
+/** The report of the furthest parsing failure. */
+struct ec_parse_failure;
+
+/**
+ * Get the failure report of a parsing tree.
+ *
+ * While parsing, ec_parse_strvec_report() records the furthest token
+ * reached by the leaves of the grammar graph, and the leaves that failed
+ * to parse this token. This is where the input stops matching the
+ * grammar: it can be used to locate an error and to describe what was
+ * expected, without parsing again.
+ *
+ * The tokens are the input of ec_parse_strvec_report(), or the tokens
+ * produced by the first lexer node reached (see ec_parse_lexed_child()).
+ * The tokens produced by other lexers are not tracked.
+ *
+ * @param pnode
+ *   The root of a parsing tree returned by ec_parse_strvec_report() or
+ *   ec_parse_report().
+ * @return
+ *   The failure report, owned by the parsing tree, or NULL if the parsing
+ *   tree was not returned by these functions.
+ */
+const struct ec_parse_failure *ec_pnode_get_failure(const struct ec_pnode *pnode);
+
+/**
+ * Get the tokens described by a failure report.
+ *
+ * @param failure
+ *   The failure report.
+ * @return
+ *   The tokens, owned by the failure report.
+ */
+const struct ec_strvec *ec_parse_failure_get_strvec(const struct ec_parse_failure *failure);
+
+/**
+ * Get the furthest token reached while parsing.
+ *
+ * @param failure
+ *   The failure report.
+ * @return
+ *   The index of the token, which is equal to the number of tokens when
+ *   more tokens were expected.
+ */
+size_t ec_parse_failure_get_offset(const struct ec_parse_failure *failure);
+
+/**
+ * Check if the tokens before the furthest token match the grammar.
+ *
+ * @param failure
+ *   The failure report.
+ * @return
+ *   True if the tokens located before the offset returned by
+ *   ec_parse_failure_get_offset() were matched by the top node.
+ */
+bool ec_parse_failure_prefix_matches(const struct ec_parse_failure *failure);
+
+/**
+ * Get the number of nodes that failed to parse the furthest token.
+ *
+ * @param failure
+ *   The failure report.
+ * @return
+ *   The number of expected nodes.
+ */
+size_t ec_parse_failure_get_count(const struct ec_parse_failure *failure);
+
+/**
+ * Get a node that failed to parse the furthest token.
+ *
+ * @param failure
+ *   The failure report.
+ * @param i
+ *   The index of the expected node, lower than the value returned by
+ *   ec_parse_failure_get_count().
+ * @param len
+ *   The pointer where the length of the path is returned.
+ * @return
+ *   The path of grammar nodes, from the expected node (first) to the
+ *   root node (last), or NULL on error (errno is set).
+ */
+const struct ec_node *const *
+ec_parse_failure_get_path(const struct ec_parse_failure *failure, size_t i, size_t *len);
+
 /**
  * Link a parsing node to a parsing tree.
  *
@@ -0,0 +1,86 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2025, Olivier MATZ <zer0@droids-corp.org>
+ */
+
+/**
+ * @defgroup ecoli_snapshot Binary grammar snapshots
+ * @{
+ *
+ * @brief Save a built grammar in a binary file and load it quickly.
+ *
+ * A snapshot contains the type, id, configuration and attributes of
+ * each node of a grammar, like a YAML export, but in a compact binary
+ * form that does not need to be parsed: it is a header followed by
+ * arrays of fixed-size records referencing each other by index, and a
+ * table of nul-terminated strings. It contains no pointer, so it can be
+ * mapped at any address, or embedded in a program.
+ *
+ * Nodes referenced several times (shared nodes and loops) are stored
+ * once, and are shared again when the snapshot is loaded.
+ *
+ * Like ec_yaml_export(), only the configuration of a node is saved, and
+ * the node is rebuilt from it when the snapshot is loaded. The export
+ * fails with ENOTSUP if a node has children but no configuration (for
+ * instance a subset node built with ec_node_subset_add()).
+ *
+ * Only the attributes whose value is NULL, or a string freed with
+ * free() (like the ones set by ec_interact_set_help() or by
+ * ec_yaml_import()), are saved. The other ones, like callbacks, cannot
+ * be saved and are ignored.
+ *
+ * The snapshot uses the byte order of the machine that created it, and
+ * references the node types by name: it can only be loaded by a program
+ * that registers the same node types, with the same configuration
+ * schemas.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdio.h>
+
+struct ec_node;
+
+/**
+ * Export an ::ec_node grammar to a binary snapshot.
+ *
+ * @param out
+ *   The output stream where the snapshot is written.
+ * @param node
+ *   The root node of the grammar.
+ * @return
+ *   0 on success, or -1 on error (errno is set, ENOTSUP if a node cannot
+ *   be saved).
+ */
+int ec_snapshot_export(FILE *out, const struct ec_node *node);
+
+/**
+ * Build an ::ec_node grammar from a snapshot in memory.
+ *
+ * @param buf
+ *   The snapshot, aligned on 4 bytes. It is not referenced after the
+ *   function returns.
+ * @param len
+ *   The length of the buffer.
+ * @return
+ *   The root node on success, or NULL on error (errno is set, EINVAL
+ *   if the snapshot is invalid). The returned node must be freed by
+ *   the caller with ec_node_free().
+ */
+struct ec_node *ec_snapshot_import_mem(const void *buf, size_t len);
+
+/**
+ * Build an ::ec_node grammar from a snapshot file.
+ *
+ * The file is mapped in memory, then loaded with
+ * ec_snapshot_import_mem().
+ *
+ * @param filename
+ *   The path to the snapshot file.
+ * @return
+ *   The root node on success, or NULL on error (errno is set). The
+ *   returned node must be freed by the caller with ec_node_free().
+ */
+struct ec_node *ec_snapshot_import(const char *filename);
+
+/** @} */
@@ -11,6 +11,7 @@
 
 #pragma once
 
+#include <stddef.h>
 #include <stdio.h>
 
 struct ec_node;
@@ -18,6 +19,10 @@ struct ec_node;
 /**
  * Parse a YAML file and build an ::ec_node tree from it.
  *
+ * The document is parsed as a stream: it is never loaded entirely in
+ * memory. Anchors and aliases can be used to share nodes or to create
+ * loops in the grammar.
+ *
  * @param filename
  *   The path to the file to be parsed.
  * @return
@@ -26,6 +31,33 @@ struct ec_node;
  */
 struct ec_node *ec_yaml_import(const char *filename);
 
+/**
+ * Parse a YAML document from a file descriptor and build an ::ec_node
+ * tree from it.
+ *
+ * @param fd
+ *   The file descriptor, read until the end of the document. It is not
+ *   closed.
+ * @return
+ *   The ec_node tree on success, or NULL on error (errno is set).
+ *   The returned node must be freed by the caller with ec_node_free().
+ */
+struct ec_node *ec_yaml_import_fd(int fd);
+
+/**
+ * Parse a YAML document from a memory buffer and build an ::ec_node
+ * tree from it.
+ *
+ * @param buf
+ *   The buffer containing the document.
+ * @param len
+ *   The length of the buffer.
+ * @return
+ *   The ec_node tree on success, or NULL on error (errno is set).
+ *   The returned node must be freed by the caller with ec_node_free().
+ */
+struct ec_node *ec_yaml_import_mem(const char *buf, size_t len);
+
 /**
  * Export an ::ec_node tree to a YAML formatted stream.
  *
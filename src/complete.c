@@ -20,6 +20,8 @@
 #include <ecoli/string.h>
 #include <ecoli/strvec.h>
 
+#include "parse_private.h"
+
 EC_LOG_TYPE_REGISTER(comp);
 
 struct ec_comp_item {
@@ -42,6 +44,7 @@ struct ec_comp_group {
 	struct ec_comp_item_list items;
 	struct ec_pnode *pstate;
 	struct ec_dict *attrs;
+	bool resumable; /**< Items can be recomputed from pstate only. */
 };
 
 TAILQ_HEAD(ec_comp_group_list, ec_comp_group);
@@ -55,6 +58,21 @@ struct ec_comp {
 	struct ec_comp_group *cur_group;
 	struct ec_comp_group_list groups;
 	struct ec_dict *attrs;
+	const struct ec_strvec *cur_strvec; /**< Input of the current node. */
+	struct ec_comp_session *session; /**< Set while built by a session. */
+};
+
+struct ec_comp_session {
+	const struct ec_node *node; /**< The grammar graph. */
+	struct ec_strvec *input; /**< Input of the last completion. */
+	struct ec_comp *comp; /**< Result of the last completion. */
+	struct ec_strvec *tokens; /**< Lexed tokens of the last completion. */
+	bool resumable; /**< All groups of comp can be resumed. */
+	/* state used while building a new completion */
+	struct ec_comp *prev; /**< Previous result, NULL if not resumable. */
+	struct ec_strvec *prev_tokens; /**< Lexed tokens of prev. */
+	const char *cur_token; /**< Last lexed token. */
+	bool lexed; /**< The first lexer was already reached. */
 };
 
 struct ec_comp *ec_comp(void)
@@ -103,6 +121,7 @@ int ec_complete_child(
 )
 {
 	struct ec_pnode *child_pstate, *cur_pstate;
+	const struct ec_strvec *cur_strvec;
 	struct ec_comp_group *cur_group;
 	ec_complete_t complete_cb;
 	int ret;
@@ -118,16 +137,23 @@ int ec_complete_child(
 	if (child_pstate == NULL)
 		return -1;
 
-	if (cur_pstate != NULL)
+	if (cur_pstate != NULL) {
 		ec_pnode_link_child(cur_pstate, child_pstate);
+	} else if (ec_pnode_init_ctx(child_pstate) < 0) {
+		ec_pnode_free(child_pstate);
+		return -1;
+	}
 	comp->cur_pstate = child_pstate;
 	cur_group = comp->cur_group;
 	comp->cur_group = NULL;
+	cur_strvec = comp->cur_strvec;
+	comp->cur_strvec = strvec;
 
 	/* fill the comp struct with items */
 	ret = complete_cb(node, comp, strvec);
 
 	/* restore parent parse state */
+	comp->cur_strvec = cur_strvec;
 	if (cur_pstate != NULL) {
 		ec_pnode_unlink_child(child_pstate);
 		assert(ec_pnode_get_first_child(child_pstate) == NULL);
@@ -241,6 +267,222 @@ err:
 	return NULL;
 }
 
+/* check if the tokens only differ from the previous ones by an extension of
+ * the last token */
+static bool ec_comp_tokens_extend(const struct ec_strvec *prev, const struct ec_strvec *tokens)
+{
+	size_t i, len = ec_strvec_len(tokens);
+
+	if (len == 0 || ec_strvec_len(prev) != len)
+		return false;
+
+	for (i = 0; i < len - 1; i++) {
+		if (strcmp(ec_strvec_val(prev, i), ec_strvec_val(tokens, i)))
+			return false;
+	}
+
+	return ec_str_startswith(ec_strvec_val(tokens, len - 1), ec_strvec_val(prev, len - 1));
+}
+
+/* complete the nodes of the previous groups again, with the new last token */
+static int ec_comp_session_resume(struct ec_comp *comp, const struct ec_strvec *tokens)
+{
+	struct ec_comp_session *session = comp->session;
+	struct ec_pnode *cur_pstate = comp->cur_pstate;
+	struct ec_comp *prev = session->prev;
+	struct ec_strvec *last = NULL;
+	struct ec_comp_group *grp;
+	struct ec_pnode *pstate;
+	struct ec_dict *attrs;
+	int ret = 0;
+
+	last = ec_strvec_ndup(tokens, ec_strvec_len(tokens) - 1, 1);
+	if (last == NULL)
+		return -1;
+
+	TAILQ_FOREACH (grp, &prev->groups, next) {
+		/* the parse state of the parent only depends on the previous
+		 * tokens, which are unchanged */
+		pstate = grp->pstate;
+		grp->pstate = ec_pnode_get_parent(pstate);
+		ec_pnode_unlink_child(pstate);
+		ec_pnode_free(pstate);
+
+		comp->cur_pstate = grp->pstate;
+		ret = ec_complete_child(grp->node, comp, last);
+		comp->cur_pstate = cur_pstate;
+		if (ret < 0)
+			break;
+	}
+	ec_strvec_free(last);
+	if (ret < 0)
+		return -1;
+
+	/* the nodes built during the previous completion (see
+	 * ec_node_dynamic()) must live as long as the new groups */
+	if (ec_dict_len(comp->attrs) == 0) {
+		attrs = comp->attrs;
+		comp->attrs = prev->attrs;
+		prev->attrs = attrs;
+	} else if (ec_dict_len(prev->attrs) != 0) {
+		attrs = ec_dict();
+		if (attrs == NULL)
+			return -1;
+		ret = ec_dict_set(comp->attrs, "_prev_attrs", prev->attrs, (void *)ec_dict_free);
+		prev->attrs = attrs;
+	}
+
+	return ret;
+}
+
+int ec_complete_lexed_child(
+	const struct ec_node *node,
+	struct ec_comp *comp,
+	const struct ec_strvec *strvec
+)
+{
+	struct ec_comp_session *session = comp->session;
+	size_t len = ec_strvec_len(strvec);
+
+	/* only the first lexer reached during a session completion is
+	 * tracked, the other ones behave like ec_complete_child() */
+	if (session == NULL || session->lexed)
+		return ec_complete_child(node, comp, strvec);
+
+	session->lexed = true;
+	session->tokens = ec_strvec_dup(strvec);
+	if (session->tokens == NULL)
+		return -1;
+	if (len > 0)
+		session->cur_token = ec_strvec_val(strvec, len - 1);
+
+	if (session->prev != NULL && ec_comp_tokens_extend(session->prev_tokens, strvec))
+		return ec_comp_session_resume(comp, strvec);
+
+	return ec_complete_child(node, comp, strvec);
+}
+
+struct ec_comp_session *ec_comp_session(const struct ec_node *node)
+{
+	struct ec_comp_session *session;
+
+	if (node == NULL) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	session = calloc(1, sizeof(*session));
+	if (session == NULL)
+		return NULL;
+
+	session->node = node;
+
+	return session;
+}
+
+void ec_comp_session_reset(struct ec_comp_session *session)
+{
+	if (session == NULL)
+		return;
+
+	ec_strvec_free(session->input);
+	session->input = NULL;
+	ec_comp_free(session->comp);
+	session->comp = NULL;
+	ec_strvec_free(session->tokens);
+	session->tokens = NULL;
+	session->resumable = false;
+}
+
+void ec_comp_session_free(struct ec_comp_session *session)
+{
+	if (session == NULL)
+		return;
+
+	ec_comp_session_reset(session);
+	free(session);
+}
+
+const struct ec_comp *
+ec_comp_session_complete_strvec(struct ec_comp_session *session, const struct ec_strvec *strvec)
+{
+	struct ec_comp_group *grp;
+	struct ec_strvec *input;
+	struct ec_comp *comp;
+
+	if (session == NULL || strvec == NULL) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	if (session->comp != NULL && ec_strvec_cmp(session->input, strvec) == 0)
+		return session->comp;
+
+	input = ec_strvec_dup(strvec);
+	if (input == NULL)
+		return NULL;
+
+	comp = ec_comp();
+	if (comp == NULL) {
+		ec_strvec_free(input);
+		return NULL;
+	}
+
+	/* keep the previous result only if it can be resumed */
+	if (session->resumable) {
+		session->prev = session->comp;
+		session->prev_tokens = session->tokens;
+		session->comp = NULL;
+		session->tokens = NULL;
+	}
+	ec_comp_session_reset(session);
+
+	comp->session = session;
+	if (ec_complete_child(session->node, comp, input) < 0) {
+		ec_comp_free(comp);
+		comp = NULL;
+	} else {
+		session->resumable = session->tokens != NULL;
+		TAILQ_FOREACH (grp, &comp->groups, next) {
+			if (!grp->resumable)
+				session->resumable = false;
+		}
+		session->comp = comp;
+		session->input = input;
+		input = NULL;
+		comp->session = NULL;
+	}
+
+	ec_comp_free(session->prev);
+	session->prev = NULL;
+	ec_strvec_free(session->prev_tokens);
+	session->prev_tokens = NULL;
+	session->cur_token = NULL;
+	session->lexed = false;
+	ec_strvec_free(input);
+	if (comp == NULL)
+		ec_comp_session_reset(session);
+
+	return comp;
+}
+
+const struct ec_comp *ec_comp_session_complete(struct ec_comp_session *session, const char *str)
+{
+	const struct ec_comp *comp = NULL;
+	struct ec_strvec *strvec;
+
+	errno = ENOMEM;
+	strvec = ec_strvec();
+	if (strvec == NULL)
+		return NULL;
+
+	if (ec_strvec_add(strvec, str) == 0)
+		comp = ec_comp_session_complete_strvec(session, strvec);
+
+	ec_strvec_free(strvec);
+	return comp;
+}
+
 static struct ec_comp_group *
 ec_comp_group(const struct ec_comp *comp, const struct ec_node *node, struct ec_pnode *parse)
 {
@@ -439,6 +681,14 @@ ec_comp_item_add(struct ec_comp *comp, const struct ec_node *node, struct ec_com
 		grp = ec_comp_group(comp, node, comp->cur_pstate);
 		if (grp == NULL)
 			return -1;
+		/* the items only depend on the parse state and on the
+		 * token tracked by the session: they can be recomputed
+		 * from the group if this token is extended */
+		if (comp->session != NULL && comp->session->cur_token != NULL
+		    && ec_node_get_children_count(node) == 0
+		    && ec_strvec_len(comp->cur_strvec) == 1
+		    && ec_strvec_val(comp->cur_strvec, 0) == comp->session->cur_token)
+			grp->resumable = true;
 		TAILQ_INSERT_TAIL(&comp->groups, grp, next);
 		comp->cur_group = grp;
 	}
@@ -15,6 +15,7 @@
 #include <ecoli/init.h>
 #include <ecoli/log.h>
 
+#include "dict_private.h"
 #include "htable_private.h"
 
 EC_LOG_TYPE_REGISTER(dict);
@@ -102,6 +103,11 @@ void *ec_dict_iter_get_val(const struct ec_dict_elt_ref *iter)
 	return (struct ec_dict_elt_ref *)ec_htable_iter_get_val(&iter->htable);
 }
 
+ec_dict_elt_free_t ec_dict_iter_get_free(const struct ec_dict_elt_ref *iter)
+{
+	return iter->htable.elt->free;
+}
+
 void ec_dict_dump(FILE *out, const struct ec_dict *dict)
 {
 	struct ec_dict_elt_ref *iter;
@@ -117,6 +123,13 @@ void ec_dict_dump(FILE *out, const struct ec_dict *dict)
 	}
 }
 
+struct ec_dict *ec_dict_clone(struct ec_dict *dict)
+{
+	/* the grammar can be used by several threads, which share its dicts */
+	__atomic_add_fetch(&dict->htable.refcnt, 1, __ATOMIC_RELAXED);
+	return dict;
+}
+
 struct ec_dict *ec_dict_dup(const struct ec_dict *dict)
 {
 	return (struct ec_dict *)ec_htable_dup(&dict->htable);
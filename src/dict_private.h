@@ -0,0 +1,18 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2025, Olivier MATZ <zer0@droids-corp.org>
+ */
+
+#pragma once
+
+#include <ecoli/dict.h>
+
+/*
+ * Take a reference on a dictionary, which is freed when ec_dict_free() is
+ * called on its last reference. The dictionary must not be modified while
+ * it is shared, but it can be cloned and freed concurrently. Return the
+ * dictionary.
+ */
+struct ec_dict *ec_dict_clone(struct ec_dict *dict);
+
+/* Return the function used to free the value of a dictionary element. */
+ec_dict_elt_free_t ec_dict_iter_get_free(const struct ec_dict_elt_ref *iter);
@@ -27,6 +27,7 @@ struct ec_editline {
 	char *hist_file;
 	HistEvent histev;
 	const struct ec_node *node;
+	struct ec_comp_session *session;
 	char *prompt;
 };
 
@@ -199,6 +200,7 @@ void ec_editline_free(struct ec_editline *editline)
 		el_end(editline->el);
 	if (editline->history != NULL)
 		history_end(editline->history);
+	ec_comp_session_free(editline->session);
 	free(editline->hist_file);
 	free(editline->prompt);
 	free(editline);
@@ -216,11 +218,19 @@ const struct ec_node *ec_editline_get_node(const struct ec_editline *editline)
 
 int ec_editline_set_node(struct ec_editline *editline, const struct ec_node *node)
 {
+	struct ec_comp_session *session;
+
 	if (strcmp(ec_node_get_type_name(node), "sh_lex")) {
 		errno = EINVAL;
 		return -1;
 	}
 
+	session = ec_comp_session(node);
+	if (session == NULL)
+		return -1;
+
+	ec_comp_session_free(editline->session);
+	editline->session = session;
 	editline->node = node;
 	return 0;
 }
@@ -298,7 +308,8 @@ int ec_editline_complete(struct editline *el, int c)
 {
 	struct ec_editline *editline;
 	int ret = CC_REFRESH;
-	struct ec_comp *cmpl = NULL;
+	struct ec_interact_query *query = NULL;
+	const struct ec_comp *cmpl = NULL;
 	char *append = NULL;
 	unsigned int height;
 	unsigned int width;
@@ -338,19 +349,18 @@ int ec_editline_complete(struct editline *el, int c)
 	if (width < 50)
 		width = 50;
 
-	cmpl = ec_complete(editline->node, line);
-	if (cmpl == NULL)
-		goto fail;
-
-	append = ec_interact_append_chars(cmpl);
-	comp_count = ec_comp_count(cmpl, EC_COMP_FULL) + ec_comp_count(cmpl, EC_COMP_PARTIAL);
-
 	if (c == '?') {
 		struct ec_interact_help *helps = NULL;
 		ssize_t count = 0;
 		size_t char_idx;
 
-		count = ec_interact_get_helps(editline->node, line, &helps);
+		query = ec_interact_query(editline->node, line);
+		if (query == NULL) {
+			fprintf(err, "completion failure: failed to get helps\n");
+			goto fail;
+		}
+
+		count = ec_interact_query_get_helps(query, &helps);
 		if (count < 0) {
 			fprintf(err, "completion failure: failed to get helps\n");
 			goto fail;
@@ -364,9 +374,7 @@ int ec_editline_complete(struct editline *el, int c)
 		ec_interact_free_helps(helps, count);
 
 		if (count == 0) {
-			count = ec_interact_get_error_helps(
-				editline->node, line, &helps, &char_idx
-			);
+			count = ec_interact_query_get_error_helps(query, &helps, &char_idx);
 			if (count < 0) {
 				fprintf(err, "completion failure: failed to get error helps\n");
 				goto fail;
@@ -382,7 +390,17 @@ int ec_editline_complete(struct editline *el, int c)
 			ec_interact_free_helps(helps, count);
 		}
 		ret = CC_REDISPLAY;
-	} else if (append == NULL || (strcmp(append, "") == 0 && comp_count != 1)) {
+		goto out;
+	}
+
+	cmpl = ec_comp_session_complete(editline->session, line);
+	if (cmpl == NULL)
+		goto fail;
+
+	append = ec_interact_append_chars(cmpl);
+	comp_count = ec_comp_count(cmpl, EC_COMP_FULL) + ec_comp_count(cmpl, EC_COMP_PARTIAL);
+
+	if (append == NULL || (strcmp(append, "") == 0 && comp_count != 1)) {
 		char **matches = NULL;
 		ssize_t count = 0;
 
@@ -416,14 +434,15 @@ int ec_editline_complete(struct editline *el, int c)
 		}
 	}
 
-	ec_comp_free(cmpl);
+out:
+	ec_interact_query_free(query);
 	free(line);
 	free(append);
 
 	return ret;
 
 fail:
-	ec_comp_free(cmpl);
+	ec_interact_query_free(query);
 	free(line);
 	free(append);
 
@@ -437,6 +456,9 @@ char *ec_editline_gets(struct ec_editline *editline)
 	const char *line;
 	int count;
 
+	/* the completions of the previous line may be outdated */
+	ec_comp_session_reset(editline->session);
+
 	line = el_gets(el, &count);
 	if (line == NULL)
 		return NULL;
@@ -648,8 +670,8 @@ int ec_editline_interact(
 )
 {
 	struct ec_interact_help *helps = NULL;
+	struct ec_interact_query *query = NULL;
 	struct ec_strvec *line_vec = NULL;
-	struct ec_pnode *parse = NULL;
 	ec_interact_command_cb_t cb;
 	const struct ec_node *node;
 	size_t char_idx = 0;
@@ -689,20 +711,20 @@ int ec_editline_interact(
 		if (ec_strvec_len(line_vec) == 0)
 			goto again;
 
-		parse = ec_parse(node, line);
-		if (parse == NULL) {
+		query = ec_interact_query(node, line);
+		if (query == NULL) {
 			fprintf(err, "Failed to parse command\n");
 			goto fail;
 		}
 
-		if (!ec_pnode_matches(parse)) {
+		if (!ec_interact_query_matches(query)) {
 			ec_editline_term_size(editline, &width, &height);
 			if (width > 100)
 				width = 100;
 			if (width < 50)
 				width = 50;
 
-			n = ec_interact_get_error_helps(editline->node, line, &helps, &char_idx);
+			n = ec_interact_query_get_error_helps(query, &helps, &char_idx);
 			if (n < 0
 			    || ec_interact_print_error_helps(out, width, line, helps, n, char_idx)
 				    < 0)
@@ -713,13 +735,13 @@ int ec_editline_interact(
 			goto again;
 		}
 
-		cb = ec_interact_get_callback(parse);
+		cb = ec_interact_get_callback(ec_interact_query_get_pnode(query));
 		if (cb == NULL) {
 			fprintf(err, "Callback function missing\n");
 			goto fail;
 		}
 
-		if (cb(parse) < 0) {
+		if (cb(ec_interact_query_get_pnode(query)) < 0) {
 			fprintf(err, "Command function returned an error\n");
 			goto again;
 		}
@@ -727,8 +749,8 @@ int ec_editline_interact(
 again:
 		free(line);
 		line = NULL;
-		ec_pnode_free(parse);
-		parse = NULL;
+		ec_interact_query_free(query);
+		query = NULL;
 		ec_strvec_free(line_vec);
 		line_vec = NULL;
 	}
@@ -737,7 +759,7 @@ again:
 
 fail:
 	free(line);
-	ec_pnode_free(parse);
+	ec_interact_query_free(query);
 	ec_strvec_free(line_vec);
 
 	return -1;
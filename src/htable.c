@@ -33,6 +33,7 @@ struct ec_htable *ec_htable(void)
 	if (htable == NULL)
 		return NULL;
 	TAILQ_INIT(&htable->list);
+	htable->refcnt = 1;
 
 	return htable;
 }
@@ -232,6 +233,8 @@ void ec_htable_free(struct ec_htable *htable)
 
 	if (htable == NULL)
 		return;
+	if (__atomic_sub_fetch(&htable->refcnt, 1, __ATOMIC_ACQ_REL) > 0)
+		return;
 
 	while (!TAILQ_EMPTY(&htable->list)) {
 		ref = TAILQ_FIRST(&htable->list);
@@ -27,6 +27,7 @@ struct ec_htable_elt_ref {
 TAILQ_HEAD(ec_htable_elt_ref_list, ec_htable_elt_ref);
 
 struct ec_htable {
+	unsigned int refcnt; /* see ec_dict_clone() */
 	size_t len;
 	size_t table_size;
 	struct ec_htable_elt_ref_list list;
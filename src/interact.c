@@ -194,40 +194,24 @@ static int help_strcasecmp_cb(const void *p1, const void *p2)
 	return strcasecmp(h1->desc, h2->desc);
 }
 
-/* this function builds the help string */
-static int get_node_help(const struct ec_comp_item *item, struct ec_interact_help *help)
+/* build the help of a node, given the help attribute found in its ancestors */
+static int
+build_node_help(const struct ec_node *node, const char *node_help, struct ec_interact_help *help)
 {
-	const struct ec_comp_group *grp;
-	const struct ec_pnode *pstate;
-	const struct ec_node *node;
-	const char *node_help = NULL;
-	const char *node_desc = NULL;
+	const char *node_desc;
 	char *desc_to_free = NULL;
 
 	help->desc = NULL;
 	help->help = NULL;
 
-	grp = ec_comp_item_get_grp(item);
-
-	for (pstate = ec_comp_group_get_pstate(grp); pstate != NULL;
-	     pstate = ec_pnode_get_parent(pstate)) {
-		node = ec_pnode_get_node(pstate);
-		if (node_help == NULL)
-			node_help = ec_dict_get(ec_node_attrs(node), EC_INTERACT_HELP_ATTR);
-		if (node_desc == NULL)
-			node_desc = ec_dict_get(ec_node_attrs(node), EC_INTERACT_DESC_ATTR);
-		if (node_desc == NULL) {
-			node_desc = ec_node_desc(node);
-			if (node_desc == NULL)
-				goto fail;
-			desc_to_free = (char *)node_desc;
-		}
-		if (node_desc == NULL)
+	node_desc = ec_dict_get(ec_node_attrs(node), EC_INTERACT_DESC_ATTR);
+	if (node_desc == NULL) {
+		desc_to_free = ec_node_desc(node);
+		if (desc_to_free == NULL)
 			goto fail;
+		node_desc = desc_to_free;
 	}
 
-	if (node_desc == NULL)
-		goto fail;
 	if (node_help == NULL)
 		node_help = "";
 	help->desc = strdup(node_desc);
@@ -247,40 +231,63 @@ fail:
 	return -1;
 }
 
-ssize_t ec_interact_get_helps(
-	const struct ec_node *node,
-	const char *line,
-	struct ec_interact_help **helps_out
-)
+/* this function builds the help string */
+static int get_node_help(const struct ec_comp_item *item, struct ec_interact_help *help)
+{
+	const struct ec_comp_group *grp;
+	const struct ec_pnode *pstate;
+	const char *node_help = NULL;
+
+	grp = ec_comp_item_get_grp(item);
+
+	for (pstate = ec_comp_group_get_pstate(grp); pstate != NULL && node_help == NULL;
+	     pstate = ec_pnode_get_parent(pstate))
+		node_help = ec_dict_get(
+			ec_node_attrs(ec_pnode_get_node(pstate)), EC_INTERACT_HELP_ATTR
+		);
+
+	return build_node_help(ec_comp_group_get_node(grp), node_help, help);
+}
+
+/* this function builds the help string of an expected node */
+static int
+get_expected_help(const struct ec_node *const *path, size_t len, struct ec_interact_help *help)
+{
+	const char *node_help = NULL;
+	size_t i;
+
+	for (i = 0; i < len && node_help == NULL; i++)
+		node_help = ec_dict_get(ec_node_attrs(path[i]), EC_INTERACT_HELP_ATTR);
+
+	return build_node_help(path[0], node_help, help);
+}
+
+struct ec_interact_query {
+	const struct ec_node *node; /**< The sh_lex grammar node. */
+	char *line; /**< The queried line. */
+	struct ec_pnode *parse; /**< The parse tree of the line. */
+	struct ec_comp *comp; /**< The completions, built on demand. */
+};
+
+/* one help for "<return>" if the line matches, then one help per group */
+static ssize_t
+build_helps(bool matches, const struct ec_comp *cmpl, struct ec_interact_help **helps_out)
 {
 	const struct ec_comp_group *grp, *prev_grp = NULL;
+	struct ec_interact_help *helps = NULL;
 	struct ec_comp_item *item;
-	struct ec_comp *cmpl = NULL;
-	struct ec_pnode *parse = NULL;
 	unsigned int count = 0;
-	struct ec_interact_help *helps = NULL;
 
 	*helps_out = NULL;
 
-	/* check if the current line matches */
-	parse = ec_parse(node, line);
-	if (ec_pnode_matches(parse))
-		count = 1;
-	ec_pnode_free(parse);
-	parse = NULL;
-
-	/* complete at current cursor position */
-	cmpl = ec_complete(node, line);
-	if (cmpl == NULL)
-		goto fail;
-
 	helps = calloc(1, sizeof(*helps));
 	if (helps == NULL)
 		goto fail;
-	if (count == 1) {
+	if (matches) {
 		helps[0].desc = strdup("<return>");
 		if (helps[0].desc == NULL)
 			goto fail;
+		count = 1;
 		helps[0].help = strdup("Validate command.");
 		if (helps[0].help == NULL)
 			goto fail;
@@ -306,139 +313,230 @@ ssize_t ec_interact_get_helps(
 		count++;
 	}
 
-	ec_comp_free(cmpl);
-
 	qsort(helps, count, sizeof(struct ec_interact_help), help_strcasecmp_cb);
 	*helps_out = helps;
 
 	return count;
 
 fail:
-	ec_pnode_free(parse);
-	ec_comp_free(cmpl);
-	if (helps != NULL) {
-		while (count--) {
-			free(helps[count].desc);
-			free(helps[count].help);
-		}
-		free(helps);
+	ec_interact_free_helps(helps, count);
+	return -1;
+}
+
+struct ec_interact_query *ec_interact_query(const struct ec_node *node, const char *line)
+{
+	struct ec_interact_query *query = NULL;
+
+	if (node == NULL || line == NULL) {
+		errno = EINVAL;
+		return NULL;
 	}
 
-	return -1;
+	query = calloc(1, sizeof(*query));
+	if (query == NULL)
+		goto fail;
+
+	query->node = node;
+	query->line = strdup(line);
+	if (query->line == NULL)
+		goto fail;
+
+	query->parse = ec_parse_report(node, line);
+	if (query->parse == NULL)
+		goto fail;
+
+	return query;
+
+fail:
+	ec_interact_query_free(query);
+	return NULL;
 }
 
-ssize_t ec_interact_get_error_helps(
-	const struct ec_node *node,
-	const char *line,
+void ec_interact_query_free(struct ec_interact_query *query)
+{
+	if (query == NULL)
+		return;
+
+	ec_comp_free(query->comp);
+	ec_pnode_free(query->parse);
+	free(query->line);
+	free(query);
+}
+
+bool ec_interact_query_matches(const struct ec_interact_query *query)
+{
+	return ec_pnode_matches(query->parse);
+}
+
+struct ec_pnode *ec_interact_query_get_pnode(const struct ec_interact_query *query)
+{
+	return query->parse;
+}
+
+const struct ec_comp *ec_interact_query_get_comp(struct ec_interact_query *query)
+{
+	/* second pass: the completion does not reuse the parse tree */
+	if (query->comp == NULL)
+		query->comp = ec_complete(query->node, query->line);
+
+	return query->comp;
+}
+
+ssize_t
+ec_interact_query_get_helps(struct ec_interact_query *query, struct ec_interact_help **helps_out)
+{
+	const struct ec_comp *cmpl;
+
+	*helps_out = NULL;
+
+	cmpl = ec_interact_query_get_comp(query);
+	if (cmpl == NULL)
+		return -1;
+
+	return build_helps(ec_interact_query_matches(query), cmpl, helps_out);
+}
+
+ssize_t ec_interact_query_get_error_helps(
+	struct ec_interact_query *query,
 	struct ec_interact_help **helps_out,
 	size_t *char_idx
 )
 {
-	struct ec_strvec *line_vec_partial = NULL;
-	const struct ec_strvec *parsed_vec = NULL;
+	const struct ec_parse_failure *failure;
+	struct ec_interact_help *helps = NULL;
+	const struct ec_node *const *path;
 	struct ec_strvec *line_vec = NULL;
-	struct ec_pnode *parse = NULL;
-	struct ec_comp *comp = NULL;
 	const struct ec_dict *attrs;
-	struct ec_node *cmdlist;
-	char *line_copy = NULL;
-	size_t parsed_vec_len;
-	int ret = 0;
-	size_t len;
-	int i;
+	size_t i, n, len, path_len;
+	size_t count = 0;
+	size_t offset;
 
-	if (helps_out == NULL) {
+	if (query == NULL || helps_out == NULL || char_idx == NULL) {
 		errno = EINVAL;
-		goto out;
+		return -1;
 	}
 
 	*helps_out = NULL;
 
-	/* one additional char to add a space at the end */
-	line_copy = malloc(strlen(line) + 2);
-	if (line_copy == NULL)
-		goto fail;
-	strcpy(line_copy, line);
-	line_copy[strlen(line)] = ' ';
-	line_copy[strlen(line) + 1] = '\0';
-
-	if (ec_node_get_child(node, 0, &cmdlist) < 0)
+	/* the parser already knows where it failed, and what it expected */
+	failure = ec_pnode_get_failure(query->parse);
+	if (failure == NULL) {
+		errno = EINVAL;
 		goto fail;
+	}
 
-	line_vec = ec_strvec_sh_lex_str(line, EC_STRVEC_STRICT, NULL);
-	if (line_vec == NULL && errno == EBADMSG)
-		goto fail;
+	/* get the position of the error and store it in char_idx */
+	line_vec = ec_strvec_sh_lex_str(query->line, EC_STRVEC_STRICT, NULL);
 	if (line_vec == NULL)
 		goto fail;
 
 	len = ec_strvec_len(line_vec);
-	for (i = len; i >= 0; i--) {
-		/* build an strvec from the first i tokens + an empty token */
-		line_vec_partial = ec_strvec_ndup(line_vec, 0, i);
-		if (line_vec_partial == NULL)
+	offset = ec_parse_failure_get_offset(failure);
+	if (offset > len)
+		offset = len;
+	if (len == 0) {
+		*char_idx = 0;
+	} else if (offset == len) {
+		attrs = ec_strvec_get_attrs(line_vec, len - 1);
+		if (attrs == NULL)
+			goto fail;
+		*char_idx = (uintptr_t)ec_dict_get(attrs, EC_STRVEC_ATTR_END) + 1;
+	} else {
+		attrs = ec_strvec_get_attrs(line_vec, offset);
+		if (attrs == NULL)
+			goto fail;
+		*char_idx = (uintptr_t)ec_dict_get(attrs, EC_STRVEC_ATTR_START);
+	}
+
+	n = ec_parse_failure_get_count(failure);
+	helps = calloc(n + 1, sizeof(*helps));
+	if (helps == NULL)
+		goto fail;
+
+	if (ec_parse_failure_prefix_matches(failure)) {
+		helps[0].desc = strdup("<return>");
+		if (helps[0].desc == NULL)
 			goto fail;
-		if (ec_strvec_add(line_vec_partial, "") < 0)
+		count = 1;
+		helps[0].help = strdup("Validate command.");
+		if (helps[0].help == NULL)
 			goto fail;
+	}
 
-		/* try to parse and complete this strvec */
-		parse = ec_parse_strvec(cmdlist, line_vec_partial);
-		if (parse == NULL)
+	/* one help per node that failed to parse the token */
+	for (i = 0; i < n; i++) {
+		path = ec_parse_failure_get_path(failure, i, &path_len);
+		if (path == NULL)
 			goto fail;
-		comp = ec_complete_strvec(cmdlist, line_vec_partial);
-		if (comp == NULL)
+		if (get_expected_help(path, path_len, &helps[count]) < 0)
 			goto fail;
+		count++;
+	}
 
-		/* get the length of the parsed vec, if any */
-		parsed_vec = ec_pnode_get_strvec(parse);
-		if (parsed_vec != NULL)
-			parsed_vec_len = ec_strvec_len(parsed_vec);
-		else
-			parsed_vec_len = 0;
-
-		/* if it matches or if it completes, return the helps */
-		if ((ec_pnode_matches(parse) && (int)parsed_vec_len == i)
-		    || ec_comp_count(comp, EC_COMP_ALL) > 0) {
-			/* get the position of the error and store it in char_idx */
-			if (i == (int)len) {
-				attrs = ec_strvec_get_attrs(line_vec, i - 1);
-				if (attrs == NULL)
-					goto fail;
-				*char_idx = (uintptr_t)ec_dict_get(attrs, EC_STRVEC_ATTR_END) + 1;
-			} else {
-				attrs = ec_strvec_get_attrs(line_vec, i);
-				if (attrs == NULL)
-					goto fail;
-				*char_idx = (uintptr_t)ec_dict_get(attrs, EC_STRVEC_ATTR_START);
-			}
-
-			/* build the partial line string */
-			line_copy[*char_idx] = '\0';
-
-			ret = ec_interact_get_helps(node, line_copy, helps_out);
-			goto out;
-		}
+	ec_strvec_free(line_vec);
 
-		ec_pnode_free(parse);
-		parse = NULL;
-		ec_comp_free(comp);
-		comp = NULL;
-		ec_strvec_free(line_vec_partial);
-		line_vec_partial = NULL;
+	if (count == 0) {
+		free(helps);
+		return 0;
 	}
 
-	ret = 0;
+	qsort(helps, count, sizeof(struct ec_interact_help), help_strcasecmp_cb);
+	*helps_out = helps;
 
-out:
-	ec_strvec_free(line_vec_partial);
+	return count;
+
+fail:
 	ec_strvec_free(line_vec);
-	free(line_copy);
-	ec_pnode_free(parse);
-	ec_comp_free(comp);
+	ec_interact_free_helps(helps, count);
+	return -1;
+}
+
+ssize_t ec_interact_get_helps(
+	const struct ec_node *node,
+	const char *line,
+	struct ec_interact_help **helps_out
+)
+{
+	struct ec_interact_query *query;
+	ssize_t ret;
+
+	*helps_out = NULL;
+
+	query = ec_interact_query(node, line);
+	if (query == NULL)
+		return -1;
+
+	ret = ec_interact_query_get_helps(query, helps_out);
+	ec_interact_query_free(query);
+
 	return ret;
+}
 
-fail:
-	ret = -1;
-	goto out;
+ssize_t ec_interact_get_error_helps(
+	const struct ec_node *node,
+	const char *line,
+	struct ec_interact_help **helps_out,
+	size_t *char_idx
+)
+{
+	struct ec_interact_query *query;
+	ssize_t ret;
+
+	if (helps_out == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	*helps_out = NULL;
+
+	query = ec_interact_query(node, line);
+	if (query == NULL)
+		return -1;
+
+	ret = ec_interact_query_get_error_helps(query, helps_out, char_idx);
+	ec_interact_query_free(query);
+
+	return ret;
 }
 
 int ec_interact_print_error_helps(
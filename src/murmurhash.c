@@ -2,6 +2,8 @@
  * Copyright 2016, Olivier MATZ <zer0@droids-corp.org>
  */
 
+#include <string.h>
+
 #include <ecoli/murmurhash.h>
 
 uint32_t ec_murmurhash3(const void *key, int len, uint32_t seed)
@@ -11,11 +13,11 @@ uint32_t ec_murmurhash3(const void *key, int len, uint32_t seed)
 	const int nblocks = len / 4;
 	uint32_t h1 = seed;
 	uint32_t k1;
-	const uint32_t *blocks = (const uint32_t *)(data + nblocks * 4);
 	int i;
 
-	for (i = -nblocks; i; i++) {
-		k1 = blocks[i];
+	/* the key may not be aligned */
+	for (i = 0; i < nblocks; i++) {
+		memcpy(&k1, data + i * 4, sizeof(k1));
 
 		h1 = ec_murmurhash3_add32(h1, k1);
 		h1 = ec_murmurhash3_mix32(h1);
@@ -0,0 +1,200 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2025, Olivier MATZ <zer0@droids-corp.org>
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ecoli/nameset.h>
+
+struct ec_nameset {
+	unsigned int refcnt;
+	char **table;
+	size_t len;
+	size_t size; /* allocated entries */
+	bool sorted; /* table is sorted and without duplicates */
+};
+
+struct ec_nameset *ec_nameset(void)
+{
+	struct ec_nameset *set;
+
+	set = calloc(1, sizeof(*set));
+	if (set == NULL)
+		return NULL;
+	set->refcnt = 1;
+	set->sorted = true;
+
+	return set;
+}
+
+struct ec_nameset *ec_nameset_clone(struct ec_nameset *set)
+{
+	if (set != NULL)
+		set->refcnt++;
+
+	return set;
+}
+
+void ec_nameset_free(struct ec_nameset *set)
+{
+	size_t i;
+
+	if (set == NULL)
+		return;
+
+	if (--set->refcnt > 0)
+		return;
+
+	for (i = 0; i < set->len; i++)
+		free(set->table[i]);
+	free(set->table);
+	free(set);
+}
+
+static int cmp_names(const void *p1, const void *p2)
+{
+	const char *const *name1 = p1, *const *name2 = p2;
+
+	return strcmp(*name1, *name2);
+}
+
+/* sort the names added out of order and remove the duplicates */
+static void nameset_sort(struct ec_nameset *set)
+{
+	size_t i, j;
+
+	if (set->sorted)
+		return;
+
+	qsort(set->table, set->len, sizeof(*set->table), cmp_names);
+	for (i = 1, j = 1; i < set->len; i++) {
+		if (strcmp(set->table[i], set->table[j - 1]))
+			set->table[j++] = set->table[i];
+		else
+			free(set->table[i]);
+	}
+	if (set->len > 0)
+		set->len = j;
+	set->sorted = true;
+}
+
+/* index of the first name greater than or equal to the first len bytes of name */
+static size_t nameset_lower_bound(const struct ec_nameset *set, const char *name, size_t len)
+{
+	size_t lo = 0, hi = set->len, mid;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (strncmp(set->table[mid], name, len) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+/* index of the first name greater than the names starting with prefix */
+static size_t nameset_upper_bound(const struct ec_nameset *set, const char *prefix, size_t len)
+{
+	size_t lo = 0, hi = set->len, mid;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (strncmp(set->table[mid], prefix, len) <= 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+int ec_nameset_add(struct ec_nameset *set, const char *name)
+{
+	char **table;
+	char *dup;
+	size_t size;
+
+	if (set->len == set->size) {
+		size = set->size == 0 ? 16 : set->size * 2;
+		table = realloc(set->table, size * sizeof(*table));
+		if (table == NULL)
+			return -1;
+		set->table = table;
+		set->size = size;
+	}
+
+	dup = strdup(name);
+	if (dup == NULL)
+		return -1;
+
+	/* appending in increasing order keeps the table sorted */
+	if (set->sorted && set->len > 0 && strcmp(name, set->table[set->len - 1]) <= 0)
+		set->sorted = false;
+	set->table[set->len++] = dup;
+
+	return 0;
+}
+
+int ec_nameset_del(struct ec_nameset *set, const char *name)
+{
+	size_t i;
+
+	nameset_sort(set);
+
+	i = nameset_lower_bound(set, name, strlen(name) + 1);
+	if (i == set->len || strcmp(set->table[i], name)) {
+		errno = ENOENT;
+		return -1;
+	}
+
+	free(set->table[i]);
+	memmove(&set->table[i], &set->table[i + 1], (set->len - i - 1) * sizeof(*set->table));
+	set->len--;
+
+	return 0;
+}
+
+bool ec_nameset_has(struct ec_nameset *set, const char *name)
+{
+	size_t i;
+
+	nameset_sort(set);
+
+	i = nameset_lower_bound(set, name, strlen(name) + 1);
+
+	return i < set->len && !strcmp(set->table[i], name);
+}
+
+size_t ec_nameset_len(struct ec_nameset *set)
+{
+	nameset_sort(set);
+
+	return set->len;
+}
+
+const char *ec_nameset_get(struct ec_nameset *set, size_t idx)
+{
+	nameset_sort(set);
+
+	if (idx >= set->len)
+		return NULL;
+
+	return set->table[idx];
+}
+
+size_t ec_nameset_prefix(struct ec_nameset *set, const char *prefix, size_t *first)
+{
+	size_t len = strlen(prefix);
+	size_t last;
+
+	nameset_sort(set);
+
+	*first = nameset_lower_bound(set, prefix, len);
+	last = nameset_upper_bound(set, prefix, len);
+
+	return last - *first;
+}
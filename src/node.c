@@ -4,13 +4,15 @@
 
 #include <assert.h>
 #include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include <ecoli/config.h>
 #include <ecoli/dict.h>
-#include <ecoli/htable.h>
+#include <ecoli/init.h>
 #include <ecoli/log.h>
 #include <ecoli/node.h>
 #include <ecoli/node_int.h>
@@ -20,6 +22,8 @@
 #include <ecoli/string.h>
 #include <ecoli/strvec.h>
 
+#include "node_private.h"
+
 EC_LOG_TYPE_REGISTER(node);
 
 /* These states are used to mark the grammar graph when freeing, to
@@ -29,6 +33,9 @@ enum ec_node_free_state {
 	EC_NODE_FREE_STATE_TRAVERSED,
 	EC_NODE_FREE_STATE_FREEABLE,
 	EC_NODE_FREE_STATE_NOT_FREEABLE,
+	/* not freeable, but a reference not counted in the round was
+	 * dropped: check it again in another round */
+	EC_NODE_FREE_STATE_DROPPED,
 	EC_NODE_FREE_STATE_FREEING,
 };
 
@@ -38,18 +45,37 @@ enum ec_node_free_state {
 struct ec_node {
 	const struct ec_node_type *type; /**< The node type. */
 	struct ec_config *config; /**< Node configuration. */
+	bool lazy_config; /**< Config built on demand by type->get_config(). */
+	bool interned; /**< Registered by ec_node_intern(). */
 	char *id; /**< Node identifier (EC_NO_ID if none). */
 	struct ec_dict *attrs; /**< Attributes of the node. */
 	unsigned int refcnt; /**< Reference counter. */
 	struct {
 		enum ec_node_free_state state; /**< State of loop detection. */
-		unsigned int refcnt; /**< Number of reachable references
-					 *   starting from node being freed. */
+		/** Number of reachable references starting from the nodes
+		 *  being freed, then number of references owned by freeable
+		 *  nodes for the ones that are not freeable. */
+		unsigned int refcnt;
+		struct ec_node *next; /**< Next node of the free round. */
+		struct ec_node *stack; /**< Next node to mark not freeable. */
 	} free; /**< Freeing state: used for loop detection */
 };
 
+/* The list of the nodes marked by a free operation. */
+struct free_round {
+	struct ec_node *head;
+	struct ec_node **tail;
+};
+
+/* The free operation in progress in this thread, if any. */
+static __thread struct free_round *cur_round;
+
 struct ec_node_type_list node_type_list = TAILQ_HEAD_INITIALIZER(node_type_list);
 
+/* Index of node_type_list by name. It is built by ec_init(), once the
+ * hash seed is known: before that, the list is browsed. */
+static struct ec_dict *node_type_index;
+
 static int __ec_node_get_child(
 	const struct ec_node *node,
 	size_t i,
@@ -61,6 +87,13 @@ const struct ec_node_type *ec_node_type_lookup(const char *name)
 {
 	struct ec_node_type *type;
 
+	if (node_type_index != NULL) {
+		type = ec_dict_get(node_type_index, name);
+		if (type == NULL)
+			errno = ENOENT;
+		return type;
+	}
+
 	TAILQ_FOREACH (type, &node_type_list, next) {
 		if (!strcmp(name, type->name))
 			return type;
@@ -77,6 +110,9 @@ int ec_node_type_register(struct ec_node_type *type, bool override)
 		return -1;
 	}
 
+	if (node_type_index != NULL && ec_dict_set(node_type_index, type->name, type, NULL) < 0)
+		return -1;
+
 	TAILQ_INSERT_HEAD(&node_type_list, type, next);
 
 	return 0;
@@ -155,119 +191,284 @@ struct ec_node *ec_node(const char *typename, const char *id)
 	return ec_node_from_type(type, id);
 }
 
-static void count_references(struct ec_node *node, unsigned int refs)
+static void round_add(
+	struct free_round *round,
+	struct ec_node *node,
+	enum ec_node_free_state state,
+	unsigned int refcnt
+)
 {
-	struct ec_node *child;
+	node->free.state = state;
+	node->free.refcnt = refcnt;
+	node->free.next = NULL;
+	*round->tail = node;
+	round->tail = &node->free.next;
+}
+
+/* Browse the nodes reachable from the ones of the round (in breadth-first
+ * order, appending them to the round), and count the references to each
+ * of them. */
+static void count_references(struct free_round *round)
+{
+	struct ec_node *node, *child;
+	unsigned int refs;
 	size_t i, n;
 	int ret;
 
-	if (node->free.state == EC_NODE_FREE_STATE_TRAVERSED) {
-		node->free.refcnt += refs;
-		return;
-	}
-	node->free.refcnt = refs;
-	node->free.state = EC_NODE_FREE_STATE_TRAVERSED;
-	n = ec_node_get_children_count(node);
-	for (i = 0; i < n; i++) {
-		ret = __ec_node_get_child(node, i, &child, &refs);
-		assert(ret == 0);
-		count_references(child, refs);
+	for (node = round->head; node != NULL; node = node->free.next) {
+		n = ec_node_get_children_count(node);
+		for (i = 0; i < n; i++) {
+			ret = __ec_node_get_child(node, i, &child, &refs);
+			assert(ret == 0);
+			if (child->free.state == EC_NODE_FREE_STATE_NONE)
+				round_add(round, child, EC_NODE_FREE_STATE_TRAVERSED, refs);
+			else
+				child->free.refcnt += refs;
+		}
 	}
 }
 
-static void mark_freeable(struct ec_node *node, enum ec_node_free_state mark)
+/* Mark a node and all the nodes reachable from it as not freeable. */
+static void mark_not_freeable(struct ec_node *node)
 {
-	struct ec_node *child;
+	struct ec_node *stack, *child;
 	size_t i, n;
 	int ret;
 
-	if (mark == node->free.state)
-		return;
-
-	if (node->refcnt > node->free.refcnt)
-		mark = EC_NODE_FREE_STATE_NOT_FREEABLE;
-	assert(node->refcnt >= node->free.refcnt);
-	node->free.state = mark;
+	node->free.state = EC_NODE_FREE_STATE_NOT_FREEABLE;
+	node->free.stack = NULL;
+	stack = node;
 
-	n = ec_node_get_children_count(node);
-	for (i = 0; i < n; i++) {
-		ret = ec_node_get_child(node, i, &child);
-		assert(ret == 0);
-		mark_freeable(child, mark);
+	while (stack != NULL) {
+		node = stack;
+		stack = node->free.stack;
+		n = ec_node_get_children_count(node);
+		for (i = 0; i < n; i++) {
+			ret = ec_node_get_child(node, i, &child);
+			assert(ret == 0);
+			if (child->free.state == EC_NODE_FREE_STATE_NOT_FREEABLE)
+				continue;
+			child->free.state = EC_NODE_FREE_STATE_NOT_FREEABLE;
+			child->free.stack = stack;
+			stack = child;
+		}
 	}
 }
 
-static void reset_mark(struct ec_node *node)
+/* Nodes whose references are not all reachable from the round are still
+ * used, and so are the nodes reachable from them. The other ones can be
+ * freed. Then, count the references to the nodes that are not freeable
+ * owned by the freeable ones: they will be dropped during the round. */
+static void mark_freeable(struct free_round *round)
 {
-	struct ec_node *child;
+	struct ec_node *node, *child;
+	unsigned int refs;
 	size_t i, n;
 	int ret;
 
-	if (node->free.state == EC_NODE_FREE_STATE_NONE)
+	for (node = round->head; node != NULL; node = node->free.next) {
+		if (node->free.state != EC_NODE_FREE_STATE_TRAVERSED)
+			continue;
+		assert(node->refcnt >= node->free.refcnt);
+		if (node->refcnt > node->free.refcnt)
+			mark_not_freeable(node);
+	}
+
+	for (node = round->head; node != NULL; node = node->free.next) {
+		if (node->free.state == EC_NODE_FREE_STATE_TRAVERSED)
+			node->free.state = EC_NODE_FREE_STATE_FREEABLE;
+		else
+			node->free.refcnt = 0;
+	}
+
+	for (node = round->head; node != NULL; node = node->free.next) {
+		if (node->free.state != EC_NODE_FREE_STATE_FREEABLE)
+			continue;
+		n = ec_node_get_children_count(node);
+		for (i = 0; i < n; i++) {
+			ret = __ec_node_get_child(node, i, &child, &refs);
+			assert(ret == 0);
+			if (child->free.state == EC_NODE_FREE_STATE_NOT_FREEABLE)
+				child->free.refcnt += refs;
+		}
+	}
+
+	/* hold a reference on each node of the round, so that they can
+	 * be browsed until the end of the round */
+	for (node = round->head; node != NULL; node = node->free.next)
+		node->refcnt++;
+}
+
+/* Remove a node from the interned nodes before it is modified. */
+static void node_forget(struct ec_node *node)
+{
+	if (!node->interned)
 		return;
+	node->interned = false;
+	ec_node_intern_forget(node);
+}
 
-	node->free.state = EC_NODE_FREE_STATE_NONE;
-	node->free.refcnt = 0;
+/* Free everything owned by the node, except the node structure. */
+static void release_node(struct ec_node *node)
+{
+	size_t n;
+
+	node->free.state = EC_NODE_FREE_STATE_FREEING;
+	node_forget(node);
 
+	/* children will be freed by config_free() and free_priv() */
+	ec_config_free(node->config);
+	node->config = NULL;
 	n = ec_node_get_children_count(node);
-	for (i = 0; i < n; i++) {
-		ret = ec_node_get_child(node, i, &child);
-		assert(ret == 0);
-		reset_mark(child);
+	assert(n == 0 || node->type->free_priv != NULL);
+	if (node->type->free_priv != NULL)
+		node->type->free_priv(node);
+	free(node->id);
+	ec_dict_free(node->attrs);
+}
+
+/* Drop a reference to a node while a round is in progress. */
+static void drop_ref(struct free_round *round, struct ec_node *node)
+{
+	switch (node->free.state) {
+	case EC_NODE_FREE_STATE_NONE:
+		/* Not reachable from the round: the parent did not report
+		 * this reference in its children. */
+		if (node->refcnt == 1) {
+			release_node(node);
+			free(node);
+			return;
+		}
+		node->refcnt--;
+		round_add(round, node, EC_NODE_FREE_STATE_DROPPED, 0);
+		node->refcnt++;
+		break;
+	case EC_NODE_FREE_STATE_FREEABLE:
+		release_node(node);
+		node->refcnt--;
+		break;
+	case EC_NODE_FREE_STATE_FREEING:
+		node->refcnt--;
+		break;
+	case EC_NODE_FREE_STATE_NOT_FREEABLE:
+	case EC_NODE_FREE_STATE_DROPPED:
+		node->refcnt--;
+		if (node->free.refcnt > 0)
+			node->free.refcnt--;
+		else
+			node->free.state = EC_NODE_FREE_STATE_DROPPED;
+		/* only the reference held by the round is left */
+		if (node->refcnt == 1)
+			release_node(node);
+		break;
+	case EC_NODE_FREE_STATE_TRAVERSED:
+		assert(false);
+		break;
+	}
+}
+
+/* Release the freeable nodes that were not released by dropping the
+ * references of the round. */
+static void release_freeable(struct free_round *round)
+{
+	struct ec_node *node;
+
+	for (node = round->head; node != NULL; node = node->free.next) {
+		if (node->free.state == EC_NODE_FREE_STATE_FREEABLE)
+			release_node(node);
+	}
+}
+
+/* Drop the references held by the round, free the released nodes and
+ * reset the marks of the other ones. Return the list of nodes to check
+ * again in another round. */
+static struct ec_node *end_round(struct free_round *round)
+{
+	struct ec_node *node, *next, *dropped = NULL;
+
+	for (node = round->head; node != NULL; node = next) {
+		next = node->free.next;
+		node->refcnt--;
+		if (node->refcnt == 0) {
+			assert(node->free.state == EC_NODE_FREE_STATE_FREEING);
+			free(node);
+			continue;
+		}
+		assert(node->free.state != EC_NODE_FREE_STATE_FREEING);
+		if (node->free.state == EC_NODE_FREE_STATE_DROPPED) {
+			node->free.next = dropped;
+			dropped = node;
+		}
+		node->free.state = EC_NODE_FREE_STATE_NONE;
+		node->free.refcnt = 0;
 	}
+
+	return dropped;
 }
 
 /* free a node, taking care of loops in the node graph */
 void ec_node_free(struct ec_node *node)
 {
-	size_t n;
+	struct ec_node *dropped, *next;
+	struct free_round round;
 
 	if (node == NULL)
 		return;
 
 	assert(node->refcnt > 0);
 
-	if (node->free.state == EC_NODE_FREE_STATE_NONE && node->refcnt != 1) {
-		/* Traverse the node tree starting from this node, and for each
-		 * node, count the number of reachable references. Then, all
-		 * nodes whose reachable references == total reference are
-		 * marked as freeable, and other are marked as unfreeable. Any
-		 * node reachable from an unfreeable node is also marked as
-		 * unfreeable. */
-		if (node->free.state == EC_NODE_FREE_STATE_NONE) {
-			count_references(node, 1);
-			mark_freeable(node, EC_NODE_FREE_STATE_FREEABLE);
-		}
+	if (cur_round != NULL) {
+		drop_ref(cur_round, node);
+		return;
 	}
 
-	if (node->free.state == EC_NODE_FREE_STATE_NOT_FREEABLE) {
+	/* a node without children cannot be part of a loop */
+	if (ec_node_get_children_count(node) == 0) {
 		node->refcnt--;
-		reset_mark(node);
+		if (node->refcnt == 0) {
+			release_node(node);
+			free(node);
+		}
 		return;
 	}
 
-	if (node->free.state != EC_NODE_FREE_STATE_FREEING) {
-		node->free.state = EC_NODE_FREE_STATE_FREEING;
-
-		/* children will be freed by config_free() and free_priv() */
-		ec_config_free(node->config);
-		node->config = NULL;
-		n = ec_node_get_children_count(node);
-		assert(n == 0 || node->type->free_priv != NULL);
-		if (node->type->free_priv != NULL)
-			node->type->free_priv(node);
-		free(node->id);
-		ec_dict_free(node->attrs);
+	/* Traverse the node graph once starting from this node, and for
+	 * each node, count the number of reachable references. Then, all
+	 * nodes whose reachable references == total reference are marked
+	 * as freeable, and other are marked as unfreeable. Any node
+	 * reachable from an unfreeable node is also marked as unfreeable.
+	 * The references dropped while the freeable nodes are released do
+	 * not trigger another traversal. */
+	cur_round = &round;
+	round.head = NULL;
+	round.tail = &round.head;
+	round_add(&round, node, EC_NODE_FREE_STATE_TRAVERSED, 1);
+	count_references(&round);
+	mark_freeable(&round);
+	if (node->free.state == EC_NODE_FREE_STATE_NOT_FREEABLE)
+		node->refcnt--;
+	else
+		drop_ref(&round, node);
+	release_freeable(&round);
+	dropped = end_round(&round);
+
+	/* Some types do not report all the references they hold in their
+	 * children. If such a reference to a node that was not freeable is
+	 * dropped, check again if the node is still used. */
+	while (dropped != NULL) {
+		round.head = NULL;
+		round.tail = &round.head;
+		for (node = dropped; node != NULL; node = next) {
+			next = node->free.next;
+			round_add(&round, node, EC_NODE_FREE_STATE_TRAVERSED, 0);
+		}
+		count_references(&round);
+		mark_freeable(&round);
+		release_freeable(&round);
+		dropped = end_round(&round);
 	}
 
-	node->refcnt--;
-	if (node->refcnt != 0)
-		return;
-
-	node->free.state = EC_NODE_FREE_STATE_NONE;
-	node->free.refcnt = 0;
-
-	free(node);
+	cur_round = NULL;
 }
 
 struct ec_node *ec_node_clone(struct ec_node *node)
@@ -307,6 +508,8 @@ int ec_node_get_child(const struct ec_node *node, size_t i, struct ec_node **chi
 
 int ec_node_set_config(struct ec_node *node, struct ec_config *config)
 {
+	node_forget(node);
+
 	if (node->type->schema == NULL) {
 		errno = ENOTSUP;
 		goto fail;
@@ -323,6 +526,7 @@ int ec_node_set_config(struct ec_node *node, struct ec_config *config)
 
 	ec_config_free(node->config);
 	node->config = config;
+	node->lazy_config = false;
 
 	return 0;
 
@@ -333,26 +537,333 @@ fail:
 
 const struct ec_config *ec_node_get_config(const struct ec_node *node)
 {
+	struct ec_node *mutable_node = (struct ec_node *)node;
+
+	if (node->config == NULL && node->lazy_config) {
+		mutable_node->config = node->type->get_config(node);
+		if (node->config == NULL)
+			return NULL;
+		mutable_node->lazy_config = false;
+	}
+
 	return node->config;
 }
 
-struct ec_node *ec_node_find(struct ec_node *node, const char *id)
+void ec_node_invalidate_config(struct ec_node *node)
+{
+	struct ec_config *config = node->config;
+
+	assert(node->type->get_config != NULL);
+
+	node_forget(node);
+
+	/* detach the config before freeing it, so that the nodes it
+	 * references are not counted as children while they are freed */
+	node->config = NULL;
+	node->lazy_config = true;
+	ec_config_free(config);
+}
+
+bool ec_node_has_config(const struct ec_node *node)
 {
-	struct ec_node_iter *iter_root, *iter;
-	struct ec_node *iter_node;
+	return node->config != NULL;
+}
 
-	iter_root = ec_node_iter(node);
-	for (iter = iter_root; iter != NULL; iter = ec_node_iter_next(iter_root, iter, true)) {
-		iter_node = ec_node_iter_get_node(iter);
-		if (!strcmp(ec_node_id(iter_node), id))
-			break;
+bool ec_node_is_interned(const struct ec_node *node)
+{
+	return node->interned;
+}
+
+void ec_node_set_interned(struct ec_node *node, bool interned)
+{
+	node->interned = interned;
+}
+
+/* Number of nodes that can be browsed without allocating memory. */
+#define VISIT_SET_SIZE 128
+#define VISIT_STACK_SIZE 32
+
+/* Set of the visited nodes: open addressing on the node addresses. */
+struct visit_set {
+	const struct ec_node **table;
+	size_t size; /* power of 2 */
+	size_t len;
+	const struct ec_node *buf[VISIT_SET_SIZE];
+};
+
+/* A node whose children are being browsed. */
+struct visit_frame {
+	struct ec_node *node;
+	size_t child; /* next child to browse */
+	size_t n; /* number of children to browse */
+};
+
+struct visit_stack {
+	struct visit_frame *frames;
+	size_t size;
+	size_t len;
+	struct visit_frame buf[VISIT_STACK_SIZE];
+};
+
+static size_t visit_hash(const struct ec_node *node, size_t size)
+{
+	uint64_t h = (uintptr_t)node;
+
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+
+	return h & (size - 1);
+}
+
+static void visit_set_insert(const struct ec_node **table, size_t size, const struct ec_node *node)
+{
+	size_t i;
+
+	for (i = visit_hash(node, size); table[i] != NULL; i = (i + 1) & (size - 1))
+		;
+	table[i] = node;
+}
+
+/* Add a node in the set. Return 1 if it was already in it, 0 if it was
+ * added, or -1 on error. */
+static int visit_set_add(struct visit_set *set, const struct ec_node *node)
+{
+	const struct ec_node **table;
+	size_t i, mask;
+
+	mask = set->size - 1;
+	for (i = visit_hash(node, set->size); set->table[i] != NULL; i = (i + 1) & mask) {
+		if (set->table[i] == node)
+			return 1;
 	}
-	ec_node_iter_free(iter_root);
 
-	if (iter == NULL)
+	/* keep the table half empty */
+	if ((set->len + 1) * 2 > set->size) {
+		table = calloc(set->size * 2, sizeof(*table));
+		if (table == NULL)
+			return -1;
+		for (i = 0; i < set->size; i++) {
+			if (set->table[i] != NULL)
+				visit_set_insert(table, set->size * 2, set->table[i]);
+		}
+		if (set->table != set->buf)
+			free(set->table);
+		set->table = table;
+		set->size *= 2;
+	}
+
+	visit_set_insert(set->table, set->size, node);
+	set->len++;
+
+	return 0;
+}
+
+static int visit_stack_push(struct visit_stack *stack, struct ec_node *node, size_t n)
+{
+	struct visit_frame *frames;
+
+	if (stack->len == stack->size) {
+		if (stack->frames == stack->buf) {
+			frames = malloc(stack->size * 2 * sizeof(*frames));
+			if (frames != NULL)
+				memcpy(frames, stack->buf, sizeof(stack->buf));
+		} else {
+			frames = realloc(stack->frames, stack->size * 2 * sizeof(*frames));
+		}
+		if (frames == NULL)
+			return -1;
+		stack->frames = frames;
+		stack->size *= 2;
+	}
+
+	stack->frames[stack->len].node = node;
+	stack->frames[stack->len].child = 0;
+	stack->frames[stack->len].n = n;
+	stack->len++;
+
+	return 0;
+}
+
+/* Convert the return value of a callback. */
+static int visit_action(int action)
+{
+	if (action < 0)
+		return -1;
+	if (action == EC_NODE_VISIT_STOP)
+		return 1;
+	return 0;
+}
+
+/* Visit a node reached from parent if it was not visited yet. */
+static int visit_enter(
+	struct visit_set *set,
+	struct visit_stack *stack,
+	struct ec_node *node,
+	struct ec_node *parent,
+	ec_node_visit_t pre,
+	void *opaque
+)
+{
+	int action = EC_NODE_VISIT_CONTINUE;
+	int ret;
+
+	ret = visit_set_add(set, node);
+	if (ret != 0)
+		return ret < 0 ? -1 : 0;
+
+	if (pre != NULL)
+		action = pre(node, parent, opaque);
+	if (action < 0 || action == EC_NODE_VISIT_STOP)
+		return visit_action(action);
+
+	if (action == EC_NODE_VISIT_SKIP)
+		return visit_stack_push(stack, node, 0);
+
+	return visit_stack_push(stack, node, ec_node_get_children_count(node));
+}
+
+int ec_node_visit(struct ec_node *node, ec_node_visit_t pre, ec_node_visit_t post, void *opaque)
+{
+	struct visit_stack stack;
+	struct visit_frame *frame;
+	struct ec_node *child, *parent;
+	struct visit_set set;
+	int ret;
+
+	memset(set.buf, 0, sizeof(set.buf));
+	set.table = set.buf;
+	set.size = VISIT_SET_SIZE;
+	set.len = 0;
+	stack.frames = stack.buf;
+	stack.size = VISIT_STACK_SIZE;
+	stack.len = 0;
+
+	ret = visit_enter(&set, &stack, node, NULL, pre, opaque);
+	while (ret == 0 && stack.len > 0) {
+		frame = &stack.frames[stack.len - 1];
+		if (frame->child < frame->n) {
+			ret = ec_node_get_child(frame->node, frame->child++, &child);
+			assert(ret == 0);
+			ret = visit_enter(&set, &stack, child, frame->node, pre, opaque);
+			continue;
+		}
+
+		stack.len--;
+		if (post == NULL)
+			continue;
+		parent = stack.len > 0 ? stack.frames[stack.len - 1].node : NULL;
+		ret = visit_action(post(frame->node, parent, opaque));
+	}
+
+	if (set.table != set.buf)
+		free(set.table);
+	if (stack.frames != stack.buf)
+		free(stack.frames);
+
+	return ret;
+}
+
+struct find_ctx {
+	const char *id;
+	struct ec_node *node;
+};
+
+static int find_cb(struct ec_node *node, struct ec_node *parent, void *opaque)
+{
+	struct find_ctx *ctx = opaque;
+
+	(void)parent;
+
+	if (strcmp(ec_node_id(node), ctx->id))
+		return EC_NODE_VISIT_CONTINUE;
+
+	ctx->node = node;
+	return EC_NODE_VISIT_STOP;
+}
+
+struct ec_node *ec_node_find(struct ec_node *node, const char *id)
+{
+	struct find_ctx ctx = {id, NULL};
+
+	if (ec_node_visit(node, find_cb, NULL, &ctx) < 0)
 		return NULL;
 
-	return iter_node;
+	return ctx.node;
+}
+
+static int uses_parse_tree_cb(struct ec_node *node, struct ec_node *parent, void *opaque)
+{
+	(void)parent;
+	(void)opaque;
+
+	if (ec_node_type(node)->uses_parse_tree)
+		return EC_NODE_VISIT_STOP;
+
+	return EC_NODE_VISIT_CONTINUE;
+}
+
+int ec_node_uses_parse_tree(struct ec_node *node)
+{
+	return ec_node_visit(node, uses_parse_tree_cb, NULL, NULL);
+}
+
+struct ec_node_index {
+	struct ec_node *node;
+	struct ec_dict *ids;
+};
+
+static int index_cb(struct ec_node *node, struct ec_node *parent, void *opaque)
+{
+	struct ec_node_index *index = opaque;
+	const char *id = ec_node_id(node);
+
+	(void)parent;
+
+	/* keep the first node in pre-order, like ec_node_find() */
+	if (ec_dict_has_key(index->ids, id))
+		return EC_NODE_VISIT_CONTINUE;
+
+	return ec_dict_set(index->ids, id, node, NULL);
+}
+
+struct ec_node_index *ec_node_index(struct ec_node *node)
+{
+	struct ec_node_index *index;
+
+	index = calloc(1, sizeof(*index));
+	if (index == NULL)
+		goto fail;
+
+	index->ids = ec_dict();
+	if (index->ids == NULL)
+		goto fail;
+
+	if (ec_node_visit(node, index_cb, NULL, index) < 0)
+		goto fail;
+
+	index->node = ec_node_clone(node);
+
+	return index;
+
+fail:
+	ec_node_index_free(index);
+	return NULL;
+}
+
+struct ec_node *ec_node_index_find(const struct ec_node_index *index, const char *id)
+{
+	return ec_dict_get(index->ids, id);
+}
+
+void ec_node_index_free(struct ec_node_index *index)
+{
+	if (index == NULL)
+		return;
+
+	ec_dict_free(index->ids);
+	ec_node_free(index->node);
+	free(index);
 }
 
 TAILQ_HEAD(ec_node_iter_list, ec_node_iter);
@@ -401,65 +912,57 @@ ec_node_iter_next(struct ec_node_iter *root, struct ec_node_iter *iter, bool ite
 	return NULL;
 }
 
-static int __ec_node_iter(struct ec_node_iter *iter, struct ec_htable *seen_nodes)
-{
-	struct ec_node_iter *child = NULL;
-	struct ec_node *child_node;
-	size_t n, i;
-	int ret;
-
-	n = ec_node_get_children_count(iter->node);
-	for (i = 0; i < n; i++) {
-		ret = ec_node_get_child(iter->node, i, &child_node);
-		assert(ret == 0);
-		if (ec_htable_has_key(seen_nodes, child_node, sizeof(*child_node)))
-			continue;
-
-		if (ec_htable_set(seen_nodes, child_node, sizeof(*child_node), NULL, NULL) < 0)
-			return -1;
+/* The iterator of the last visited node whose children are browsed. */
+struct iter_ctx {
+	struct ec_node_iter *root;
+	struct ec_node_iter *cur;
+};
 
-		child = calloc(1, sizeof(*child));
-		if (child == NULL)
-			return -1;
+static int iter_pre_cb(struct ec_node *node, struct ec_node *parent, void *opaque)
+{
+	struct iter_ctx *ctx = opaque;
+	struct ec_node_iter *iter;
 
-		TAILQ_INSERT_TAIL(&iter->children, child, next);
-		child->parent = iter;
-		child->node = child_node;
-		TAILQ_INIT(&child->children);
+	(void)parent;
 
-		if (__ec_node_iter(child, seen_nodes) < 0)
-			return -1;
-	}
+	iter = calloc(1, sizeof(*iter));
+	if (iter == NULL)
+		return -1;
 
-	return 0;
+	TAILQ_INIT(&iter->children);
+	iter->node = node;
+	iter->parent = ctx->cur;
+	if (ctx->cur == NULL)
+		ctx->root = iter;
+	else
+		TAILQ_INSERT_TAIL(&ctx->cur->children, iter, next);
+	ctx->cur = iter;
+
+	return EC_NODE_VISIT_CONTINUE;
 }
 
-struct ec_node_iter *ec_node_iter(struct ec_node *node)
+static int iter_post_cb(struct ec_node *node, struct ec_node *parent, void *opaque)
 {
-	struct ec_htable *seen_nodes = NULL;
-	struct ec_node_iter *iter = NULL;
+	struct iter_ctx *ctx = opaque;
 
-	seen_nodes = ec_htable();
-	if (seen_nodes == NULL)
-		goto fail;
+	(void)node;
+	(void)parent;
 
-	iter = calloc(1, sizeof(*iter));
-	if (iter == NULL)
-		goto fail;
-	TAILQ_INIT(&iter->children);
-	iter->node = node;
+	ctx->cur = ctx->cur->parent;
 
-	if (__ec_node_iter(iter, seen_nodes) < 0)
-		goto fail;
+	return EC_NODE_VISIT_CONTINUE;
+}
 
-	ec_htable_free(seen_nodes);
+struct ec_node_iter *ec_node_iter(struct ec_node *node)
+{
+	struct iter_ctx ctx = {NULL, NULL};
 
-	return iter;
+	if (ec_node_visit(node, iter_pre_cb, iter_post_cb, &ctx) < 0) {
+		ec_node_iter_free(ctx.root);
+		return NULL;
+	}
 
-fail:
-	ec_htable_free(seen_nodes);
-	ec_node_iter_free(iter);
-	return NULL;
+	return ctx.root;
 }
 
 struct ec_node *ec_node_iter_get_node(struct ec_node_iter *iter)
@@ -491,6 +994,25 @@ const char *ec_node_id(const struct ec_node *node)
 	return node->id;
 }
 
+int ec_node_set_id(struct ec_node *node, const char *id)
+{
+	char *dup;
+
+	if (id == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	dup = strdup(id);
+	if (dup == NULL)
+		return -1;
+	node_forget(node);
+	free(node->id);
+	node->id = dup;
+
+	return 0;
+}
+
 static void
 __ec_node_dump(FILE *out, const struct ec_node *node, size_t indent, struct ec_dict *dict)
 {
@@ -585,7 +1107,7 @@ char *ec_node_desc(const struct ec_node *node)
 
 int ec_node_check_type(const struct ec_node *node, const struct ec_node_type *type)
 {
-	if (strcmp(node->type->name, type->name)) {
+	if (node->type != type && strcmp(node->type->name, type->name)) {
 		errno = EINVAL;
 		return -1;
 	}
@@ -609,3 +1131,44 @@ void ec_node_schema_dump(FILE *out, const struct ec_node *node)
 {
 	ec_config_schema_dump(out, node->type->schema, node->type->name);
 }
+
+static int ec_node_init_func(void)
+{
+	struct ec_node_type *type;
+	struct ec_dict *index;
+
+	index = ec_dict();
+	if (index == NULL)
+		return -1;
+
+	/* the most recently registered types are at the head of the list:
+	 * browse it from the tail, so that they override the previous ones */
+	TAILQ_FOREACH_REVERSE(type, &node_type_list, ec_node_type_list, next)
+	{
+		if (ec_dict_set(index, type->name, type, NULL) < 0) {
+			ec_dict_free(index);
+			return -1;
+		}
+	}
+
+	if (node_type_index != NULL)
+		ec_dict_free(node_type_index);
+	node_type_index = index;
+
+	return 0;
+}
+
+static void ec_node_exit_func(void)
+{
+	if (node_type_index != NULL)
+		ec_dict_free(node_type_index);
+	node_type_index = NULL;
+}
+
+static struct ec_init ec_node_init = {
+	.init = ec_node_init_func,
+	.exit = ec_node_exit_func,
+	.priority = 60,
+};
+
+EC_INIT_REGISTER(ec_node_init);
@@ -3,7 +3,10 @@
  */
 
 #include <errno.h>
+#include <pthread.h>
 #include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -11,28 +14,29 @@
 
 #include <ecoli/complete.h>
 #include <ecoli/config.h>
+#include <ecoli/htable.h>
 #include <ecoli/init.h>
 #include <ecoli/log.h>
 #include <ecoli/node.h>
 #include <ecoli/node_cmd.h>
-#include <ecoli/node_expr.h>
 #include <ecoli/node_helper.h>
-#include <ecoli/node_int.h>
 #include <ecoli/node_many.h>
 #include <ecoli/node_option.h>
 #include <ecoli/node_or.h>
-#include <ecoli/node_re.h>
-#include <ecoli/node_re_lex.h>
 #include <ecoli/node_seq.h>
 #include <ecoli/node_str.h>
 #include <ecoli/node_subset.h>
 #include <ecoli/parse.h>
-#include <ecoli/strvec.h>
 
 EC_LOG_TYPE_REGISTER(node_cmd);
 
-static struct ec_node *ec_node_cmd_parser; /* the expression parser. */
-static struct ec_node *ec_node_cmd_expr; /* the expr parser without lexer. */
+/* above this number of built commands, the cache is flushed */
+#define CMD_CACHE_MAX 1024
+
+/* built commands, indexed by the command string and the children */
+static struct ec_htable *cmd_cache;
+/* protects the cache, and the references taken on the cached commands */
+static pthread_mutex_t cmd_cache_lock = PTHREAD_MUTEX_INITIALIZER;
 
 struct ec_node_cmd {
 	char *cmd_str; /* the command string. */
@@ -41,393 +45,429 @@ struct ec_node_cmd {
 	unsigned int len; /* len of the table. */
 };
 
-/* passed as user context to expression parser */
-struct ec_node_cmd_ctx {
-	struct ec_node **table;
-	unsigned int len;
+/*
+ * Compiler for the command expressions. The grammar, from the lowest to
+ * the highest precedence, is:
+ *
+ * expr = or ( or )*
+ * or = list ( "|" list )*
+ * list = all ( "," all )*
+ * all = term ( "&" term )*
+ * term = ( word | "(" expr ")" | "[" expr "]" ) [ "*" | "+" ]
+ *
+ * The operands of a binary operator are combined the same way as the
+ * generic ec_node_expr evaluation did when it was used to build the
+ * commands: the operands after the first one are folded from left to
+ * right, then the first operand is combined with the result. This
+ * matters because the combination reuses the seq, or and subset nodes
+ * of the operands, which gives the order of their children.
+ */
+struct cmd_compiler {
+	const char *str; /* the command string */
+	size_t off; /* current offset in the string */
+	struct ec_node **table; /* table of node referenced in command */
+	size_t len; /* len of the table */
 };
 
-static int ec_node_cmd_eval_var(void **result, void *userctx, const struct ec_pnode *var)
+static bool cmd_is_word_char(char c)
+{
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')
+		|| c == '.' || c == '_' || c == '-';
+}
+
+/* Skip blanks and return the first character of the next token. */
+static char cmd_peek(struct cmd_compiler *cc)
+{
+	while (cc->str[cc->off] == ' ' || cc->str[cc->off] == '\t')
+		cc->off++;
+
+	return cc->str[cc->off];
+}
+
+static bool cmd_is_type(const struct ec_node *node, const char *type_name)
+{
+	return !strcmp(ec_node_get_type_name(node), type_name);
+}
+
+/* A word references a node whose id matches, else it is a string node. */
+static struct ec_node *cmd_word(struct cmd_compiler *cc)
 {
-	const struct ec_strvec *vec;
-	struct ec_node_cmd_ctx *ctx = userctx;
-	struct ec_node *eval = NULL;
-	const char *str, *id;
-	unsigned int i;
-
-	/* get parsed string vector, it should contain only one str */
-	vec = ec_pnode_get_strvec(var);
-	if (ec_strvec_len(vec) != 1) {
+	struct ec_node *node;
+	const char *id;
+	size_t i, len = 0;
+	char *word;
+
+	while (cmd_is_word_char(cc->str[cc->off + len]))
+		len++;
+	if (len == 0) {
 		errno = EINVAL;
-		return -1;
+		return NULL;
 	}
-	str = ec_strvec_val(vec, 0);
 
-	for (i = 0; i < ctx->len; i++) {
-		id = ec_node_id(ctx->table[i]);
-		if (id == NULL)
-			continue;
-		if (strcmp(str, id))
-			continue;
-		/* if id matches, use a node provided by the user... */
-		eval = ec_node_clone(ctx->table[i]);
-		if (eval == NULL)
-			return -1;
-		break;
-	}
+	word = strndup(&cc->str[cc->off], len);
+	if (word == NULL)
+		return NULL;
+	cc->off += len;
 
-	/* ...or create a string node */
-	if (eval == NULL) {
-		eval = ec_node_str(EC_NO_ID, str);
-		if (eval == NULL)
-			return -1;
+	for (i = 0; i < cc->len; i++) {
+		id = ec_node_id(cc->table[i]);
+		if (id != NULL && !strcmp(id, word)) {
+			free(word);
+			return ec_node_clone(cc->table[i]);
+		}
 	}
 
-	*result = eval;
+	node = ec_node_str(EC_NO_ID, word);
+	free(word);
 
-	return 0;
+	return node;
 }
 
-static int ec_node_cmd_eval_pre_op(
-	void **result,
-	void *userctx,
-	void *operand,
-	const struct ec_pnode *operator
-)
+/* The subsets built by ',' have min = 1, the ones built by '&' have min > 1. */
+static bool cmd_is_subset(const struct ec_node *node, bool all)
 {
-	(void)result;
-	(void)userctx;
-	(void)operand;
-	(void)operator;
-
-	errno = EINVAL;
-	return -1;
+	if (!cmd_is_type(node, "subset"))
+		return false;
+	if (all)
+		return ec_node_subset_get_min(node) > 1;
+	return ec_node_subset_get_min(node) == 1;
 }
 
-static int ec_node_cmd_eval_post_op(
-	void **result,
-	void *userctx,
-	void *operand,
-	const struct ec_pnode *operator
-)
+/* Combine two operands with ',' or '&'. The operands are always consumed. */
+static struct ec_node *cmd_subset(struct ec_node *in1, char op, struct ec_node *in2)
 {
-	const struct ec_strvec *vec;
-	struct ec_node *in = operand;
-	struct ec_node *out = NULL;
-
-	(void)userctx;
-
-	/* get parsed string vector, it should contain only one str */
-	vec = ec_pnode_get_strvec(operator);
-	if (ec_strvec_len(vec) != 1) {
-		errno = EINVAL;
-		return -1;
+	struct ec_node *out = NULL, *add = NULL;
+	bool all = op == '&';
+
+	if (!all && cmd_is_subset(in2, all)) {
+		out = in2;
+		add = in1;
+	} else if (cmd_is_subset(in1, all)) {
+		out = in1;
+		add = in2;
+	} else if (all && cmd_is_subset(in2, all)) {
+		out = in2;
+		add = in1;
+	} else {
+		out = EC_NODE_SUBSET(EC_NO_ID, ec_node_clone(in1), ec_node_clone(in2));
+		ec_node_free(in1);
+		ec_node_free(in2);
+		if (out == NULL)
+			return NULL;
 	}
 
-	if (!strcmp(ec_strvec_val(vec, 0), "*")) {
-		out = ec_node_many(EC_NO_ID, ec_node_clone(in), 0, 0);
-		if (out == NULL)
-			return -1;
-		ec_node_free(in);
-		*result = out;
-	} else if (!strcmp(ec_strvec_val(vec, 0), "+")) {
-		out = ec_node_many(EC_NO_ID, ec_node_clone(in), 1, 0);
-		if (out == NULL)
-			return -1;
-		ec_node_free(in);
-		*result = out;
-	} else {
-		errno = EINVAL;
-		return -1;
+	if (add != NULL) {
+		if (ec_node_subset_add(out, ec_node_clone(add)) < 0)
+			goto fail;
+		ec_node_free(add);
+		add = NULL;
 	}
 
-	return 0;
+	if (ec_node_subset_set_min(out, all ? ec_node_get_children_count(out) : 1) < 0)
+		goto fail;
+
+	return out;
+
+fail:
+	ec_node_free(out);
+	ec_node_free(add);
+	return NULL;
 }
 
-static int ec_node_cmd_eval_bin_op(
-	void **result,
-	void *userctx,
-	void *operand1,
-	const struct ec_pnode *operator,
-	void *operand2
-)
+/*
+ * Combine two operands with a binary operator, ' ' being the sequence.
+ * The operands are always consumed.
+ */
+static struct ec_node *cmd_bin_op(struct ec_node *in1, char op, struct ec_node *in2)
 {
-	const struct ec_strvec *vec;
 	struct ec_node *out = NULL;
-	struct ec_node *in1 = operand1;
-	struct ec_node *in2 = operand2;
-
-	(void)userctx;
 
-	/* get parsed string vector, it should contain only one str */
-	vec = ec_pnode_get_strvec(operator);
-	if (ec_strvec_len(vec) > 1) {
-		errno = EINVAL;
-		return -1;
-	}
+	if (in1 == NULL || in2 == NULL)
+		goto fail;
 
-	if (ec_strvec_len(vec) == 0) {
-		if (!strcmp(ec_node_get_type_name(in1), "seq")) {
+	switch (op) {
+	case ' ':
+		if (cmd_is_type(in1, "seq")) {
 			if (ec_node_seq_add(in1, ec_node_clone(in2)) < 0)
-				return -1;
-			ec_node_free(in2);
-			*result = in1;
-		} else {
-			out = EC_NODE_SEQ(EC_NO_ID, ec_node_clone(in1), ec_node_clone(in2));
-			if (out == NULL)
-				return -1;
-			ec_node_free(in1);
+				goto fail;
 			ec_node_free(in2);
-			*result = out;
+			return in1;
 		}
-	} else if (!strcmp(ec_strvec_val(vec, 0), "|")) {
-		if (!strcmp(ec_node_get_type_name(in2), "or")) {
+		out = EC_NODE_SEQ(EC_NO_ID, ec_node_clone(in1), ec_node_clone(in2));
+		break;
+	case '|':
+		if (cmd_is_type(in2, "or")) {
 			if (ec_node_or_add(in2, ec_node_clone(in1)) < 0)
-				return -1;
+				goto fail;
 			ec_node_free(in1);
-			*result = in2;
-		} else if (!strcmp(ec_node_get_type_name(in1), "or")) {
-			if (ec_node_or_add(in1, ec_node_clone(in2)) < 0)
-				return -1;
-			ec_node_free(in2);
-			*result = in1;
-		} else {
-			out = EC_NODE_OR(EC_NO_ID, ec_node_clone(in1), ec_node_clone(in2));
-			if (out == NULL)
-				return -1;
-			ec_node_free(in1);
-			ec_node_free(in2);
-			*result = out;
+			return in2;
 		}
-	} else if (!strcmp(ec_strvec_val(vec, 0), ",")) {
-		if (!strcmp(ec_node_get_type_name(in2), "subset")
-		    && ec_node_subset_get_min(in2) == 1) {
-			if (ec_node_subset_add(in2, ec_node_clone(in1)) < 0)
-				return -1;
-			ec_node_free(in1);
-			*result = in2;
-		} else if (
-			/* clang-format off */
-			!strcmp(ec_node_get_type_name(in1), "subset")
-			&& ec_node_subset_get_min(in1) == 1
-			/* clang-format on */
-		) {
-			if (ec_node_subset_add(in1, ec_node_clone(in2)) < 0)
-				return -1;
-			ec_node_free(in2);
-			*result = in1;
-		} else {
-			out = EC_NODE_SUBSET(EC_NO_ID, ec_node_clone(in1), ec_node_clone(in2));
-			if (out == NULL)
-				return -1;
-			ec_node_free(in1);
-			ec_node_free(in2);
-			*result = out;
-		}
-		if (ec_node_subset_set_min(*result, 1) < 0)
-			return -1;
-	} else if (!strcmp(ec_strvec_val(vec, 0), "&")) {
-		if (!strcmp(ec_node_get_type_name(in1), "subset")
-		    && ec_node_subset_get_min(in1) > 1) {
-			if (ec_node_subset_add(in1, ec_node_clone(in2)) < 0)
-				return -1;
-			ec_node_free(in2);
-			*result = in1;
-		} else if (
-			/* clang-format off */
-			!strcmp(ec_node_get_type_name(in2), "subset")
-			&& ec_node_subset_get_min(in2) > 1
-			/* clang-format on */
-		) {
-			if (ec_node_subset_add(in2, ec_node_clone(in1)) < 0)
-				return -1;
-			ec_node_free(in1);
-			*result = in2;
-		} else {
-			out = EC_NODE_SUBSET(EC_NO_ID, ec_node_clone(in1), ec_node_clone(in2));
-			if (out == NULL)
-				return -1;
-			ec_node_free(in1);
+		if (cmd_is_type(in1, "or")) {
+			if (ec_node_or_add(in1, ec_node_clone(in2)) < 0)
+				goto fail;
 			ec_node_free(in2);
-			*result = out;
+			return in1;
 		}
-		if (ec_node_subset_set_min(*result, ec_node_get_children_count(*result)) < 0)
-			return -1;
-	} else {
+		out = EC_NODE_OR(EC_NO_ID, ec_node_clone(in1), ec_node_clone(in2));
+		break;
+	case ',':
+	case '&':
+		return cmd_subset(in1, op, in2);
+	default:
 		errno = EINVAL;
-		return -1;
+		goto fail;
 	}
 
-	return 0;
-}
+	ec_node_free(in1);
+	ec_node_free(in2);
+	return out;
 
-static int ec_node_cmd_eval_parenthesis(
-	void **result,
-	void *userctx,
-	const struct ec_pnode *open_paren,
-	const struct ec_pnode *close_paren,
-	void *value
-)
-{
-	const struct ec_strvec *vec;
-	struct ec_node *in = value;
-	struct ec_node *out = NULL;
+fail:
+	ec_node_free(in1);
+	ec_node_free(in2);
+	return NULL;
+}
 
-	(void)userctx;
-	(void)close_paren;
+static struct ec_node *cmd_expr(struct cmd_compiler *cc);
 
-	/* get parsed string vector, it should contain only one str */
-	vec = ec_pnode_get_strvec(open_paren);
-	if (ec_strvec_len(vec) != 1) {
-		errno = EINVAL;
-		return -1;
+static struct ec_node *cmd_term(struct cmd_compiler *cc)
+{
+	struct ec_node *node = NULL, *out;
+	char c;
+
+	c = cmd_peek(cc);
+	if (c == '(' || c == '[') {
+		cc->off++;
+		node = cmd_expr(cc);
+		if (node == NULL)
+			return NULL;
+		if (cmd_peek(cc) != (c == '(' ? ')' : ']')) {
+			errno = EINVAL;
+			goto fail;
+		}
+		cc->off++;
+		if (c == '[') {
+			out = ec_node_option(EC_NO_ID, ec_node_clone(node));
+			ec_node_free(node);
+			node = out;
+			if (node == NULL)
+				return NULL;
+		}
+	} else {
+		node = cmd_word(cc);
+		if (node == NULL)
+			return NULL;
 	}
 
-	if (!strcmp(ec_strvec_val(vec, 0), "[")) {
-		out = ec_node_option(EC_NO_ID, ec_node_clone(in));
-		if (out == NULL)
-			return -1;
-		ec_node_free(in);
-	} else if (!strcmp(ec_strvec_val(vec, 0), "(")) {
-		out = in;
-	} else {
-		errno = EINVAL;
-		return -1;
+	c = cmd_peek(cc);
+	if (c == '*' || c == '+') {
+		cc->off++;
+		out = ec_node_many(EC_NO_ID, ec_node_clone(node), c == '+' ? 1 : 0, 0);
+		ec_node_free(node);
+		node = out;
+		if (node == NULL)
+			return NULL;
+		/* a second postfix operator is not supported */
+		c = cmd_peek(cc);
+		if (c == '*' || c == '+') {
+			errno = EINVAL;
+			goto fail;
+		}
 	}
 
-	*result = out;
+	return node;
 
-	return 0;
+fail:
+	ec_node_free(node);
+	return NULL;
 }
 
-static void ec_node_cmd_eval_free(void *result, void *userctx)
+/* Return true if the next token can start a term. */
+static bool cmd_is_term_start(struct cmd_compiler *cc)
 {
-	(void)userctx;
-	ec_node_free(result);
-}
+	char c = cmd_peek(cc);
 
-static const struct ec_node_expr_eval_ops expr_ops = {
-	.eval_var = ec_node_cmd_eval_var,
-	.eval_pre_op = ec_node_cmd_eval_pre_op,
-	.eval_post_op = ec_node_cmd_eval_post_op,
-	.eval_bin_op = ec_node_cmd_eval_bin_op,
-	.eval_parenthesis = ec_node_cmd_eval_parenthesis,
-	.eval_free = ec_node_cmd_eval_free,
-};
+	return c == '(' || c == '[' || cmd_is_word_char(c);
+}
 
-static struct ec_node *ec_node_cmd_build_expr(void)
+/* Parse the operands of a binary operator at a given precedence level. */
+static struct ec_node *cmd_bin_level(struct cmd_compiler *cc, unsigned int level)
 {
-	struct ec_node *expr = NULL;
-	int ret;
+	static const char ops[] = {'&', ',', '|', ' '};
+	struct ec_node *first = NULL, *rest = NULL, *node;
+	char op = ops[level];
+
+	if (level == 0)
+		first = cmd_term(cc);
+	else
+		first = cmd_bin_level(cc, level - 1);
+	if (first == NULL)
+		return NULL;
+
+	for (;;) {
+		if (op == ' ') {
+			if (!cmd_is_term_start(cc))
+				break;
+		} else {
+			if (cmd_peek(cc) != op)
+				break;
+			cc->off++;
+		}
 
-	/* build the expression parser */
-	expr = ec_node("expr", "expr");
-	if (expr == NULL)
-		goto fail;
-	ret = ec_node_expr_set_val_node(expr, ec_node_re(EC_NO_ID, "[a-zA-Z0-9._-]+"));
-	if (ret < 0)
-		goto fail;
-	ret = ec_node_expr_add_bin_op(expr, ec_node_str(EC_NO_ID, "&"));
-	if (ret < 0)
-		goto fail;
-	ret = ec_node_expr_add_bin_op(expr, ec_node_str(EC_NO_ID, ","));
-	if (ret < 0)
-		goto fail;
-	ret = ec_node_expr_add_bin_op(expr, ec_node_str(EC_NO_ID, "|"));
-	if (ret < 0)
-		goto fail;
-	ret = ec_node_expr_add_bin_op(expr, ec_node("empty", EC_NO_ID));
-	if (ret < 0)
-		goto fail;
-	ret = ec_node_expr_add_post_op(expr, ec_node_str(EC_NO_ID, "+"));
-	if (ret < 0)
-		goto fail;
-	ret = ec_node_expr_add_post_op(expr, ec_node_str(EC_NO_ID, "*"));
-	if (ret < 0)
-		goto fail;
-	ret = ec_node_expr_add_parenthesis(
-		expr, ec_node_str(EC_NO_ID, "["), ec_node_str(EC_NO_ID, "]")
-	);
-	if (ret < 0)
-		goto fail;
-	ret = ec_node_expr_add_parenthesis(
-		expr, ec_node_str(EC_NO_ID, "("), ec_node_str(EC_NO_ID, ")")
-	);
-	if (ret < 0)
-		goto fail;
+		if (level == 0)
+			node = cmd_term(cc);
+		else
+			node = cmd_bin_level(cc, level - 1);
+		if (node == NULL)
+			goto fail;
+
+		if (rest == NULL) {
+			rest = node;
+		} else {
+			rest = cmd_bin_op(rest, op, node);
+			if (rest == NULL)
+				goto fail;
+		}
+	}
 
-	return expr;
+	if (rest == NULL)
+		return first;
+
+	return cmd_bin_op(first, op, rest);
 
 fail:
-	ec_node_free(expr);
+	ec_node_free(first);
+	ec_node_free(rest);
 	return NULL;
 }
 
-static struct ec_node *ec_node_cmd_build_parser(struct ec_node *expr)
+static struct ec_node *cmd_expr(struct cmd_compiler *cc)
 {
-	struct ec_node *lex = NULL;
-	int ret;
+	return cmd_bin_level(cc, 3);
+}
 
-	/* prepend a lexer to the expression node */
-	lex = ec_node_re_lex(EC_NO_ID, ec_node_clone(expr));
-	if (lex == NULL)
-		goto fail;
+static struct ec_node *ec_node_cmd_compile(const char *cmd_str, struct ec_node **table, size_t len)
+{
+	struct cmd_compiler cc = {cmd_str, 0, table, len};
+	struct ec_node *cmd;
 
-	ret = ec_node_re_lex_add(lex, "[a-zA-Z0-9._-]+", 1, NULL);
-	if (ret < 0)
-		goto fail;
-	ret = ec_node_re_lex_add(lex, "[*+|,&()]", 1, NULL);
-	if (ret < 0)
-		goto fail;
-	ret = ec_node_re_lex_add(lex, "\\[", 1, NULL);
-	if (ret < 0)
-		goto fail;
-	ret = ec_node_re_lex_add(lex, "\\]", 1, NULL);
-	if (ret < 0)
-		goto fail;
-	ret = ec_node_re_lex_add(lex, "[	 ]+", 0, NULL);
-	if (ret < 0)
-		goto fail;
+	cmd = cmd_expr(&cc);
+	if (cmd == NULL)
+		return NULL;
 
-	return lex;
+	if (cmd_peek(&cc) != '\0') {
+		ec_node_free(cmd);
+		errno = EINVAL;
+		return NULL;
+	}
 
-fail:
-	ec_node_free(lex);
+	return cmd;
+}
 
-	return NULL;
+static void cmd_cache_free(void *cmd)
+{
+	ec_node_free(cmd);
+}
+
+/*
+ * The key is the command string followed by the address and the id of
+ * each child. The referenced children are kept alive by the cached
+ * command, so their address cannot be reused by another node.
+ */
+static char *cmd_cache_key(const char *cmd_str, struct ec_node **table, size_t len, size_t *key_len)
+{
+	const char *id;
+	size_t i, off;
+	char *key;
+
+	*key_len = strlen(cmd_str) + 1;
+	for (i = 0; i < len; i++) {
+		id = ec_node_id(table[i]);
+		*key_len += sizeof(table[i]) + (id != NULL ? strlen(id) : 0) + 1;
+	}
+
+	key = malloc(*key_len);
+	if (key == NULL)
+		return NULL;
+
+	off = strlen(cmd_str) + 1;
+	memcpy(key, cmd_str, off);
+	for (i = 0; i < len; i++) {
+		id = ec_node_id(table[i]);
+		if (id == NULL)
+			id = "";
+		memcpy(&key[off], &table[i], sizeof(table[i]));
+		off += sizeof(table[i]);
+		memcpy(&key[off], id, strlen(id) + 1);
+		off += strlen(id) + 1;
+	}
+
+	return key;
 }
 
 static struct ec_node *ec_node_cmd_build(const char *cmd_str, struct ec_node **table, size_t len)
 {
-	struct ec_node_cmd_ctx ctx = {table, len};
-	struct ec_pnode *p = NULL;
-	void *result;
-	int ret;
+	struct ec_node *cmd = NULL;
+	char *key = NULL;
+	size_t key_len;
 
-	/* parse the command expression */
-	p = ec_parse(ec_node_cmd_parser, cmd_str);
-	if (p == NULL)
-		goto fail;
+	pthread_mutex_lock(&cmd_cache_lock);
+	if (cmd_cache == NULL) {
+		pthread_mutex_unlock(&cmd_cache_lock);
+		return ec_node_cmd_compile(cmd_str, table, len);
+	}
 
-	if (!ec_pnode_matches(p)) {
-		errno = EINVAL;
+	key = cmd_cache_key(cmd_str, table, len, &key_len);
+	if (key == NULL)
 		goto fail;
+
+	cmd = ec_htable_get(cmd_cache, key, key_len);
+	if (cmd != NULL) {
+		cmd = ec_node_clone(cmd);
+		goto end;
 	}
 
-	ret = ec_node_expr_eval(
-		&result, ec_node_cmd_expr, ec_pnode_get_first_child(p), &expr_ops, &ctx
-	);
-	if (ret < 0)
+	cmd = ec_node_cmd_compile(cmd_str, table, len);
+	if (cmd == NULL)
 		goto fail;
 
-	ec_pnode_free(p);
-	return result;
+	if (ec_htable_len(cmd_cache) >= CMD_CACHE_MAX) {
+		ec_htable_free(cmd_cache);
+		cmd_cache = ec_htable();
+	}
+	/* the cache is only an optimization, ignore errors */
+	if (cmd_cache != NULL)
+		ec_htable_set(cmd_cache, key, key_len, ec_node_clone(cmd), cmd_cache_free);
+
+end:
+	pthread_mutex_unlock(&cmd_cache_lock);
+	free(key);
+	return cmd;
 
 fail:
-	ec_pnode_free(p);
+	pthread_mutex_unlock(&cmd_cache_lock);
+	free(key);
 	return NULL;
 }
 
+int ec_node_cmd_set_cache(bool enable)
+{
+	int ret = 0;
+
+	pthread_mutex_lock(&cmd_cache_lock);
+	if (!enable) {
+		ec_htable_free(cmd_cache);
+		cmd_cache = NULL;
+	} else if (cmd_cache == NULL) {
+		cmd_cache = ec_htable();
+		if (cmd_cache == NULL)
+			ret = -1;
+	}
+	pthread_mutex_unlock(&cmd_cache_lock);
+
+	return ret;
+}
+
 static int ec_node_cmd_parse(
 	const struct ec_node *node,
 	struct ec_pnode *pstate,
@@ -649,37 +689,12 @@ fail:
 	return NULL;
 }
 
-static int ec_node_cmd_init_func(void)
-{
-	ec_node_cmd_expr = ec_node_cmd_build_expr();
-	if (ec_node_cmd_expr == NULL)
-		goto fail;
-
-	ec_node_cmd_parser = ec_node_cmd_build_parser(ec_node_cmd_expr);
-	if (ec_node_cmd_parser == NULL)
-		goto fail;
-
-	return 0;
-
-fail:
-	EC_LOG(EC_LOG_ERR, "Failed to initialize command parser\n");
-	ec_node_free(ec_node_cmd_expr);
-	ec_node_cmd_expr = NULL;
-	ec_node_free(ec_node_cmd_parser);
-	ec_node_cmd_parser = NULL;
-	return -1;
-}
-
 static void ec_node_cmd_exit_func(void)
 {
-	ec_node_free(ec_node_cmd_expr);
-	ec_node_cmd_expr = NULL;
-	ec_node_free(ec_node_cmd_parser);
-	ec_node_cmd_parser = NULL;
+	ec_node_cmd_set_cache(false);
 }
 
 static struct ec_init ec_node_cmd_init = {
-	.init = ec_node_cmd_init_func,
 	.exit = ec_node_cmd_exit_func,
 	.priority = 75,
 };
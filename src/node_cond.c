@@ -4,6 +4,9 @@
 
 #include <errno.h>
 #include <limits.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -11,8 +14,6 @@
 
 #include <ecoli/complete.h>
 #include <ecoli/config.h>
-#include <ecoli/dict.h>
-#include <ecoli/htable.h>
 #include <ecoli/init.h>
 #include <ecoli/log.h>
 #include <ecoli/node.h>
@@ -33,14 +34,9 @@
 
 EC_LOG_TYPE_REGISTER(node_cond);
 
-static struct ec_node *ec_node_cond_parser; /* the expression parser. */
-static struct ec_dict *ec_node_cond_functions; /* functions dictionary */
-
-struct ec_node_cond {
-	char *cond_str; /* the condition string. */
-	struct ec_pnode *parsed_cond; /* the parsed condition. */
-	struct ec_node *child; /* the child node. */
-};
+/* the expression parser, built on first use */
+static struct ec_node *ec_node_cond_parser;
+static pthread_mutex_t ec_node_cond_parser_lock = PTHREAD_MUTEX_INITIALIZER;
 
 enum cond_result_type {
 	NODESET,
@@ -55,48 +51,148 @@ enum cond_result_type {
  * - get/set variable
  */
 
+/* a set of parse nodes, sorted by address, without duplicates */
+struct cond_nodeset {
+	const struct ec_pnode **table;
+	size_t len;
+};
+
 struct cond_result {
 	enum cond_result_type type;
 	union {
-		struct ec_htable *htable;
-		char *str;
+		struct cond_nodeset nodeset;
+		const char *str; /* points to the program constants */
 		int64_t int64;
 		bool boolean;
 	};
 };
 
-typedef struct cond_result
-	*(cond_func_t)(const struct ec_pnode *pstate, struct cond_result **in, size_t in_len);
+/*
+ * A function takes its arguments from the evaluation stack and stores its
+ * result in out. The arguments are released by the caller, so a function
+ * that returns one of them must move it with cond_result_move().
+ */
+typedef int(cond_func_t)(
+	const struct ec_pnode *pstate,
+	struct cond_result *in,
+	size_t in_len,
+	struct cond_result *out
+);
+
+struct cond_func {
+	const char *name;
+	cond_func_t *func;
+	size_t min_args;
+	size_t max_args;
+};
+
+enum cond_op {
+	COND_OP_STR, /* push a string */
+	COND_OP_INT, /* push an integer */
+	COND_OP_CALL, /* pop the arguments, call a function, push its result */
+};
 
-static void cond_result_free(struct cond_result *res)
+struct cond_insn {
+	enum cond_op op;
+	union {
+		char *str;
+		int64_t int64;
+		struct {
+			const struct cond_func *func;
+			size_t n_args;
+		};
+	};
+};
+
+/*
+ * The condition, compiled when the node is configured into a program for a
+ * stack machine, in postfix order: the arguments of a function are evaluated
+ * before calling it.
+ */
+struct cond_prog {
+	struct cond_insn *insns;
+	size_t len;
+	size_t stack_len; /* maximum depth of the evaluation stack */
+};
+
+/* above this depth, the evaluation stack is allocated */
+#define COND_STACK_LEN 16
+
+struct ec_node_cond {
+	char *cond_str; /* the condition string. */
+	struct cond_prog *prog; /* the compiled condition. */
+	struct ec_node *child; /* the child node. */
+};
+
+static void cond_result_clear(struct cond_result *res)
 {
-	if (res == NULL)
-		return;
+	if (res->type == NODESET)
+		free(res->nodeset.table);
+	memset(res, 0, sizeof(*res));
+	res->type = BOOLEAN;
+}
 
-	switch (res->type) {
-	case NODESET:
-		ec_htable_free(res->htable);
-		break;
-	case STR:
-		free(res->str);
-		break;
-	case BOOLEAN:
-	case INT:
-		break;
+static void cond_result_move(struct cond_result *dst, struct cond_result *src)
+{
+	*dst = *src;
+	memset(src, 0, sizeof(*src));
+	src->type = BOOLEAN;
+}
+
+static int cond_nodeset_add(struct cond_nodeset *nodeset, const struct ec_pnode *pnode)
+{
+	const struct ec_pnode **table;
+
+	/* grow when the length reaches a power of 2 */
+	if (nodeset->len == 0 || (nodeset->len & (nodeset->len - 1)) == 0) {
+		table = realloc(nodeset->table, (nodeset->len * 2 + 1) * sizeof(*table));
+		if (table == NULL)
+			return -1;
+		nodeset->table = table;
 	}
+	nodeset->table[nodeset->len++] = pnode;
+
+	return 0;
+}
+
+static int cmp_pnode_ptr(const void *p1, const void *p2)
+{
+	const struct ec_pnode *const *pnode1 = p1, *const *pnode2 = p2;
+
+	if (*pnode1 < *pnode2)
+		return -1;
+	return *pnode1 > *pnode2;
+}
+
+/* sort the nodes and remove the duplicates */
+static void cond_nodeset_normalize(struct cond_nodeset *nodeset)
+{
+	size_t i, j;
+
+	if (nodeset->len < 2)
+		return;
 
-	free(res);
+	qsort(nodeset->table, nodeset->len, sizeof(*nodeset->table), cmp_pnode_ptr);
+	for (i = 1, j = 1; i < nodeset->len; i++) {
+		if (nodeset->table[i] != nodeset->table[j - 1])
+			nodeset->table[j++] = nodeset->table[i];
+	}
+	nodeset->len = j;
 }
 
-static void cond_result_table_free(struct cond_result **table, size_t len)
+static void cond_prog_free(struct cond_prog *prog)
 {
 	size_t i;
 
-	for (i = 0; i < len; i++) {
-		cond_result_free(table[i]);
-		table[i] = NULL;
+	if (prog == NULL)
+		return;
+
+	for (i = 0; i < prog->len; i++) {
+		if (prog->insns[i].op == COND_OP_STR)
+			free(prog->insns[i].str);
 	}
-	free(table);
+	free(prog->insns);
+	free(prog);
 }
 
 static struct ec_node *ec_node_cond_build_parser(void)
@@ -180,102 +276,60 @@ fail:
 	return NULL;
 }
 
-static struct ec_pnode *ec_node_cond_build(const char *cond_str)
+static struct ec_node *ec_node_cond_get_parser(void)
 {
-	struct ec_pnode *p = NULL;
-
-	/* parse the condition expression */
-	p = ec_parse(ec_node_cond_parser, cond_str);
-	if (p == NULL)
-		goto fail;
-
-	if (!ec_pnode_matches(p)) {
-		errno = EINVAL;
-		goto fail;
+	struct ec_node *parser;
+
+	parser = __atomic_load_n(&ec_node_cond_parser, __ATOMIC_ACQUIRE);
+	if (parser != NULL)
+		return parser;
+
+	pthread_mutex_lock(&ec_node_cond_parser_lock);
+	parser = ec_node_cond_parser;
+	if (parser == NULL) {
+		parser = ec_node_cond_build_parser();
+		if (parser == NULL)
+			EC_LOG(EC_LOG_ERR, "Failed to initialize condition parser\n");
+		__atomic_store_n(&ec_node_cond_parser, parser, __ATOMIC_RELEASE);
 	}
+	pthread_mutex_unlock(&ec_node_cond_parser_lock);
 
-	return p;
-
-fail:
-	ec_pnode_free(p);
-	return NULL;
+	return parser;
 }
 
-static struct cond_result *
-eval_root(const struct ec_pnode *pstate, struct cond_result **in, size_t in_len)
+static int eval_root(
+	const struct ec_pnode *pstate,
+	struct cond_result *in,
+	size_t in_len,
+	struct cond_result *out
+)
 {
-	struct cond_result *out = NULL;
-	const struct ec_pnode *root = NULL;
-
 	(void)in;
-
-	if (in_len != 0) {
-		EC_LOG(LOG_ERR, "root() does not take any argument\n");
-		errno = EINVAL;
-		goto fail;
-	}
-
-	out = malloc(sizeof(*out));
-	if (out == NULL)
-		goto fail;
+	(void)in_len;
 
 	out->type = NODESET;
-	out->htable = ec_htable();
-	if (out->htable == NULL)
-		goto fail;
-
-	root = EC_PNODE_GET_ROOT(pstate);
-	if (ec_htable_set(out->htable, &root, sizeof(root), NULL, NULL) < 0)
-		goto fail;
-
-	cond_result_table_free(in, in_len);
-	return out;
-
-fail:
-	cond_result_free(out);
-	cond_result_table_free(in, in_len);
-	return NULL;
+	return cond_nodeset_add(&out->nodeset, EC_PNODE_GET_ROOT(pstate));
 }
 
-static struct cond_result *
-eval_current(const struct ec_pnode *pstate, struct cond_result **in, size_t in_len)
+static int eval_current(
+	const struct ec_pnode *pstate,
+	struct cond_result *in,
+	size_t in_len,
+	struct cond_result *out
+)
 {
-	struct cond_result *out = NULL;
-
 	(void)in;
-
-	if (in_len != 0) {
-		EC_LOG(LOG_ERR, "current() does not take any argument\n");
-		errno = EINVAL;
-		goto fail;
-	}
-
-	out = malloc(sizeof(*out));
-	if (out == NULL)
-		goto fail;
+	(void)in_len;
 
 	out->type = NODESET;
-	out->htable = ec_htable();
-	if (out->htable == NULL)
-		goto fail;
-
-	if (ec_htable_set(out->htable, &pstate, sizeof(pstate), NULL, NULL) < 0)
-		goto fail;
-
-	cond_result_table_free(in, in_len);
-	return out;
-
-fail:
-	cond_result_free(out);
-	cond_result_table_free(in, in_len);
-	return NULL;
+	return cond_nodeset_add(&out->nodeset, pstate);
 }
 
 static bool boolean_value(const struct cond_result *res)
 {
 	switch (res->type) {
 	case NODESET:
-		return ec_htable_len(res->htable) > 0;
+		return res->nodeset.len > 0;
 	case BOOLEAN:
 		return res->boolean;
 	case INT:
@@ -287,333 +341,278 @@ static bool boolean_value(const struct cond_result *res)
 	return false;
 }
 
-static struct cond_result *
-eval_bool(const struct ec_pnode *pstate, struct cond_result **in, size_t in_len)
+static int eval_bool(
+	const struct ec_pnode *pstate,
+	struct cond_result *in,
+	size_t in_len,
+	struct cond_result *out
+)
 {
-	struct cond_result *out = NULL;
-
 	(void)pstate;
-
-	if (in_len != 1) {
-		EC_LOG(LOG_ERR, "bool() takes one argument.\n");
-		errno = EINVAL;
-		goto fail;
-	}
-
-	out = malloc(sizeof(*out));
-	if (out == NULL)
-		goto fail;
+	(void)in_len;
 
 	out->type = BOOLEAN;
-	out->boolean = boolean_value(in[0]);
-
-	cond_result_table_free(in, in_len);
-	return out;
+	out->boolean = boolean_value(&in[0]);
 
-fail:
-	cond_result_free(out);
-	cond_result_table_free(in, in_len);
-	return NULL;
+	return 0;
 }
 
-static struct cond_result *
-eval_or(const struct ec_pnode *pstate, struct cond_result **in, size_t in_len)
+static int eval_or(
+	const struct ec_pnode *pstate,
+	struct cond_result *in,
+	size_t in_len,
+	struct cond_result *out
+)
 {
-	struct cond_result *out = NULL;
 	size_t i;
 
 	(void)pstate;
 
-	if (in_len < 2) {
-		EC_LOG(LOG_ERR, "or() takes at least two arguments\n");
-		errno = EINVAL;
-		goto fail;
-	}
-
 	/* return the first true element, or the last one */
 	for (i = 0; i < in_len; i++) {
-		if (boolean_value(in[i]))
+		if (boolean_value(&in[i]))
 			break;
 	}
 	if (i == in_len)
 		i--;
 
-	out = in[i];
-	in[i] = NULL;
+	cond_result_move(out, &in[i]);
 
-	cond_result_table_free(in, in_len);
-	return out;
-
-fail:
-	cond_result_free(out);
-	cond_result_table_free(in, in_len);
-	return NULL;
+	return 0;
 }
 
-static struct cond_result *
-eval_and(const struct ec_pnode *pstate, struct cond_result **in, size_t in_len)
+static int eval_and(
+	const struct ec_pnode *pstate,
+	struct cond_result *in,
+	size_t in_len,
+	struct cond_result *out
+)
 {
-	struct cond_result *out = NULL;
 	size_t i;
 
 	(void)pstate;
 
-	if (in_len < 2) {
-		EC_LOG(LOG_ERR, "or() takes at least two arguments\n");
-		errno = EINVAL;
-		goto fail;
-	}
-
 	/* return the first false element, or the last one */
 	for (i = 0; i < in_len; i++) {
-		if (!boolean_value(in[i]))
+		if (!boolean_value(&in[i]))
 			break;
 	}
 	if (i == in_len)
 		i--;
 
-	out = in[i];
-	in[i] = NULL;
-
-	cond_result_table_free(in, in_len);
-	return out;
+	cond_result_move(out, &in[i]);
 
-fail:
-	cond_result_free(out);
-	cond_result_table_free(in, in_len);
-	return NULL;
+	return 0;
 }
 
-static struct cond_result *
-eval_first_child(const struct ec_pnode *pstate, struct cond_result **in, size_t in_len)
+static int eval_first_child(
+	const struct ec_pnode *pstate,
+	struct cond_result *in,
+	size_t in_len,
+	struct cond_result *out
+)
 {
-	struct cond_result *out = NULL;
-	struct ec_htable_elt_ref *iter;
-	const struct ec_pnode *const *pparse;
-	struct ec_pnode *parse;
+	struct ec_pnode *child;
+	size_t i;
 
 	(void)pstate;
+	(void)in_len;
 
-	if (in_len != 1 || in[0]->type != NODESET) {
+	if (in[0].type != NODESET) {
 		EC_LOG(LOG_ERR, "first_child() takes one argument of type nodeset.\n");
 		errno = EINVAL;
-		goto fail;
+		return -1;
 	}
 
-	out = malloc(sizeof(*out));
-	if (out == NULL)
-		goto fail;
-
 	out->type = NODESET;
-	out->htable = ec_htable();
-	if (out->htable == NULL)
-		goto fail;
-
-	for (iter = ec_htable_iter(in[0]->htable); iter != NULL; iter = ec_htable_iter_next(iter)) {
-		pparse = ec_htable_iter_get_key(iter);
-		parse = ec_pnode_get_first_child(*pparse);
-		if (parse == NULL)
+	for (i = 0; i < in[0].nodeset.len; i++) {
+		child = ec_pnode_get_first_child(in[0].nodeset.table[i]);
+		if (child == NULL)
 			continue;
-		if (ec_htable_set(out->htable, &parse, sizeof(parse), NULL, NULL) < 0)
-			goto fail;
+		if (cond_nodeset_add(&out->nodeset, child) < 0)
+			return -1;
 	}
+	cond_nodeset_normalize(&out->nodeset);
 
-	cond_result_table_free(in, in_len);
-	return out;
-
-fail:
-	cond_result_free(out);
-	cond_result_table_free(in, in_len);
-	return NULL;
+	return 0;
 }
 
-static struct cond_result *
-eval_find(const struct ec_pnode *pstate, struct cond_result **in, size_t in_len)
+static int eval_find(
+	const struct ec_pnode *pstate,
+	struct cond_result *in,
+	size_t in_len,
+	struct cond_result *out
+)
 {
-	struct cond_result *out = NULL;
-	struct ec_htable_elt_ref *iter;
-	struct ec_pnode *const *pparse;
-	const struct ec_pnode *parse;
+	const struct ec_pnode *root, *pnode;
 	const char *id;
+	size_t i;
 
 	(void)pstate;
+	(void)in_len;
 
-	if (in_len != 2 || in[0]->type != NODESET || in[1]->type != STR) {
+	if (in[0].type != NODESET || in[1].type != STR) {
 		EC_LOG(LOG_ERR, "find() takes two arguments (nodeset, str).\n");
 		errno = EINVAL;
-		goto fail;
+		return -1;
 	}
 
-	out = malloc(sizeof(*out));
-	if (out == NULL)
-		goto fail;
-
 	out->type = NODESET;
-	out->htable = ec_htable();
-	if (out->htable == NULL)
-		goto fail;
-
-	id = in[1]->str;
-	for (iter = ec_htable_iter(in[0]->htable); iter != NULL; iter = ec_htable_iter_next(iter)) {
-		pparse = ec_htable_iter_get_key(iter);
-		parse = ec_pnode_find(*pparse, id);
-		while (parse != NULL) {
-			if (ec_htable_set(out->htable, &parse, sizeof(parse), NULL, NULL) < 0)
-				goto fail;
-			parse = ec_pnode_find_next(*pparse, parse, id, 1);
+	id = in[1].str;
+	for (i = 0; i < in[0].nodeset.len; i++) {
+		root = in[0].nodeset.table[i];
+		pnode = ec_pnode_find(root, id);
+		while (pnode != NULL) {
+			if (cond_nodeset_add(&out->nodeset, pnode) < 0)
+				return -1;
+			pnode = ec_pnode_find_next(root, pnode, id, 1);
 		}
 	}
+	cond_nodeset_normalize(&out->nodeset);
 
-	cond_result_table_free(in, in_len);
-	return out;
-
-fail:
-	cond_result_free(out);
-	cond_result_table_free(in, in_len);
-	return NULL;
+	return 0;
 }
 
-static struct cond_result *
-eval_cmp(const struct ec_pnode *pstate, struct cond_result **in, size_t in_len)
+static int eval_cmp(
+	const struct ec_pnode *pstate,
+	struct cond_result *in,
+	size_t in_len,
+	struct cond_result *out
+)
 {
-	struct cond_result *out = NULL;
-	struct ec_htable_elt_ref *iter;
 	bool eq = false, gt = false;
+	const char *op;
 
 	(void)pstate;
+	(void)in_len;
 
-	if (in_len != 3 || in[0]->type != STR || in[1]->type != in[2]->type) {
+	if (in[0].type != STR || in[1].type != in[2].type) {
 		EC_LOG(LOG_ERR, "cmp() takes 3 arguments (str, <type>, <type>).\n");
 		errno = EINVAL;
-		goto fail;
+		return -1;
 	}
 
-	if (strcmp(in[0]->str, "eq") && strcmp(in[0]->str, "ne") && strcmp(in[0]->str, "gt")
-	    && strcmp(in[0]->str, "lt") && strcmp(in[0]->str, "ge") && strcmp(in[0]->str, "le")) {
+	op = in[0].str;
+	if (strcmp(op, "eq") && strcmp(op, "ne") && strcmp(op, "gt") && strcmp(op, "lt")
+	    && strcmp(op, "ge") && strcmp(op, "le")) {
 		EC_LOG(LOG_ERR, "invalid comparison operator in cmp().\n");
 		errno = EINVAL;
-		goto fail;
+		return -1;
 	}
 
-	if (strcmp(in[0]->str, "eq") && strcmp(in[0]->str, "ne") && in[1]->type != INT) {
+	if (strcmp(op, "eq") && strcmp(op, "ne") && in[1].type != INT) {
 		EC_LOG(LOG_ERR, "cmp(gt|lt|ge|le, ...) is only allowed with integers.\n");
 		errno = EINVAL;
-		goto fail;
+		return -1;
 	}
 
-	if (in[1]->type == INT) {
-		eq = in[1]->int64 == in[2]->int64;
-		gt = in[1]->int64 > in[2]->int64;
-	} else if (
-		/* clang-format off */
-		in[1]->type == NODESET
-		&& ec_htable_len(in[1]->htable) != ec_htable_len(in[2]->htable)
-		/* clang-format on */
-	) {
-		eq = false;
-	} else if (in[1]->type == NODESET) {
-		eq = true;
-		for (iter = ec_htable_iter(in[1]->htable); iter != NULL;
-		     iter = ec_htable_iter_next(iter)) {
-			if (ec_htable_get(
-				    in[2]->htable,
-				    ec_htable_iter_get_key(iter),
-				    sizeof(struct ec_pnode *)
-			    )
-			    == NULL) {
-				eq = false;
-				break;
-			}
-		}
-	} else if (in[1]->type == STR) {
-		eq = !strcmp(in[1]->str, in[2]->str);
-	} else if (in[1]->type == BOOLEAN) {
-		eq = in[1]->boolean == in[2]->boolean;
+	if (in[1].type == INT) {
+		eq = in[1].int64 == in[2].int64;
+		gt = in[1].int64 > in[2].int64;
+	} else if (in[1].type == NODESET) {
+		/* nodesets are sorted */
+		eq = in[1].nodeset.len == in[2].nodeset.len
+			&& (in[1].nodeset.len == 0
+			    || !memcmp(in[1].nodeset.table,
+				       in[2].nodeset.table,
+				       in[1].nodeset.len * sizeof(*in[1].nodeset.table)));
+	} else if (in[1].type == STR) {
+		eq = !strcmp(in[1].str, in[2].str);
+	} else if (in[1].type == BOOLEAN) {
+		eq = in[1].boolean == in[2].boolean;
 	}
 
-	out = malloc(sizeof(*out));
-	if (out == NULL)
-		goto fail;
-
 	out->type = BOOLEAN;
-	if (!strcmp(in[0]->str, "eq"))
+	if (!strcmp(op, "eq"))
 		out->boolean = eq;
-	else if (!strcmp(in[0]->str, "ne"))
+	else if (!strcmp(op, "ne"))
 		out->boolean = !eq;
-	else if (!strcmp(in[0]->str, "lt"))
+	else if (!strcmp(op, "lt"))
 		out->boolean = !gt && !eq;
-	else if (!strcmp(in[0]->str, "gt"))
+	else if (!strcmp(op, "gt"))
 		out->boolean = gt && !eq;
-	else if (!strcmp(in[0]->str, "le"))
+	else if (!strcmp(op, "le"))
 		out->boolean = !gt || eq;
-	else if (!strcmp(in[0]->str, "ge"))
+	else if (!strcmp(op, "ge"))
 		out->boolean = gt || eq;
 
-	cond_result_table_free(in, in_len);
-	return out;
-
-fail:
-	cond_result_free(out);
-	cond_result_table_free(in, in_len);
-	return NULL;
+	return 0;
 }
 
-static struct cond_result *
-eval_count(const struct ec_pnode *pstate, struct cond_result **in, size_t in_len)
+static int eval_count(
+	const struct ec_pnode *pstate,
+	struct cond_result *in,
+	size_t in_len,
+	struct cond_result *out
+)
 {
-	struct cond_result *out = NULL;
-
 	(void)pstate;
+	(void)in_len;
 
-	if (in_len != 1 || in[0]->type != NODESET) {
+	if (in[0].type != NODESET) {
 		EC_LOG(LOG_ERR, "count() takes one argument of type nodeset.\n");
 		errno = EINVAL;
-		goto fail;
+		return -1;
 	}
 
-	out = malloc(sizeof(*out));
-	if (out == NULL)
-		goto fail;
-
 	out->type = INT;
-	out->int64 = ec_htable_len(in[0]->htable);
+	out->int64 = in[0].nodeset.len;
 
-	cond_result_table_free(in, in_len);
-	return out;
+	return 0;
+}
+
+static const struct cond_func cond_functions[] = {
+	{"root", eval_root, 0, 0},
+	{"current", eval_current, 0, 0},
+	{"bool", eval_bool, 1, 1},
+	{"or", eval_or, 2, SIZE_MAX},
+	{"and", eval_and, 2, SIZE_MAX},
+	{"first_child", eval_first_child, 1, 1},
+	{"find", eval_find, 2, 2},
+	{"cmp", eval_cmp, 3, 3},
+	{"count", eval_count, 1, 1},
+};
+
+static const struct cond_func *cond_func_lookup(const char *name)
+{
+	size_t i;
+
+	for (i = 0; i < EC_COUNT_OF(cond_functions); i++) {
+		if (!strcmp(cond_functions[i].name, name))
+			return &cond_functions[i];
+	}
 
-fail:
-	cond_result_free(out);
-	cond_result_table_free(in, in_len);
 	return NULL;
 }
 
-static struct cond_result *
-eval_func(const char *name, const struct ec_pnode *pstate, struct cond_result **in, size_t in_len)
+static struct cond_insn *cond_prog_add(struct cond_prog *prog, enum cond_op op)
 {
-	cond_func_t *f;
+	struct cond_insn *insns;
 
-	f = ec_dict_get(ec_node_cond_functions, name);
-	if (f == NULL) {
-		EC_LOG(LOG_ERR, "No such function <%s>\n", name);
-		errno = ENOENT;
-		cond_result_table_free(in, in_len);
+	insns = realloc(prog->insns, (prog->len + 1) * sizeof(*insns));
+	if (insns == NULL)
 		return NULL;
-	}
+	prog->insns = insns;
+	memset(&insns[prog->len], 0, sizeof(*insns));
+	insns[prog->len].op = op;
 
-	return f(pstate, in, in_len);
+	return &insns[prog->len++];
 }
 
-static struct cond_result *
-eval_condition(const struct ec_pnode *cond, const struct ec_pnode *pstate)
+/* append the instructions evaluating cond, whose result is pushed at depth */
+static int cond_compile(struct cond_prog *prog, const struct ec_pnode *cond, size_t depth)
 {
 	const struct ec_pnode *iter;
-	struct cond_result *res = NULL;
-	struct cond_result **args = NULL;
 	const struct ec_pnode *func = NULL, *func_name = NULL, *arg_list = NULL;
 	const struct ec_pnode *value = NULL;
-	const char *id;
+	const struct cond_func *f;
+	struct cond_insn *insn;
+	const char *id, *name;
 	size_t n_arg = 0;
 
+	if (depth + 1 > prog->stack_len)
+		prog->stack_len = depth + 1;
+
 	/* XXX fix cast (x3) */
 	func = ec_pnode_find((void *)cond, "id_function");
 	if (func != NULL) {
@@ -627,77 +626,154 @@ eval_condition(const struct ec_pnode *cond, const struct ec_pnode *pstate)
 
 		iter = ec_pnode_find((void *)arg_list, "id_arg");
 		while (iter != NULL) {
-			struct cond_result **tmp;
-
-			tmp = realloc(args, (n_arg + 1) * sizeof(*args));
-			if (tmp == NULL)
-				goto fail;
-			args = tmp;
-			args[n_arg] = eval_condition(iter, pstate);
-			if (args[n_arg] == NULL)
-				goto fail;
+			if (cond_compile(prog, iter, depth + n_arg) < 0)
+				return -1;
 			n_arg++;
 			iter = ec_pnode_find_next((void *)arg_list, (void *)iter, "id_arg", 0);
 		}
 
-		res = eval_func(
-			ec_strvec_val(ec_pnode_get_strvec(func_name), 0), pstate, args, n_arg
-		);
-		args = NULL;
-		return res;
+		name = ec_strvec_val(ec_pnode_get_strvec(func_name), 0);
+		f = cond_func_lookup(name);
+		if (f == NULL) {
+			EC_LOG(LOG_ERR, "No such function <%s>\n", name);
+			errno = ENOENT;
+			return -1;
+		}
+		if (n_arg < f->min_args || n_arg > f->max_args) {
+			EC_LOG(LOG_ERR, "Invalid number of arguments for %s()\n", name);
+			errno = EINVAL;
+			return -1;
+		}
+
+		insn = cond_prog_add(prog, COND_OP_CALL);
+		if (insn == NULL)
+			return -1;
+		insn->func = f;
+		insn->n_args = n_arg;
+		return 0;
 	}
 
 	value = ec_pnode_find((void *)cond, "id_value_str");
 	if (value != NULL) {
-		res = malloc(sizeof(*res));
-		if (res == NULL)
-			goto fail;
-		res->type = STR;
-		res->str = strdup(ec_strvec_val(ec_pnode_get_strvec(value), 0));
-		if (res->str == NULL)
-			goto fail;
-		return res;
+		insn = cond_prog_add(prog, COND_OP_STR);
+		if (insn == NULL)
+			return -1;
+		insn->str = strdup(ec_strvec_val(ec_pnode_get_strvec(value), 0));
+		if (insn->str == NULL)
+			return -1;
+		return 0;
 	}
 
 	value = ec_pnode_find((void *)cond, "id_value_int");
 	if (value != NULL) {
-		res = malloc(sizeof(*res));
-		if (res == NULL)
-			goto fail;
-		res->type = INT;
+		insn = cond_prog_add(prog, COND_OP_INT);
+		if (insn == NULL)
+			return -1;
 		if (ec_str_parse_llint(
 			    ec_strvec_val(ec_pnode_get_strvec(value), 0),
 			    0,
 			    LLONG_MIN,
 			    LLONG_MAX,
-			    &res->int64
+			    &insn->int64
 		    )
 		    < 0)
-			goto fail;
-		return res;
+			return -1;
+		return 0;
 	}
 
-fail:
-	cond_result_free(res);
-	cond_result_table_free(args, n_arg);
-	return NULL;
+	errno = EINVAL;
+	return -1;
 }
 
-static int validate_condition(const struct ec_pnode *cond, const struct ec_pnode *pstate)
+static int validate_condition(const struct cond_prog *prog, const struct ec_pnode *pstate)
 {
-	struct cond_result *res;
-	int ret;
+	struct cond_result stack_buf[COND_STACK_LEN], *stack = stack_buf;
+	const struct cond_insn *insn;
+	struct cond_result res;
+	size_t i, j, sp = 0;
+	int ret = -1;
+
+	if (prog->stack_len > COND_STACK_LEN) {
+		stack = malloc(prog->stack_len * sizeof(*stack));
+		if (stack == NULL)
+			return -1;
+	}
 
-	res = eval_condition(cond, pstate);
-	if (res == NULL)
-		return -1;
+	for (i = 0; i < prog->len; i++) {
+		insn = &prog->insns[i];
+		switch (insn->op) {
+		case COND_OP_STR:
+			stack[sp].type = STR;
+			stack[sp++].str = insn->str;
+			break;
+		case COND_OP_INT:
+			stack[sp].type = INT;
+			stack[sp++].int64 = insn->int64;
+			break;
+		case COND_OP_CALL:
+			sp -= insn->n_args;
+			memset(&res, 0, sizeof(res));
+			ret = insn->func->func(pstate, &stack[sp], insn->n_args, &res);
+			for (j = 0; j < insn->n_args; j++)
+				cond_result_clear(&stack[sp + j]);
+			if (ret < 0) {
+				cond_result_clear(&res);
+				goto out;
+			}
+			stack[sp++] = res;
+			break;
+		}
+	}
+
+	ret = boolean_value(&stack[0]);
 
-	ret = boolean_value(res);
-	cond_result_free(res);
+out:
+	while (sp > 0)
+		cond_result_clear(&stack[--sp]);
+	if (stack != stack_buf)
+		free(stack);
 
 	return ret;
 }
 
+static struct cond_prog *ec_node_cond_build(const char *cond_str)
+{
+	struct cond_prog *prog = NULL;
+	struct ec_node *parser;
+	struct ec_pnode *p = NULL;
+
+	parser = ec_node_cond_get_parser();
+	if (parser == NULL)
+		goto fail;
+
+	/* parse the condition expression */
+	p = ec_parse(parser, cond_str);
+	if (p == NULL)
+		goto fail;
+
+	if (!ec_pnode_matches(p)) {
+		errno = EINVAL;
+		goto fail;
+	}
+
+	/* compile it */
+	prog = calloc(1, sizeof(*prog));
+	if (prog == NULL)
+		goto fail;
+
+	if (cond_compile(prog, p, 0) < 0)
+		goto fail;
+
+	ec_pnode_free(p);
+
+	return prog;
+
+fail:
+	cond_prog_free(prog);
+	ec_pnode_free(p);
+	return NULL;
+}
+
 static int ec_node_cond_parse(
 	const struct ec_node *node,
 	struct ec_pnode *pstate,
@@ -708,16 +784,16 @@ static int ec_node_cond_parse(
 	struct ec_pnode *child;
 	int ret, valid;
 
-	if (priv->child == NULL || priv->parsed_cond == NULL) {
+	if (priv->child == NULL || priv->prog == NULL) {
 		errno = ENOENT;
 		return -1;
 	}
 
 	ret = ec_parse_child(priv->child, pstate, strvec);
-	if (ret <= 0)
+	if (ret <= 0 || ret == EC_PARSE_NOMATCH)
 		return ret;
 
-	valid = validate_condition(priv->parsed_cond, pstate);
+	valid = validate_condition(priv->prog, pstate);
 	if (valid < 0)
 		return valid;
 
@@ -739,7 +815,7 @@ static int ec_node_cond_complete(
 {
 	struct ec_node_cond *priv = ec_node_priv(node);
 
-	if (priv->child == NULL || priv->parsed_cond == NULL) {
+	if (priv->child == NULL || priv->prog == NULL) {
 		errno = ENOENT;
 		return -1;
 	}
@@ -756,8 +832,8 @@ static void ec_node_cond_free_priv(struct ec_node *node)
 
 	free(priv->cond_str);
 	priv->cond_str = NULL;
-	ec_pnode_free(priv->parsed_cond);
-	priv->parsed_cond = NULL;
+	cond_prog_free(priv->prog);
+	priv->prog = NULL;
 	ec_node_free(priv->child);
 }
 
@@ -781,7 +857,7 @@ static int ec_node_cond_set_config(struct ec_node *node, const struct ec_config
 {
 	struct ec_node_cond *priv = ec_node_priv(node);
 	const struct ec_config *cond = NULL;
-	struct ec_pnode *parsed_cond = NULL;
+	struct cond_prog *prog = NULL;
 	const struct ec_config *child;
 	char *cond_str = NULL;
 
@@ -799,14 +875,14 @@ static int ec_node_cond_set_config(struct ec_node *node, const struct ec_config
 	if (child == NULL)
 		goto fail;
 
-	/* parse expression to build the cmd child node */
-	parsed_cond = ec_node_cond_build(cond_str);
-	if (parsed_cond == NULL)
+	/* parse and compile the condition expression */
+	prog = ec_node_cond_build(cond_str);
+	if (prog == NULL)
 		goto fail;
 
 	/* ok, store the config */
-	ec_pnode_free(priv->parsed_cond);
-	priv->parsed_cond = parsed_cond;
+	cond_prog_free(priv->prog);
+	priv->prog = prog;
 	free(priv->cond_str);
 	priv->cond_str = cond_str;
 	ec_node_free(priv->child);
@@ -815,7 +891,7 @@ static int ec_node_cond_set_config(struct ec_node *node, const struct ec_config
 	return 0;
 
 fail:
-	ec_pnode_free(parsed_cond);
+	cond_prog_free(prog);
 	free(cond_str);
 	return -1;
 }
@@ -856,6 +932,7 @@ static struct ec_node_type ec_node_cond_type = {
 	.free_priv = ec_node_cond_free_priv,
 	.get_children_count = ec_node_cond_get_children_count,
 	.get_child = ec_node_cond_get_child,
+	.uses_parse_tree = true,
 };
 
 EC_NODE_TYPE_REGISTER(ec_node_cond_type);
@@ -903,56 +980,13 @@ fail:
 
 static void ec_node_cond_exit_func(void)
 {
+	pthread_mutex_lock(&ec_node_cond_parser_lock);
 	ec_node_free(ec_node_cond_parser);
 	ec_node_cond_parser = NULL;
-	ec_dict_free(ec_node_cond_functions);
-	ec_node_cond_functions = NULL;
-}
-
-static int add_func(const char *name, cond_func_t *f)
-{
-	return ec_dict_set(ec_node_cond_functions, name, f, NULL);
-}
-
-static int ec_node_cond_init_func(void)
-{
-	ec_node_cond_parser = ec_node_cond_build_parser();
-	if (ec_node_cond_parser == NULL)
-		goto fail;
-
-	ec_node_cond_functions = ec_dict();
-	if (ec_node_cond_functions == NULL)
-		goto fail;
-
-	if (add_func("root", eval_root) < 0)
-		goto fail;
-	if (add_func("current", eval_current) < 0)
-		goto fail;
-	if (add_func("bool", eval_bool) < 0)
-		goto fail;
-	if (add_func("or", eval_or) < 0)
-		goto fail;
-	if (add_func("and", eval_and) < 0)
-		goto fail;
-	if (add_func("first_child", eval_first_child) < 0)
-		goto fail;
-	if (add_func("find", eval_find) < 0)
-		goto fail;
-	if (add_func("cmp", eval_cmp) < 0)
-		goto fail;
-	if (add_func("count", eval_count) < 0)
-		goto fail;
-
-	return 0;
-
-fail:
-	EC_LOG(EC_LOG_ERR, "Failed to initialize condition parser\n");
-	ec_node_cond_exit_func();
-	return -1;
+	pthread_mutex_unlock(&ec_node_cond_parser_lock);
 }
 
 static struct ec_init ec_node_cond_init = {
-	.init = ec_node_cond_init_func,
 	.exit = ec_node_cond_exit_func,
 	.priority = 75,
 };
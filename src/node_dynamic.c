@@ -3,6 +3,8 @@
  */
 
 #include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -22,9 +24,63 @@ EC_LOG_TYPE_REGISTER(node_dynamic);
 
 struct ec_node_dynamic {
 	ec_node_dynamic_build_t build;
+	ec_node_dynamic_generation_t generation; /* NULL if the child is not cached */
 	void *opaque;
+	struct ec_node *cache; /* the cached child */
+	uint64_t cache_gen; /* the generation of the cached child */
 };
 
+/*
+ * Protect the cached children, and the references to them. They are shared
+ * by the threads parsing with the same grammar, and the reference counters
+ * of the nodes are not atomic.
+ */
+static pthread_mutex_t ec_node_dynamic_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* drop the reference to a cached child held by a parse tree */
+static void ec_node_dynamic_release(struct ec_node *child)
+{
+	pthread_mutex_lock(&ec_node_dynamic_lock);
+	ec_node_free(child);
+	pthread_mutex_unlock(&ec_node_dynamic_lock);
+}
+
+/* return a reference to the child, built or taken from the cache */
+static struct ec_node *
+ec_node_dynamic_ref_child(const struct ec_node *node, struct ec_pnode *pstate)
+{
+	struct ec_node_dynamic *priv = ec_node_priv(node);
+	struct ec_node *child = NULL;
+	uint64_t gen;
+
+	if (priv->build == NULL) {
+		errno = ENOENT;
+		return NULL;
+	}
+
+	if (priv->generation == NULL)
+		return priv->build(pstate, priv->opaque);
+
+	/* the child is built with the lock held, since it may reference the
+	 * nodes of the grammar, like this one */
+	pthread_mutex_lock(&ec_node_dynamic_lock);
+	gen = priv->generation(priv->opaque);
+	if (priv->cache == NULL || gen != priv->cache_gen) {
+		child = priv->build(pstate, priv->opaque);
+		if (child == NULL)
+			goto out;
+		/* the users of the previous child hold their own reference */
+		ec_node_free(priv->cache);
+		priv->cache = child;
+		priv->cache_gen = gen;
+	}
+	child = ec_node_clone(priv->cache);
+
+out:
+	pthread_mutex_unlock(&ec_node_dynamic_lock);
+	return child;
+}
+
 static int ec_node_dynamic_parse(
 	const struct ec_node *node,
 	struct ec_pnode *parse,
@@ -32,17 +88,15 @@ static int ec_node_dynamic_parse(
 )
 {
 	struct ec_node_dynamic *priv = ec_node_priv(node);
-	struct ec_node *child = NULL;
 	void (*node_free)(struct ec_node *) = ec_node_free;
+	struct ec_node *child = NULL;
 	char key[64];
 	int ret = -1;
 
-	if (priv->build == NULL) {
-		errno = ENOENT;
-		return -1;
-	}
+	if (priv->generation != NULL)
+		node_free = ec_node_dynamic_release;
 
-	child = priv->build(parse, priv->opaque);
+	child = ec_node_dynamic_ref_child(node, parse);
 	if (child == NULL)
 		goto fail;
 
@@ -69,19 +123,17 @@ static int ec_node_dynamic_complete(
 )
 {
 	struct ec_node_dynamic *priv = ec_node_priv(node);
-	struct ec_pnode *parse;
-	struct ec_node *child = NULL;
 	void (*node_free)(struct ec_node *) = ec_node_free;
+	struct ec_node *child = NULL;
+	struct ec_pnode *parse;
 	char key[64];
 	int ret = -1;
 
-	if (priv->build == NULL) {
-		errno = ENOENT;
-		return -1;
-	}
+	if (priv->generation != NULL)
+		node_free = ec_node_dynamic_release;
 
 	parse = ec_comp_get_cur_pstate(comp);
-	child = priv->build(parse, priv->opaque);
+	child = ec_node_dynamic_ref_child(node, parse);
 	if (child == NULL)
 		goto fail;
 
@@ -101,11 +153,51 @@ fail:
 	return ret;
 }
 
+static void ec_node_dynamic_free_priv(struct ec_node *node)
+{
+	struct ec_node_dynamic *priv = ec_node_priv(node);
+
+	ec_node_free(priv->cache);
+}
+
+/* the cached child is reported, so that a child referencing this node
+ * (a recursive grammar) does not prevent it from being freed. It is
+ * also browsed by ec_node_visit() once it is built. */
+static size_t ec_node_dynamic_get_children_count(const struct ec_node *node)
+{
+	struct ec_node_dynamic *priv = ec_node_priv(node);
+
+	if (priv->cache)
+		return 1;
+	return 0;
+}
+
+static int ec_node_dynamic_get_child(
+	const struct ec_node *node,
+	size_t i,
+	struct ec_node **child,
+	unsigned int *refs
+)
+{
+	struct ec_node_dynamic *priv = ec_node_priv(node);
+
+	if (i >= 1)
+		return -1;
+
+	*child = priv->cache;
+	*refs = 1;
+	return 0;
+}
+
 static struct ec_node_type ec_node_dynamic_type = {
 	.name = "dynamic",
 	.parse = ec_node_dynamic_parse,
 	.complete = ec_node_dynamic_complete,
 	.size = sizeof(struct ec_node_dynamic),
+	.free_priv = ec_node_dynamic_free_priv,
+	.get_children_count = ec_node_dynamic_get_children_count,
+	.get_child = ec_node_dynamic_get_child,
+	.uses_parse_tree = true,
 };
 
 struct ec_node *ec_node_dynamic(const char *id, ec_node_dynamic_build_t build, void *opaque)
@@ -133,4 +225,29 @@ fail:
 	return NULL;
 }
 
+struct ec_node *ec_node_dynamic_cached(
+	const char *id,
+	ec_node_dynamic_build_t build,
+	ec_node_dynamic_generation_t generation,
+	void *opaque
+)
+{
+	struct ec_node_dynamic *priv;
+	struct ec_node *node;
+
+	if (generation == NULL) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	node = ec_node_dynamic(id, build, opaque);
+	if (node == NULL)
+		return NULL;
+
+	priv = ec_node_priv(node);
+	priv->generation = generation;
+
+	return node;
+}
+
 EC_NODE_TYPE_REGISTER(ec_node_dynamic_type);
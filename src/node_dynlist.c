@@ -3,7 +3,6 @@
  */
 
 #include <errno.h>
-#include <regex.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -11,6 +10,7 @@
 #include <ecoli/complete.h>
 #include <ecoli/dict.h>
 #include <ecoli/log.h>
+#include <ecoli/nameset.h>
 #include <ecoli/node.h>
 #include <ecoli/node_dynlist.h>
 #include <ecoli/node_many.h>
@@ -19,16 +19,81 @@
 #include <ecoli/string.h>
 #include <ecoli/strvec.h>
 
+#include "regex_private.h"
+
 EC_LOG_TYPE_REGISTER(node_dynlist);
 
 struct ec_node_dynlist {
-	ec_node_dynlist_get_t get;
+	ec_node_dynlist_get_t get; /* NULL if the ops are used */
+	struct ec_node_dynlist_ops ops;
 	void *opaque;
+	struct ec_nameset *nameset; /* reference held by ec_node_dynlist_nameset() */
 	enum ec_node_dynlist_flags flags;
 	char *re_str;
-	regex_t re;
+	struct ec_regex *re;
 };
 
+/* return 1 if the name is in the list, 0 if not, or -1 on error */
+static int dynlist_lookup(struct ec_node_dynlist *priv, struct ec_pnode *pstate, const char *str)
+{
+	struct ec_strvec *names;
+	size_t i, len;
+	int ret = 0;
+
+	if (priv->get == NULL)
+		return priv->ops.lookup(pstate, str, priv->opaque);
+
+	names = priv->get(pstate, priv->opaque);
+	if (names == NULL)
+		return -1;
+
+	len = ec_strvec_len(names);
+	for (i = 0; i < len; i++) {
+		if (!strcmp(ec_strvec_val(names, i), str)) {
+			ret = 1;
+			break;
+		}
+	}
+
+	ec_strvec_free(names);
+	return ret;
+}
+
+/* invoke cb() for each name of the list starting with prefix */
+static int dynlist_iter_prefix(
+	struct ec_node_dynlist *priv,
+	struct ec_pnode *pstate,
+	const char *prefix,
+	ec_node_dynlist_iter_cb_t cb,
+	void *cb_arg
+)
+{
+	struct ec_strvec *names;
+	const char *name;
+	size_t i, len;
+	int ret = 0;
+
+	if (priv->get == NULL)
+		return priv->ops.iter_prefix(pstate, prefix, cb, cb_arg, priv->opaque);
+
+	names = priv->get(pstate, priv->opaque);
+	if (names == NULL)
+		return -1;
+
+	len = ec_strvec_len(names);
+	for (i = 0; i < len; i++) {
+		name = ec_strvec_val(names, i);
+		if (!ec_str_startswith(name, prefix))
+			continue;
+		ret = cb(name, cb_arg);
+		if (ret < 0)
+			break;
+	}
+
+	ec_strvec_free(names);
+	return ret;
+}
+
 static int ec_node_dynlist_parse(
 	const struct ec_node *node,
 	struct ec_pnode *parse,
@@ -36,15 +101,10 @@ static int ec_node_dynlist_parse(
 )
 {
 	struct ec_node_dynlist *priv = ec_node_priv(node);
-	struct ec_strvec *names = NULL;
-	const char *name;
 	const char *str;
-	regmatch_t pos;
-	size_t len;
-	size_t i;
 	int ret;
 
-	if (priv->get == NULL || priv->re_str == NULL) {
+	if ((priv->get == NULL && priv->ops.lookup == NULL) || priv->re_str == NULL) {
 		errno = ENOENT;
 		return -1;
 	}
@@ -54,43 +114,39 @@ static int ec_node_dynlist_parse(
 
 	str = ec_strvec_val(strvec, 0);
 
-	names = priv->get(parse, priv->opaque);
-	if (names == NULL)
-		goto fail;
-
-	len = ec_strvec_len(names);
-	for (i = 0; i < len; i++) {
-		name = ec_strvec_val(names, i);
-		if (strcmp(name, str))
-			continue;
-		if (priv->flags & DYNLIST_EXCLUDE_LIST) {
-			ret = EC_PARSE_NOMATCH;
-			goto end;
-		}
-		if (priv->flags & DYNLIST_MATCH_LIST) {
-			ret = 1;
-			goto end;
-			;
-		}
+	if (priv->flags & (DYNLIST_EXCLUDE_LIST | DYNLIST_MATCH_LIST)) {
+		ret = dynlist_lookup(priv, parse, str);
+		if (ret < 0)
+			return -1;
+		if (ret == 1 && priv->flags & DYNLIST_EXCLUDE_LIST)
+			return EC_PARSE_NOMATCH;
+		if (ret == 1 && priv->flags & DYNLIST_MATCH_LIST)
+			return 1;
 	}
 
 	if (priv->re_str != NULL && priv->flags & DYNLIST_MATCH_REGEXP) {
-		if (regexec(&priv->re, str, 1, &pos, 0) == 0 && pos.rm_so == 0
-		    && pos.rm_eo == (int)strlen(str)) {
-			ret = 1;
-			goto end;
-		}
+		if (ec_regex_match(priv->re, str, strlen(str)) >= 0)
+			return 1;
 	}
 
-	ret = EC_PARSE_NOMATCH;
+	return EC_PARSE_NOMATCH;
+}
 
-end:
-	ec_strvec_free(names);
-	return ret;
+struct dynlist_comp_arg {
+	const struct ec_node *node;
+	struct ec_comp *comp;
+	const char *str;
+};
 
-fail:
-	ret = -1;
-	goto end;
+static int dynlist_add_item(const char *name, void *arg)
+{
+	struct dynlist_comp_arg *comp_arg = arg;
+
+	if (ec_comp_add_item(comp_arg->comp, comp_arg->node, EC_COMP_FULL, comp_arg->str, name)
+	    == NULL)
+		return -1;
+
+	return 0;
 }
 
 static int ec_node_dynlist_complete(
@@ -100,14 +156,11 @@ static int ec_node_dynlist_complete(
 )
 {
 	struct ec_node_dynlist *priv = ec_node_priv(node);
-	const struct ec_comp_item *item = NULL;
-	struct ec_strvec *names = NULL;
-	const char *name;
+	struct dynlist_comp_arg arg;
 	const char *str;
-	size_t len;
-	size_t i;
+	int ret;
 
-	if (priv->get == NULL || priv->re_str == NULL) {
+	if ((priv->get == NULL && priv->ops.iter_prefix == NULL) || priv->re_str == NULL) {
 		errno = ENOENT;
 		return -1;
 	}
@@ -117,44 +170,30 @@ static int ec_node_dynlist_complete(
 
 	str = ec_strvec_val(strvec, 0);
 
-	item = ec_comp_add_item(comp, node, EC_COMP_UNKNOWN, NULL, NULL);
-	if (item == NULL)
-		goto fail;
+	if (ec_comp_add_item(comp, node, EC_COMP_UNKNOWN, NULL, NULL) == NULL)
+		return -1;
 
 	if (priv->flags & DYNLIST_MATCH_LIST) {
-		names = priv->get(ec_comp_get_cur_pstate(comp), priv->opaque);
-		if (names == NULL)
-			goto fail;
-
-		len = ec_strvec_len(names);
-		for (i = 0; i < len; i++) {
-			name = ec_strvec_val(names, i);
-
-			if (!ec_str_startswith(name, str))
-				continue;
-
-			item = ec_comp_add_item(comp, node, EC_COMP_FULL, str, name);
-			if (item == NULL)
-				goto fail;
-		}
+		arg.node = node;
+		arg.comp = comp;
+		arg.str = str;
+		ret = dynlist_iter_prefix(
+			priv, ec_comp_get_cur_pstate(comp), str, dynlist_add_item, &arg
+		);
+		if (ret < 0)
+			return -1;
 	}
 
-	ec_strvec_free(names);
 	return 0;
-
-fail:
-	ec_strvec_free(names);
-	return -1;
 }
 
 static void ec_node_dynlist_free_priv(struct ec_node *node)
 {
 	struct ec_node_dynlist *priv = ec_node_priv(node);
 
-	if (priv->re_str != NULL) {
-		free(priv->re_str);
-		regfree(&priv->re);
-	}
+	free(priv->re_str);
+	ec_regex_free(priv->re);
+	ec_nameset_free(priv->nameset);
 }
 
 static struct ec_node_type ec_node_dynlist_type = {
@@ -163,11 +202,13 @@ static struct ec_node_type ec_node_dynlist_type = {
 	.complete = ec_node_dynlist_complete,
 	.size = sizeof(struct ec_node_dynlist),
 	.free_priv = ec_node_dynlist_free_priv,
+	.uses_parse_tree = true,
 };
 
-struct ec_node *ec_node_dynlist(
+static struct ec_node *__ec_node_dynlist(
 	const char *id,
 	ec_node_dynlist_get_t get,
+	const struct ec_node_dynlist_ops *ops,
 	void *opaque,
 	const char *re_str,
 	enum ec_node_dynlist_flags flags
@@ -175,13 +216,6 @@ struct ec_node *ec_node_dynlist(
 {
 	struct ec_node *node = NULL;
 	struct ec_node_dynlist *priv;
-	regex_t re;
-	int ret;
-
-	if (get == NULL) {
-		errno = EINVAL;
-		goto fail;
-	}
 
 	node = ec_node_from_type(&ec_node_dynlist_type, id);
 	if (node == NULL)
@@ -192,16 +226,12 @@ struct ec_node *ec_node_dynlist(
 	if (priv->re_str == NULL)
 		goto fail;
 
-	ret = regcomp(&re, re_str, REG_EXTENDED);
-	if (ret != 0) {
-		if (ret == REG_ESPACE)
-			errno = ENOMEM;
-		else
-			errno = EINVAL;
+	priv->re = ec_regex(re_str, EC_REGEX_FULL);
+	if (priv->re == NULL)
 		goto fail;
-	}
-	priv->re = re;
 	priv->get = get;
+	if (ops != NULL)
+		priv->ops = *ops;
 	priv->opaque = opaque;
 	priv->flags = flags;
 
@@ -212,4 +242,97 @@ fail:
 	return NULL;
 }
 
+struct ec_node *ec_node_dynlist(
+	const char *id,
+	ec_node_dynlist_get_t get,
+	void *opaque,
+	const char *re_str,
+	enum ec_node_dynlist_flags flags
+)
+{
+	if (get == NULL) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	return __ec_node_dynlist(id, get, NULL, opaque, re_str, flags);
+}
+
+struct ec_node *ec_node_dynlist_indexed(
+	const char *id,
+	const struct ec_node_dynlist_ops *ops,
+	void *opaque,
+	const char *re_str,
+	enum ec_node_dynlist_flags flags
+)
+{
+	if (ops == NULL || ops->lookup == NULL || ops->iter_prefix == NULL) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	return __ec_node_dynlist(id, NULL, ops, opaque, re_str, flags);
+}
+
+static int nameset_lookup(struct ec_pnode *pstate, const char *name, void *opaque)
+{
+	struct ec_nameset *set = opaque;
+
+	(void)pstate;
+
+	return ec_nameset_has(set, name);
+}
+
+static int nameset_iter_prefix(
+	struct ec_pnode *pstate,
+	const char *prefix,
+	ec_node_dynlist_iter_cb_t cb,
+	void *cb_arg,
+	void *opaque
+)
+{
+	struct ec_nameset *set = opaque;
+	size_t i, first, count;
+
+	(void)pstate;
+
+	count = ec_nameset_prefix(set, prefix, &first);
+	for (i = first; i < first + count; i++) {
+		if (cb(ec_nameset_get(set, i), cb_arg) < 0)
+			return -1;
+	}
+
+	return 0;
+}
+
+static const struct ec_node_dynlist_ops nameset_ops = {
+	.lookup = nameset_lookup,
+	.iter_prefix = nameset_iter_prefix,
+};
+
+struct ec_node *ec_node_dynlist_nameset(
+	const char *id,
+	struct ec_nameset *set,
+	const char *re_str,
+	enum ec_node_dynlist_flags flags
+)
+{
+	struct ec_node_dynlist *priv;
+	struct ec_node *node;
+
+	if (set == NULL) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	node = __ec_node_dynlist(id, NULL, &nameset_ops, set, re_str, flags);
+	if (node == NULL)
+		return NULL;
+
+	priv = ec_node_priv(node);
+	priv->nameset = ec_nameset_clone(set);
+
+	return node;
+}
+
 EC_NODE_TYPE_REGISTER(ec_node_dynlist_type);
@@ -4,14 +4,21 @@
 
 #include <assert.h>
 #include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/inotify.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
 #include <sys/types.h>
 #include <unistd.h>
 
 #include <ecoli/complete.h>
+#include <ecoli/htable.h>
+#include <ecoli/init.h>
 #include <ecoli/log.h>
 #include <ecoli/node.h>
 #include <ecoli/node_file.h>
@@ -21,18 +28,410 @@
 
 EC_LOG_TYPE_REGISTER(node_file);
 
-static struct ec_node_file_ops file_ops = {
+/* size of the buffer passed to getdents64(2), holds thousands of entries */
+#define FILE_GETDENTS_BUF_SIZE (128 * 1024)
+
+/* maximum number of directories in the listing cache */
+#define FILE_CACHE_MAX_DIRS 64
+
+/* inotify events that change the listing of a directory */
+#define FILE_CACHE_EVENTS                                                                          \
+	(IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF       \
+	 | IN_ONLYDIR)
+
+/* the record returned by getdents64(2) */
+struct file_dirent64 {
+	uint64_t d_ino;
+	int64_t d_off;
+	unsigned short d_reclen;
+	unsigned char d_type;
+	char d_name[];
+};
+
+/* not provided by all libc */
+static ssize_t file_getdents64(int fd, void *dirp, size_t count)
+{
+	return syscall(SYS_getdents64, fd, dirp, count);
+}
+
+static int file_open(const char *pathname, int flags)
+{
+	return open(pathname, flags);
+}
+
+static const struct ec_node_file_ops default_file_ops = {
 	.lstat = lstat,
-	.opendir = opendir,
-	.readdir = readdir,
-	.closedir = closedir,
-	.dirfd = dirfd,
+	.open = file_open,
+	.getdents64 = file_getdents64,
 	.fstatat = fstatat,
+	.inotify_init1 = inotify_init1,
+	.inotify_add_watch = inotify_add_watch,
+	.inotify_rm_watch = inotify_rm_watch,
+	.read = read,
+	.close = close,
+};
+
+static struct ec_node_file_ops file_ops = default_file_ops;
+
+/* a directory entry in the listing cache */
+struct file_entry {
+	char *name;
+	bool is_dir;
+};
+
+/* the key of the listing cache */
+struct file_dir_key {
+	dev_t dev;
+	ino_t ino;
+};
+
+/* a cached directory listing, valid until an inotify event is received */
+struct file_dir {
+	struct file_dir_key key;
+	uint64_t last_use; /* to evict the least recently used listing */
+	int wd;
+	bool valid;
+	struct file_entry *entries;
+	size_t len;
+	size_t size;
+};
+
+static struct {
+	bool enabled;
+	int fd; /* inotify file descriptor */
+	struct ec_htable *dirs; /* struct file_dir, indexed by struct file_dir_key */
+	uint64_t use_count; /* incremented at each lookup */
+} file_cache = {
+	.fd = -1,
 };
 
 void ec_node_file_set_ops(const struct ec_node_file_ops *ops)
 {
+	if (ops == NULL) {
+		file_ops = default_file_ops;
+		return;
+	}
+
 	file_ops = *ops;
+#define FILE_OPS_DEFAULT(f)                                                                        \
+	do {                                                                                       \
+		if (file_ops.f == NULL)                                                            \
+			file_ops.f = default_file_ops.f;                                           \
+	} while (0)
+	FILE_OPS_DEFAULT(lstat);
+	FILE_OPS_DEFAULT(open);
+	FILE_OPS_DEFAULT(getdents64);
+	FILE_OPS_DEFAULT(fstatat);
+	FILE_OPS_DEFAULT(inotify_init1);
+	FILE_OPS_DEFAULT(inotify_add_watch);
+	FILE_OPS_DEFAULT(inotify_rm_watch);
+	FILE_OPS_DEFAULT(read);
+	FILE_OPS_DEFAULT(close);
+#undef FILE_OPS_DEFAULT
+}
+
+/* read the entries of a directory, many at a time */
+struct file_reader {
+	int fd;
+	char *buf;
+	size_t len;
+	size_t off;
+};
+
+static int file_reader_open(struct file_reader *reader, const char *path)
+{
+	reader->buf = malloc(FILE_GETDENTS_BUF_SIZE);
+	if (reader->buf == NULL)
+		return -1;
+	reader->fd = file_ops.open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (reader->fd < 0) {
+		free(reader->buf);
+		return -1;
+	}
+	reader->len = 0;
+	reader->off = 0;
+
+	return 0;
+}
+
+/* return NULL at the end of the directory (errno is 0) or on error */
+static const struct file_dirent64 *file_reader_next(struct file_reader *reader)
+{
+	const struct file_dirent64 *de;
+	ssize_t n;
+
+	if (reader->off >= reader->len) {
+		do {
+			n = file_ops.getdents64(reader->fd, reader->buf, FILE_GETDENTS_BUF_SIZE);
+		} while (n < 0 && errno == EINTR);
+		if (n <= 0) {
+			if (n == 0)
+				errno = 0;
+			return NULL;
+		}
+		reader->len = n;
+		reader->off = 0;
+	}
+
+	de = (const struct file_dirent64 *)&reader->buf[reader->off];
+	reader->off += de->d_reclen;
+
+	return de;
+}
+
+static void file_reader_close(struct file_reader *reader)
+{
+	file_ops.close(reader->fd);
+	free(reader->buf);
+}
+
+/* check if an entry is a directory, the symbolic links are followed */
+static bool file_reader_is_dir(const struct file_reader *reader, const struct file_dirent64 *de)
+{
+	struct stat st;
+
+	switch (de->d_type) {
+	case DT_DIR:
+		return true;
+	case DT_UNKNOWN:
+	case DT_LNK:
+		/* broken links or removed entries are completed as files */
+		if (file_ops.fstatat(reader->fd, de->d_name, &st, 0) < 0)
+			return false;
+		return S_ISDIR(st.st_mode);
+	default:
+		return false;
+	}
+}
+
+static void file_dir_invalidate(struct file_dir *dir)
+{
+	size_t i;
+
+	for (i = 0; i < dir->len; i++)
+		free(dir->entries[i].name);
+	free(dir->entries);
+	dir->entries = NULL;
+	dir->len = 0;
+	dir->size = 0;
+	dir->valid = false;
+}
+
+static void file_dir_free(void *arg)
+{
+	struct file_dir *dir = arg;
+
+	if (dir->wd >= 0)
+		file_ops.inotify_rm_watch(file_cache.fd, dir->wd);
+	file_dir_invalidate(dir);
+	free(dir);
+}
+
+static struct file_dir *file_cache_lookup_wd(int wd)
+{
+	struct ec_htable_elt_ref *iter;
+	struct file_dir *dir;
+
+	for (iter = ec_htable_iter(file_cache.dirs); iter != NULL;
+	     iter = ec_htable_iter_next(iter)) {
+		dir = ec_htable_iter_get_val(iter);
+		if (dir->wd == wd)
+			return dir;
+	}
+
+	return NULL;
+}
+
+static void file_cache_invalidate_all(void)
+{
+	struct ec_htable_elt_ref *iter;
+
+	for (iter = ec_htable_iter(file_cache.dirs); iter != NULL;
+	     iter = ec_htable_iter_next(iter))
+		file_dir_invalidate(ec_htable_iter_get_val(iter));
+}
+
+/* read the pending inotify events without blocking, and invalidate the
+ * listings of the modified directories */
+static void file_cache_process_events(void)
+{
+	char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	const struct inotify_event *ev;
+	struct file_dir *dir;
+	ssize_t n, off;
+
+	while (1) {
+		n = file_ops.read(file_cache.fd, buf, sizeof(buf));
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0 && errno != EAGAIN) {
+			/* the events are lost, nothing can be trusted */
+			file_cache_invalidate_all();
+			return;
+		}
+		if (n <= 0)
+			return;
+
+		for (off = 0; off + (ssize_t)sizeof(*ev) <= n; off += sizeof(*ev) + ev->len) {
+			ev = (const struct inotify_event *)&buf[off];
+			if (ev->mask & IN_Q_OVERFLOW) {
+				file_cache_invalidate_all();
+				continue;
+			}
+			dir = file_cache_lookup_wd(ev->wd);
+			if (dir == NULL)
+				continue;
+			if (ev->mask & IN_IGNORED) {
+				/* the watch was removed by the kernel,
+				 * the directory was probably deleted */
+				dir->wd = -1;
+			}
+			file_dir_invalidate(dir);
+		}
+	}
+}
+
+/* read the whole content of a directory into the cache entry */
+static int file_dir_fill(struct file_dir *cdir, const char *path)
+{
+	struct file_entry *entries, *entry;
+	const struct file_dirent64 *de;
+	struct file_reader reader;
+	size_t size;
+
+	if (file_reader_open(&reader, path) < 0)
+		return -1;
+
+	while (1) {
+		de = file_reader_next(&reader);
+		if (de == NULL) {
+			if (errno != 0)
+				goto fail;
+			break;
+		}
+
+		if (cdir->len == cdir->size) {
+			size = cdir->size == 0 ? 64 : cdir->size * 2;
+			entries = realloc(cdir->entries, size * sizeof(*entries));
+			if (entries == NULL)
+				goto fail;
+			cdir->entries = entries;
+			cdir->size = size;
+		}
+		entry = &cdir->entries[cdir->len];
+		entry->is_dir = file_reader_is_dir(&reader, de);
+		entry->name = strdup(de->d_name);
+		if (entry->name == NULL)
+			goto fail;
+		cdir->len++;
+	}
+
+	file_reader_close(&reader);
+	cdir->valid = true;
+
+	return 0;
+
+fail:
+	file_reader_close(&reader);
+	file_dir_invalidate(cdir);
+	return -1;
+}
+
+/* remove the least recently used listing from the cache */
+static void file_cache_evict(void)
+{
+	struct ec_htable_elt_ref *iter;
+	struct file_dir *dir, *lru = NULL;
+
+	for (iter = ec_htable_iter(file_cache.dirs); iter != NULL;
+	     iter = ec_htable_iter_next(iter)) {
+		dir = ec_htable_iter_get_val(iter);
+		if (lru == NULL || dir->last_use < lru->last_use)
+			lru = dir;
+	}
+
+	if (lru != NULL)
+		ec_htable_del(file_cache.dirs, &lru->key, sizeof(lru->key));
+}
+
+/* get the cached listing of a directory, reading it if needed */
+static const struct file_dir *file_cache_get(const char *path, const struct stat *st)
+{
+	struct file_dir_key key;
+	struct file_dir *dir;
+
+	file_cache_process_events();
+
+	memset(&key, 0, sizeof(key));
+	key.dev = st->st_dev;
+	key.ino = st->st_ino;
+
+	dir = ec_htable_get(file_cache.dirs, &key, sizeof(key));
+	if (dir != NULL && dir->wd < 0) {
+		ec_htable_del(file_cache.dirs, &key, sizeof(key));
+		dir = NULL;
+	}
+
+	if (dir == NULL) {
+		if (ec_htable_len(file_cache.dirs) >= FILE_CACHE_MAX_DIRS)
+			file_cache_evict();
+
+		dir = calloc(1, sizeof(*dir));
+		if (dir == NULL)
+			return NULL;
+		dir->key = key;
+
+		/* the watch is added before reading the directory, so
+		 * that no modification can be missed */
+		dir->wd = file_ops.inotify_add_watch(file_cache.fd, path, FILE_CACHE_EVENTS);
+		if (dir->wd < 0) {
+			free(dir);
+			return NULL;
+		}
+		if (ec_htable_set(file_cache.dirs, &key, sizeof(key), dir, file_dir_free) < 0)
+			return NULL;
+	}
+
+	dir->last_use = ++file_cache.use_count;
+
+	if (!dir->valid && file_dir_fill(dir, path) < 0)
+		return NULL;
+
+	return dir;
+}
+
+static void file_cache_disable(void)
+{
+	ec_htable_free(file_cache.dirs);
+	file_cache.dirs = NULL;
+	if (file_cache.fd >= 0)
+		file_ops.close(file_cache.fd);
+	file_cache.fd = -1;
+	file_cache.enabled = false;
+}
+
+int ec_node_file_set_cache(bool enable)
+{
+	if (!enable) {
+		file_cache_disable();
+		return 0;
+	}
+
+	if (file_cache.enabled)
+		return 0;
+
+	file_cache.dirs = ec_htable();
+	if (file_cache.dirs == NULL)
+		return -1;
+
+	file_cache.fd = file_ops.inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (file_cache.fd < 0) {
+		file_cache_disable();
+		return -1;
+	}
+	file_cache.enabled = true;
+
+	return 0;
 }
 
 static int ec_node_file_parse(
@@ -98,34 +497,91 @@ static int split_path(const char *path, char **dname_p, char **bname_p)
 	return 0;
 }
 
-static int ec_node_file_complete(
+/* check if a directory entry can complete the given basename */
+static bool file_match(const char *name, const char *bname)
+{
+	if (!ec_str_startswith(name, bname))
+		return false;
+	if (bname[0] != '.' && name[0] == '.')
+		return false;
+
+	return true;
+}
+
+static int file_add_item(
 	const struct ec_node *node,
 	struct ec_comp *comp,
-	const struct ec_strvec *strvec
+	const char *input,
+	size_t bname_len,
+	const char *name,
+	bool is_dir
 )
 {
-	char *dname = NULL, *bname = NULL, *effective_dir;
 	struct ec_comp_item *item = NULL;
 	enum ec_comp_type type;
-	struct stat st, st2;
-	const char *input;
-	size_t bname_len;
-	struct dirent *de = NULL;
-	DIR *dir = NULL;
 	char *comp_str = NULL;
 	char *disp_str = NULL;
-	int is_dir = 0;
+
+	/* add '/' if it's a dir */
+	if (is_dir) {
+		type = EC_COMP_PARTIAL;
+		if (asprintf(&comp_str, "%s%s/", input, &name[bname_len]) < 0)
+			goto fail;
+		if (asprintf(&disp_str, "%s/", name) < 0)
+			goto fail;
+	} else {
+		type = EC_COMP_FULL;
+		if (asprintf(&comp_str, "%s%s", input, &name[bname_len]) < 0)
+			goto fail;
+		if (asprintf(&disp_str, "%s", name) < 0)
+			goto fail;
+	}
+	item = ec_comp_add_item(comp, node, type, input, comp_str);
+	if (item == NULL)
+		goto fail;
+
+	/* fix the display string: we don't want to display the full
+	 * path. */
+	if (ec_comp_item_set_display(item, disp_str) < 0)
+		goto fail;
+
+	free(comp_str);
+	free(disp_str);
+
+	return 0;
+
+fail:
+	free(comp_str);
+	free(disp_str);
+	return -1;
+}
+
+static int ec_node_file_complete(
+	const struct ec_node *node,
+	struct ec_comp *comp,
+	const struct ec_strvec *strvec
+)
+{
+	char *dname = NULL, *bname = NULL, *effective_dir;
+	const struct file_dirent64 *de;
+	struct file_reader reader;
+	const struct file_dir *cdir;
+	bool reader_open = false;
+	const char *input;
+	bool is_dir;
+	size_t bname_len, i;
+	struct stat st;
 
 	/*
 	 * Example with this file tree:
 	 * /
 	 * ├── dir1
-	 * │   ├── file1
-	 * │   ├── file2
-	 * │   └── subdir
-	 * │       └── file3
+	 * │   ├── file1
+	 * │   ├── file2
+	 * │   └── subdir
+	 * │       └── file3
 	 * ├── dir2
-	 * │   └── file4
+	 * │   └── file4
 	 * └── file5
 	 *
 	 * Input     Output completions
@@ -155,84 +611,57 @@ static int ec_node_file_complete(
 	if (!S_ISDIR(st.st_mode))
 		goto out;
 
-	dir = file_ops.opendir(effective_dir);
-	if (dir == NULL)
+	bname_len = strlen(bname);
+
+	/* on cache failure, fallback to reading the directory */
+	cdir = file_cache.enabled ? file_cache_get(effective_dir, &st) : NULL;
+	if (cdir != NULL) {
+		for (i = 0; i < cdir->len; i++) {
+			if (!file_match(cdir->entries[i].name, bname))
+				continue;
+			if (file_add_item(
+				    node,
+				    comp,
+				    input,
+				    bname_len,
+				    cdir->entries[i].name,
+				    cdir->entries[i].is_dir
+			    )
+			    < 0)
+				goto fail;
+		}
 		goto out;
+	}
+
+	if (file_reader_open(&reader, effective_dir) < 0)
+		goto out;
+	reader_open = true;
 
-	bname_len = strlen(bname);
 	while (1) {
-		de = file_ops.readdir(dir);
+		de = file_reader_next(&reader);
 		if (de == NULL)
 			goto out;
 
-		if (!ec_str_startswith(de->d_name, bname))
-			continue;
-		if (bname[0] != '.' && de->d_name[0] == '.')
+		if (!file_match(de->d_name, bname))
 			continue;
 
-		/* add '/' if it's a dir */
-		if (de->d_type == DT_DIR) {
-			is_dir = 1;
-		} else if (de->d_type == DT_UNKNOWN) {
-			int dir_fd = file_ops.dirfd(dir);
-
-			if (dir_fd < 0)
-				goto out;
-			if (file_ops.fstatat(dir_fd, de->d_name, &st2, 0) < 0)
-				goto out;
-			if (S_ISDIR(st2.st_mode))
-				is_dir = 1;
-			else
-				is_dir = 0;
-		} else {
-			is_dir = 0;
-		}
-
-		if (is_dir) {
-			type = EC_COMP_PARTIAL;
-			if (asprintf(&comp_str, "%s%s/", input, &de->d_name[bname_len]) < 0)
-				goto fail;
-			if (asprintf(&disp_str, "%s/", de->d_name) < 0)
-				goto fail;
-		} else {
-			type = EC_COMP_FULL;
-			if (asprintf(&comp_str, "%s%s", input, &de->d_name[bname_len]) < 0)
-				goto fail;
-			if (asprintf(&disp_str, "%s", de->d_name) < 0)
-				goto fail;
-		}
-		item = ec_comp_add_item(comp, node, type, input, comp_str);
-		if (item == NULL)
-			goto fail;
-
-		/* fix the display string: we don't want to display the full
-		 * path. */
-		if (ec_comp_item_set_display(item, disp_str) < 0)
+		is_dir = file_reader_is_dir(&reader, de);
+		if (file_add_item(node, comp, input, bname_len, de->d_name, is_dir) < 0)
 			goto fail;
-
-		item = NULL;
-		free(comp_str);
-		comp_str = NULL;
-		free(disp_str);
-		disp_str = NULL;
 	}
 out:
-	free(comp_str);
-	free(disp_str);
 	free(dname);
 	free(bname);
-	if (dir != NULL)
-		file_ops.closedir(dir);
+	if (reader_open)
+		file_reader_close(&reader);
 
 	return 0;
 
 fail:
-	free(comp_str);
-	free(disp_str);
 	free(dname);
 	free(bname);
-	if (dir != NULL)
-		file_ops.closedir(dir);
+	if (reader_open)
+		file_reader_close(&reader);
 
 	return -1;
 }
@@ -244,3 +673,15 @@ static struct ec_node_type ec_node_file_type = {
 };
 
 EC_NODE_TYPE_REGISTER(ec_node_file_type);
+
+static void ec_node_file_exit_func(void)
+{
+	file_cache_disable();
+}
+
+static struct ec_init ec_node_file_init = {
+	.exit = ec_node_file_exit_func,
+	.priority = 75,
+};
+
+EC_INIT_REGISTER(ec_node_file_init);
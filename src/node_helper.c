@@ -14,6 +14,8 @@
 #include <ecoli/node_helper.h>
 #include <ecoli/utils.h>
 
+#include "node_private.h"
+
 struct ec_node **ec_node_config_node_list_to_table(const struct ec_config *config, size_t *len)
 {
 	struct ec_node **table = NULL;
@@ -64,6 +66,25 @@ fail:
 	return NULL;
 }
 
+struct ec_config *ec_node_config_node_list_from_table(struct ec_node **table, size_t len)
+{
+	struct ec_config *list = NULL;
+	size_t i;
+
+	list = ec_config_list();
+	if (list == NULL)
+		return NULL;
+
+	for (i = 0; i < len; i++) {
+		if (ec_config_list_add(list, ec_config_node(ec_node_clone(table[i]))) < 0) {
+			ec_config_free(list);
+			return NULL;
+		}
+	}
+
+	return list;
+}
+
 struct ec_config *ec_node_config_node_list_from_vargs(va_list ap)
 {
 	struct ec_config *list = NULL;
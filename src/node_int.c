@@ -18,6 +18,8 @@
 #include <ecoli/string.h>
 #include <ecoli/strvec.h>
 
+#include "node_private.h"
+
 EC_LOG_TYPE_REGISTER(node_int);
 
 /* common to int and uint */
@@ -104,6 +106,42 @@ static int ec_node_uint_init_priv(struct ec_node *node)
 	return 0;
 }
 
+static struct ec_config *ec_node_int_uint_get_config(const struct ec_node *node)
+{
+	struct ec_node_int_uint *priv = ec_node_priv(node);
+	struct ec_config *config = NULL;
+	struct ec_config *value;
+
+	config = ec_config_dict();
+	if (config == NULL)
+		goto fail;
+
+	if (priv->check_min) {
+		if (priv->is_signed)
+			value = ec_config_i64(priv->min);
+		else
+			value = ec_config_u64(priv->umin);
+		if (ec_config_dict_set(config, "min", value) < 0)
+			goto fail;
+	}
+	if (priv->check_max) {
+		if (priv->is_signed)
+			value = ec_config_i64(priv->max);
+		else
+			value = ec_config_u64(priv->umax);
+		if (ec_config_dict_set(config, "max", value) < 0)
+			goto fail;
+	}
+	if (ec_config_dict_set(config, "base", ec_config_u64(priv->base)) < 0)
+		goto fail;
+
+	return config;
+
+fail:
+	ec_config_free(config);
+	return NULL;
+}
+
 static const struct ec_config_schema ec_node_int_schema[] = {
 	{
 		.key = "min",
@@ -173,45 +211,34 @@ static struct ec_node_type ec_node_int_type = {
 	.parse = ec_node_int_uint_parse,
 	.size = sizeof(struct ec_node_int_uint),
 	.init_priv = ec_node_uint_init_priv,
+	.get_config = ec_node_int_uint_get_config,
 };
 
 EC_NODE_TYPE_REGISTER(ec_node_int_type);
 
 struct ec_node *ec_node_int(const char *id, int64_t min, int64_t max, unsigned int base)
 {
-	struct ec_config *config = NULL;
-	struct ec_node *node = NULL;
-	int ret;
+	struct ec_node_int_uint *priv;
+	struct ec_node *node;
+
+	if (min > max) {
+		errno = EINVAL;
+		return NULL;
+	}
 
 	node = ec_node_from_type(&ec_node_int_type, id);
 	if (node == NULL)
 		return NULL;
 
-	config = ec_config_dict();
-	if (config == NULL)
-		goto fail;
-
-	ret = ec_config_dict_set(config, "min", ec_config_i64(min));
-	if (ret < 0)
-		goto fail;
-	ret = ec_config_dict_set(config, "max", ec_config_i64(max));
-	if (ret < 0)
-		goto fail;
-	ret = ec_config_dict_set(config, "base", ec_config_u64(base));
-	if (ret < 0)
-		goto fail;
-
-	ret = ec_node_set_config(node, config);
-	config = NULL;
-	if (ret < 0)
-		goto fail;
+	priv = ec_node_priv(node);
+	priv->check_min = true;
+	priv->min = min;
+	priv->check_max = true;
+	priv->max = max;
+	priv->base = base;
+	ec_node_invalidate_config(node);
 
 	return node;
-
-fail:
-	ec_config_free(config);
-	ec_node_free(node);
-	return NULL;
 }
 
 static const struct ec_config_schema ec_node_uint_schema[] = {
@@ -282,45 +309,34 @@ static struct ec_node_type ec_node_uint_type = {
 	.set_config = ec_node_uint_set_config,
 	.parse = ec_node_int_uint_parse,
 	.size = sizeof(struct ec_node_int_uint),
+	.get_config = ec_node_int_uint_get_config,
 };
 
 EC_NODE_TYPE_REGISTER(ec_node_uint_type);
 
 struct ec_node *ec_node_uint(const char *id, uint64_t min, uint64_t max, unsigned int base)
 {
-	struct ec_config *config = NULL;
-	struct ec_node *node = NULL;
-	int ret;
+	struct ec_node_int_uint *priv;
+	struct ec_node *node;
+
+	if (min > max) {
+		errno = EINVAL;
+		return NULL;
+	}
 
 	node = ec_node_from_type(&ec_node_uint_type, id);
 	if (node == NULL)
 		return NULL;
 
-	config = ec_config_dict();
-	if (config == NULL)
-		goto fail;
-
-	ret = ec_config_dict_set(config, "min", ec_config_u64(min));
-	if (ret < 0)
-		goto fail;
-	ret = ec_config_dict_set(config, "max", ec_config_u64(max));
-	if (ret < 0)
-		goto fail;
-	ret = ec_config_dict_set(config, "base", ec_config_u64(base));
-	if (ret < 0)
-		goto fail;
-
-	ret = ec_node_set_config(node, config);
-	config = NULL;
-	if (ret < 0)
-		goto fail;
+	priv = ec_node_priv(node);
+	priv->check_min = true;
+	priv->umin = min;
+	priv->check_max = true;
+	priv->umax = max;
+	priv->base = base;
+	ec_node_invalidate_config(node);
 
 	return node;
-
-fail:
-	ec_config_free(config);
-	ec_node_free(node);
-	return NULL;
 }
 
 int ec_node_int_getval(const struct ec_node *node, const char *str, int64_t *result)
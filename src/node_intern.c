@@ -0,0 +1,306 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2025, Olivier MATZ <zer0@droids-corp.org>
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ecoli/config.h>
+#include <ecoli/dict.h>
+#include <ecoli/htable.h>
+#include <ecoli/init.h>
+#include <ecoli/node.h>
+#include <ecoli/node_intern.h>
+
+#include "dict_private.h"
+#include "node_private.h"
+
+/*
+ * The key of an interned node is a binary description of its type,
+ * identifier, configuration and attributes. The elements of dictionaries
+ * are sorted, so that identical nodes have the same key whatever the
+ * order in which they were configured.
+ */
+struct intern_key {
+	size_t len;
+	char buf[];
+};
+
+/* key -> interned node. The table does not hold a reference to the
+ * nodes: they are removed from it when they are freed. */
+static struct ec_htable *intern_nodes;
+/* node address -> struct intern_key, to remove it from intern_nodes */
+static struct ec_htable *intern_keys;
+static pthread_mutex_t intern_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int elt_cmp(const void *p1, const void *p2)
+{
+	struct ec_dict_elt_ref *const *elt1 = p1;
+	struct ec_dict_elt_ref *const *elt2 = p2;
+
+	return strcmp(ec_dict_iter_get_key(*elt1), ec_dict_iter_get_key(*elt2));
+}
+
+/* Return the elements of a dictionary, sorted by key. */
+static struct ec_dict_elt_ref **sorted_elts(const struct ec_dict *dict, size_t *len)
+{
+	struct ec_dict_elt_ref **elts, *iter;
+	size_t i = 0;
+
+	*len = ec_dict_len(dict);
+	elts = malloc((*len + 1) * sizeof(*elts));
+	if (elts == NULL)
+		return NULL;
+	for (iter = ec_dict_iter(dict); iter != NULL; iter = ec_dict_iter_next(iter))
+		elts[i++] = iter;
+	qsort(elts, *len, sizeof(*elts), elt_cmp);
+
+	return elts;
+}
+
+static void write_string(FILE *f, const char *str)
+{
+	size_t len = strlen(str);
+
+	fwrite(&len, sizeof(len), 1, f);
+	fwrite(str, 1, len, f);
+}
+
+static int write_config(FILE *f, const struct ec_config *config)
+{
+	struct ec_dict_elt_ref **elts;
+	const struct ec_config *value;
+	size_t i, len;
+
+	fwrite(&config->type, sizeof(config->type), 1, f);
+
+	switch (config->type) {
+	case EC_CONFIG_TYPE_BOOL:
+		fwrite(&config->boolean, sizeof(config->boolean), 1, f);
+		break;
+	case EC_CONFIG_TYPE_INT64:
+		fwrite(&config->i64, sizeof(config->i64), 1, f);
+		break;
+	case EC_CONFIG_TYPE_UINT64:
+		fwrite(&config->u64, sizeof(config->u64), 1, f);
+		break;
+	case EC_CONFIG_TYPE_STRING:
+		write_string(f, config->string);
+		break;
+	case EC_CONFIG_TYPE_NODE:
+		/* children are compared by address */
+		fwrite(&config->node, sizeof(config->node), 1, f);
+		break;
+	case EC_CONFIG_TYPE_LIST:
+		len = 0;
+		TAILQ_FOREACH (value, &config->list, next)
+			len++;
+		fwrite(&len, sizeof(len), 1, f);
+		TAILQ_FOREACH (value, &config->list, next) {
+			if (write_config(f, value) < 0)
+				return -1;
+		}
+		break;
+	case EC_CONFIG_TYPE_DICT:
+		elts = sorted_elts(config->dict, &len);
+		if (elts == NULL)
+			return -1;
+		fwrite(&len, sizeof(len), 1, f);
+		for (i = 0; i < len; i++) {
+			write_string(f, ec_dict_iter_get_key(elts[i]));
+			if (write_config(f, ec_dict_iter_get_val(elts[i])) < 0) {
+				free(elts);
+				return -1;
+			}
+		}
+		free(elts);
+		break;
+	default:
+		break;
+	}
+
+	return 0;
+}
+
+/* Strings freed with free() (like the help set by ec_interact_set_help())
+ * are compared by value, the other attributes by address. */
+static int write_attrs(FILE *f, const struct ec_dict *attrs)
+{
+	struct ec_dict_elt_ref **elts;
+	ec_dict_elt_free_t free_cb;
+	const char *val;
+	size_t i, len;
+
+	elts = sorted_elts(attrs, &len);
+	if (elts == NULL)
+		return -1;
+
+	fwrite(&len, sizeof(len), 1, f);
+	for (i = 0; i < len; i++) {
+		write_string(f, ec_dict_iter_get_key(elts[i]));
+		val = ec_dict_iter_get_val(elts[i]);
+		free_cb = ec_dict_iter_get_free(elts[i]);
+		fwrite(&free_cb, sizeof(free_cb), 1, f);
+		if (val != NULL && free_cb == free)
+			write_string(f, val);
+		else
+			fwrite(&val, sizeof(val), 1, f);
+	}
+	free(elts);
+
+	return 0;
+}
+
+/* Build the key of a node. Return 1 if the node cannot be interned. */
+static int build_key(struct ec_node *node, struct intern_key **key)
+{
+	const struct ec_node_type *type = ec_node_type(node);
+	const struct ec_config *config;
+	char *buf = NULL;
+	size_t len = 0;
+	bool built;
+	FILE *f;
+	int ret;
+
+	*key = NULL;
+
+	if (type->schema == NULL)
+		return 1;
+	built = ec_node_has_config(node);
+	config = ec_node_get_config(node);
+	if (config == NULL)
+		return 1;
+
+	f = open_memstream(&buf, &len);
+	if (f == NULL)
+		return -1;
+	fwrite(&type, sizeof(type), 1, f);
+	write_string(f, ec_node_id(node));
+	ret = write_config(f, config);
+	if (ret == 0)
+		ret = write_attrs(f, ec_node_attrs(node));
+	if (ferror(f)) {
+		errno = ENOMEM;
+		ret = -1;
+	}
+	fclose(f);
+	if (ret < 0)
+		goto out;
+
+	*key = malloc(sizeof(**key) + len);
+	if (*key == NULL) {
+		ret = -1;
+		goto out;
+	}
+	(*key)->len = len;
+	memcpy((*key)->buf, buf, len);
+
+out:
+	free(buf);
+
+	/* do not keep a configuration built only for the key */
+	if (!built && type->get_config != NULL)
+		ec_node_invalidate_config(node);
+
+	return ret;
+}
+
+struct ec_node *ec_node_intern(struct ec_node *node)
+{
+	struct intern_key *key = NULL;
+	struct ec_node *interned;
+	int ret;
+
+	if (node == NULL)
+		return NULL;
+
+	if (ec_node_is_interned(node))
+		return node;
+
+	ret = build_key(node, &key);
+	if (ret < 0)
+		goto fail;
+	if (ret > 0)
+		return node;
+
+	pthread_mutex_lock(&intern_lock);
+
+	if (intern_nodes == NULL) {
+		intern_nodes = ec_htable();
+		intern_keys = ec_htable();
+		if (intern_nodes == NULL || intern_keys == NULL) {
+			ec_htable_free(intern_nodes);
+			intern_nodes = NULL;
+			ec_htable_free(intern_keys);
+			intern_keys = NULL;
+			goto fail_unlock;
+		}
+	}
+
+	interned = ec_htable_get(intern_nodes, key->buf, key->len);
+	if (interned != NULL) {
+		ec_node_clone(interned);
+		pthread_mutex_unlock(&intern_lock);
+		free(key);
+		ec_node_free(node);
+		return interned;
+	}
+
+	if (ec_htable_set(intern_nodes, key->buf, key->len, node, NULL) < 0)
+		goto fail_unlock;
+	if (ec_htable_set(intern_keys, &node, sizeof(node), key, free) < 0) {
+		/* the key is freed */
+		ec_htable_del(intern_nodes, key->buf, key->len);
+		key = NULL;
+		goto fail_unlock;
+	}
+	ec_node_set_interned(node, true);
+
+	pthread_mutex_unlock(&intern_lock);
+
+	return node;
+
+fail_unlock:
+	pthread_mutex_unlock(&intern_lock);
+fail:
+	free(key);
+	ec_node_free(node);
+	return NULL;
+}
+
+void ec_node_intern_forget(struct ec_node *node)
+{
+	struct intern_key *key;
+
+	pthread_mutex_lock(&intern_lock);
+	if (intern_keys != NULL) {
+		key = ec_htable_get(intern_keys, &node, sizeof(node));
+		if (key != NULL) {
+			ec_htable_del(intern_nodes, key->buf, key->len);
+			ec_htable_del(intern_keys, &node, sizeof(node));
+		}
+	}
+	pthread_mutex_unlock(&intern_lock);
+}
+
+static void ec_node_intern_exit_func(void)
+{
+	pthread_mutex_lock(&intern_lock);
+	ec_htable_free(intern_nodes);
+	intern_nodes = NULL;
+	ec_htable_free(intern_keys);
+	intern_keys = NULL;
+	pthread_mutex_unlock(&intern_lock);
+}
+
+static struct ec_init ec_node_intern_init = {
+	.exit = ec_node_intern_exit_func,
+	.priority = 75,
+};
+
+EC_INIT_REGISTER(ec_node_intern_init);
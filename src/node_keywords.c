@@ -0,0 +1,341 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2025, Olivier MATZ <zer0@droids-corp.org>
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ecoli/complete.h>
+#include <ecoli/config.h>
+#include <ecoli/log.h>
+#include <ecoli/node.h>
+#include <ecoli/node_keywords.h>
+#include <ecoli/parse.h>
+#include <ecoli/string.h>
+#include <ecoli/strvec.h>
+
+EC_LOG_TYPE_REGISTER(node_keywords);
+
+struct ec_node_keywords {
+	char **table; /**< Sorted keywords, pointing to buf. */
+	size_t len;
+	char *buf; /**< The keywords, separated by '\0'. */
+	bool unique_prefix;
+};
+
+/* index of the first keyword greater or equal to the token */
+static size_t lower_bound(const struct ec_node_keywords *priv, const char *token)
+{
+	size_t lo = 0, hi = priv->len, mid;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (strcmp(priv->table[mid], token) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+/*
+ * The keywords starting with the token are contiguous, the first one is at the
+ * lower bound. An exact match is always first in this range.
+ */
+static const char *keywords_match(const struct ec_node_keywords *priv, const char *token)
+{
+	size_t i = lower_bound(priv, token);
+
+	if (i == priv->len || !ec_str_startswith(priv->table[i], token))
+		return NULL;
+
+	if (strcmp(priv->table[i], token) == 0)
+		return priv->table[i];
+
+	if (!priv->unique_prefix || token[0] == '\0')
+		return NULL;
+
+	if (i + 1 < priv->len && ec_str_startswith(priv->table[i + 1], token))
+		return NULL;
+
+	return priv->table[i];
+}
+
+static int ec_node_keywords_parse(
+	const struct ec_node *node,
+	struct ec_pnode *pstate,
+	const struct ec_strvec *strvec
+)
+{
+	struct ec_node_keywords *priv = ec_node_priv(node);
+
+	(void)pstate;
+
+	if (priv->table == NULL) {
+		errno = ENOENT;
+		return -1;
+	}
+
+	if (ec_strvec_len(strvec) == 0)
+		return EC_PARSE_NOMATCH;
+
+	if (keywords_match(priv, ec_strvec_val(strvec, 0)) == NULL)
+		return EC_PARSE_NOMATCH;
+
+	return 1;
+}
+
+static int ec_node_keywords_complete(
+	const struct ec_node *node,
+	struct ec_comp *comp,
+	const struct ec_strvec *strvec
+)
+{
+	struct ec_node_keywords *priv = ec_node_priv(node);
+	const struct ec_comp_item *item;
+	const char *str;
+	size_t i;
+
+	if (priv->table == NULL) {
+		errno = ENOENT;
+		return -1;
+	}
+
+	if (ec_strvec_len(strvec) != 1)
+		return 0;
+
+	str = ec_strvec_val(strvec, 0);
+	for (i = lower_bound(priv, str); i < priv->len; i++) {
+		if (!ec_str_startswith(priv->table[i], str))
+			break;
+		item = ec_comp_add_item(comp, node, EC_COMP_FULL, str, priv->table[i]);
+		if (item == NULL)
+			return -1;
+	}
+
+	return 0;
+}
+
+static void ec_node_keywords_free_priv(struct ec_node *node)
+{
+	struct ec_node_keywords *priv = ec_node_priv(node);
+
+	free(priv->table);
+	free(priv->buf);
+}
+
+static const struct ec_config_schema ec_node_keywords_subschema[] = {
+	{
+		.desc = "A keyword to match.",
+		.type = EC_CONFIG_TYPE_STRING,
+	},
+	{
+		.type = EC_CONFIG_TYPE_NONE,
+	},
+};
+
+static const struct ec_config_schema ec_node_keywords_schema[] = {
+	{
+		.key = "keywords",
+		.desc = "The list of keywords to match.",
+		.type = EC_CONFIG_TYPE_LIST,
+		.subschema = ec_node_keywords_subschema,
+	},
+	{
+		.key = "unique_prefix",
+		.desc = "Also match a token which is the prefix of only one keyword.",
+		.type = EC_CONFIG_TYPE_BOOL,
+	},
+	{
+		.type = EC_CONFIG_TYPE_NONE,
+	},
+};
+
+static int cmp_keywords(const void *a, const void *b)
+{
+	return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+static int ec_node_keywords_set_config(struct ec_node *node, const struct ec_config *config)
+{
+	struct ec_node_keywords *priv = ec_node_priv(node);
+	const struct ec_config *keywords, *unique_prefix, *elt;
+	char **table = NULL, *buf = NULL;
+	size_t i, n, size = 0;
+	ssize_t count;
+
+	keywords = ec_config_dict_get(config, "keywords");
+	if (keywords == NULL) {
+		errno = EINVAL;
+		goto fail;
+	}
+	count = ec_config_count(keywords);
+	if (count < 0)
+		goto fail;
+
+	TAILQ_FOREACH (elt, &keywords->list, next) {
+		if (ec_config_get_type(elt) != EC_CONFIG_TYPE_STRING) {
+			errno = EINVAL;
+			goto fail;
+		}
+		size += strlen(elt->string) + 1;
+	}
+
+	unique_prefix = ec_config_dict_get(config, "unique_prefix");
+	if (unique_prefix != NULL && ec_config_get_type(unique_prefix) != EC_CONFIG_TYPE_BOOL) {
+		errno = EINVAL;
+		goto fail;
+	}
+
+	/* all strings are stored in one buffer, the table is then sorted */
+	table = calloc(count + 1, sizeof(*table));
+	buf = malloc(size + 1);
+	if (table == NULL || buf == NULL)
+		goto fail;
+
+	n = 0;
+	size = 0;
+	TAILQ_FOREACH (elt, &keywords->list, next) {
+		table[n++] = strcpy(&buf[size], elt->string);
+		size += strlen(elt->string) + 1;
+	}
+	qsort(table, n, sizeof(*table), cmp_keywords);
+
+	/* remove duplicates */
+	n = 0;
+	for (i = 0; i < (size_t)count; i++) {
+		if (n == 0 || strcmp(table[i], table[n - 1]) != 0)
+			table[n++] = table[i];
+	}
+
+	free(priv->table);
+	free(priv->buf);
+	priv->table = table;
+	priv->buf = buf;
+	priv->len = n;
+	priv->unique_prefix = unique_prefix != NULL && unique_prefix->boolean;
+
+	return 0;
+
+fail:
+	free(table);
+	free(buf);
+	return -1;
+}
+
+static struct ec_node_type ec_node_keywords_type = {
+	.name = "keywords",
+	.schema = ec_node_keywords_schema,
+	.set_config = ec_node_keywords_set_config,
+	.parse = ec_node_keywords_parse,
+	.complete = ec_node_keywords_complete,
+	.size = sizeof(struct ec_node_keywords),
+	.free_priv = ec_node_keywords_free_priv,
+};
+
+EC_NODE_TYPE_REGISTER(ec_node_keywords_type);
+
+int ec_node_keywords_set(
+	struct ec_node *node,
+	const char *const *keywords,
+	size_t len,
+	bool unique_prefix
+)
+{
+	struct ec_config *config = NULL, *list = NULL;
+	size_t i;
+	int ret;
+
+	if (ec_node_check_type(node, &ec_node_keywords_type) < 0)
+		goto fail;
+
+	if (keywords == NULL && len != 0) {
+		errno = EINVAL;
+		goto fail;
+	}
+
+	config = ec_config_dict();
+	if (config == NULL)
+		goto fail;
+
+	list = ec_config_list();
+	if (list == NULL)
+		goto fail;
+
+	for (i = 0; i < len; i++) {
+		if (keywords[i] == NULL) {
+			errno = EINVAL;
+			goto fail;
+		}
+		if (ec_config_list_add(list, ec_config_string(keywords[i])) < 0)
+			goto fail;
+	}
+
+	ret = ec_config_dict_set(config, "keywords", list);
+	list = NULL; /* freed on error */
+	if (ret < 0)
+		goto fail;
+
+	if (ec_config_dict_set(config, "unique_prefix", ec_config_bool(unique_prefix)) < 0)
+		goto fail;
+
+	ret = ec_node_set_config(node, config);
+	config = NULL; /* freed */
+	if (ret < 0)
+		goto fail;
+
+	return 0;
+
+fail:
+	ec_config_free(list);
+	ec_config_free(config);
+	return -1;
+}
+
+struct ec_node *ec_node_keywords(
+	const char *id,
+	const char *const *keywords,
+	size_t len,
+	bool unique_prefix
+)
+{
+	struct ec_node *node = NULL;
+
+	node = ec_node_from_type(&ec_node_keywords_type, id);
+	if (node == NULL)
+		goto fail;
+
+	if (ec_node_keywords_set(node, keywords, len, unique_prefix) < 0)
+		goto fail;
+
+	return node;
+
+fail:
+	ec_node_free(node);
+	return NULL;
+}
+
+const char *ec_node_keywords_match(const struct ec_node *node, const char *token)
+{
+	struct ec_node_keywords *priv;
+	const char *keyword;
+
+	if (ec_node_check_type(node, &ec_node_keywords_type) < 0)
+		return NULL;
+
+	priv = ec_node_priv(node);
+
+	if (priv->table == NULL || token == NULL) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	keyword = keywords_match(priv, token);
+	if (keyword == NULL)
+		errno = ENOENT;
+
+	return keyword;
+}
@@ -3,6 +3,7 @@
  */
 
 #include <errno.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -17,6 +18,8 @@
 #include <ecoli/parse.h>
 #include <ecoli/strvec.h>
 
+#include "node_private.h"
+
 EC_LOG_TYPE_REGISTER(node_many);
 
 struct ec_node_many {
@@ -178,10 +181,35 @@ static int ec_node_many_get_child(
 		return -1;
 
 	*child = priv->child;
-	*refs = 2;
+	/* the child is referenced once in priv, and once in the config if
+	 * it is built */
+	*refs = ec_node_has_config(node) ? 2 : 1;
 	return 0;
 }
 
+static struct ec_config *ec_node_many_get_config(const struct ec_node *node)
+{
+	struct ec_node_many *priv = ec_node_priv(node);
+	struct ec_config *config = NULL;
+
+	config = ec_config_dict();
+	if (config == NULL)
+		goto fail;
+
+	if (ec_config_dict_set(config, "child", ec_config_node(ec_node_clone(priv->child))) < 0)
+		goto fail;
+	if (ec_config_dict_set(config, "min", ec_config_u64(priv->min)) < 0)
+		goto fail;
+	if (ec_config_dict_set(config, "max", ec_config_u64(priv->max)) < 0)
+		goto fail;
+
+	return config;
+
+fail:
+	ec_config_free(config);
+	return NULL;
+}
+
 static const struct ec_config_schema ec_node_many_schema[] = {
 	{
 		.key = "child",
@@ -257,6 +285,7 @@ static struct ec_node_type ec_node_many_type = {
 	.free_priv = ec_node_many_free_priv,
 	.get_children_count = ec_node_many_get_children_count,
 	.get_child = ec_node_many_get_child,
+	.get_config = ec_node_many_get_config,
 };
 
 EC_NODE_TYPE_REGISTER(ec_node_many_type);
@@ -268,41 +297,28 @@ int ec_node_many_set_params(
 	unsigned int max
 )
 {
-	const struct ec_config *cur_config = NULL;
-	struct ec_config *config = NULL;
-	int ret;
+	struct ec_node_many *priv;
+	struct ec_node *old_child;
 
 	if (ec_node_check_type(node, &ec_node_many_type) < 0)
 		goto fail;
 
-	cur_config = ec_node_get_config(node);
-	if (cur_config == NULL)
-		config = ec_config_dict();
-	else
-		config = ec_config_dup(cur_config);
-	if (config == NULL)
-		goto fail;
-
-	if (ec_config_dict_set(config, "child", ec_config_node(child)) < 0) {
-		child = NULL; /* freed */
+	if (child == NULL || min >= UINT_MAX || max >= UINT_MAX) {
+		errno = EINVAL;
 		goto fail;
 	}
-	child = NULL; /* freed */
 
-	if (ec_config_dict_set(config, "min", ec_config_u64(min)) < 0)
-		goto fail;
-	if (ec_config_dict_set(config, "max", ec_config_u64(max)) < 0)
-		goto fail;
-
-	ret = ec_node_set_config(node, config);
-	config = NULL; /* freed */
-	if (ret < 0)
-		goto fail;
+	priv = ec_node_priv(node);
+	old_child = priv->child;
+	priv->child = child;
+	priv->min = min;
+	priv->max = max;
+	ec_node_invalidate_config(node);
+	ec_node_free(old_child);
 
 	return 0;
 
 fail:
-	ec_config_free(config);
 	ec_node_free(child);
 	return -1;
 }
@@ -18,29 +18,14 @@
 #include <ecoli/parse.h>
 #include <ecoli/strvec.h>
 
+#include "parse_private.h"
+
 EC_LOG_TYPE_REGISTER(node_once);
 
 struct ec_node_once {
 	struct ec_node *child;
 };
 
-static unsigned int count_node(struct ec_pnode *parse, const struct ec_node *node)
-{
-	struct ec_pnode *child;
-	unsigned int count = 0;
-
-	if (parse == NULL)
-		return 0;
-
-	if (ec_pnode_get_node(parse) == node)
-		count++;
-
-	EC_PNODE_FOREACH_CHILD (child, parse)
-		count += count_node(child, node);
-
-	return count;
-}
-
 static int ec_node_once_parse(
 	const struct ec_node *node,
 	struct ec_pnode *state,
@@ -48,7 +33,7 @@ static int ec_node_once_parse(
 )
 {
 	struct ec_node_once *priv = ec_node_priv(node);
-	unsigned int count;
+	int count;
 
 	if (priv->child == NULL) {
 		errno = ENOENT;
@@ -58,7 +43,9 @@ static int ec_node_once_parse(
 	/* count the number of occurrences of the node: if already parsed,
 	 * do not match
 	 */
-	count = count_node(ec_pnode_get_root(state), priv->child);
+	count = ec_pnode_count_node(state, priv->child);
+	if (count < 0)
+		return -1;
 	if (count > 0)
 		return EC_PARSE_NOMATCH;
 
@@ -73,8 +60,7 @@ static int ec_node_once_complete(
 {
 	struct ec_node_once *priv = ec_node_priv(node);
 	struct ec_pnode *parse = ec_comp_get_cur_pstate(comp);
-	unsigned int count;
-	int ret;
+	int count, ret;
 
 	if (priv->child == NULL) {
 		errno = ENOENT;
@@ -84,7 +70,9 @@ static int ec_node_once_complete(
 	/* count the number of occurrences of the node: if already parsed,
 	 * do not match
 	 */
-	count = count_node(ec_pnode_get_root(parse), priv->child);
+	count = ec_pnode_count_node(parse, priv->child);
+	if (count < 0)
+		return -1;
 	if (count > 0)
 		return 0;
 
@@ -172,6 +160,7 @@ static struct ec_node_type ec_node_once_type = {
 	.free_priv = ec_node_once_free_priv,
 	.get_children_count = ec_node_once_get_children_count,
 	.get_child = ec_node_once_get_child,
+	.uses_parse_tree = true,
 };
 
 EC_NODE_TYPE_REGISTER(ec_node_once_type);
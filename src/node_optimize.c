@@ -0,0 +1,429 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2025, Olivier MATZ <zer0@droids-corp.org>
+ */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ecoli/config.h>
+#include <ecoli/dict.h>
+#include <ecoli/htable.h>
+#include <ecoli/node.h>
+#include <ecoli/node_keywords.h>
+#include <ecoli/node_optimize.h>
+
+#include "node_private.h"
+
+/* above this number of removed nodes, a chain of wrappers is a loop */
+#define OPTIMIZE_MAX_DEPTH 64
+
+/* minimum number of consecutive str nodes replaced by a keywords node */
+#define OPTIMIZE_MIN_KEYWORDS 3
+
+/* a table of node references */
+struct node_table {
+	struct ec_node **table;
+	size_t len;
+	size_t size;
+};
+
+struct optimizer {
+	const struct ec_node_type *seq;
+	const struct ec_node_type *or;
+	const struct ec_node_type *option;
+	const struct ec_node_type *many;
+	const struct ec_node_type *bypass;
+	const struct ec_node_type *cmd;
+	const struct ec_node_type *str;
+	struct node_table nodes; /* the nodes to rewrite, children first */
+	struct node_table opaque; /* the nodes whose children are not browsed */
+	struct ec_htable *protected; /* the nodes below an opaque node */
+};
+
+static int node_table_add(struct node_table *table, struct ec_node *node)
+{
+	struct ec_node **new_table;
+	size_t size;
+
+	if (table->len == table->size) {
+		size = table->size == 0 ? 16 : table->size * 2;
+		new_table = realloc(table->table, size * sizeof(*new_table));
+		if (new_table == NULL)
+			return -1;
+		table->table = new_table;
+		table->size = size;
+	}
+	table->table[table->len++] = ec_node_clone(node);
+
+	return 0;
+}
+
+static void node_table_free(struct node_table *table)
+{
+	size_t i;
+
+	for (i = 0; i < table->len; i++)
+		ec_node_free(table->table[i]);
+	free(table->table);
+	table->table = NULL;
+	table->len = 0;
+	table->size = 0;
+}
+
+/* The nodes with an identifier or attributes are never removed. */
+static bool is_plain(const struct ec_node *node)
+{
+	return !strcmp(ec_node_id(node), EC_NO_ID) && ec_dict_len(ec_node_attrs(node)) == 0;
+}
+
+/* The nodes whose child is replaced by ec_node_set_config(). */
+static bool is_rewritable(const struct optimizer *opt, const struct ec_node *node)
+{
+	const struct ec_node_type *type = ec_node_type(node);
+
+	return type == opt->seq || type == opt->or || type == opt->option || type == opt->many
+		|| type == opt->bypass;
+}
+
+static int collect_pre(struct ec_node *node, struct ec_node *parent, void *opaque)
+{
+	struct optimizer *opt = opaque;
+
+	(void)parent;
+
+	/* the grammar built by a cmd node can be optimized, but not replaced */
+	if (is_rewritable(opt, node) || ec_node_type(node) == opt->cmd)
+		return EC_NODE_VISIT_CONTINUE;
+
+	if (ec_node_get_children_count(node) > 0 && node_table_add(&opt->opaque, node) < 0)
+		return -1;
+
+	return EC_NODE_VISIT_SKIP;
+}
+
+static int collect_post(struct ec_node *node, struct ec_node *parent, void *opaque)
+{
+	struct optimizer *opt = opaque;
+
+	(void)parent;
+
+	if (is_rewritable(opt, node) && node_table_add(&opt->nodes, node) < 0)
+		return -1;
+
+	return EC_NODE_VISIT_CONTINUE;
+}
+
+static int protect_pre(struct ec_node *node, struct ec_node *parent, void *opaque)
+{
+	struct optimizer *opt = opaque;
+
+	(void)parent;
+
+	if (ec_htable_has_key(opt->protected, &node, sizeof(node)))
+		return EC_NODE_VISIT_SKIP;
+	if (ec_htable_set(opt->protected, &node, sizeof(node), NULL, NULL) < 0)
+		return -1;
+
+	return EC_NODE_VISIT_CONTINUE;
+}
+
+/*
+ * Return the node matching the same input as this one, after removing
+ * the wrappers: bypass nodes, and seq or or nodes with only one child.
+ */
+static struct ec_node *resolve(const struct optimizer *opt, struct ec_node *node)
+{
+	const struct ec_node_type *type;
+	struct ec_node *child;
+	unsigned int i;
+
+	for (i = 0; i < OPTIMIZE_MAX_DEPTH; i++) {
+		type = ec_node_type(node);
+		if (type != opt->bypass && type != opt->seq && type != opt->or)
+			break;
+		if (!is_plain(node) || ec_node_get_children_count(node) != 1)
+			break;
+		if (ec_node_get_child(node, 0, &child) < 0)
+			break;
+		node = child;
+	}
+
+	return node;
+}
+
+/*
+ * Replace one value of the configuration of a node. The value is
+ * consumed. A configuration built only for this update is dropped.
+ */
+static int set_config_value(struct ec_node *node, const char *key, struct ec_config *value)
+{
+	bool built = ec_node_has_config(node);
+	const struct ec_config *cur;
+	struct ec_config *config;
+
+	cur = ec_node_get_config(node);
+	if (cur != NULL)
+		config = ec_config_dup(cur);
+	else
+		config = ec_config_dict();
+	if (config == NULL)
+		goto fail;
+	if (ec_config_dict_set(config, key, value) < 0) {
+		ec_config_free(config);
+		return -1;
+	}
+	if (ec_node_set_config(node, config) < 0)
+		return -1;
+
+	if (!built && ec_node_type(node)->get_config != NULL)
+		ec_node_invalidate_config(node);
+
+	return 0;
+
+fail:
+	ec_config_free(value);
+	return -1;
+}
+
+static int rewrite_child(const struct optimizer *opt, struct ec_node *node)
+{
+	struct ec_node *child, *new_child;
+	unsigned int i;
+
+	if (ec_node_get_children_count(node) != 1 || ec_node_get_child(node, 0, &child) < 0)
+		return 0;
+
+	new_child = resolve(opt, child);
+
+	/* an optional node is already optional */
+	if (ec_node_type(node) == opt->option) {
+		for (i = 0; i < OPTIMIZE_MAX_DEPTH; i++) {
+			if (ec_node_type(new_child) != opt->option || !is_plain(new_child))
+				break;
+			if (ec_node_get_children_count(new_child) != 1)
+				break;
+			if (ec_node_get_child(new_child, 0, &new_child) < 0)
+				return -1;
+			new_child = resolve(opt, new_child);
+		}
+	}
+
+	if (new_child == child)
+		return 0;
+
+	return set_config_value(node, "child", ec_config_node(ec_node_clone(new_child)));
+}
+
+static int cmp_str(const void *p1, const void *p2)
+{
+	return strcmp(*(char *const *)p1, *(char *const *)p2);
+}
+
+/*
+ * Build a keywords node matching the same strings as a list of str
+ * nodes. Return 1 if the strings are not unique: the completion of the
+ * keywords node would return each string only once.
+ */
+static int keywords_from_str(struct ec_node **table, size_t len, struct ec_node **keywords)
+{
+	char **strs, **sorted = NULL;
+	size_t i;
+	int ret = -1;
+
+	*keywords = NULL;
+
+	strs = calloc(len, sizeof(*strs));
+	if (strs == NULL)
+		goto out;
+	for (i = 0; i < len; i++) {
+		strs[i] = ec_node_desc(table[i]);
+		if (strs[i] == NULL)
+			goto out;
+	}
+
+	sorted = malloc(len * sizeof(*sorted));
+	if (sorted == NULL)
+		goto out;
+	memcpy(sorted, strs, len * sizeof(*sorted));
+	qsort(sorted, len, sizeof(*sorted), cmp_str);
+	for (i = 1; i < len; i++) {
+		if (!strcmp(sorted[i - 1], sorted[i])) {
+			ret = 1;
+			goto out;
+		}
+	}
+
+	*keywords = ec_node_keywords(EC_NO_ID, (const char *const *)strs, len, false);
+	if (*keywords == NULL)
+		goto out;
+	ret = 0;
+
+out:
+	if (strs != NULL) {
+		for (i = 0; i < len; i++)
+			free(strs[i]);
+	}
+	free(strs);
+	free(sorted);
+	return ret;
+}
+
+/* Replace the runs of plain str nodes by keywords nodes. */
+static int merge_str(const struct optimizer *opt, struct node_table *children)
+{
+	struct node_table out = {0};
+	struct ec_node *keywords;
+	size_t i, j, k;
+	int ret;
+
+	for (i = 0; i < children->len; i = j) {
+		for (j = i; j < children->len; j++) {
+			if (ec_node_type(children->table[j]) != opt->str)
+				break;
+			if (!is_plain(children->table[j]))
+				break;
+		}
+
+		ret = 1;
+		keywords = NULL;
+		if (j - i >= OPTIMIZE_MIN_KEYWORDS)
+			ret = keywords_from_str(&children->table[i], j - i, &keywords);
+		if (ret < 0)
+			goto fail;
+		if (ret == 0) {
+			ret = node_table_add(&out, keywords);
+			ec_node_free(keywords);
+			if (ret < 0)
+				goto fail;
+			continue;
+		}
+
+		if (j == i)
+			j++;
+		for (k = i; k < j; k++) {
+			if (node_table_add(&out, children->table[k]) < 0)
+				goto fail;
+		}
+	}
+
+	node_table_free(children);
+	*children = out;
+
+	return 0;
+
+fail:
+	node_table_free(&out);
+	return -1;
+}
+
+static int rewrite_children(const struct optimizer *opt, struct ec_node *node)
+{
+	const struct ec_node_type *type = ec_node_type(node);
+	struct ec_node *child, *new_child, *grandchild;
+	struct node_table children = {0};
+	bool changed = false;
+	size_t i, j, n;
+	int ret = -1;
+
+	n = ec_node_get_children_count(node);
+	for (i = 0; i < n; i++) {
+		if (ec_node_get_child(node, i, &child) < 0)
+			goto out;
+		new_child = resolve(opt, child);
+		if (new_child != child)
+			changed = true;
+
+		/* a seq in a seq, or an or in an or, is replaced by its children */
+		if (new_child != node && ec_node_type(new_child) == type && is_plain(new_child)) {
+			changed = true;
+			for (j = 0; j < ec_node_get_children_count(new_child); j++) {
+				if (ec_node_get_child(new_child, j, &grandchild) < 0)
+					goto out;
+				if (node_table_add(&children, resolve(opt, grandchild)) < 0)
+					goto out;
+			}
+			continue;
+		}
+
+		if (node_table_add(&children, new_child) < 0)
+			goto out;
+	}
+
+	if (type == opt->or) {
+		n = children.len;
+		if (merge_str(opt, &children) < 0)
+			goto out;
+		if (children.len != n)
+			changed = true;
+	}
+
+	ret = 0;
+	if (!changed)
+		goto out;
+
+	ret = set_config_value(
+		node,
+		"children",
+		ec_node_config_node_list_from_table(children.table, children.len)
+	);
+
+out:
+	node_table_free(&children);
+	return ret;
+}
+
+struct ec_node *ec_node_optimize(struct ec_node *node)
+{
+	struct optimizer opt = {0};
+	struct ec_node *root = NULL, *elt;
+	size_t i;
+
+	if (node == NULL)
+		return NULL;
+
+	opt.seq = ec_node_type_lookup("seq");
+	opt.or = ec_node_type_lookup("or");
+	opt.option = ec_node_type_lookup("option");
+	opt.many = ec_node_type_lookup("many");
+	opt.bypass = ec_node_type_lookup("bypass");
+	opt.cmd = ec_node_type_lookup("cmd");
+	opt.str = ec_node_type_lookup("str");
+
+	opt.protected = ec_htable();
+	if (opt.protected == NULL)
+		goto out;
+
+	if (ec_node_visit(node, collect_pre, collect_post, &opt) < 0)
+		goto out;
+
+	/* the nodes below the other types may depend on their address, or on
+	 * the shape of the parse tree: they are not modified */
+	for (i = 0; i < opt.opaque.len; i++) {
+		if (ec_node_visit(opt.opaque.table[i], protect_pre, NULL, &opt) < 0)
+			goto out;
+	}
+
+	for (i = 0; i < opt.nodes.len; i++) {
+		elt = opt.nodes.table[i];
+		if (ec_htable_has_key(opt.protected, &elt, sizeof(elt)))
+			continue;
+		if (ec_node_type(elt) == opt.seq || ec_node_type(elt) == opt.or) {
+			if (rewrite_children(&opt, elt) < 0)
+				goto out;
+		} else {
+			if (rewrite_child(&opt, elt) < 0)
+				goto out;
+		}
+	}
+
+	root = ec_node_clone(resolve(&opt, node));
+
+out:
+	node_table_free(&opt.nodes);
+	node_table_free(&opt.opaque);
+	ec_htable_free(opt.protected);
+	ec_node_free(node);
+	return root;
+}
@@ -16,6 +16,8 @@
 #include <ecoli/parse.h>
 #include <ecoli/strvec.h>
 
+#include "node_private.h"
+
 EC_LOG_TYPE_REGISTER(node_option);
 
 struct ec_node_option {
@@ -91,10 +93,31 @@ static int ec_node_option_get_child(
 		return -1;
 
 	*child = priv->child;
-	*refs = 2;
+	/* the child is referenced once in priv, and once in the config if
+	 * it is built */
+	*refs = ec_node_has_config(node) ? 2 : 1;
 	return 0;
 }
 
+static struct ec_config *ec_node_option_get_config(const struct ec_node *node)
+{
+	struct ec_node_option *priv = ec_node_priv(node);
+	struct ec_config *config = NULL;
+
+	config = ec_config_dict();
+	if (config == NULL)
+		goto fail;
+
+	if (ec_config_dict_set(config, "child", ec_config_node(ec_node_clone(priv->child))) < 0)
+		goto fail;
+
+	return config;
+
+fail:
+	ec_config_free(config);
+	return NULL;
+}
+
 static const struct ec_config_schema ec_node_option_schema[] = {
 	{
 		.key = "child",
@@ -139,42 +162,33 @@ static struct ec_node_type ec_node_option_type = {
 	.free_priv = ec_node_option_free_priv,
 	.get_children_count = ec_node_option_get_children_count,
 	.get_child = ec_node_option_get_child,
+	.get_config = ec_node_option_get_config,
 };
 
 EC_NODE_TYPE_REGISTER(ec_node_option_type);
 
 int ec_node_option_set_child(struct ec_node *node, struct ec_node *child)
 {
-	const struct ec_config *cur_config = NULL;
-	struct ec_config *config = NULL;
-	int ret;
+	struct ec_node_option *priv;
+	struct ec_node *old_child;
 
 	if (ec_node_check_type(node, &ec_node_option_type) < 0)
 		goto fail;
 
-	cur_config = ec_node_get_config(node);
-	if (cur_config == NULL)
-		config = ec_config_dict();
-	else
-		config = ec_config_dup(cur_config);
-	if (config == NULL)
-		goto fail;
-
-	if (ec_config_dict_set(config, "child", ec_config_node(child)) < 0) {
-		child = NULL; /* freed */
+	if (child == NULL) {
+		errno = EINVAL;
 		goto fail;
 	}
-	child = NULL; /* freed */
 
-	ret = ec_node_set_config(node, config);
-	config = NULL; /* freed */
-	if (ret < 0)
-		goto fail;
+	priv = ec_node_priv(node);
+	old_child = priv->child;
+	priv->child = child;
+	ec_node_invalidate_config(node);
+	ec_node_free(old_child);
 
 	return 0;
 
 fail:
-	ec_config_free(config);
 	ec_node_free(child);
 	return -1;
 }
@@ -190,13 +204,15 @@ struct ec_node *ec_node_option(const char *id, struct ec_node *child)
 	if (node == NULL)
 		goto fail;
 
-	if (ec_node_option_set_child(node, child) < 0)
+	if (ec_node_option_set_child(node, child) < 0) {
+		child = NULL; /* freed */
 		goto fail;
-	child = NULL;
+	}
 
 	return node;
 
 fail:
+	ec_node_free(node);
 	ec_node_free(child);
 	return NULL;
 }
@@ -3,6 +3,7 @@
  */
 
 #include <assert.h>
+#include <errno.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -18,6 +19,8 @@
 #include <ecoli/parse.h>
 #include <ecoli/strvec.h>
 
+#include "node_private.h"
+
 EC_LOG_TYPE_REGISTER(node_or);
 
 struct ec_node_or {
@@ -137,9 +140,49 @@ static int ec_node_or_get_child(
 		return -1;
 
 	*child = priv->table[i];
-	/* each child node is referenced twice: once in the config and
-	 * once in the priv->table[] */
-	*refs = 2;
+	/* each child node is referenced once in the priv->table[], and
+	 * once in the config if it is built */
+	*refs = ec_node_has_config(node) ? 2 : 1;
+	return 0;
+}
+
+static struct ec_config *ec_node_or_get_config(const struct ec_node *node)
+{
+	struct ec_node_or *priv = ec_node_priv(node);
+	struct ec_config *config = NULL, *children;
+
+	config = ec_config_dict();
+	if (config == NULL)
+		goto fail;
+
+	children = ec_node_config_node_list_from_table(priv->table, priv->len);
+	if (children == NULL)
+		goto fail;
+
+	if (ec_config_dict_set(config, "children", children) < 0)
+		goto fail; /* children list is freed on error */
+
+	return config;
+
+fail:
+	ec_config_free(config);
+	return NULL;
+}
+
+/* append a child to the table, the reference is not consumed on error */
+static int ec_node_or_append(struct ec_node *node, struct ec_node *child)
+{
+	struct ec_node_or *priv = ec_node_priv(node);
+	struct ec_node **table;
+
+	table = realloc(priv->table, (priv->len + 1) * sizeof(*priv->table));
+	if (table == NULL)
+		return -1;
+
+	priv->table = table;
+	priv->table[priv->len] = child;
+	priv->len++;
+
 	return 0;
 }
 
@@ -153,6 +196,7 @@ static struct ec_node_type ec_node_or_type = {
 	.free_priv = ec_node_or_free_priv,
 	.get_children_count = ec_node_or_get_children_count,
 	.get_child = ec_node_or_get_child,
+	.get_config = ec_node_or_get_config,
 };
 
 EC_NODE_TYPE_REGISTER(ec_node_or_type);
@@ -164,106 +208,59 @@ struct ec_node *ec_node_or(const char *id)
 
 int ec_node_or_add(struct ec_node *node, struct ec_node *child)
 {
-	const struct ec_config *cur_config = NULL;
-	struct ec_config *config = NULL, *children;
-	int ret;
-
 	assert(node != NULL);
 
 	if (ec_node_check_type(node, &ec_node_or_type) < 0)
 		goto fail;
 
-	cur_config = ec_node_get_config(node);
-	if (cur_config == NULL)
-		config = ec_config_dict();
-	else
-		config = ec_config_dup(cur_config);
-	if (config == NULL)
+	if (child == NULL) {
+		errno = EINVAL;
 		goto fail;
-
-	children = ec_config_dict_get(config, "children");
-	if (children == NULL) {
-		children = ec_config_list();
-		if (children == NULL)
-			goto fail;
-
-		if (ec_config_dict_set(config, "children", children) < 0)
-			goto fail; /* children list is freed on error */
 	}
 
-	if (ec_config_list_add(children, ec_config_node(child)) < 0) {
-		child = NULL;
+	if (ec_node_or_append(node, child) < 0)
 		goto fail;
-	}
 
-	ret = ec_node_set_config(node, config);
-	config = NULL; /* freed */
-	if (ret < 0)
-		goto fail;
+	ec_node_invalidate_config(node);
 
 	return 0;
 
 fail:
-	ec_config_free(config);
 	ec_node_free(child);
 	return -1;
 }
 
 struct ec_node *__ec_node_or(const char *id, ...)
 {
-	struct ec_config *config = NULL, *children = NULL;
 	struct ec_node *node = NULL;
 	struct ec_node *child;
 	va_list ap;
-	int ret;
 
 	va_start(ap, id);
 	child = va_arg(ap, struct ec_node *);
 
 	node = ec_node_from_type(&ec_node_or_type, id);
 	if (node == NULL)
-		goto fail_free_children;
-
-	config = ec_config_dict();
-	if (config == NULL)
-		goto fail_free_children;
-
-	children = ec_config_list();
-	if (children == NULL)
-		goto fail_free_children;
+		goto fail;
 
 	for (; child != EC_VA_END; child = va_arg(ap, struct ec_node *)) {
 		if (child == NULL)
-			goto fail_free_children;
-
-		if (ec_config_list_add(children, ec_config_node(child)) < 0) {
-			child = NULL;
-			goto fail_free_children;
-		}
-	}
+			goto fail;
 
-	if (ec_config_dict_set(config, "children", children) < 0) {
-		children = NULL; /* freed */
-		goto fail;
+		if (ec_node_or_append(node, child) < 0)
+			goto fail;
 	}
-	children = NULL;
 
-	ret = ec_node_set_config(node, config);
-	config = NULL; /* freed */
-	if (ret < 0)
-		goto fail;
+	ec_node_invalidate_config(node);
 
 	va_end(ap);
 
 	return node;
 
-fail_free_children:
+fail:
 	for (; child != EC_VA_END; child = va_arg(ap, struct ec_node *))
 		ec_node_free(child);
-fail:
 	ec_node_free(node); /* will also free added children */
-	ec_config_free(children);
-	ec_config_free(config);
 	va_end(ap);
 
 	return NULL;
@@ -0,0 +1,56 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2025, Olivier MATZ <zer0@droids-corp.org>
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <ecoli/node.h>
+
+struct ec_config;
+
+/*
+ * Replace the identifier of a node, for loaders that only know it after
+ * the node is created. Return -1 on error (errno is set).
+ */
+int ec_node_set_id(struct ec_node *node, const char *id);
+
+/*
+ * Drop the configuration of a node after its constructor or a setter
+ * modified its private data directly. The configuration is rebuilt by
+ * the get_config() operation of the node type, when it is requested
+ * with ec_node_get_config().
+ */
+void ec_node_invalidate_config(struct ec_node *node);
+
+/*
+ * Return true if the configuration of the node is currently built. In
+ * this case, it holds a reference to each child of the node.
+ */
+bool ec_node_has_config(const struct ec_node *node);
+
+/*
+ * Get or set the flag telling that a node is registered by
+ * ec_node_intern(). When a flagged node is modified or freed, it is
+ * removed with ec_node_intern_forget().
+ */
+bool ec_node_is_interned(const struct ec_node *node);
+void ec_node_set_interned(struct ec_node *node, bool interned);
+
+/* Remove a node from the table of interned nodes (node_intern.c). */
+void ec_node_intern_forget(struct ec_node *node);
+
+/*
+ * Build a config list referencing the nodes of a table. It takes a
+ * reference on each node. Return NULL on error (errno is set).
+ */
+struct ec_config *ec_node_config_node_list_from_table(struct ec_node **table, size_t len);
+
+/*
+ * Return 1 if the node or one of its descendants has a type whose parse
+ * or completion depends on the parse tree (see the uses_parse_tree field
+ * of struct ec_node_type), 0 if not, or -1 on error (errno is set).
+ */
+int ec_node_uses_parse_tree(struct ec_node *node);
@@ -3,7 +3,6 @@
  */
 
 #include <errno.h>
-#include <regex.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -16,11 +15,14 @@
 #include <ecoli/parse.h>
 #include <ecoli/strvec.h>
 
+#include "node_private.h"
+#include "regex_private.h"
+
 EC_LOG_TYPE_REGISTER(node_re);
 
 struct ec_node_re {
 	char *re_str;
-	regex_t re;
+	struct ec_regex *re;
 };
 
 static int ec_node_re_parse(
@@ -31,7 +33,6 @@ static int ec_node_re_parse(
 {
 	struct ec_node_re *priv = ec_node_priv(node);
 	const char *str;
-	regmatch_t pos;
 
 	(void)pstate;
 
@@ -44,9 +45,7 @@ static int ec_node_re_parse(
 		return EC_PARSE_NOMATCH;
 
 	str = ec_strvec_val(strvec, 0);
-	if (regexec(&priv->re, str, 1, &pos, 0) != 0)
-		return EC_PARSE_NOMATCH;
-	if (pos.rm_so != 0 || pos.rm_eo != (int)strlen(str))
+	if (ec_regex_match(priv->re, str, strlen(str)) < 0)
 		return EC_PARSE_NOMATCH;
 
 	return 1;
@@ -56,10 +55,8 @@ static void ec_node_re_free_priv(struct ec_node *node)
 {
 	struct ec_node_re *priv = ec_node_priv(node);
 
-	if (priv->re_str != NULL) {
-		free(priv->re_str);
-		regfree(&priv->re);
-	}
+	free(priv->re_str);
+	ec_regex_free(priv->re);
 }
 
 static const struct ec_config_schema ec_node_re_schema[] = {
@@ -73,37 +70,22 @@ static const struct ec_config_schema ec_node_re_schema[] = {
 	},
 };
 
-static int ec_node_re_set_config(struct ec_node *node, const struct ec_config *config)
+static int set_pattern(struct ec_node *node, const char *pattern)
 {
 	struct ec_node_re *priv = ec_node_priv(node);
-	const struct ec_config *value = NULL;
+	struct ec_regex *re;
 	char *s = NULL;
-	regex_t re;
-	int ret;
-
-	value = ec_config_dict_get(config, "pattern");
-	if (value == NULL) {
-		errno = EINVAL;
-		goto fail;
-	}
 
-	s = strdup(value->string);
+	s = strdup(pattern);
 	if (s == NULL)
 		goto fail;
 
-	ret = regcomp(&re, s, REG_EXTENDED);
-	if (ret != 0) {
-		if (ret == REG_ESPACE)
-			errno = ENOMEM;
-		else
-			errno = EINVAL;
+	re = ec_regex(s, EC_REGEX_FULL);
+	if (re == NULL)
 		goto fail;
-	}
 
-	if (priv->re_str != NULL) {
-		free(priv->re_str);
-		regfree(&priv->re);
-	}
+	free(priv->re_str);
+	ec_regex_free(priv->re);
 	priv->re_str = s;
 	priv->re = re;
 
@@ -114,6 +96,38 @@ fail:
 	return -1;
 }
 
+static int ec_node_re_set_config(struct ec_node *node, const struct ec_config *config)
+{
+	const struct ec_config *value = NULL;
+
+	value = ec_config_dict_get(config, "pattern");
+	if (value == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	return set_pattern(node, value->string);
+}
+
+static struct ec_config *ec_node_re_get_config(const struct ec_node *node)
+{
+	struct ec_node_re *priv = ec_node_priv(node);
+	struct ec_config *config = NULL;
+
+	config = ec_config_dict();
+	if (config == NULL)
+		goto fail;
+
+	if (ec_config_dict_set(config, "pattern", ec_config_string(priv->re_str)) < 0)
+		goto fail;
+
+	return config;
+
+fail:
+	ec_config_free(config);
+	return NULL;
+}
+
 static struct ec_node_type ec_node_re_type = {
 	.name = "re",
 	.schema = ec_node_re_schema,
@@ -121,38 +135,24 @@ static struct ec_node_type ec_node_re_type = {
 	.parse = ec_node_re_parse,
 	.size = sizeof(struct ec_node_re),
 	.free_priv = ec_node_re_free_priv,
+	.get_config = ec_node_re_get_config,
 };
 
 EC_NODE_TYPE_REGISTER(ec_node_re_type);
 
 int ec_node_re_set_regexp(struct ec_node *node, const char *str)
 {
-	struct ec_config *config = NULL;
-	int ret;
-
 	EC_CHECK_ARG(str != NULL, -1, EINVAL);
 
 	if (ec_node_check_type(node, &ec_node_re_type) < 0)
-		goto fail;
-
-	config = ec_config_dict();
-	if (config == NULL)
-		goto fail;
+		return -1;
 
-	ret = ec_config_dict_set(config, "pattern", ec_config_string(str));
-	if (ret < 0)
-		goto fail;
+	if (set_pattern(node, str) < 0)
+		return -1;
 
-	ret = ec_node_set_config(node, config);
-	config = NULL;
-	if (ret < 0)
-		goto fail;
+	ec_node_invalidate_config(node);
 
 	return 0;
-
-fail:
-	ec_config_free(config);
-	return -1;
 }
 
 struct ec_node *ec_node_re(const char *id, const char *re_str)
@@ -3,7 +3,6 @@
  */
 
 #include <errno.h>
-#include <regex.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -22,89 +21,84 @@
 #include <ecoli/parse.h>
 #include <ecoli/strvec.h>
 
+#include "dict_private.h"
+#include "regex_private.h"
+#include "strvec_private.h"
+
 EC_LOG_TYPE_REGISTER(node_re_lex);
 
 struct regexp_pattern {
 	char *pattern;
-	char *attr_name;
-	regex_t r;
+	struct ec_dict *attrs; /* shared by all tokens, see ec_dict_clone() */
+	struct ec_regex *r;    /* only when the patterns cannot be a set */
 	bool keep;
 };
 
 struct ec_node_re_lex {
 	struct ec_node *child;
 	struct regexp_pattern *table;
+	struct ec_regex_set *set;
 	size_t len;
 };
 
-static struct ec_strvec *tokenize(struct regexp_pattern *table, size_t table_len, const char *str)
+/* Return the length of the first pattern matching at str, and its index. */
+static ssize_t
+lex_match(const struct ec_node_re_lex *priv, const char *str, size_t len, size_t *idx)
 {
+	ssize_t match_len;
+	size_t i;
+
+	if (priv->set != NULL)
+		return ec_regex_set_match(priv->set, str, len, idx);
+
+	for (i = 0; i < priv->len; i++) {
+		match_len = ec_regex_match(priv->table[i].r, str, len);
+		if (match_len > 0) {
+			*idx = i;
+			return match_len;
+		}
+	}
+
+	return -1;
+}
+
+static struct ec_strvec *tokenize(const struct ec_node_re_lex *priv, const char *str)
+{
+	const struct regexp_pattern *pat;
 	struct ec_strvec *strvec = NULL;
-	struct ec_dict *attrs = NULL;
-	char *dup = NULL;
-	char c;
 	size_t len, off = 0;
+	ssize_t match_len;
 	size_t i;
-	int ret = 0;
-	regmatch_t pos = {0};
-
-	dup = strdup(str);
-	if (dup == NULL)
-		goto fail;
 
 	strvec = ec_strvec();
 	if (strvec == NULL)
 		goto fail;
 
-	len = strlen(dup);
+	len = strlen(str);
 	while (off < len) {
-		for (i = 0; i < table_len; i++) {
-			ret = regexec(&table[i].r, &dup[off], 1, &pos, 0);
-			if (ret != 0)
-				continue;
-			if (pos.rm_so != 0 || pos.rm_eo == 0) {
-				ret = -1;
-				continue;
-			}
-
-			if (table[i].keep == 0)
-				break;
+		match_len = lex_match(priv, &str[off], len - off, &i);
+		if (match_len <= 0)
+			goto fail;
 
-			c = dup[pos.rm_eo + off];
-			dup[pos.rm_eo + off] = '\0';
-			EC_LOG(EC_LOG_DEBUG, "re_lex match <%s>\n", &dup[off]);
-			if (ec_strvec_add(strvec, &dup[off]) < 0)
+		pat = &priv->table[i];
+		if (pat->keep) {
+			EC_LOG(EC_LOG_DEBUG, "re_lex match <%.*s>\n", (int)match_len, &str[off]);
+			if (ec_strvec_add_token(
+				    strvec,
+				    &str[off],
+				    match_len,
+				    pat->attrs != NULL ? ec_dict_clone(pat->attrs) : NULL
+			    )
+			    < 0)
 				goto fail;
-
-			if (table[i].attr_name != NULL) {
-				attrs = ec_dict();
-				if (attrs == NULL)
-					goto fail;
-				if (ec_dict_set(attrs, table[i].attr_name, NULL, NULL) < 0)
-					goto fail;
-				if (ec_strvec_set_attrs(strvec, ec_strvec_len(strvec) - 1, attrs)
-				    < 0) {
-					attrs = NULL;
-					goto fail;
-				}
-				attrs = NULL;
-			}
-
-			dup[pos.rm_eo + off] = c;
-			break;
 		}
 
-		if (ret != 0)
-			goto fail;
-
-		off += pos.rm_eo;
+		off += match_len;
 	}
 
-	free(dup);
 	return strvec;
 
 fail:
-	free(dup);
 	ec_strvec_free(strvec);
 	return NULL;
 }
@@ -130,12 +124,12 @@ static int ec_node_re_lex_parse(
 		new_vec = ec_strvec();
 	} else {
 		str = ec_strvec_val(strvec, 0);
-		new_vec = tokenize(priv->table, priv->len, str);
+		new_vec = tokenize(priv, str);
 	}
 	if (new_vec == NULL)
 		goto fail;
 
-	ret = ec_parse_child(priv->child, pstate, new_vec);
+	ret = ec_parse_lexed_child(priv->child, pstate, new_vec);
 	if (ret < 0)
 		goto fail;
 
@@ -158,19 +152,29 @@ fail:
 	return -1;
 }
 
+static void free_table(struct regexp_pattern *table, size_t len)
+{
+	size_t i;
+
+	if (table == NULL)
+		return;
+
+	for (i = 0; i < len; i++) {
+		free(table[i].pattern);
+		if (table[i].attrs != NULL)
+			ec_dict_free(table[i].attrs);
+		ec_regex_free(table[i].r);
+	}
+	free(table);
+}
+
 static void ec_node_re_lex_free_priv(struct ec_node *node)
 {
 	struct ec_node_re_lex *priv = ec_node_priv(node);
-	unsigned int i;
 
 	ec_node_free(priv->child);
-	for (i = 0; i < priv->len; i++) {
-		free(priv->table[i].pattern);
-		free(priv->table[i].attr_name);
-		regfree(&priv->table[i].r);
-	}
-
-	free(priv->table);
+	free_table(priv->table, priv->len);
+	ec_regex_set_free(priv->set);
 }
 
 static size_t ec_node_re_lex_get_children_count(const struct ec_node *node)
@@ -249,14 +253,52 @@ static const struct ec_config_schema ec_node_re_lex_schema[] = {
 	},
 };
 
+/*
+ * Compile all patterns into one automaton. If one of them is not
+ * supported by ec_regex_set(), compile them one by one instead.
+ */
+static int compile_table(struct regexp_pattern *table, size_t len, struct ec_regex_set **set)
+{
+	const char **patterns = NULL;
+	size_t i;
+
+	*set = NULL;
+	if (len == 0)
+		return 0;
+
+	patterns = calloc(len, sizeof(*patterns));
+	if (patterns == NULL)
+		return -1;
+	for (i = 0; i < len; i++)
+		patterns[i] = table[i].pattern;
+	*set = ec_regex_set(patterns, len);
+	free(patterns);
+	if (*set != NULL)
+		return 0;
+	if (errno != ENOTSUP)
+		return -1;
+
+	for (i = 0; i < len; i++) {
+		table[i].r = ec_regex(table[i].pattern, EC_REGEX_PREFIX);
+		if (table[i].r == NULL) {
+			EC_LOG(EC_LOG_ERR,
+			       "Regular expression <%s> compilation failed\n",
+			       table[i].pattern);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
 static int ec_node_re_lex_set_config(struct ec_node *node, const struct ec_config *config)
 {
 	struct ec_node_re_lex *priv = ec_node_priv(node);
 	struct regexp_pattern *table = NULL;
+	struct ec_regex_set *set = NULL;
 	const struct ec_config *patterns, *child, *elt, *pattern, *keep, *attr;
-	char *pattern_str = NULL, *attr_name = NULL;
-	ssize_t i, n = 0;
-	int ret;
+	size_t n = 0;
+	ssize_t count;
 
 	child = ec_config_dict_get(config, "child");
 	if (child == NULL)
@@ -268,15 +310,14 @@ static int ec_node_re_lex_set_config(struct ec_node *node, const struct ec_confi
 
 	patterns = ec_config_dict_get(config, "patterns");
 	if (patterns != NULL) {
-		n = ec_config_count(patterns);
-		if (n < 0)
+		count = ec_config_count(patterns);
+		if (count < 0)
 			goto fail;
 
-		table = calloc(n, sizeof(*table));
+		table = calloc(count, sizeof(*table));
 		if (table == NULL)
 			goto fail;
 
-		n = 0;
 		TAILQ_FOREACH (elt, &patterns->list, next) {
 			if (ec_config_get_type(elt) != EC_CONFIG_TYPE_DICT) {
 				errno = EINVAL;
@@ -305,64 +346,39 @@ static int ec_node_re_lex_set_config(struct ec_node *node, const struct ec_confi
 				errno = EINVAL;
 				goto fail;
 			}
-			pattern_str = strdup(pattern->string);
-			if (pattern_str == NULL)
+
+			/* entry n is freed by free_table() on error */
+			table[n].pattern = strdup(pattern->string);
+			table[n].keep = keep->boolean;
+			n++;
+			if (table[n - 1].pattern == NULL)
 				goto fail;
 			if (attr != NULL && attr->string != NULL) {
-				attr_name = strdup(attr->string);
-				if (attr_name == NULL)
+				table[n - 1].attrs = ec_dict();
+				if (table[n - 1].attrs == NULL)
+					goto fail;
+				if (ec_dict_set(table[n - 1].attrs, attr->string, NULL, NULL) < 0)
 					goto fail;
 			}
-
-			ret = regcomp(&table[n].r, pattern_str, REG_EXTENDED);
-			if (ret != 0) {
-				EC_LOG(EC_LOG_ERR,
-				       "Regular expression <%s> compilation failed: %d\n",
-				       pattern_str,
-				       ret);
-				if (ret == REG_ESPACE)
-					errno = ENOMEM;
-				else
-					errno = EINVAL;
-				goto fail;
-			}
-			table[n].pattern = pattern_str;
-			table[n].keep = keep->boolean;
-			table[n].attr_name = attr_name;
-			pattern_str = NULL;
-			attr_name = NULL;
-
-			n++;
 		}
 	}
 
+	if (compile_table(table, n, &set) < 0)
+		goto fail;
+
 	if (priv->child != NULL)
 		ec_node_free(priv->child);
 	priv->child = ec_node_clone(child->node);
-	for (i = 0; i < (ssize_t)priv->len; i++) {
-		free(priv->table[i].pattern);
-		free(priv->table[i].attr_name);
-		regfree(&priv->table[i].r);
-	}
-	free(priv->table);
+	free_table(priv->table, priv->len);
+	ec_regex_set_free(priv->set);
 	priv->table = table;
+	priv->set = set;
 	priv->len = n;
 
 	return 0;
 
 fail:
-	if (table != NULL) {
-		for (i = 0; i < n; i++) {
-			if (table[i].pattern != NULL) {
-				free(table[i].pattern);
-				free(table[i].attr_name);
-				regfree(&table[i].r);
-			}
-		}
-	}
-	free(table);
-	free(pattern_str);
-	free(attr_name);
+	free_table(table, n);
 	return -1;
 }
 
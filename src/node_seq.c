@@ -3,7 +3,9 @@
  */
 
 #include <assert.h>
+#include <errno.h>
 #include <stdarg.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -21,11 +23,14 @@
 #include <ecoli/parse.h>
 #include <ecoli/strvec.h>
 
+#include "node_private.h"
+
 EC_LOG_TYPE_REGISTER(node_seq);
 
 struct ec_node_seq {
 	struct ec_node **table;
 	size_t len;
+	bool uses_parse_tree; /* a child depends on the parse tree */
 };
 
 static int ec_node_seq_parse(
@@ -67,6 +72,12 @@ fail:
 	return -1;
 }
 
+/*
+ * Complete a sequence by parsing its first child on each prefix of the
+ * input, and completing the rest of the table on the remaining input.
+ * This is used when a child depends on the parse tree: its result may
+ * depend on the children matched before it in the sequence.
+ */
 static int __ec_node_seq_complete(
 	struct ec_node **table,
 	size_t table_len,
@@ -140,6 +151,115 @@ fail:
 	return -1;
 }
 
+/* The prefixes of the input matched by a child at a given offset. */
+struct seq_prefixes {
+	bool parsed;
+	struct ec_pnode **pnodes; /* indexed by length, NULL if no match */
+};
+
+/*
+ * Completion state of a sequence whose children do not depend on the
+ * parse tree. A child is parsed at most once on a given prefix of the
+ * input, whatever the lengths matched by the previous children: the
+ * prefixes table is indexed by child and offset.
+ */
+struct seq_complete_ctx {
+	struct ec_node **table;
+	size_t table_len;
+	struct ec_comp *comp;
+	const struct ec_strvec *strvec;
+	size_t strvec_len;
+	struct seq_prefixes *prefixes;
+};
+
+/*
+ * Parse a child on each prefix of the input starting at an offset. The
+ * parse trees of the matching prefixes are unlinked and kept, to be
+ * linked again on each path going through them.
+ */
+static int seq_parse_prefixes(struct seq_complete_ctx *ctx, size_t n, size_t off)
+{
+	struct seq_prefixes *prefixes = &ctx->prefixes[n * ctx->strvec_len + off];
+	struct ec_pnode *parse = ec_comp_get_cur_pstate(ctx->comp);
+	struct ec_strvec *childvec;
+	size_t i;
+	int ret;
+
+	if (prefixes->parsed)
+		return 0;
+	prefixes->parsed = true;
+
+	prefixes->pnodes = calloc(ctx->strvec_len - off, sizeof(*prefixes->pnodes));
+	if (prefixes->pnodes == NULL)
+		return -1;
+
+	for (i = 0; off + i < ctx->strvec_len; i++) {
+		childvec = ec_strvec_ndup(ctx->strvec, off, i);
+		if (childvec == NULL)
+			return -1;
+
+		ret = ec_parse_child(ctx->table[n], parse, childvec);
+		ec_strvec_free(childvec);
+		if (ret < 0)
+			return -1;
+		if (ret == EC_PARSE_NOMATCH)
+			continue;
+
+		if ((size_t)ret != i) {
+			ec_pnode_del_last_child(parse);
+			continue;
+		}
+
+		prefixes->pnodes[i] = ec_pnode_get_last_child(parse);
+		ec_pnode_unlink_child(prefixes->pnodes[i]);
+	}
+
+	return 0;
+}
+
+static int seq_complete(struct seq_complete_ctx *ctx, size_t n, size_t off)
+{
+	struct ec_pnode *parse = ec_comp_get_cur_pstate(ctx->comp);
+	const struct seq_prefixes *prefixes;
+	struct ec_strvec *childvec;
+	size_t i;
+	int ret;
+
+	/* first, try to complete with the child at this offset */
+	childvec = ec_strvec_ndup(ctx->strvec, off, ctx->strvec_len - off);
+	if (childvec == NULL)
+		return -1;
+
+	ret = ec_complete_child(ctx->table[n], ctx->comp, childvec);
+	ec_strvec_free(childvec);
+	if (ret < 0)
+		return -1;
+
+	/* the parse of the last child would not be used */
+	if (n + 1 == ctx->table_len || off == ctx->strvec_len)
+		return 0;
+
+	/* then, complete the next child after each prefix matched by this one,
+	 * with the parse tree of the path leading to it */
+	if (seq_parse_prefixes(ctx, n, off) < 0)
+		return -1;
+
+	prefixes = &ctx->prefixes[n * ctx->strvec_len + off];
+	for (i = 0; off + i < ctx->strvec_len; i++) {
+		if (prefixes->pnodes[i] == NULL)
+			continue;
+
+		ec_pnode_link_child(parse, prefixes->pnodes[i]);
+		ret = seq_complete(ctx, n + 1, off + i);
+		ec_pnode_unlink_child(prefixes->pnodes[i]);
+
+		if (ret < 0)
+			return -1;
+	}
+
+	return 0;
+}
+
 static int ec_node_seq_complete(
 	const struct ec_node *node,
 	struct ec_comp *comp,
@@ -147,8 +267,38 @@ static int ec_node_seq_complete(
 )
 {
 	struct ec_node_seq *priv = ec_node_priv(node);
+	struct seq_complete_ctx ctx;
+	size_t i, j;
+	int ret;
+
+	if (priv->len == 0)
+		return 0;
+
+	if (priv->uses_parse_tree)
+		return __ec_node_seq_complete(priv->table, priv->len, comp, strvec);
+
+	ctx.table = priv->table;
+	ctx.table_len = priv->len;
+	ctx.comp = comp;
+	ctx.strvec = strvec;
+	ctx.strvec_len = ec_strvec_len(strvec);
+	/* one more entry, so that the table is not empty */
+	ctx.prefixes = calloc(priv->len * ctx.strvec_len + 1, sizeof(*ctx.prefixes));
+	if (ctx.prefixes == NULL)
+		return -1;
 
-	return __ec_node_seq_complete(priv->table, priv->len, comp, strvec);
+	ret = seq_complete(&ctx, 0, 0);
+
+	for (i = 0; i < priv->len * ctx.strvec_len; i++) {
+		if (ctx.prefixes[i].pnodes == NULL)
+			continue;
+		for (j = 0; j < ctx.strvec_len - i % ctx.strvec_len; j++)
+			ec_pnode_free(ctx.prefixes[i].pnodes[j]);
+		free(ctx.prefixes[i].pnodes);
+	}
+	free(ctx.prefixes);
+
+	return ret;
 }
 
 static void ec_node_seq_free_priv(struct ec_node *node)
@@ -189,19 +339,35 @@ static int ec_node_seq_set_config(struct ec_node *node, const struct ec_config *
 {
 	struct ec_node_seq *priv = ec_node_priv(node);
 	struct ec_node **table = NULL;
+	bool uses_parse_tree = false;
 	size_t i, len = 0;
+	int ret;
 
 	table = ec_node_config_node_list_to_table(ec_config_dict_get(config, "children"), &len);
 	if (table == NULL)
 		return -1;
 
+	for (i = 0; i < len && !uses_parse_tree; i++) {
+		ret = ec_node_uses_parse_tree(table[i]);
+		if (ret < 0)
+			goto fail;
+		uses_parse_tree = ret;
+	}
+
 	for (i = 0; i < priv->len; i++)
 		ec_node_free(priv->table[i]);
 	free(priv->table);
 	priv->table = table;
 	priv->len = len;
+	priv->uses_parse_tree = uses_parse_tree;
 
 	return 0;
+
+fail:
+	for (i = 0; i < len; i++)
+		ec_node_free(table[i]);
+	free(table);
+	return -1;
 }
 
 static size_t ec_node_seq_get_children_count(const struct ec_node *node)
@@ -223,9 +389,56 @@ static int ec_node_seq_get_child(
 		return -1;
 
 	*child = priv->table[i];
-	/* each child node is referenced twice: once in the config and
-	 * once in the priv->table[] */
-	*refs = 2;
+	/* each child node is referenced once in the priv->table[], and
+	 * once in the config if it is built */
+	*refs = ec_node_has_config(node) ? 2 : 1;
+	return 0;
+}
+
+static struct ec_config *ec_node_seq_get_config(const struct ec_node *node)
+{
+	struct ec_node_seq *priv = ec_node_priv(node);
+	struct ec_config *config = NULL, *children;
+
+	config = ec_config_dict();
+	if (config == NULL)
+		goto fail;
+
+	children = ec_node_config_node_list_from_table(priv->table, priv->len);
+	if (children == NULL)
+		goto fail;
+
+	if (ec_config_dict_set(config, "children", children) < 0)
+		goto fail; /* children list is freed on error */
+
+	return config;
+
+fail:
+	ec_config_free(config);
+	return NULL;
+}
+
+/* append a child to the table, the reference is not consumed on error */
+static int ec_node_seq_append(struct ec_node *node, struct ec_node *child)
+{
+	struct ec_node_seq *priv = ec_node_priv(node);
+	struct ec_node **table;
+	int ret;
+
+	ret = ec_node_uses_parse_tree(child);
+	if (ret < 0)
+		return -1;
+
+	table = realloc(priv->table, (priv->len + 1) * sizeof(*priv->table));
+	if (table == NULL)
+		return -1;
+
+	priv->table = table;
+	priv->table[priv->len] = child;
+	priv->len++;
+	if (ret)
+		priv->uses_parse_tree = true;
+
 	return 0;
 }
 
@@ -239,6 +452,7 @@ static struct ec_node_type ec_node_seq_type = {
 	.free_priv = ec_node_seq_free_priv,
 	.get_children_count = ec_node_seq_get_children_count,
 	.get_child = ec_node_seq_get_child,
+	.get_config = ec_node_seq_get_config,
 };
 
 EC_NODE_TYPE_REGISTER(ec_node_seq_type);
@@ -250,106 +464,59 @@ struct ec_node *ec_node_seq(const char *id)
 
 int ec_node_seq_add(struct ec_node *node, struct ec_node *child)
 {
-	const struct ec_config *cur_config = NULL;
-	struct ec_config *config = NULL, *children;
-	int ret;
-
 	assert(node != NULL);
 
 	if (ec_node_check_type(node, &ec_node_seq_type) < 0)
 		goto fail;
 
-	cur_config = ec_node_get_config(node);
-	if (cur_config == NULL)
-		config = ec_config_dict();
-	else
-		config = ec_config_dup(cur_config);
-	if (config == NULL)
+	if (child == NULL) {
+		errno = EINVAL;
 		goto fail;
-
-	children = ec_config_dict_get(config, "children");
-	if (children == NULL) {
-		children = ec_config_list();
-		if (children == NULL)
-			goto fail;
-
-		if (ec_config_dict_set(config, "children", children) < 0)
-			goto fail; /* children list is freed on error */
 	}
 
-	if (ec_config_list_add(children, ec_config_node(child)) < 0) {
-		child = NULL;
+	if (ec_node_seq_append(node, child) < 0)
 		goto fail;
-	}
 
-	ret = ec_node_set_config(node, config);
-	config = NULL; /* freed */
-	if (ret < 0)
-		goto fail;
+	ec_node_invalidate_config(node);
 
 	return 0;
 
 fail:
-	ec_config_free(config);
 	ec_node_free(child);
 	return -1;
 }
 
 struct ec_node *__ec_node_seq(const char *id, ...)
 {
-	struct ec_config *config = NULL, *children = NULL;
 	struct ec_node *node = NULL;
 	struct ec_node *child;
 	va_list ap;
-	int ret;
 
 	va_start(ap, id);
 	child = va_arg(ap, struct ec_node *);
 
 	node = ec_node_from_type(&ec_node_seq_type, id);
 	if (node == NULL)
-		goto fail_free_children;
-
-	config = ec_config_dict();
-	if (config == NULL)
-		goto fail_free_children;
-
-	children = ec_config_list();
-	if (children == NULL)
-		goto fail_free_children;
+		goto fail;
 
 	for (; child != EC_VA_END; child = va_arg(ap, struct ec_node *)) {
 		if (child == NULL)
-			goto fail_free_children;
-
-		if (ec_config_list_add(children, ec_config_node(child)) < 0) {
-			child = NULL;
-			goto fail_free_children;
-		}
-	}
+			goto fail;
 
-	if (ec_config_dict_set(config, "children", children) < 0) {
-		children = NULL; /* freed */
-		goto fail;
+		if (ec_node_seq_append(node, child) < 0)
+			goto fail;
 	}
-	children = NULL;
 
-	ret = ec_node_set_config(node, config);
-	config = NULL; /* freed */
-	if (ret < 0)
-		goto fail;
+	ec_node_invalidate_config(node);
 
 	va_end(ap);
 
 	return node;
 
-fail_free_children:
+fail:
 	for (; child != EC_VA_END; child = va_arg(ap, struct ec_node *))
 		ec_node_free(child);
-fail:
 	ec_node_free(node); /* will also free added children */
-	ec_config_free(children);
-	ec_config_free(config);
 	va_end(ap);
 
 	return NULL;
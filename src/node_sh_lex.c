@@ -63,7 +63,7 @@ static int ec_node_sh_lex_parse(
 		new_vec = exp;
 	}
 
-	ret = ec_parse_child(priv->child, pstate, new_vec);
+	ret = ec_parse_lexed_child(priv->child, pstate, new_vec);
 	if (ret < 0)
 		goto fail;
 
@@ -130,10 +130,10 @@ static int ec_node_sh_lex_complete(
 		exp = ec_complete_strvec_expand(priv->child, EC_COMP_FULL, new_vec);
 		if (exp == NULL)
 			goto fail;
-		ret = ec_complete_child(priv->child, comp, exp);
+		ret = ec_complete_lexed_child(priv->child, comp, exp);
 		ec_strvec_free(exp);
 	} else {
-		ret = ec_complete_child(priv->child, comp, new_vec);
+		ret = ec_complete_lexed_child(priv->child, comp, new_vec);
 	}
 	if (ret < 0)
 		goto fail;
@@ -16,6 +16,8 @@
 #include <ecoli/string.h>
 #include <ecoli/strvec.h>
 
+#include "node_private.h"
+
 EC_LOG_TYPE_REGISTER(node_str);
 
 struct ec_node_str {
@@ -106,31 +108,52 @@ static const struct ec_config_schema ec_node_str_schema[] = {
 	},
 };
 
-static int ec_node_str_set_config(struct ec_node *node, const struct ec_config *config)
+static int set_string(struct ec_node *node, const char *str)
 {
 	struct ec_node_str *priv = ec_node_priv(node);
+	char *s;
+
+	s = strdup(str);
+	if (s == NULL)
+		return -1;
+
+	free(priv->string);
+	priv->string = s;
+	priv->len = strlen(priv->string);
+
+	return 0;
+}
+
+static int ec_node_str_set_config(struct ec_node *node, const struct ec_config *config)
+{
 	const struct ec_config *value = NULL;
-	char *s = NULL;
 
 	value = ec_config_dict_get(config, "string");
 	if (value == NULL) {
 		errno = EINVAL;
-		goto fail;
+		return -1;
 	}
 
-	s = strdup(value->string);
-	if (s == NULL)
+	return set_string(node, value->string);
+}
+
+static struct ec_config *ec_node_str_get_config(const struct ec_node *node)
+{
+	struct ec_node_str *priv = ec_node_priv(node);
+	struct ec_config *config = NULL;
+
+	config = ec_config_dict();
+	if (config == NULL)
 		goto fail;
 
-	free(priv->string);
-	priv->string = s;
-	priv->len = strlen(priv->string);
+	if (ec_config_dict_set(config, "string", ec_config_string(priv->string)) < 0)
+		goto fail;
 
-	return 0;
+	return config;
 
 fail:
-	free(s);
-	return -1;
+	ec_config_free(config);
+	return NULL;
 }
 
 static struct ec_node_type ec_node_str_type = {
@@ -142,41 +165,27 @@ static struct ec_node_type ec_node_str_type = {
 	.desc = ec_node_str_desc,
 	.size = sizeof(struct ec_node_str),
 	.free_priv = ec_node_str_free_priv,
+	.get_config = ec_node_str_get_config,
 };
 
 EC_NODE_TYPE_REGISTER(ec_node_str_type);
 
 int ec_node_str_set_str(struct ec_node *node, const char *str)
 {
-	struct ec_config *config = NULL;
-	int ret;
-
 	if (ec_node_check_type(node, &ec_node_str_type) < 0)
-		goto fail;
+		return -1;
 
 	if (str == NULL) {
 		errno = EINVAL;
-		goto fail;
+		return -1;
 	}
 
-	config = ec_config_dict();
-	if (config == NULL)
-		goto fail;
-
-	ret = ec_config_dict_set(config, "string", ec_config_string(str));
-	if (ret < 0)
-		goto fail;
+	if (set_string(node, str) < 0)
+		return -1;
 
-	ret = ec_node_set_config(node, config);
-	config = NULL;
-	if (ret < 0)
-		goto fail;
+	ec_node_invalidate_config(node);
 
 	return 0;
-
-fail:
-	ec_config_free(config);
-	return -1;
 }
 
 struct ec_node *ec_node_str(const char *id, const char *str)
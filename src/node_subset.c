@@ -11,6 +11,7 @@
 #include <string.h>
 
 #include <ecoli/complete.h>
+#include <ecoli/htable.h>
 #include <ecoli/log.h>
 #include <ecoli/node.h>
 #include <ecoli/node_or.h>
@@ -19,21 +20,27 @@
 #include <ecoli/parse.h>
 #include <ecoli/strvec.h>
 
+#include "node_private.h"
+
 EC_LOG_TYPE_REGISTER(node_subset);
 
 struct ec_node_subset {
 	struct ec_node **table;
 	unsigned int len;
 	unsigned int min;
+	bool uses_parse_tree; /* a child depends on the parse tree */
 };
 
+#define SUBSET_UNKNOWN -2
+
 struct parse_result {
 	size_t parse_len; /* number of parsed nodes */
 	size_t len; /* consumed strings */
 };
 
 /* recursively find the longest list of nodes that matches: the state is
- * updated accordingly. */
+ * updated accordingly. This tries all the orders of the children, and
+ * is only used when they depend on the parse tree. */
 static int __ec_node_subset_parse(
 	struct parse_result *out,
 	struct ec_node **table,
@@ -120,6 +127,183 @@ fail:
 	return -1;
 }
 
+/*
+ * The result of a subset parse or completion only depends on the children
+ * already used and on the offset in the input, whatever the order in which
+ * these children were matched. This state is used as a key to memoize the
+ * results, so that each one is computed once instead of once per permutation.
+ */
+struct subset_ctx {
+	struct ec_node **table;
+	size_t table_len;
+	struct ec_pnode *pstate;
+	const struct ec_strvec *strvec;
+	size_t strvec_len;
+	int *child_len; /**< Parse result of child i at offset j, or SUBSET_UNKNOWN. */
+	bool *completed; /**< True if child i was already completed at offset j. */
+	struct ec_htable *states; /**< Results, keyed by offset and used children. */
+	unsigned char *key; /**< Offset followed by the bitmask of used children. */
+	size_t key_len;
+};
+
+/* best result of a state */
+struct subset_result {
+	size_t parse_len; /**< Number of parsed children. */
+	size_t len; /**< Number of consumed strings. */
+	size_t child; /**< The first child to parse, if parse_len > 0. */
+};
+
+static inline bool subset_used(const struct subset_ctx *ctx, size_t i)
+{
+	return ctx->key[sizeof(size_t) + i / 8] & (1 << (i % 8));
+}
+
+static inline void subset_use(struct subset_ctx *ctx, size_t i, bool used)
+{
+	if (used)
+		ctx->key[sizeof(size_t) + i / 8] |= 1 << (i % 8);
+	else
+		ctx->key[sizeof(size_t) + i / 8] &= ~(1 << (i % 8));
+}
+
+static inline size_t subset_offset(const struct subset_ctx *ctx)
+{
+	size_t off;
+
+	memcpy(&off, ctx->key, sizeof(off));
+	return off;
+}
+
+static inline void subset_set_offset(struct subset_ctx *ctx, size_t off)
+{
+	memcpy(ctx->key, &off, sizeof(off));
+}
+
+static void subset_ctx_free(struct subset_ctx *ctx)
+{
+	free(ctx->child_len);
+	free(ctx->completed);
+	ec_htable_free(ctx->states);
+	free(ctx->key);
+}
+
+static int subset_ctx_init(
+	struct subset_ctx *ctx,
+	struct ec_node **table,
+	size_t table_len,
+	struct ec_pnode *pstate,
+	const struct ec_strvec *strvec
+)
+{
+	size_t i;
+
+	memset(ctx, 0, sizeof(*ctx));
+	ctx->table = table;
+	ctx->table_len = table_len;
+	ctx->pstate = pstate;
+	ctx->strvec = strvec;
+	ctx->strvec_len = ec_strvec_len(strvec);
+	ctx->key_len = sizeof(size_t) + (table_len + 7) / 8;
+
+	ctx->child_len = malloc(table_len * (ctx->strvec_len + 1) * sizeof(*ctx->child_len));
+	ctx->completed = calloc(table_len * (ctx->strvec_len + 1), sizeof(*ctx->completed));
+	ctx->states = ec_htable();
+	ctx->key = calloc(1, ctx->key_len);
+	if (ctx->child_len == NULL || ctx->completed == NULL || ctx->states == NULL
+	    || ctx->key == NULL) {
+		subset_ctx_free(ctx);
+		return -1;
+	}
+	for (i = 0; i < table_len * (ctx->strvec_len + 1); i++)
+		ctx->child_len[i] = SUBSET_UNKNOWN;
+
+	return 0;
+}
+
+/*
+ * Parse child i at the current offset. If keep is true and the child matches,
+ * its parse tree is linked to the parse state.
+ */
+static int subset_parse_child(struct subset_ctx *ctx, size_t i, bool keep)
+{
+	size_t off = subset_offset(ctx);
+	int *len = &ctx->child_len[i * (ctx->strvec_len + 1) + off];
+	struct ec_strvec *childvec;
+	int ret;
+
+	if (*len == EC_PARSE_NOMATCH || (*len != SUBSET_UNKNOWN && !keep))
+		return *len;
+
+	childvec = ec_strvec_ndup(ctx->strvec, off, ctx->strvec_len - off);
+	if (childvec == NULL)
+		return -1;
+
+	ret = ec_parse_child(ctx->table[i], ctx->pstate, childvec);
+	ec_strvec_free(childvec);
+	if (ret < 0)
+		return -1;
+
+	if (ret != EC_PARSE_NOMATCH && !keep)
+		ec_pnode_del_last_child(ctx->pstate);
+	*len = ret;
+
+	return ret;
+}
+
+/* find the longest list of children that matches from the current state */
+static int subset_parse(struct subset_ctx *ctx, const struct subset_result **out)
+{
+	struct subset_result best, *result;
+	const struct subset_result *child_result;
+	size_t i, off = subset_offset(ctx);
+	int ret;
+
+	result = ec_htable_get(ctx->states, ctx->key, ctx->key_len);
+	if (result != NULL) {
+		*out = result;
+		return 0;
+	}
+
+	memset(&best, 0, sizeof(best));
+
+	for (i = 0; i < ctx->table_len; i++) {
+		if (subset_used(ctx, i))
+			continue;
+
+		ret = subset_parse_child(ctx, i, false);
+		if (ret < 0)
+			return -1;
+		if (ret == EC_PARSE_NOMATCH)
+			continue;
+
+		subset_use(ctx, i, true);
+		subset_set_offset(ctx, off + ret);
+		ret = subset_parse(ctx, &child_result);
+		subset_set_offset(ctx, off);
+		subset_use(ctx, i, false);
+		if (ret < 0)
+			return -1;
+
+		/* keep the first of the longest results */
+		if (child_result->parse_len + 1 <= best.parse_len)
+			continue;
+
+		best.parse_len = child_result->parse_len + 1;
+		best.len = ctx->child_len[i * (ctx->strvec_len + 1) + off] + child_result->len;
+		best.child = i;
+	}
+
+	result = malloc(sizeof(*result));
+	if (result == NULL)
+		return -1;
+	*result = best;
+	if (ec_htable_set(ctx->states, ctx->key, ctx->key_len, result, free) < 0)
+		return -1;
+
+	*out = result;
+	return 0;
+}
+
 static int ec_node_subset_parse(
 	const struct ec_node *node,
 	struct ec_pnode *pstate,
@@ -127,27 +311,70 @@ static int ec_node_subset_parse(
 )
 {
 	struct ec_node_subset *priv = ec_node_priv(node);
-	struct ec_pnode *parse = NULL;
-	struct parse_result result;
+	const struct subset_result *result;
+	struct parse_result exhaustive;
+	size_t parse_len = 0, len = 0;
+	struct subset_ctx ctx;
 	int ret;
 
-	memset(&result, 0, sizeof(result));
+	if (priv->len == 0)
+		return priv->min > 0 ? EC_PARSE_NOMATCH : 0;
 
-	ret = __ec_node_subset_parse(&result, priv->table, priv->len, pstate, strvec);
-	if (ret < 0)
+	if (priv->uses_parse_tree) {
+		memset(&exhaustive, 0, sizeof(exhaustive));
+		if (__ec_node_subset_parse(&exhaustive, priv->table, priv->len, pstate, strvec) < 0)
+			return -1;
+		if (exhaustive.parse_len < priv->min)
+			return EC_PARSE_NOMATCH;
+		return exhaustive.len;
+	}
+
+	if (subset_ctx_init(&ctx, priv->table, priv->len, pstate, strvec) < 0)
+		return -1;
+
+	if (subset_parse(&ctx, &result) < 0)
 		goto fail;
 
-	if (result.parse_len < priv->min)
+	if (result->parse_len < priv->min) {
+		subset_ctx_free(&ctx);
 		return EC_PARSE_NOMATCH;
+	}
+
+	/*
+	 * Parse the children of the best result again to build the tree. A
+	 * child may not match again if it depends on its siblings, ex: once.
+	 */
+	while (result != NULL && result->parse_len > 0) {
+		ret = subset_parse_child(&ctx, result->child, true);
+		if (ret < 0)
+			goto fail;
+		if (ret == EC_PARSE_NOMATCH)
+			break;
+		parse_len++;
+		len += ret;
+		subset_use(&ctx, result->child, true);
+		subset_set_offset(&ctx, len);
+		result = ec_htable_get(ctx.states, ctx.key, ctx.key_len);
+	}
+
+	subset_ctx_free(&ctx);
+
+	if (parse_len < priv->min) {
+		ec_pnode_free_children(pstate);
+		return EC_PARSE_NOMATCH;
+	}
 
 	/* if no child node matches, return a matching empty strvec */
-	return result.len;
+	return len;
 
 fail:
-	ec_pnode_free(parse);
-	return ret;
+	ec_pnode_free_children(pstate);
+	subset_ctx_free(&ctx);
+	return -1;
 }
 
+/* complete with all the orders of the children, when they depend on the
+ * parse tree */
 static int __ec_node_subset_complete(
 	struct ec_node **table,
 	size_t table_len,
@@ -161,15 +388,6 @@ static int __ec_node_subset_complete(
 	size_t i, len;
 	int ret;
 
-	/*
-	 * example with table = [a, b, c]
-	 * subset_complete([a,b,c], strvec) returns:
-	 *   complete(a, strvec) + complete(b, strvec) + complete(c, strvec) +
-	 *   + __subset_complete([b, c], childvec) if a matches
-	 *   + __subset_complete([a, c], childvec) if b matches
-	 *   + __subset_complete([a, b], childvec) if c matches
-	 */
-
 	/* first, try to complete with each node of the table */
 	for (i = 0; i < table_len; i++) {
 		if (table[i] == NULL)
@@ -218,6 +436,93 @@ fail:
 	return -1;
 }
 
+static int subset_complete(struct subset_ctx *ctx, struct ec_comp *comp)
+{
+	size_t i, off = subset_offset(ctx);
+	struct ec_strvec *childvec = NULL;
+	bool visited;
+	int ret;
+
+	/*
+	 * example with table = [a, b, c]
+	 * subset_complete([a,b,c], strvec) returns:
+	 *   complete(a, strvec) + complete(b, strvec) + complete(c, strvec) +
+	 *   + __subset_complete([b, c], childvec) if a matches
+	 *   + __subset_complete([a, c], childvec) if b matches
+	 *   + __subset_complete([a, b], childvec) if c matches
+	 *
+	 * A state that was already completed through another order of the
+	 * same children is skipped, and a child is completed only once at a
+	 * given offset, whatever the children used before.
+	 */
+	if (ec_htable_has_key(ctx->states, ctx->key, ctx->key_len))
+		return 0;
+	if (ec_htable_set(ctx->states, ctx->key, ctx->key_len, NULL, NULL) < 0)
+		return -1;
+
+	childvec = ec_strvec_ndup(ctx->strvec, off, ctx->strvec_len - off);
+	if (childvec == NULL)
+		goto fail;
+
+	/* first, try to complete with each node of the table */
+	for (i = 0; i < ctx->table_len; i++) {
+		if (subset_used(ctx, i) || ctx->completed[i * (ctx->strvec_len + 1) + off])
+			continue;
+		ctx->completed[i * (ctx->strvec_len + 1) + off] = true;
+
+		ret = ec_complete_child(ctx->table[i], comp, childvec);
+		if (ret < 0)
+			goto fail;
+	}
+
+	ec_strvec_free(childvec);
+	childvec = NULL;
+
+	/* then, if a node matches, advance in strvec and try to complete with
+	 * all the other nodes */
+	for (i = 0; i < ctx->table_len; i++) {
+		if (subset_used(ctx, i))
+			continue;
+
+		ret = subset_parse_child(ctx, i, false);
+		if (ret < 0)
+			goto fail;
+		if (ret == EC_PARSE_NOMATCH)
+			continue;
+
+		/* skip the parsing if the next state was already completed */
+		subset_use(ctx, i, true);
+		subset_set_offset(ctx, off + ret);
+		visited = ec_htable_has_key(ctx->states, ctx->key, ctx->key_len);
+		subset_set_offset(ctx, off);
+		subset_use(ctx, i, false);
+		if (visited)
+			continue;
+
+		ret = subset_parse_child(ctx, i, true);
+		if (ret < 0)
+			goto fail;
+		if (ret == EC_PARSE_NOMATCH)
+			continue;
+
+		subset_use(ctx, i, true);
+		subset_set_offset(ctx, off + ret);
+		ret = subset_complete(ctx, comp);
+		subset_set_offset(ctx, off);
+		subset_use(ctx, i, false);
+		ec_pnode_del_last_child(ctx->pstate);
+
+		if (ret < 0)
+			goto fail;
+	}
+
+	return 0;
+
+fail:
+	ec_strvec_free(childvec);
+	return -1;
+}
+
 static int ec_node_subset_complete(
 	const struct ec_node *node,
 	struct ec_comp *comp,
@@ -225,8 +530,23 @@ static int ec_node_subset_complete(
 )
 {
 	struct ec_node_subset *priv = ec_node_priv(node);
+	struct subset_ctx ctx;
+	int ret;
+
+	if (priv->len == 0)
+		return 0;
 
-	return __ec_node_subset_complete(priv->table, priv->len, comp, strvec);
+	if (priv->uses_parse_tree)
+		return __ec_node_subset_complete(priv->table, priv->len, comp, strvec);
+
+	ret = subset_ctx_init(&ctx, priv->table, priv->len, ec_comp_get_cur_pstate(comp), strvec);
+	if (ret < 0)
+		return -1;
+
+	ret = subset_complete(&ctx, comp);
+	subset_ctx_free(&ctx);
+
+	return ret;
 }
 
 static void ec_node_subset_free_priv(struct ec_node *node)
@@ -283,6 +603,7 @@ int ec_node_subset_add(struct ec_node *node, struct ec_node *child)
 {
 	struct ec_node_subset *priv = ec_node_priv(node);
 	struct ec_node **table;
+	int ret;
 
 	assert(node != NULL);
 
@@ -294,6 +615,10 @@ int ec_node_subset_add(struct ec_node *node, struct ec_node *child)
 	if (ec_node_check_type(node, &ec_node_subset_type) < 0)
 		goto fail;
 
+	ret = ec_node_uses_parse_tree(child);
+	if (ret < 0)
+		goto fail;
+
 	table = realloc(priv->table, (priv->len + 1) * sizeof(*priv->table));
 	if (table == NULL) {
 		ec_node_free(child);
@@ -303,6 +628,8 @@ int ec_node_subset_add(struct ec_node *node, struct ec_node *child)
 	priv->table = table;
 	table[priv->len] = child;
 	priv->len++;
+	if (ret)
+		priv->uses_parse_tree = true;
 
 	return 0;
 
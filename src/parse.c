@@ -10,6 +10,7 @@
 
 #include <ecoli/assert.h>
 #include <ecoli/dict.h>
+#include <ecoli/htable.h>
 #include <ecoli/log.h>
 #include <ecoli/node.h>
 #include <ecoli/node_seq.h>
@@ -18,6 +19,8 @@
 #include <ecoli/parse.h>
 #include <ecoli/strvec.h>
 
+#include "parse_private.h"
+
 EC_LOG_TYPE_REGISTER(parse);
 
 TAILQ_HEAD(ec_pnode_list, ec_pnode);
@@ -29,8 +32,215 @@ struct ec_pnode {
 	const struct ec_node *node;
 	struct ec_strvec *strvec;
 	struct ec_dict *attrs;
+	struct ec_parse_ctx *ctx; /**< Shared by the nodes of a parse, can be NULL. */
+	bool in_ctx; /**< In the tree of the context root, see ec_pnode_count_node(). */
+};
+
+/*
+ * The state of a parse, shared by the nodes of its tree, so that it is
+ * reached without walking to the root. A node gets the context of its
+ * parent when it is linked to it.
+ */
+struct ec_parse_ctx {
+	unsigned int refcnt;
+	struct ec_pnode *root; /**< The root of the tree, NULL once freed. */
+	struct ec_parse_failure *failure; /**< Only if requested, see ec_parse_report(). */
+	struct ec_htable *counts; /**< See ec_pnode_count_node(). */
 };
 
+struct ec_parse_expected {
+	const struct ec_node **path; /**< From the expected node to the root. */
+	size_t len; /**< Length of the path. */
+};
+
+struct ec_parse_failure {
+	struct ec_strvec *strvec; /**< The tokens, input or lexed. */
+	bool lexed; /**< The tokens were produced by a lexer. */
+	size_t offset; /**< Furthest token reached. */
+	int match_len; /**< Tokens matched by the top node, or NOMATCH. */
+	struct ec_parse_expected *expected; /**< Nodes that failed at offset. */
+	size_t count; /**< Number of expected nodes. */
+	unsigned long calls; /**< Number of nodes parsed so far. */
+};
+
+static struct ec_parse_failure *ec_parse_failure(const struct ec_strvec *strvec)
+{
+	struct ec_parse_failure *failure;
+
+	failure = calloc(1, sizeof(*failure));
+	if (failure == NULL)
+		return NULL;
+
+	failure->strvec = ec_strvec_dup(strvec);
+	if (failure->strvec == NULL) {
+		free(failure);
+		return NULL;
+	}
+	failure->match_len = EC_PARSE_NOMATCH;
+
+	return failure;
+}
+
+static void ec_parse_failure_clear(struct ec_parse_failure *failure)
+{
+	size_t i;
+
+	for (i = 0; i < failure->count; i++)
+		free(failure->expected[i].path);
+	free(failure->expected);
+	failure->expected = NULL;
+	failure->count = 0;
+}
+
+static void ec_parse_failure_free(struct ec_parse_failure *failure)
+{
+	if (failure == NULL)
+		return;
+
+	ec_parse_failure_clear(failure);
+	ec_strvec_free(failure->strvec);
+	free(failure);
+}
+
+static struct ec_parse_ctx *ec_parse_ctx(void)
+{
+	struct ec_parse_ctx *ctx;
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL)
+		return NULL;
+	ctx->refcnt = 1;
+
+	return ctx;
+}
+
+static void ec_parse_ctx_free(struct ec_parse_ctx *ctx)
+{
+	if (ctx == NULL)
+		return;
+	if (--ctx->refcnt > 0)
+		return;
+
+	ec_parse_failure_free(ctx->failure);
+	ec_htable_free(ctx->counts);
+	free(ctx);
+}
+
+/* Replace the context of a node. */
+static void ec_pnode_set_ctx(struct ec_pnode *pnode, struct ec_parse_ctx *ctx)
+{
+	if (pnode->ctx == ctx)
+		return;
+
+	if (pnode->ctx != NULL && pnode->ctx->root == pnode)
+		pnode->ctx->root = NULL;
+	ec_parse_ctx_free(pnode->ctx);
+	pnode->ctx = ctx;
+	if (ctx != NULL)
+		ctx->refcnt++;
+}
+
+int ec_pnode_init_ctx(struct ec_pnode *root)
+{
+	struct ec_parse_ctx *ctx;
+
+	ctx = ec_parse_ctx();
+	if (ctx == NULL)
+		return -1;
+
+	ec_pnode_set_ctx(root, ctx);
+	ec_parse_ctx_free(ctx);
+	ctx->root = root;
+	root->in_ctx = true;
+
+	return 0;
+}
+
+/* Get the offset of a token vector in the tracked tokens. The vectors
+ * passed to the children are usually sub-vectors of their parent's one,
+ * sharing the same elements. Other vectors, like the ones built by a lexer
+ * that is not tracked, are ignored. */
+static bool ec_parse_failure_offset(
+	const struct ec_parse_failure *failure,
+	const struct ec_strvec *strvec,
+	size_t *offset
+)
+{
+	size_t len = ec_strvec_len(strvec);
+	size_t total = ec_strvec_len(failure->strvec);
+
+	if (len > total)
+		return false;
+	if (len > 0 && ec_strvec_val(strvec, 0) != ec_strvec_val(failure->strvec, total - len))
+		return false;
+
+	*offset = total - len;
+	return true;
+}
+
+static int ec_parse_failure_add(struct ec_parse_failure *failure, const struct ec_pnode *pstate)
+{
+	struct ec_parse_expected *expected;
+	const struct ec_pnode *iter;
+	size_t i, len = 0;
+
+	for (i = 0; i < failure->count; i++) {
+		if (failure->expected[i].path[0] == pstate->node)
+			return 0;
+	}
+
+	for (iter = pstate; iter != NULL; iter = iter->parent)
+		len++;
+
+	expected = realloc(failure->expected, (failure->count + 1) * sizeof(*expected));
+	if (expected == NULL)
+		return -1;
+	failure->expected = expected;
+	expected = &failure->expected[failure->count];
+
+	expected->path = calloc(len, sizeof(*expected->path));
+	if (expected->path == NULL)
+		return -1;
+	expected->len = len;
+	for (i = 0, iter = pstate; iter != NULL; i++, iter = iter->parent)
+		expected->path[i] = iter->node;
+	failure->count++;
+
+	return 0;
+}
+
+/* update the failure report after a leaf node was parsed */
+static int ec_parse_failure_update(
+	struct ec_parse_failure *failure,
+	const struct ec_pnode *pstate,
+	const struct ec_strvec *strvec,
+	int ret
+)
+{
+	size_t offset;
+
+	if (!ec_parse_failure_offset(failure, strvec, &offset))
+		return 0;
+
+	if (ret != EC_PARSE_NOMATCH) {
+		/* the next token was not tried yet */
+		if (offset + ret > failure->offset) {
+			ec_parse_failure_clear(failure);
+			failure->offset = offset + ret;
+		}
+		return 0;
+	}
+
+	if (offset < failure->offset)
+		return 0;
+	if (offset > failure->offset) {
+		ec_parse_failure_clear(failure);
+		failure->offset = offset;
+	}
+
+	return ec_parse_failure_add(failure, pstate);
+}
+
 static int __ec_parse_child(
 	const struct ec_node *node,
 	struct ec_pnode *pstate,
@@ -38,8 +248,10 @@ static int __ec_parse_child(
 	const struct ec_strvec *strvec
 )
 {
+	struct ec_parse_failure *failure = NULL;
 	struct ec_strvec *match_strvec;
 	struct ec_pnode *child = NULL;
+	unsigned long calls = 0;
 	int ret;
 
 	/* XXX limit max number of recursions to avoid segfault */
@@ -58,10 +270,22 @@ static int __ec_parse_child(
 	} else {
 		child = pstate;
 	}
+
+	if (child->ctx != NULL)
+		failure = child->ctx->failure;
+	if (failure != NULL)
+		calls = ++failure->calls;
+
 	ret = ec_node_type(node)->parse(node, child, strvec);
 	if (ret < 0)
 		goto fail;
 
+	/* only track the leaves, i.e. the nodes that did not parse any child */
+	if (failure != NULL && calls == failure->calls && ec_node_get_children_count(node) == 0) {
+		if (ec_parse_failure_update(failure, child, strvec, ret) < 0)
+			goto fail;
+	}
+
 	if (ret == EC_PARSE_NOMATCH) {
 		if (!is_root) {
 			ec_pnode_unlink_child(child);
@@ -96,24 +320,83 @@ int ec_parse_child(
 	return __ec_parse_child(node, pstate, false, strvec);
 }
 
-struct ec_pnode *ec_parse_strvec(const struct ec_node *node, const struct ec_strvec *strvec)
+int ec_parse_lexed_child(
+	const struct ec_node *node,
+	struct ec_pnode *pstate,
+	const struct ec_strvec *strvec
+)
+{
+	struct ec_parse_failure *failure = NULL;
+	struct ec_strvec *tokens;
+	int ret;
+
+	/* track the tokens of the first lexer instead of its input */
+	if (pstate->ctx != NULL)
+		failure = pstate->ctx->failure;
+	if (failure != NULL && !failure->lexed) {
+		tokens = ec_strvec_dup(strvec);
+		if (tokens == NULL)
+			return -1;
+		ec_strvec_free(failure->strvec);
+		failure->strvec = tokens;
+		failure->lexed = true;
+		ec_parse_failure_clear(failure);
+		failure->offset = 0;
+	} else {
+		failure = NULL;
+	}
+
+	ret = ec_parse_child(node, pstate, strvec);
+	if (ret >= 0 && failure != NULL)
+		failure->match_len = ret;
+
+	return ret;
+}
+
+static struct ec_pnode *
+__ec_parse_strvec(const struct ec_node *node, const struct ec_strvec *strvec, bool report)
 {
+	struct ec_parse_failure *failure = NULL;
 	struct ec_pnode *pnode = ec_pnode(node);
 	int ret;
 
 	if (pnode == NULL)
 		return NULL;
 
-	ret = __ec_parse_child(node, pnode, true, strvec);
-	if (ret < 0) {
-		ec_pnode_free(pnode);
-		return NULL;
+	if (ec_pnode_init_ctx(pnode) < 0)
+		goto fail;
+	if (report) {
+		failure = ec_parse_failure(strvec);
+		if (failure == NULL)
+			goto fail;
+		pnode->ctx->failure = failure;
 	}
 
+	ret = __ec_parse_child(node, pnode, true, strvec);
+	if (ret < 0)
+		goto fail;
+
+	if (failure != NULL && !failure->lexed)
+		failure->match_len = ret;
+
 	return pnode;
+
+fail:
+	ec_pnode_free(pnode);
+	return NULL;
 }
 
-struct ec_pnode *ec_parse(const struct ec_node *node, const char *str)
+struct ec_pnode *ec_parse_strvec(const struct ec_node *node, const struct ec_strvec *strvec)
+{
+	return __ec_parse_strvec(node, strvec, false);
+}
+
+struct ec_pnode *ec_parse_strvec_report(const struct ec_node *node, const struct ec_strvec *strvec)
+{
+	return __ec_parse_strvec(node, strvec, true);
+}
+
+static struct ec_pnode *__ec_parse(const struct ec_node *node, const char *str, bool report)
 {
 	struct ec_strvec *strvec = NULL;
 	struct ec_pnode *pnode = NULL;
@@ -126,7 +409,7 @@ struct ec_pnode *ec_parse(const struct ec_node *node, const char *str)
 	if (ec_strvec_add(strvec, str) < 0)
 		goto fail;
 
-	pnode = ec_parse_strvec(node, strvec);
+	pnode = __ec_parse_strvec(node, strvec, report);
 	if (pnode == NULL)
 		goto fail;
 
@@ -139,6 +422,16 @@ fail:
 	return NULL;
 }
 
+struct ec_pnode *ec_parse(const struct ec_node *node, const char *str)
+{
+	return __ec_parse(node, str, false);
+}
+
+struct ec_pnode *ec_parse_report(const struct ec_node *node, const char *str)
+{
+	return __ec_parse(node, str, true);
+}
+
 struct ec_pnode *ec_pnode(const struct ec_node *node)
 {
 	struct ec_pnode *pnode = NULL;
@@ -221,6 +514,88 @@ struct ec_pnode *ec_pnode_dup(const struct ec_pnode *pnode)
 	return dup;
 }
 
+/* add delta to the occurrence counter of a node, if it is tracked */
+static void ec_parse_ctx_count(struct ec_parse_ctx *ctx, const struct ec_node *node, int delta)
+{
+	unsigned int *count;
+
+	if (ctx->counts == NULL)
+		return;
+
+	count = ec_htable_get(ctx->counts, &node, sizeof(node));
+	if (count != NULL)
+		*count += delta;
+}
+
+/* add a subtree to the tree of a context, which becomes its context */
+static void ec_pnode_attach(struct ec_pnode *pnode, struct ec_parse_ctx *ctx)
+{
+	struct ec_pnode *child;
+
+	ec_pnode_set_ctx(pnode, ctx);
+	pnode->in_ctx = true;
+	ec_parse_ctx_count(ctx, pnode->node, 1);
+
+	TAILQ_FOREACH (child, &pnode->children, next)
+		ec_pnode_attach(child, ctx);
+}
+
+/* remove a subtree from the tree of its context */
+static void ec_pnode_detach(struct ec_pnode *pnode)
+{
+	struct ec_pnode *child;
+
+	pnode->in_ctx = false;
+	ec_parse_ctx_count(pnode->ctx, pnode->node, -1);
+
+	TAILQ_FOREACH (child, &pnode->children, next)
+		ec_pnode_detach(child);
+}
+
+static unsigned int __ec_pnode_count_node(const struct ec_pnode *pnode, const struct ec_node *node)
+{
+	const struct ec_pnode *child;
+	unsigned int count = 0;
+
+	if (pnode->node == node)
+		count++;
+
+	TAILQ_FOREACH (child, &pnode->children, next)
+		count += __ec_pnode_count_node(child, node);
+
+	return count;
+}
+
+int ec_pnode_count_node(struct ec_pnode *pnode, const struct ec_node *node)
+{
+	struct ec_parse_ctx *ctx = pnode->ctx;
+	unsigned int *count;
+
+	/* not built by a parse or a completion */
+	if (ctx == NULL || !pnode->in_ctx)
+		return __ec_pnode_count_node(ec_pnode_get_root(pnode), node);
+
+	if (ctx->counts == NULL) {
+		ctx->counts = ec_htable();
+		if (ctx->counts == NULL)
+			return -1;
+	}
+
+	count = ec_htable_get(ctx->counts, &node, sizeof(node));
+	if (count != NULL)
+		return *count;
+
+	/* first request for this node: count it once, then track it */
+	count = malloc(sizeof(*count));
+	if (count == NULL)
+		return -1;
+	*count = __ec_pnode_count_node(ctx->root, node);
+	if (ec_htable_set(ctx->counts, &node, sizeof(node), count, free) < 0)
+		return -1;
+
+	return *count;
+}
+
 void ec_pnode_free_children(struct ec_pnode *pnode)
 {
 	struct ec_pnode *child;
@@ -230,6 +605,8 @@ void ec_pnode_free_children(struct ec_pnode *pnode)
 
 	while (!TAILQ_EMPTY(&pnode->children)) {
 		child = TAILQ_FIRST(&pnode->children);
+		if (child->in_ctx)
+			ec_pnode_detach(child);
 		TAILQ_REMOVE(&pnode->children, child, next);
 		child->parent = NULL;
 		ec_pnode_free(child);
@@ -246,6 +623,7 @@ void ec_pnode_free(struct ec_pnode *pnode)
 	ec_pnode_free_children(pnode);
 	ec_strvec_free(pnode->strvec);
 	ec_dict_free(pnode->attrs);
+	ec_pnode_set_ctx(pnode, NULL);
 	free(pnode);
 }
 
@@ -304,6 +682,13 @@ void ec_pnode_dump(FILE *out, const struct ec_pnode *pnode)
 
 void ec_pnode_link_child(struct ec_pnode *pnode, struct ec_pnode *child)
 {
+	/* the children created while parsing have no children yet, so
+	 * attaching them only updates their own counter */
+	if (pnode->in_ctx)
+		ec_pnode_attach(child, pnode->ctx);
+	else if (child->ctx == NULL)
+		ec_pnode_set_ctx(child, pnode->ctx);
+
 	TAILQ_INSERT_TAIL(&pnode->children, child, next);
 	child->parent = pnode;
 }
@@ -313,6 +698,8 @@ void ec_pnode_unlink_child(struct ec_pnode *child)
 	struct ec_pnode *parent = child->parent;
 
 	if (parent != NULL) {
+		if (child->in_ctx)
+			ec_pnode_detach(child);
 		TAILQ_REMOVE(&parent->children, child, next);
 		child->parent = NULL;
 	}
@@ -472,3 +859,45 @@ bool ec_pnode_matches(const struct ec_pnode *pnode)
 
 	return true;
 }
+
+const struct ec_parse_failure *ec_pnode_get_failure(const struct ec_pnode *pnode)
+{
+	/* the report is shared by the nodes of the tree, only return it on the root */
+	if (pnode == NULL || pnode->parent != NULL || pnode->ctx == NULL)
+		return NULL;
+
+	return pnode->ctx->failure;
+}
+
+const struct ec_strvec *ec_parse_failure_get_strvec(const struct ec_parse_failure *failure)
+{
+	return failure->strvec;
+}
+
+size_t ec_parse_failure_get_offset(const struct ec_parse_failure *failure)
+{
+	return failure->offset;
+}
+
+bool ec_parse_failure_prefix_matches(const struct ec_parse_failure *failure)
+{
+	return failure->match_len != EC_PARSE_NOMATCH
+		&& (size_t)failure->match_len == failure->offset;
+}
+
+size_t ec_parse_failure_get_count(const struct ec_parse_failure *failure)
+{
+	return failure->count;
+}
+
+const struct ec_node *const *
+ec_parse_failure_get_path(const struct ec_parse_failure *failure, size_t i, size_t *len)
+{
+	if (i >= failure->count) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	*len = failure->expected[i].len;
+	return failure->expected[i].path;
+}
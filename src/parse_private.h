@@ -0,0 +1,23 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2016, Olivier MATZ <zer0@droids-corp.org>
+ */
+
+#pragma once
+
+#include <ecoli/parse.h>
+
+/*
+ * Create the context of a parse tree, shared by the nodes linked below the
+ * root. It holds the state of a parse or of a completion, like the
+ * occurrence counters. Return -1 on error (errno is set).
+ */
+int ec_pnode_init_ctx(struct ec_pnode *root);
+
+/*
+ * Return the number of occurrences of a grammar node in the parse tree
+ * containing pnode. In a tree with a context, the first call for a node
+ * walks the tree; the counter is then kept in the context and updated when
+ * children are linked or unlinked, so the next calls are O(1). Other trees
+ * are walked on each call. Return -1 on error (errno is set).
+ */
+int ec_pnode_count_node(struct ec_pnode *pnode, const struct ec_node *node);
@@ -0,0 +1,152 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2025, Olivier MATZ <zer0@droids-corp.org>
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+
+#define PCRE2_CODE_UNIT_WIDTH 8
+#include <pcre2.h>
+
+#include <ecoli/init.h>
+#include <ecoli/log.h>
+
+#include "regex_private.h"
+
+EC_LOG_TYPE_REGISTER(regex);
+
+struct ec_regex {
+	pcre2_code *code;
+};
+
+/* allocating it on each match is as costly as the match itself */
+static __thread pcre2_match_data *match_data;
+/* frees the match data of a thread when it exits */
+static pthread_key_t match_data_key;
+static pthread_once_t match_data_once = PTHREAD_ONCE_INIT;
+static int match_data_key_ret;
+
+static void match_data_free(void *arg)
+{
+	pcre2_match_data_free(arg);
+}
+
+static void match_data_key_create(void)
+{
+	match_data_key_ret = pthread_key_create(&match_data_key, match_data_free);
+}
+
+static pcre2_match_data *match_data_get(void)
+{
+	pcre2_match_data *data;
+
+	if (match_data != NULL)
+		return match_data;
+
+	pthread_once(&match_data_once, match_data_key_create);
+	if (match_data_key_ret != 0) {
+		errno = match_data_key_ret;
+		return NULL;
+	}
+
+	/* only the bounds of the whole match are needed, any pattern can use it */
+	data = pcre2_match_data_create(1, NULL);
+	if (data == NULL)
+		return NULL;
+	if (pthread_setspecific(match_data_key, data) != 0) {
+		pcre2_match_data_free(data);
+		errno = ENOMEM;
+		return NULL;
+	}
+	match_data = data;
+
+	return match_data;
+}
+
+struct ec_regex *ec_regex(const char *pattern, enum ec_regex_anchor anchor)
+{
+	PCRE2_UCHAR errbuf[128];
+	struct ec_regex *re;
+	PCRE2_SIZE erroff;
+	uint32_t options;
+	int errcode;
+
+	re = calloc(1, sizeof(*re));
+	if (re == NULL)
+		return NULL;
+
+	/* the anchoring must be given at compile time to be done by the JIT */
+	options = PCRE2_ANCHORED;
+	if (anchor == EC_REGEX_FULL)
+		options |= PCRE2_ENDANCHORED;
+
+	re->code = pcre2_compile(
+		(PCRE2_SPTR)pattern, PCRE2_ZERO_TERMINATED, options, &errcode, &erroff, NULL
+	);
+	if (re->code == NULL) {
+		pcre2_get_error_message(errcode, errbuf, sizeof(errbuf));
+		EC_LOG(EC_LOG_DEBUG,
+		       "cannot compile <%s> at offset %zu: %s\n",
+		       pattern,
+		       (size_t)erroff,
+		       errbuf);
+		free(re);
+		if (errcode == PCRE2_ERROR_HEAPLIMIT || errcode == PCRE2_ERROR_NOMEMORY)
+			errno = ENOMEM;
+		else
+			errno = EINVAL;
+		return NULL;
+	}
+
+	/* without JIT support, the interpreter is used */
+	pcre2_jit_compile(re->code, PCRE2_JIT_COMPLETE);
+
+	return re;
+}
+
+void ec_regex_free(struct ec_regex *re)
+{
+	if (re == NULL)
+		return;
+
+	pcre2_code_free(re->code);
+	free(re);
+}
+
+ssize_t ec_regex_match(const struct ec_regex *re, const char *str, size_t len)
+{
+	pcre2_match_data *data;
+	PCRE2_SIZE *ovector;
+	int ret;
+
+	data = match_data_get();
+	if (data == NULL)
+		return -1;
+
+	/* 0 means that the groups do not fit in the match data */
+	ret = pcre2_match(re->code, (PCRE2_SPTR)str, len, 0, 0, data, NULL);
+	if (ret < 0)
+		return -1;
+
+	ovector = pcre2_get_ovector_pointer(data);
+
+	return ovector[1];
+}
+
+/* the match data of the other threads is freed when they exit */
+static void ec_regex_exit_func(void)
+{
+	if (match_data == NULL)
+		return;
+	pthread_setspecific(match_data_key, NULL);
+	pcre2_match_data_free(match_data);
+	match_data = NULL;
+}
+
+static struct ec_init ec_regex_init = {
+	.exit = ec_regex_exit_func,
+	.priority = 50,
+};
+
+EC_INIT_REGISTER(ec_regex_init);
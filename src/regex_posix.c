@@ -0,0 +1,117 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2025, Olivier MATZ <zer0@droids-corp.org>
+ */
+
+#include <errno.h>
+#include <regex.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "regex_private.h"
+
+struct ec_regex {
+	regex_t re;
+	enum ec_regex_anchor anchor;
+};
+
+/* a back-reference would be renumbered by an enclosing group */
+static bool has_backref(const char *pattern)
+{
+	const char *s;
+
+	for (s = strchr(pattern, '\\'); s != NULL; s = strchr(s + 2, '\\')) {
+		if (s[1] == '\0')
+			break;
+		if (s[1] >= '1' && s[1] <= '9')
+			return true;
+	}
+
+	return false;
+}
+
+static int regex_compile(regex_t *re, const char *pattern)
+{
+	int ret;
+
+	ret = regcomp(re, pattern, REG_EXTENDED);
+	if (ret != 0) {
+		if (ret == REG_ESPACE)
+			errno = ENOMEM;
+		else
+			errno = EINVAL;
+		return -1;
+	}
+
+	return 0;
+}
+
+struct ec_regex *ec_regex(const char *pattern, enum ec_regex_anchor anchor)
+{
+	struct ec_regex *re = NULL;
+	char *anchored = NULL;
+	regex_t tmp;
+
+	re = calloc(1, sizeof(*re));
+	if (re == NULL)
+		return NULL;
+	re->anchor = anchor;
+
+	if (regex_compile(&re->re, pattern) < 0)
+		goto fail;
+
+	/*
+	 * An unanchored search scans the whole string when the pattern
+	 * does not match at its beginning, which is costly when the
+	 * lexer matches many patterns on a long input. The full matches
+	 * keep the original pattern, it is faster on matching strings.
+	 */
+	if (anchor == EC_REGEX_PREFIX && !has_backref(pattern)) {
+		if (asprintf(&anchored, "^(%s)", pattern) < 0)
+			goto fail_regfree;
+		if (regex_compile(&tmp, anchored) == 0) {
+			regfree(&re->re);
+			re->re = tmp;
+		}
+		free(anchored);
+	}
+
+	return re;
+
+fail_regfree:
+	regfree(&re->re);
+fail:
+	free(re);
+	return NULL;
+}
+
+void ec_regex_free(struct ec_regex *re)
+{
+	if (re == NULL)
+		return;
+
+	regfree(&re->re);
+	free(re);
+}
+
+ssize_t ec_regex_match(const struct ec_regex *re, const char *str, size_t len)
+{
+	regmatch_t pos;
+	int flags = 0;
+
+#ifdef REG_STARTEND
+	/* the length is known, avoid a strlen() in regexec() */
+	pos.rm_so = 0;
+	pos.rm_eo = len;
+	flags |= REG_STARTEND;
+#endif
+	if (regexec(&re->re, str, 1, &pos, flags) != 0)
+		return -1;
+	if (pos.rm_so != 0)
+		return -1;
+	if (re->anchor == EC_REGEX_FULL && (size_t)pos.rm_eo != len)
+		return -1;
+
+	return pos.rm_eo;
+}
@@ -0,0 +1,65 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2025, Olivier MATZ <zer0@droids-corp.org>
+ */
+
+#pragma once
+
+#include <sys/types.h>
+
+/*
+ * Regular expression engine used by the re, re_lex and dynlist nodes.
+ *
+ * When libecoli is built with PCRE2, the patterns are compiled with the
+ * PCRE2 syntax and JIT-compiled, with the anchoring done by the engine.
+ * Else, POSIX extended regular expressions from the libc are used. The
+ * common subset of both syntaxes behaves the same, except for
+ * alternations: PCRE2 selects the first alternative that matches while
+ * POSIX selects the longest one.
+ */
+struct ec_regex;
+
+enum ec_regex_anchor {
+	EC_REGEX_FULL, /* the whole string must match */
+	EC_REGEX_PREFIX, /* the match must start at the beginning of the string */
+};
+
+/*
+ * Compile a regular expression. Return NULL on error (errno is set to
+ * EINVAL if the pattern is invalid).
+ */
+struct ec_regex *ec_regex(const char *pattern, enum ec_regex_anchor anchor);
+
+/* Free a compiled regular expression. */
+void ec_regex_free(struct ec_regex *re);
+
+/*
+ * Match a nul-terminated string of length len. Return the length of the
+ * match, which is len for EC_REGEX_FULL, or -1 if the string does not
+ * match.
+ */
+ssize_t ec_regex_match(const struct ec_regex *re, const char *str, size_t len);
+
+/*
+ * A set of patterns compiled into one automaton, to find which pattern
+ * matches at the beginning of a string in a single scan. It always has
+ * the POSIX semantics (longest match), whatever the backend. Only a
+ * subset of the syntax is supported, see regex_set.c.
+ */
+struct ec_regex_set;
+
+/*
+ * Compile a set of patterns. Return NULL on error (errno is set to
+ * ENOTSUP if a pattern or the size of the automaton is not supported,
+ * in which case ec_regex() must be used).
+ */
+struct ec_regex_set *ec_regex_set(const char *const *patterns, size_t n);
+
+/* Free a compiled set of patterns. */
+void ec_regex_set_free(struct ec_regex_set *set);
+
+/*
+ * Find the first pattern of the set that matches a non-empty prefix of
+ * the len first bytes of str. Return the length of its longest match and
+ * set its index in idx, or return -1 if no pattern matches.
+ */
+ssize_t ec_regex_set_match(const struct ec_regex_set *set, const char *str, size_t len, size_t *idx);
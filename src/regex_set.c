@@ -0,0 +1,781 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2025, Olivier MATZ <zer0@droids-corp.org>
+ */
+
+/*
+ * A set of regular expressions compiled into one deterministic automaton.
+ *
+ * The patterns are parsed into syntax trees, converted into a Thompson
+ * NFA where each pattern ends with its own match state, then into a DFA
+ * with the subset construction. Each DFA state knows the first pattern
+ * it accepts, so the scan of a string gives the longest match of the
+ * first matching pattern.
+ *
+ * Only the part of the POSIX extended syntax that is interpreted the
+ * same way by all regex backends is supported: literals, escaped
+ * special characters, ".", brackets with ranges and character classes,
+ * groups, alternations and the "*", "+", "?" and "{m,n}" repetitions.
+ */
+
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ecoli/htable.h>
+
+#include "regex_private.h"
+
+#define RE_SET_MAX_REPEAT 255
+#define RE_SET_MAX_NFA_STATES 10000
+#define RE_SET_MAX_DFA_STATES 1024
+
+enum ast_type {
+	AST_SET,
+	AST_CAT,
+	AST_ALT,
+	AST_STAR,
+	AST_PLUS,
+	AST_QUEST,
+	AST_REPEAT,
+};
+
+struct ast {
+	enum ast_type type;
+	uint8_t set[32]; /* AST_SET: bitmap of the matching bytes */
+	struct ast *left; /* all but AST_SET */
+	struct ast *right; /* AST_CAT and AST_ALT */
+	unsigned int min; /* AST_REPEAT */
+	unsigned int max; /* AST_REPEAT, UINT_MAX if unbounded */
+};
+
+struct re_parser {
+	const char *str;
+	size_t off;
+};
+
+enum nfa_type {
+	NFA_SET,
+	NFA_SPLIT,
+	NFA_MATCH,
+};
+
+struct nfa_state {
+	enum nfa_type type;
+	const uint8_t *set; /* NFA_SET, points to the ast */
+	int out; /* NFA_SET and NFA_SPLIT */
+	int out1; /* NFA_SPLIT */
+	size_t pattern; /* NFA_MATCH */
+};
+
+struct nfa {
+	struct nfa_state *states;
+	size_t len;
+	unsigned int *mark; /* closure generation of each state */
+	unsigned int gen;
+};
+
+struct ec_regex_set {
+	int32_t *trans; /* next state for each state and byte, or -1 */
+	ssize_t *accept; /* first pattern accepted by each state, or -1 */
+	size_t len;
+};
+
+static inline void set_bit(uint8_t *set, unsigned int c)
+{
+	set[c / 8] |= 1 << (c % 8);
+}
+
+static inline bool test_bit(const uint8_t *set, unsigned int c)
+{
+	return set[c / 8] & (1 << (c % 8));
+}
+
+static void ast_free(struct ast *ast)
+{
+	if (ast == NULL)
+		return;
+	ast_free(ast->left);
+	ast_free(ast->right);
+	free(ast);
+}
+
+/* on error, the children are freed */
+static struct ast *ast_new(enum ast_type type, struct ast *left, struct ast *right)
+{
+	struct ast *ast;
+
+	ast = calloc(1, sizeof(*ast));
+	if (ast == NULL) {
+		ast_free(left);
+		ast_free(right);
+		return NULL;
+	}
+	ast->type = type;
+	ast->left = left;
+	ast->right = right;
+
+	return ast;
+}
+
+static struct ast *unsupported(void)
+{
+	errno = ENOTSUP;
+	return NULL;
+}
+
+static const struct {
+	const char *name;
+	int (*fn)(int c);
+} char_classes[] = {
+	{"alnum", isalnum},
+	{"alpha", isalpha},
+	{"blank", isblank},
+	{"cntrl", iscntrl},
+	{"digit", isdigit},
+	{"graph", isgraph},
+	{"lower", islower},
+	{"print", isprint},
+	{"punct", ispunct},
+	{"space", isspace},
+	{"upper", isupper},
+	{"xdigit", isxdigit},
+};
+
+/* parse "[:name:]", only for ascii characters which do not depend on the locale */
+static int parse_char_class(struct re_parser *p, uint8_t *set)
+{
+	const char *name = &p->str[p->off + 2];
+	const char *end = strstr(name, ":]");
+	unsigned int c;
+	size_t i;
+
+	if (end == NULL)
+		return -1;
+
+	for (i = 0; i < sizeof(char_classes) / sizeof(char_classes[0]); i++) {
+		if (strlen(char_classes[i].name) != (size_t)(end - name))
+			continue;
+		if (strncmp(char_classes[i].name, name, end - name))
+			continue;
+		for (c = 1; c < 128; c++) {
+			if (char_classes[i].fn(c))
+				set_bit(set, c);
+		}
+		p->off = end + 2 - p->str;
+		return 0;
+	}
+
+	return -1;
+}
+
+/* parse a bracket expression, the backslash meaning differs between backends */
+static struct ast *parse_bracket(struct re_parser *p)
+{
+	unsigned char lo, hi;
+	bool first = true;
+	struct ast *ast;
+	unsigned int c;
+	bool neg = false;
+
+	ast = ast_new(AST_SET, NULL, NULL);
+	if (ast == NULL)
+		return NULL;
+
+	p->off++;
+	if (p->str[p->off] == '^') {
+		neg = true;
+		p->off++;
+	}
+
+	while (1) {
+		lo = p->str[p->off];
+		if (lo == '\0' || lo == '\\' || lo >= 0x80)
+			goto unsupported;
+		if (lo == ']' && !first) {
+			p->off++;
+			break;
+		}
+		first = false;
+		if (lo == '[' && p->str[p->off + 1] == ':') {
+			if (parse_char_class(p, ast->set) < 0)
+				goto unsupported;
+			continue;
+		}
+		if (lo == '[' && (p->str[p->off + 1] == '=' || p->str[p->off + 1] == '.'))
+			goto unsupported;
+
+		p->off++;
+		if (p->str[p->off] == '-' && p->str[p->off + 1] != ']'
+		    && p->str[p->off + 1] != '\0') {
+			hi = p->str[p->off + 1];
+			if (hi == '[' || hi == '\\' || hi >= 0x80 || hi < lo)
+				goto unsupported;
+			p->off += 2;
+		} else {
+			hi = lo;
+		}
+		for (c = lo; c <= hi; c++)
+			set_bit(ast->set, c);
+	}
+
+	if (neg) {
+		for (c = 0; c < sizeof(ast->set); c++)
+			ast->set[c] = ~ast->set[c];
+	}
+	ast->set[0] &= ~1; /* never match the nul byte */
+
+	return ast;
+
+unsupported:
+	ast_free(ast);
+	return unsupported();
+}
+
+static struct ast *parse_alt(struct re_parser *p);
+
+static struct ast *parse_atom(struct re_parser *p)
+{
+	unsigned char c = p->str[p->off];
+	struct ast *ast;
+	unsigned int i;
+
+	switch (c) {
+	case '(':
+		p->off++;
+		ast = parse_alt(p);
+		if (ast == NULL)
+			return NULL;
+		if (p->str[p->off] != ')') {
+			ast_free(ast);
+			return unsupported();
+		}
+		p->off++;
+		return ast;
+	case '[':
+		return parse_bracket(p);
+	case '.':
+		ast = ast_new(AST_SET, NULL, NULL);
+		if (ast == NULL)
+			return NULL;
+		for (i = 1; i < 256; i++)
+			set_bit(ast->set, i);
+		p->off++;
+		return ast;
+	case '\\':
+		c = p->str[p->off + 1];
+		if (c == '\0' || strchr(".[]()*+?{}|^$\\", c) == NULL)
+			return unsupported();
+		p->off++;
+		break;
+	case '\0':
+	case ')':
+	case '|':
+	case '*':
+	case '+':
+	case '?':
+	case '{':
+	case '^':
+	case '$':
+		return unsupported();
+	default:
+		if (c >= 0x80)
+			return unsupported();
+		break;
+	}
+
+	ast = ast_new(AST_SET, NULL, NULL);
+	if (ast == NULL)
+		return NULL;
+	set_bit(ast->set, c);
+	p->off++;
+
+	return ast;
+}
+
+static int parse_number(struct re_parser *p, unsigned int *val)
+{
+	unsigned int n = 0;
+
+	if (!isdigit((unsigned char)p->str[p->off]))
+		return -1;
+	while (isdigit((unsigned char)p->str[p->off])) {
+		n = n * 10 + p->str[p->off] - '0';
+		if (n > RE_SET_MAX_REPEAT)
+			return -1;
+		p->off++;
+	}
+	*val = n;
+
+	return 0;
+}
+
+static struct ast *parse_repeat(struct re_parser *p)
+{
+	unsigned int min, max;
+	struct ast *ast;
+
+	ast = parse_atom(p);
+	if (ast == NULL)
+		return NULL;
+
+	switch (p->str[p->off]) {
+	case '*':
+		ast = ast_new(AST_STAR, ast, NULL);
+		p->off++;
+		break;
+	case '+':
+		ast = ast_new(AST_PLUS, ast, NULL);
+		p->off++;
+		break;
+	case '?':
+		ast = ast_new(AST_QUEST, ast, NULL);
+		p->off++;
+		break;
+	case '{':
+		p->off++;
+		if (parse_number(p, &min) < 0)
+			goto unsupported;
+		max = min;
+		if (p->str[p->off] == ',') {
+			p->off++;
+			max = UINT_MAX;
+			if (p->str[p->off] != '}' && parse_number(p, &max) < 0)
+				goto unsupported;
+		}
+		if (p->str[p->off] != '}' || max < min)
+			goto unsupported;
+		p->off++;
+		ast = ast_new(AST_REPEAT, ast, NULL);
+		if (ast == NULL)
+			return NULL;
+		ast->min = min;
+		ast->max = max;
+		break;
+	default:
+		return ast;
+	}
+	if (ast == NULL)
+		return NULL;
+
+	/* stacked repetitions have different meanings between backends */
+	if (p->str[p->off] != '\0' && strchr("*+?{", p->str[p->off]) != NULL)
+		goto unsupported;
+
+	return ast;
+
+unsupported:
+	ast_free(ast);
+	return unsupported();
+}
+
+static struct ast *parse_cat(struct re_parser *p)
+{
+	struct ast *ast = NULL, *next;
+	char c;
+
+	while (1) {
+		c = p->str[p->off];
+		if (c == '\0' || c == '|' || c == ')')
+			break;
+		next = parse_repeat(p);
+		if (next == NULL) {
+			ast_free(ast);
+			return NULL;
+		}
+		if (ast == NULL)
+			ast = next;
+		else
+			ast = ast_new(AST_CAT, ast, next);
+		if (ast == NULL)
+			return NULL;
+	}
+
+	/* empty branches are not accepted by all backends */
+	if (ast == NULL)
+		return unsupported();
+
+	return ast;
+}
+
+static struct ast *parse_alt(struct re_parser *p)
+{
+	struct ast *ast, *next;
+
+	ast = parse_cat(p);
+	if (ast == NULL)
+		return NULL;
+
+	while (p->str[p->off] == '|') {
+		p->off++;
+		next = parse_cat(p);
+		if (next == NULL) {
+			ast_free(ast);
+			return NULL;
+		}
+		ast = ast_new(AST_ALT, ast, next);
+		if (ast == NULL)
+			return NULL;
+	}
+
+	return ast;
+}
+
+static struct ast *parse(const char *str)
+{
+	struct re_parser p = {.str = str};
+	struct ast *ast;
+
+	ast = parse_alt(&p);
+	if (ast == NULL)
+		return NULL;
+	if (p.str[p.off] != '\0') {
+		ast_free(ast);
+		return unsupported();
+	}
+
+	return ast;
+}
+
+static int nfa_add(struct nfa *nfa, enum nfa_type type, const uint8_t *set, int out, int out1)
+{
+	struct nfa_state *states;
+
+	if (nfa->len == RE_SET_MAX_NFA_STATES) {
+		errno = ENOTSUP;
+		return -1;
+	}
+	states = realloc(nfa->states, (nfa->len + 1) * sizeof(*states));
+	if (states == NULL)
+		return -1;
+	nfa->states = states;
+	memset(&states[nfa->len], 0, sizeof(states[nfa->len]));
+	states[nfa->len].type = type;
+	states[nfa->len].set = set;
+	states[nfa->len].out = out;
+	states[nfa->len].out1 = out1;
+
+	return nfa->len++;
+}
+
+/* add the states matching ast then going to next, return the first one */
+static int nfa_compile(struct nfa *nfa, const struct ast *ast, int next)
+{
+	int split, start, tail;
+	unsigned int i;
+
+	switch (ast->type) {
+	case AST_SET:
+		return nfa_add(nfa, NFA_SET, ast->set, next, -1);
+	case AST_CAT:
+		tail = nfa_compile(nfa, ast->right, next);
+		if (tail < 0)
+			return -1;
+		return nfa_compile(nfa, ast->left, tail);
+	case AST_ALT:
+		start = nfa_compile(nfa, ast->left, next);
+		if (start < 0)
+			return -1;
+		tail = nfa_compile(nfa, ast->right, next);
+		if (tail < 0)
+			return -1;
+		return nfa_add(nfa, NFA_SPLIT, NULL, start, tail);
+	case AST_STAR:
+	case AST_PLUS:
+		split = nfa_add(nfa, NFA_SPLIT, NULL, -1, next);
+		if (split < 0)
+			return -1;
+		start = nfa_compile(nfa, ast->left, split);
+		if (start < 0)
+			return -1;
+		nfa->states[split].out = start;
+		return ast->type == AST_STAR ? split : start;
+	case AST_QUEST:
+		start = nfa_compile(nfa, ast->left, next);
+		if (start < 0)
+			return -1;
+		return nfa_add(nfa, NFA_SPLIT, NULL, start, next);
+	case AST_REPEAT:
+		/* a{2,4} is aa(a(a)?)? and a{2,} is aaa* */
+		tail = next;
+		if (ast->max == UINT_MAX) {
+			split = nfa_add(nfa, NFA_SPLIT, NULL, -1, next);
+			if (split < 0)
+				return -1;
+			start = nfa_compile(nfa, ast->left, split);
+			if (start < 0)
+				return -1;
+			nfa->states[split].out = start;
+			tail = split;
+		} else {
+			for (i = ast->min; i < ast->max; i++) {
+				start = nfa_compile(nfa, ast->left, tail);
+				if (start < 0)
+					return -1;
+				tail = nfa_add(nfa, NFA_SPLIT, NULL, start, next);
+				if (tail < 0)
+					return -1;
+			}
+		}
+		for (i = 0; i < ast->min; i++) {
+			tail = nfa_compile(nfa, ast->left, tail);
+			if (tail < 0)
+				return -1;
+		}
+		return tail;
+	}
+
+	errno = EINVAL;
+	return -1;
+}
+
+static int cmp_int(const void *a, const void *b)
+{
+	return *(const int *)a - *(const int *)b;
+}
+
+/*
+ * Replace the states of the list by their epsilon closure, without the
+ * split states, sorted so that it can be used as a key. The list must be
+ * large enough to hold all the states of the nfa.
+ */
+static size_t nfa_closure(struct nfa *nfa, int *list, size_t len, int *stack)
+{
+	const struct nfa_state *state;
+	size_t i, n = 0, top = 0;
+	int s;
+
+	nfa->gen++;
+	for (i = 0; i < len; i++)
+		stack[top++] = list[i];
+
+	while (top > 0) {
+		s = stack[--top];
+		if (nfa->mark[s] == nfa->gen)
+			continue;
+		nfa->mark[s] = nfa->gen;
+		state = &nfa->states[s];
+		if (state->type == NFA_SPLIT) {
+			stack[top++] = state->out;
+			stack[top++] = state->out1;
+		} else {
+			list[n++] = s;
+		}
+	}
+	qsort(list, n, sizeof(*list), cmp_int);
+
+	return n;
+}
+
+struct dfa_builder {
+	struct nfa *nfa;
+	struct ec_regex_set *set;
+	struct ec_htable *ids; /* index + 1 of the dfa states, keyed by their nfa states */
+	int **nfa_sets; /* nfa states of each dfa state */
+	size_t *nfa_lens;
+};
+
+/* return the index of the dfa state made of these nfa states, adding it if needed */
+static int dfa_get_state(struct dfa_builder *b, const int *list, size_t len)
+{
+	struct ec_regex_set *set = b->set;
+	const struct nfa_state *state;
+	size_t idx = set->len;
+	int32_t *trans;
+	ssize_t *accept;
+	size_t *lens;
+	int **sets;
+	void *val;
+	size_t i;
+
+	val = ec_htable_get(b->ids, list, len * sizeof(*list));
+	if (val != NULL)
+		return (uintptr_t)val - 1;
+
+	if (idx == RE_SET_MAX_DFA_STATES) {
+		errno = ENOTSUP;
+		return -1;
+	}
+
+	trans = realloc(set->trans, (idx + 1) * 256 * sizeof(*trans));
+	if (trans == NULL)
+		return -1;
+	set->trans = trans;
+	accept = realloc(set->accept, (idx + 1) * sizeof(*accept));
+	if (accept == NULL)
+		return -1;
+	set->accept = accept;
+	sets = realloc(b->nfa_sets, (idx + 1) * sizeof(*sets));
+	if (sets == NULL)
+		return -1;
+	b->nfa_sets = sets;
+	lens = realloc(b->nfa_lens, (idx + 1) * sizeof(*lens));
+	if (lens == NULL)
+		return -1;
+	b->nfa_lens = lens;
+
+	sets[idx] = malloc(len * sizeof(*list));
+	if (sets[idx] == NULL)
+		return -1;
+	memcpy(sets[idx], list, len * sizeof(*list));
+	lens[idx] = len;
+
+	set->accept[idx] = -1;
+	for (i = 0; i < len; i++) {
+		state = &b->nfa->states[list[i]];
+		if (state->type != NFA_MATCH)
+			continue;
+		if (set->accept[idx] < 0 || (size_t)set->accept[idx] > state->pattern)
+			set->accept[idx] = state->pattern;
+	}
+	set->len++;
+
+	if (ec_htable_set(b->ids, list, len * sizeof(*list), (void *)(uintptr_t)(idx + 1), NULL)
+	    < 0)
+		return -1;
+
+	return idx;
+}
+
+static int dfa_build(struct dfa_builder *b, const int *starts, size_t n_starts)
+{
+	int *list = NULL, *stack = NULL;
+	const struct nfa_state *state;
+	size_t i, s, len;
+	unsigned int c;
+	int next;
+	int ret = -1;
+
+	/* each split pushes 2 states, in addition to the initial list */
+	list = malloc(b->nfa->len * sizeof(*list));
+	stack = malloc(3 * b->nfa->len * sizeof(*stack));
+	if (list == NULL || stack == NULL)
+		goto out;
+
+	memcpy(list, starts, n_starts * sizeof(*list));
+	len = nfa_closure(b->nfa, list, n_starts, stack);
+	if (dfa_get_state(b, list, len) < 0)
+		goto out;
+
+	for (s = 0; s < b->set->len; s++) {
+		b->set->trans[s * 256] = -1;
+		for (c = 1; c < 256; c++) {
+			len = 0;
+			for (i = 0; i < b->nfa_lens[s]; i++) {
+				state = &b->nfa->states[b->nfa_sets[s][i]];
+				if (state->type == NFA_SET && test_bit(state->set, c))
+					list[len++] = state->out;
+			}
+			next = -1;
+			if (len > 0) {
+				len = nfa_closure(b->nfa, list, len, stack);
+				next = dfa_get_state(b, list, len);
+				if (next < 0)
+					goto out;
+			}
+			b->set->trans[s * 256 + c] = next;
+		}
+	}
+
+	ret = 0;
+
+out:
+	free(list);
+	free(stack);
+	return ret;
+}
+
+struct ec_regex_set *ec_regex_set(const char *const *patterns, size_t n)
+{
+	struct ec_regex_set *set, *ret = NULL;
+	struct dfa_builder b = {0};
+	struct ast **asts = NULL;
+	struct nfa nfa = {0};
+	int *starts = NULL;
+	int match;
+	size_t i;
+
+	set = calloc(1, sizeof(*set));
+	asts = calloc(n, sizeof(*asts));
+	starts = calloc(n, sizeof(*starts));
+	if (set == NULL || asts == NULL || starts == NULL)
+		goto out;
+
+	for (i = 0; i < n; i++) {
+		asts[i] = parse(patterns[i]);
+		if (asts[i] == NULL)
+			goto out;
+		match = nfa_add(&nfa, NFA_MATCH, NULL, -1, -1);
+		if (match < 0)
+			goto out;
+		nfa.states[match].pattern = i;
+		starts[i] = nfa_compile(&nfa, asts[i], match);
+		if (starts[i] < 0)
+			goto out;
+	}
+
+	nfa.mark = calloc(nfa.len, sizeof(*nfa.mark));
+	b.ids = ec_htable();
+	if (nfa.mark == NULL || b.ids == NULL)
+		goto out;
+	b.nfa = &nfa;
+	b.set = set;
+	if (dfa_build(&b, starts, n) < 0)
+		goto out;
+
+	ret = set;
+
+out:
+	/* the nfa sets of the dfa states were only needed during the build */
+	for (i = 0; set != NULL && i < set->len; i++)
+		free(b.nfa_sets[i]);
+	free(b.nfa_sets);
+	free(b.nfa_lens);
+	ec_htable_free(b.ids);
+	free(nfa.mark);
+	free(nfa.states);
+	for (i = 0; asts != NULL && i < n; i++)
+		ast_free(asts[i]);
+	free(asts);
+	free(starts);
+	if (ret == NULL)
+		ec_regex_set_free(set);
+
+	return ret;
+}
+
+void ec_regex_set_free(struct ec_regex_set *set)
+{
+	if (set == NULL)
+		return;
+
+	free(set->trans);
+	free(set->accept);
+	free(set);
+}
+
+ssize_t ec_regex_set_match(const struct ec_regex_set *set, const char *str, size_t len, size_t *idx)
+{
+	ssize_t best = -1, best_len = -1, acc;
+	int32_t state = 0;
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		state = set->trans[state * 256 + (unsigned char)str[i]];
+		if (state < 0)
+			break;
+		acc = set->accept[state];
+		if (acc >= 0 && (best < 0 || acc <= best)) {
+			best = acc;
+			best_len = i + 1;
+		}
+	}
+	if (best < 0)
+		return -1;
+
+	*idx = best;
+	return best_len;
+}
@@ -0,0 +1,732 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2025, Olivier MATZ <zer0@droids-corp.org>
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <ecoli/config.h>
+#include <ecoli/dict.h>
+#include <ecoli/htable.h>
+#include <ecoli/log.h>
+#include <ecoli/node.h>
+#include <ecoli/snapshot.h>
+
+#include "dict_private.h"
+
+EC_LOG_TYPE_REGISTER(snapshot);
+
+#define SNAP_MAGIC "ECSNAP01"
+#define SNAP_BYTE_ORDER 0x01020304
+#define SNAP_NONE UINT32_MAX
+#define SNAP_MAX_DEPTH 64 /* maximum nesting of lists and dicts */
+
+/*
+ * File layout: a header, then the arrays of nodes, attributes and
+ * configuration values, then the strings. All offsets are relative to
+ * the beginning of the file, and all references are indexes in these
+ * arrays, or offsets in the strings (nul-terminated).
+ */
+struct snap_header {
+	char magic[8];
+	uint32_t byte_order;
+	uint32_t size; /* size of the whole snapshot */
+	uint32_t root; /* index of the root node */
+	uint32_t nodes_off;
+	uint32_t nodes_len;
+	uint32_t attrs_off;
+	uint32_t attrs_len;
+	uint32_t configs_off;
+	uint32_t configs_len;
+	uint32_t strings_off;
+	uint32_t strings_len; /* in bytes */
+};
+
+struct snap_node {
+	uint32_t type; /* string */
+	uint32_t id; /* string, or SNAP_NONE */
+	uint32_t config; /* index, or SNAP_NONE */
+	uint32_t attrs; /* index of the first attribute */
+	uint32_t attrs_len;
+};
+
+struct snap_attr {
+	uint32_t key; /* string */
+	uint32_t val; /* string, or SNAP_NONE for a NULL value */
+};
+
+/*
+ * The elements of a list or dict are stored in contiguous records,
+ * always after the record of the container.
+ */
+struct snap_config {
+	uint32_t type; /* enum ec_config_type */
+	uint32_t key; /* string, only for an element of a dict */
+	uint32_t val[2]; /* see snap_write_config() */
+};
+
+/* a growable array of records */
+struct snap_array {
+	void *buf;
+	size_t len;
+	size_t size;
+};
+
+struct snap_writer {
+	struct ec_htable *node_idx; /* node pointer -> index + 1 */
+	struct ec_htable *string_idx; /* string -> offset + 1 */
+	struct snap_array nodes; /* const struct ec_node *, in post-order */
+	struct snap_array node_recs; /* struct snap_node */
+	struct snap_array attrs; /* struct snap_attr */
+	struct snap_array configs; /* struct snap_config */
+	struct snap_array strings; /* char */
+};
+
+/* Append n zeroed elements to an array, return the index of the first one. */
+static ssize_t snap_array_alloc(struct snap_array *array, size_t elt_size, size_t n)
+{
+	size_t new_size;
+	void *buf;
+
+	if (array->len + n > SNAP_NONE) {
+		errno = EOVERFLOW;
+		return -1;
+	}
+
+	if (array->len + n > array->size) {
+		new_size = array->size * 2;
+		if (new_size < array->len + n)
+			new_size = array->len + n + 16;
+		buf = realloc(array->buf, new_size * elt_size);
+		if (buf == NULL)
+			return -1;
+		array->buf = buf;
+		array->size = new_size;
+	}
+	memset((char *)array->buf + array->len * elt_size, 0, n * elt_size);
+	array->len += n;
+
+	return array->len - n;
+}
+
+static uint32_t snap_write_string(struct snap_writer *w, const char *str, int *err)
+{
+	size_t len = strlen(str) + 1;
+	uintptr_t off;
+	ssize_t idx;
+
+	off = (uintptr_t)ec_htable_get(w->string_idx, str, len);
+	if (off != 0)
+		return off - 1;
+
+	idx = snap_array_alloc(&w->strings, 1, len);
+	if (idx < 0)
+		goto fail;
+	memcpy((char *)w->strings.buf + idx, str, len);
+	if (ec_htable_set(w->string_idx, str, len, (void *)(uintptr_t)(idx + 1), NULL) < 0)
+		goto fail;
+
+	return idx;
+
+fail:
+	*err = -1;
+	return SNAP_NONE;
+}
+
+static int snap_visit_node(struct snap_writer *w, const struct ec_node *node);
+
+/* Visit the nodes referenced by a configuration. */
+static int snap_visit_config(struct snap_writer *w, const struct ec_config *config)
+{
+	struct ec_dict_elt_ref *iter;
+	struct ec_config *item;
+
+	switch (ec_config_get_type(config)) {
+	case EC_CONFIG_TYPE_NODE:
+		return snap_visit_node(w, config->node);
+	case EC_CONFIG_TYPE_LIST:
+		TAILQ_FOREACH (item, &config->list, next) {
+			if (snap_visit_config(w, item) < 0)
+				return -1;
+		}
+		break;
+	case EC_CONFIG_TYPE_DICT:
+		for (iter = ec_dict_iter(config->dict); iter != NULL;
+		     iter = ec_dict_iter_next(iter)) {
+			if (snap_visit_config(w, ec_dict_iter_get_val(iter)) < 0)
+				return -1;
+		}
+		break;
+	default:
+		break;
+	}
+
+	return 0;
+}
+
+/*
+ * Number the nodes in post-order, so that a node is usually configured
+ * after the nodes it references when the snapshot is loaded, like with
+ * ec_yaml_import(). A node is marked before visiting its configuration
+ * to stop on loops.
+ */
+static int snap_visit_node(struct snap_writer *w, const struct ec_node *node)
+{
+	const struct ec_config *config;
+	ssize_t idx;
+
+	if (ec_htable_has_key(w->node_idx, &node, sizeof(node)))
+		return 0;
+	if (ec_htable_set(w->node_idx, &node, sizeof(node), NULL, NULL) < 0)
+		return -1;
+
+	/* the children of the node can only be restored from its config */
+	config = ec_node_get_config(node);
+	if (config == NULL && ec_node_get_children_count(node) > 0) {
+		EC_LOG(EC_LOG_ERR,
+		       "Cannot export node %s: it has children but no config\n",
+		       ec_node_get_type_name(node));
+		errno = ENOTSUP;
+		return -1;
+	}
+	if (config != NULL && snap_visit_config(w, config) < 0)
+		return -1;
+
+	idx = snap_array_alloc(&w->nodes, sizeof(node), 1);
+	if (idx < 0)
+		return -1;
+	((const struct ec_node **)w->nodes.buf)[idx] = node;
+
+	return ec_htable_set(w->node_idx, &node, sizeof(node), (void *)(uintptr_t)(idx + 1), NULL);
+}
+
+static int cmp_dict_elt(const void *p1, const void *p2)
+{
+	const struct ec_dict_elt_ref *const *elt1 = p1, *const *elt2 = p2;
+
+	return strcmp(ec_dict_iter_get_key(*elt1), ec_dict_iter_get_key(*elt2));
+}
+
+/*
+ * Write a configuration value in the record idx. The value is stored in
+ * val[]: the boolean in val[0], the integers in val[0] (low 32 bits) and
+ * val[1] (high 32 bits), the string offset (or SNAP_NONE) and the node
+ * index in val[0], and for a list or dict, the index of the first
+ * element in val[0] and the number of elements in val[1].
+ */
+static int snap_write_config(struct snap_writer *w, const struct ec_config *config, size_t idx)
+{
+	struct ec_dict_elt_ref **elts = NULL, *iter;
+	const struct ec_node *node;
+	struct snap_config *rec;
+	struct ec_config *item;
+	uint32_t val[2] = {0, 0};
+	ssize_t first = 0, n, i;
+	uint64_t u64;
+	int err = 0;
+
+	switch (ec_config_get_type(config)) {
+	case EC_CONFIG_TYPE_BOOL:
+		val[0] = config->boolean;
+		break;
+	case EC_CONFIG_TYPE_INT64:
+	case EC_CONFIG_TYPE_UINT64:
+		u64 = config->u64;
+		val[0] = u64 & 0xffffffff;
+		val[1] = u64 >> 32;
+		break;
+	case EC_CONFIG_TYPE_STRING:
+		val[0] = SNAP_NONE;
+		if (config->string != NULL)
+			val[0] = snap_write_string(w, config->string, &err);
+		break;
+	case EC_CONFIG_TYPE_NODE:
+		node = config->node;
+		val[0] = (uintptr_t)ec_htable_get(w->node_idx, &node, sizeof(node)) - 1;
+		break;
+	case EC_CONFIG_TYPE_LIST:
+		n = ec_config_count(config);
+		if (n < 0)
+			goto fail;
+		first = snap_array_alloc(&w->configs, sizeof(*rec), n);
+		if (first < 0)
+			goto fail;
+		i = 0;
+		TAILQ_FOREACH (item, &config->list, next) {
+			if (snap_write_config(w, item, first + i) < 0)
+				goto fail;
+			rec = &((struct snap_config *)w->configs.buf)[first + i];
+			rec->key = SNAP_NONE;
+			i++;
+		}
+		val[0] = first;
+		val[1] = n;
+		break;
+	case EC_CONFIG_TYPE_DICT:
+		/* sort the elements, so that the export is reproducible */
+		n = ec_dict_len(config->dict);
+		first = snap_array_alloc(&w->configs, sizeof(*rec), n);
+		if (first < 0)
+			goto fail;
+		elts = calloc(n + 1, sizeof(*elts));
+		if (elts == NULL)
+			goto fail;
+		i = 0;
+		for (iter = ec_dict_iter(config->dict); iter != NULL && i < n;
+		     iter = ec_dict_iter_next(iter))
+			elts[i++] = iter;
+		qsort(elts, i, sizeof(*elts), cmp_dict_elt);
+		for (i = 0; i < n; i++) {
+			if (snap_write_config(w, ec_dict_iter_get_val(elts[i]), first + i) < 0)
+				goto fail;
+			rec = &((struct snap_config *)w->configs.buf)[first + i];
+			rec->key = snap_write_string(w, ec_dict_iter_get_key(elts[i]), &err);
+		}
+		free(elts);
+		elts = NULL;
+		val[0] = first;
+		val[1] = n;
+		break;
+	default:
+		errno = EINVAL;
+		goto fail;
+	}
+	if (err < 0)
+		goto fail;
+
+	rec = &((struct snap_config *)w->configs.buf)[idx];
+	rec->type = ec_config_get_type(config);
+	rec->val[0] = val[0];
+	rec->val[1] = val[1];
+
+	return 0;
+
+fail:
+	free(elts);
+	return -1;
+}
+
+static int snap_write_node(struct snap_writer *w, const struct ec_node *node, size_t idx)
+{
+	const struct ec_dict *attrs = ec_node_attrs(node);
+	struct ec_dict_elt_ref *iter;
+	struct snap_attr *attr;
+	struct snap_node rec;
+	const char *val;
+	ssize_t config;
+	int err = 0;
+
+	rec.type = snap_write_string(w, ec_node_get_type_name(node), &err);
+	rec.id = SNAP_NONE;
+	if (strcmp(ec_node_id(node), EC_NO_ID))
+		rec.id = snap_write_string(w, ec_node_id(node), &err);
+
+	rec.config = SNAP_NONE;
+	if (ec_node_get_config(node) != NULL) {
+		config = snap_array_alloc(&w->configs, sizeof(struct snap_config), 1);
+		if (config < 0)
+			return -1;
+		if (snap_write_config(w, ec_node_get_config(node), config) < 0)
+			return -1;
+		((struct snap_config *)w->configs.buf)[config].key = SNAP_NONE;
+		rec.config = config;
+	}
+
+	rec.attrs = w->attrs.len;
+	rec.attrs_len = 0;
+	for (iter = ec_dict_iter(attrs); iter != NULL; iter = ec_dict_iter_next(iter)) {
+		val = ec_dict_iter_get_val(iter);
+		if (val != NULL && ec_dict_iter_get_free(iter) != free)
+			continue;
+		if (snap_array_alloc(&w->attrs, sizeof(*attr), 1) < 0)
+			return -1;
+		attr = &((struct snap_attr *)w->attrs.buf)[w->attrs.len - 1];
+		attr->key = snap_write_string(w, ec_dict_iter_get_key(iter), &err);
+		attr->val = SNAP_NONE;
+		if (val != NULL)
+			attr->val = snap_write_string(w, val, &err);
+		rec.attrs_len++;
+	}
+	if (err < 0)
+		return -1;
+
+	((struct snap_node *)w->node_recs.buf)[idx] = rec;
+
+	return 0;
+}
+
+static int snap_write(FILE *out, const struct snap_array *array, size_t elt_size)
+{
+	if (array->len == 0)
+		return 0;
+	if (fwrite(array->buf, elt_size, array->len, out) != array->len) {
+		errno = EIO;
+		return -1;
+	}
+	return 0;
+}
+
+int ec_snapshot_export(FILE *out, const struct ec_node *node)
+{
+	struct snap_writer w;
+	struct snap_header hdr;
+	size_t i, size;
+	int ret = -1;
+
+	if (out == NULL || node == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	memset(&w, 0, sizeof(w));
+	w.node_idx = ec_htable();
+	if (w.node_idx == NULL)
+		goto out;
+	w.string_idx = ec_htable();
+	if (w.string_idx == NULL)
+		goto out;
+
+	if (snap_visit_node(&w, node) < 0)
+		goto out;
+	if (snap_array_alloc(&w.node_recs, sizeof(struct snap_node), w.nodes.len) < 0)
+		goto out;
+	for (i = 0; i < w.nodes.len; i++) {
+		if (snap_write_node(&w, ((const struct ec_node **)w.nodes.buf)[i], i) < 0)
+			goto out;
+	}
+	/* keep the size a multiple of 4 */
+	if (snap_array_alloc(&w.strings, 1, 4 - w.strings.len % 4) < 0)
+		goto out;
+
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, SNAP_MAGIC, sizeof(hdr.magic));
+	hdr.byte_order = SNAP_BYTE_ORDER;
+	hdr.root = (uintptr_t)ec_htable_get(w.node_idx, &node, sizeof(node)) - 1;
+	size = sizeof(hdr);
+	hdr.nodes_off = size;
+	hdr.nodes_len = w.node_recs.len;
+	size += w.node_recs.len * sizeof(struct snap_node);
+	hdr.attrs_off = size;
+	hdr.attrs_len = w.attrs.len;
+	size += w.attrs.len * sizeof(struct snap_attr);
+	hdr.configs_off = size;
+	hdr.configs_len = w.configs.len;
+	size += w.configs.len * sizeof(struct snap_config);
+	hdr.strings_off = size;
+	hdr.strings_len = w.strings.len;
+	size += w.strings.len;
+	if (size > UINT32_MAX) {
+		errno = EOVERFLOW;
+		goto out;
+	}
+	hdr.size = size;
+
+	if (fwrite(&hdr, sizeof(hdr), 1, out) != 1) {
+		errno = EIO;
+		goto out;
+	}
+	if (snap_write(out, &w.node_recs, sizeof(struct snap_node)) < 0)
+		goto out;
+	if (snap_write(out, &w.attrs, sizeof(struct snap_attr)) < 0)
+		goto out;
+	if (snap_write(out, &w.configs, sizeof(struct snap_config)) < 0)
+		goto out;
+	if (snap_write(out, &w.strings, 1) < 0)
+		goto out;
+
+	ret = 0;
+
+out:
+	ec_htable_free(w.node_idx);
+	ec_htable_free(w.string_idx);
+	free(w.nodes.buf);
+	free(w.node_recs.buf);
+	free(w.attrs.buf);
+	free(w.configs.buf);
+	free(w.strings.buf);
+	return ret;
+}
+
+struct snap_reader {
+	const struct snap_header *hdr;
+	const struct snap_node *nodes;
+	const struct snap_attr *attrs;
+	const struct snap_config *configs;
+	const char *strings;
+	struct ec_node **enodes;
+	uint8_t *configs_read; /* the config records already read */
+};
+
+/* Return a string of the snapshot, or NULL if the offset is invalid. */
+static const char *snap_string(const struct snap_reader *r, uint32_t off)
+{
+	if (off >= r->hdr->strings_len) {
+		errno = EINVAL;
+		return NULL;
+	}
+	return &r->strings[off];
+}
+
+/*
+ * Each record is written once by snap_write_config(), so a record read
+ * twice comes from overlapping lists or dicts, which could take an
+ * exponential time to read.
+ */
+static struct ec_config *
+snap_read_config(const struct snap_reader *r, uint32_t idx, unsigned int depth)
+{
+	const struct snap_config *rec = &r->configs[idx];
+	struct ec_config *config = NULL, *item;
+	const char *str;
+	uint32_t i;
+
+	if (r->configs_read[idx] || depth > SNAP_MAX_DEPTH) {
+		errno = EINVAL;
+		return NULL;
+	}
+	r->configs_read[idx] = 1;
+
+	switch (rec->type) {
+	case EC_CONFIG_TYPE_BOOL:
+		return ec_config_bool(rec->val[0]);
+	case EC_CONFIG_TYPE_INT64:
+		return ec_config_i64((int64_t)((uint64_t)rec->val[1] << 32 | rec->val[0]));
+	case EC_CONFIG_TYPE_UINT64:
+		return ec_config_u64((uint64_t)rec->val[1] << 32 | rec->val[0]);
+	case EC_CONFIG_TYPE_STRING:
+		if (rec->val[0] == SNAP_NONE)
+			return ec_config_string(NULL);
+		str = snap_string(r, rec->val[0]);
+		if (str == NULL)
+			return NULL;
+		return ec_config_string(str);
+	case EC_CONFIG_TYPE_NODE:
+		if (rec->val[0] >= r->hdr->nodes_len) {
+			errno = EINVAL;
+			return NULL;
+		}
+		return ec_config_node(ec_node_clone(r->enodes[rec->val[0]]));
+	case EC_CONFIG_TYPE_LIST:
+	case EC_CONFIG_TYPE_DICT:
+		/* the elements are after the container: this cannot loop */
+		if (rec->val[0] <= idx || rec->val[0] > r->hdr->configs_len
+		    || rec->val[1] > r->hdr->configs_len - rec->val[0]) {
+			errno = EINVAL;
+			return NULL;
+		}
+		if (rec->type == EC_CONFIG_TYPE_LIST)
+			config = ec_config_list();
+		else
+			config = ec_config_dict();
+		if (config == NULL)
+			return NULL;
+		for (i = rec->val[0]; i < rec->val[0] + rec->val[1]; i++) {
+			item = snap_read_config(r, i, depth + 1);
+			if (item == NULL)
+				goto fail;
+			if (rec->type == EC_CONFIG_TYPE_LIST) {
+				if (ec_config_list_add(config, item) < 0)
+					goto fail;
+			} else {
+				str = snap_string(r, r->configs[i].key);
+				if (str == NULL) {
+					ec_config_free(item);
+					goto fail;
+				}
+				if (ec_config_dict_set(config, str, item) < 0)
+					goto fail;
+			}
+		}
+		return config;
+	default:
+		errno = EINVAL;
+		return NULL;
+	}
+
+fail:
+	ec_config_free(config);
+	return NULL;
+}
+
+static int
+snap_read_attrs(const struct snap_reader *r, const struct snap_node *rec, struct ec_node *node)
+{
+	const struct snap_attr *attr;
+	const char *key, *val;
+	char *dup;
+	uint32_t i;
+
+	if (rec->attrs > r->hdr->attrs_len || rec->attrs_len > r->hdr->attrs_len - rec->attrs) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	for (i = rec->attrs; i < rec->attrs + rec->attrs_len; i++) {
+		attr = &r->attrs[i];
+		key = snap_string(r, attr->key);
+		if (key == NULL)
+			return -1;
+		if (attr->val == SNAP_NONE) {
+			if (ec_dict_set(ec_node_attrs(node), key, NULL, NULL) < 0)
+				return -1;
+			continue;
+		}
+		val = snap_string(r, attr->val);
+		if (val == NULL)
+			return -1;
+		dup = strdup(val);
+		if (dup == NULL)
+			return -1;
+		if (ec_dict_set(ec_node_attrs(node), key, dup, free) < 0)
+			return -1;
+	}
+
+	return 0;
+}
+
+/* Check that the header describes arrays that fit in the buffer. */
+static int snap_check_header(const struct snap_header *hdr, size_t len)
+{
+	if (len < sizeof(*hdr) || memcmp(hdr->magic, SNAP_MAGIC, sizeof(hdr->magic))
+	    || hdr->byte_order != SNAP_BYTE_ORDER || hdr->size != len)
+		return -1;
+	if (hdr->nodes_off < sizeof(*hdr) || hdr->nodes_off > len
+	    || hdr->nodes_len > (len - hdr->nodes_off) / sizeof(struct snap_node))
+		return -1;
+	if (hdr->attrs_off < sizeof(*hdr) || hdr->attrs_off > len
+	    || hdr->attrs_len > (len - hdr->attrs_off) / sizeof(struct snap_attr))
+		return -1;
+	if (hdr->configs_off < sizeof(*hdr) || hdr->configs_off > len
+	    || hdr->configs_len > (len - hdr->configs_off) / sizeof(struct snap_config))
+		return -1;
+	if (hdr->strings_off < sizeof(*hdr) || hdr->strings_off > len
+	    || hdr->strings_len > len - hdr->strings_off)
+		return -1;
+	if ((hdr->nodes_off | hdr->attrs_off | hdr->configs_off) % sizeof(uint32_t) != 0)
+		return -1;
+	if (hdr->root >= hdr->nodes_len)
+		return -1;
+	/* all strings are terminated */
+	if (hdr->strings_len == 0 || ((const char *)hdr)[hdr->strings_off + hdr->strings_len - 1])
+		return -1;
+
+	return 0;
+}
+
+struct ec_node *ec_snapshot_import_mem(const void *buf, size_t len)
+{
+	const struct ec_node_type *type;
+	struct ec_node *root = NULL;
+	struct snap_reader r;
+	struct ec_config *config;
+	const char *str, *id;
+	uint32_t i;
+
+	memset(&r, 0, sizeof(r));
+	r.hdr = buf;
+	if (buf == NULL || (uintptr_t)buf % sizeof(uint32_t) != 0
+	    || snap_check_header(r.hdr, len) < 0) {
+		EC_LOG(EC_LOG_ERR, "Invalid snapshot header\n");
+		errno = EINVAL;
+		return NULL;
+	}
+	r.nodes = (const void *)((const char *)buf + r.hdr->nodes_off);
+	r.attrs = (const void *)((const char *)buf + r.hdr->attrs_off);
+	r.configs = (const void *)((const char *)buf + r.hdr->configs_off);
+	r.strings = (const char *)buf + r.hdr->strings_off;
+
+	/* create all nodes first, the configurations can reference any of them */
+	r.enodes = calloc(r.hdr->nodes_len, sizeof(*r.enodes));
+	if (r.enodes == NULL)
+		return NULL;
+	/* one more byte, to get a valid pointer when there is no record */
+	r.configs_read = calloc(r.hdr->configs_len + 1, sizeof(*r.configs_read));
+	if (r.configs_read == NULL)
+		goto fail;
+	for (i = 0; i < r.hdr->nodes_len; i++) {
+		str = snap_string(&r, r.nodes[i].type);
+		if (str == NULL)
+			goto fail;
+		type = ec_node_type_lookup(str);
+		if (type == NULL) {
+			EC_LOG(EC_LOG_ERR, "Cannot find type %s\n", str);
+			errno = ENOENT;
+			goto fail;
+		}
+		id = EC_NO_ID;
+		if (r.nodes[i].id != SNAP_NONE) {
+			id = snap_string(&r, r.nodes[i].id);
+			if (id == NULL)
+				goto fail;
+		}
+		r.enodes[i] = ec_node_from_type(type, id);
+		if (r.enodes[i] == NULL)
+			goto fail;
+	}
+
+	for (i = 0; i < r.hdr->nodes_len; i++) {
+		if (r.nodes[i].config != SNAP_NONE) {
+			if (r.nodes[i].config >= r.hdr->configs_len) {
+				errno = EINVAL;
+				goto fail;
+			}
+			config = snap_read_config(&r, r.nodes[i].config, 0);
+			if (config == NULL)
+				goto fail;
+			if (ec_node_set_config(r.enodes[i], config) < 0) {
+				EC_LOG(EC_LOG_ERR,
+				       "Failed to set config of node %s\n",
+				       ec_node_get_type_name(r.enodes[i]));
+				goto fail;
+			}
+		}
+		if (snap_read_attrs(&r, &r.nodes[i], r.enodes[i]) < 0)
+			goto fail;
+	}
+
+	root = ec_node_clone(r.enodes[r.hdr->root]);
+
+fail:
+	for (i = 0; i < r.hdr->nodes_len; i++)
+		ec_node_free(r.enodes[i]);
+	free(r.enodes);
+	free(r.configs_read);
+	return root;
+}
+
+struct ec_node *ec_snapshot_import(const char *filename)
+{
+	struct ec_node *root = NULL;
+	void *buf = MAP_FAILED;
+	struct stat st;
+	int fd;
+
+	fd = open(filename, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return NULL;
+
+	if (fstat(fd, &st) < 0)
+		goto out;
+	if (st.st_size == 0) {
+		errno = EINVAL;
+		goto out;
+	}
+
+	buf = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (buf == MAP_FAILED)
+		goto out;
+
+	root = ec_snapshot_import_mem(buf, st.st_size);
+
+out:
+	if (buf != MAP_FAILED)
+		munmap(buf, st.st_size);
+	close(fd);
+	return root;
+}
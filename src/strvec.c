@@ -16,6 +16,8 @@
 #include <ecoli/string.h>
 #include <ecoli/strvec.h>
 
+#include "strvec_private.h"
+
 EC_LOG_TYPE_REGISTER(strvec);
 
 struct ec_strvec_elt {
@@ -40,7 +42,7 @@ struct ec_strvec *ec_strvec(void)
 	return strvec;
 }
 
-static struct ec_strvec_elt *__ec_strvec_elt(const char *s)
+static struct ec_strvec_elt *__ec_strvec_elt_len(const char *s, size_t len)
 {
 	struct ec_strvec_elt *elt;
 
@@ -48,7 +50,7 @@ static struct ec_strvec_elt *__ec_strvec_elt(const char *s)
 	if (elt == NULL)
 		return NULL;
 
-	elt->str = strdup(s);
+	elt->str = strndup(s, len);
 	if (elt->str == NULL) {
 		free(elt);
 		return NULL;
@@ -58,6 +60,11 @@ static struct ec_strvec_elt *__ec_strvec_elt(const char *s)
 	return elt;
 }
 
+static struct ec_strvec_elt *__ec_strvec_elt(const char *s)
+{
+	return __ec_strvec_elt_len(s, strlen(s));
+}
+
 static void __ec_strvec_elt_free(struct ec_strvec_elt *elt)
 {
 	elt->refcnt--;
@@ -88,28 +95,44 @@ int ec_strvec_set(struct ec_strvec *strvec, size_t idx, const char *s)
 }
 
 int ec_strvec_add(struct ec_strvec *strvec, const char *s)
+{
+	if (s == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	return ec_strvec_add_token(strvec, s, strlen(s), NULL);
+}
+
+int ec_strvec_add_token(struct ec_strvec *strvec, const char *s, size_t len, struct ec_dict *attrs)
 {
 	struct ec_strvec_elt *elt, **new_vec;
 
 	if (strvec == NULL || s == NULL) {
 		errno = EINVAL;
-		return -1;
+		goto fail;
 	}
 
 	new_vec = realloc(strvec->vec, sizeof(*strvec->vec) * (strvec->len + 1));
 	if (new_vec == NULL)
-		return -1;
+		goto fail;
 
 	strvec->vec = new_vec;
 
-	elt = __ec_strvec_elt(s);
+	elt = __ec_strvec_elt_len(s, len);
 	if (elt == NULL)
-		return -1;
+		goto fail;
+	elt->attrs = attrs;
 
 	new_vec[strvec->len] = elt;
 	strvec->len++;
 
 	return 0;
+
+fail:
+	if (attrs != NULL)
+		ec_dict_free(attrs);
+	return -1;
 }
 
 struct ec_strvec *ec_strvec_from_array(const char *const *strarr, size_t n)
@@ -0,0 +1,17 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2025, Olivier MATZ <zer0@droids-corp.org>
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+#include <ecoli/dict.h>
+#include <ecoli/strvec.h>
+
+/*
+ * Append the first len bytes of s to the vector, with optional attributes
+ * (they are freed on error, like in ec_strvec_set_attrs()). Return -1 on
+ * error (errno is set).
+ */
+int ec_strvec_add_token(struct ec_strvec *strvec, const char *s, size_t len, struct ec_dict *attrs);
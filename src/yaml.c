@@ -3,10 +3,12 @@
  */
 
 #include <errno.h>
+#include <fcntl.h>
 #include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include <yaml.h>
 
@@ -17,33 +19,43 @@
 #include <ecoli/string.h>
 #include <ecoli/yaml.h>
 
-/* associate a yaml node to a ecoli node */
-struct pair {
-	const yaml_node_t *ynode;
-	struct ec_node *enode;
+#include "node_private.h"
+
+/*
+ * The document is imported from the events of the yaml parser, without
+ * loading it in memory: a node is created as soon as its type is known,
+ * and configured at the end of its mapping.
+ *
+ * An event is either a yaml event, or an ecoli node already built from
+ * the events of a mapping. This is how an alias to a node is replayed.
+ */
+struct yevent {
+	yaml_event_t ev;
+	struct ec_node *node;
 };
 
-/* store the associations yaml_node <-> ec_node */
-struct enode_table {
-	struct pair *pair;
+/* a list of events, also used as a stack */
+struct yevent_list {
+	struct yevent *ev;
 	size_t len;
+	size_t size;
 };
 
-static struct ec_node *
-parse_ec_node(struct enode_table *table, const yaml_document_t *document, const yaml_node_t *ynode);
-
-static struct ec_config *parse_ec_config_list(
-	struct enode_table *table,
-	const struct ec_config_schema *schema,
-	const yaml_document_t *document,
-	const yaml_node_t *ynode
-);
+struct yaml_importer {
+	yaml_parser_t parser;
+	/* events pushed back, read before the ones of the parser (stack) */
+	struct yevent_list pending;
+	/* anchor name -> struct yevent_list containing the anchored value */
+	struct ec_dict *anchors;
+	/* anchored values being read, recording their events */
+	struct yevent_list *recorders;
+	size_t recorders_len;
+};
 
-static struct ec_config *parse_ec_config_dict(
-	struct enode_table *table,
-	const struct ec_config_schema *schema,
-	const yaml_document_t *document,
-	const yaml_node_t *ynode
+static struct ec_config *parse_ec_config(
+	struct yaml_importer *imp,
+	const struct ec_config_schema *schema_elt,
+	struct yevent *ev
 );
 
 /* XXX to utils.c ? */
@@ -116,170 +128,359 @@ static int parse_bool(const char *str, bool *val)
 	return -1;
 }
 
-static int add_in_table(struct enode_table *table, const yaml_node_t *ynode, struct ec_node *enode)
+static bool is_event(const struct yevent *ev, yaml_event_type_t type)
 {
-	struct pair *pair = NULL;
+	return ev->node == NULL && ev->ev.type == type;
+}
+
+static void yevent_free(struct yevent *ev)
+{
+	if (ev->node != NULL)
+		ec_node_free(ev->node);
+	else
+		yaml_event_delete(&ev->ev);
+	memset(ev, 0, sizeof(*ev));
+}
 
-	pair = realloc(table->pair, (table->len + 1) * sizeof(*pair));
-	if (pair == NULL)
+/* Copy an event, without its anchor: a replayed value does not define it again. */
+static int yevent_copy(struct yevent *dst, const struct yevent *src)
+{
+	const yaml_event_t *ev = &src->ev;
+	int ret;
+
+	memset(dst, 0, sizeof(*dst));
+	if (src->node != NULL) {
+		dst->node = ec_node_clone(src->node);
+		return 0;
+	}
+
+	switch (ev->type) {
+	case YAML_SCALAR_EVENT:
+		ret = yaml_scalar_event_initialize(
+			&dst->ev,
+			NULL,
+			ev->data.scalar.tag,
+			ev->data.scalar.value,
+			ev->data.scalar.length,
+			ev->data.scalar.plain_implicit,
+			ev->data.scalar.quoted_implicit,
+			ev->data.scalar.style
+		);
+		break;
+	case YAML_SEQUENCE_START_EVENT:
+		ret = yaml_sequence_start_event_initialize(
+			&dst->ev,
+			NULL,
+			ev->data.sequence_start.tag,
+			ev->data.sequence_start.implicit,
+			ev->data.sequence_start.style
+		);
+		break;
+	case YAML_SEQUENCE_END_EVENT:
+		ret = yaml_sequence_end_event_initialize(&dst->ev);
+		break;
+	case YAML_MAPPING_START_EVENT:
+		ret = yaml_mapping_start_event_initialize(
+			&dst->ev,
+			NULL,
+			ev->data.mapping_start.tag,
+			ev->data.mapping_start.implicit,
+			ev->data.mapping_start.style
+		);
+		break;
+	case YAML_MAPPING_END_EVENT:
+		ret = yaml_mapping_end_event_initialize(&dst->ev);
+		break;
+	default:
+		errno = EINVAL;
 		return -1;
+	}
+	if (ret == 0) {
+		errno = ENOMEM;
+		return -1;
+	}
 
-	ec_node_clone(enode);
-	pair[table->len].ynode = ynode;
-	pair[table->len].enode = enode;
-	table->pair = pair;
-	table->len++;
+	return 0;
+}
+
+/* Append an event to the list. On success, the list takes its ownership. */
+static int yevent_list_push(struct yevent_list *list, struct yevent *ev)
+{
+	struct yevent *tmp;
+	size_t size;
+
+	if (list->len == list->size) {
+		size = list->size * 2 + 16;
+		tmp = realloc(list->ev, size * sizeof(*tmp));
+		if (tmp == NULL)
+			return -1;
+		list->ev = tmp;
+		list->size = size;
+	}
+	list->ev[list->len++] = *ev;
+	memset(ev, 0, sizeof(*ev));
 
 	return 0;
 }
 
-static void free_table(struct enode_table *table)
+static void yevent_list_truncate(struct yevent_list *list, size_t len)
 {
-	size_t i;
+	while (list->len > len)
+		yevent_free(&list->ev[--list->len]);
+}
+
+static void yevent_list_free(void *ptr)
+{
+	struct yevent_list *list = ptr;
 
-	for (i = 0; i < table->len; i++)
-		ec_node_free(table->pair[i].enode);
-	free(table->pair);
+	yevent_list_truncate(list, 0);
+	free(list->ev);
+	memset(list, 0, sizeof(*list));
 }
 
-static struct ec_config *parse_ec_config(
-	struct enode_table *table,
-	const struct ec_config_schema *schema_elt,
-	const yaml_document_t *document,
-	const yaml_node_t *ynode
-)
+static void free_anchor(void *ptr)
 {
-	const struct ec_config_schema *subschema;
-	struct ec_config *config = NULL;
-	struct ec_node *enode = NULL;
-	enum ec_config_type type;
-	const char *value_str;
-	uint64_t u64;
-	int64_t i64;
-	bool boolean;
+	yevent_list_free(ptr);
+	free(ptr);
+}
 
-	type = ec_config_schema_type(schema_elt);
+/* Push back the events of a list, so that they are read again in order. */
+static int push_back(struct yaml_importer *imp, struct yevent_list *list)
+{
+	size_t i;
 
-	switch (type) {
-	case EC_CONFIG_TYPE_BOOL:
-		if (ynode->type != YAML_SCALAR_NODE) {
-			fprintf(stderr, "Boolean should be scalar\n");
-			goto fail;
-		}
-		value_str = (const char *)ynode->data.scalar.value;
-		if (parse_bool(value_str, &boolean) < 0) {
-			fprintf(stderr, "Failed to parse boolean\n");
-			goto fail;
-		}
-		config = ec_config_bool(boolean);
-		if (config == NULL) {
-			fprintf(stderr, "Failed to create config\n");
-			goto fail;
-		}
-		break;
-	case EC_CONFIG_TYPE_INT64:
-		if (ynode->type != YAML_SCALAR_NODE) {
-			fprintf(stderr, "Int64 should be scalar\n");
-			goto fail;
-		}
-		value_str = (const char *)ynode->data.scalar.value;
-		if (parse_llint(value_str, &i64) < 0) {
-			fprintf(stderr, "Failed to parse i64\n");
-			goto fail;
-		}
-		config = ec_config_i64(i64);
-		if (config == NULL) {
-			fprintf(stderr, "Failed to create config\n");
-			goto fail;
-		}
-		break;
-	case EC_CONFIG_TYPE_UINT64:
-		if (ynode->type != YAML_SCALAR_NODE) {
-			fprintf(stderr, "Uint64 should be scalar\n");
-			goto fail;
-		}
-		value_str = (const char *)ynode->data.scalar.value;
-		if (parse_ullint(value_str, &u64) < 0) {
-			fprintf(stderr, "Failed to parse u64\n");
-			goto fail;
-		}
-		config = ec_config_u64(u64);
-		if (config == NULL) {
-			fprintf(stderr, "Failed to create config\n");
-			goto fail;
-		}
-		break;
-	case EC_CONFIG_TYPE_STRING:
-		if (ynode->type != YAML_SCALAR_NODE) {
-			fprintf(stderr, "String should be scalar\n");
-			goto fail;
+	for (i = list->len; i > 0; i--) {
+		if (yevent_list_push(&imp->pending, &list->ev[i - 1]) < 0) {
+			list->len = i;
+			return -1;
 		}
-		value_str = (const char *)ynode->data.scalar.value;
-		config = ec_config_string(value_str);
-		if (config == NULL) {
-			fprintf(stderr, "Failed to create config\n");
-			goto fail;
+	}
+	list->len = 0;
+
+	return 0;
+}
+
+/* Same as push_back(), but keep the list untouched. */
+static int push_back_copy(struct yaml_importer *imp, const struct yevent_list *list)
+{
+	struct yevent ev;
+	size_t i;
+
+	for (i = list->len; i > 0; i--) {
+		if (yevent_copy(&ev, &list->ev[i - 1]) < 0)
+			return -1;
+		if (yevent_list_push(&imp->pending, &ev) < 0) {
+			yevent_free(&ev);
+			return -1;
 		}
-		break;
-	case EC_CONFIG_TYPE_NODE:
-		enode = parse_ec_node(table, document, ynode);
-		if (enode == NULL)
+	}
+
+	return 0;
+}
+
+/* Read the next event, and record it in the anchored values being read. */
+static int next_event(struct yaml_importer *imp, struct yevent *ev)
+{
+	struct yevent copy;
+	size_t i;
+
+	memset(ev, 0, sizeof(*ev));
+	if (imp->pending.len > 0) {
+		*ev = imp->pending.ev[--imp->pending.len];
+	} else if (yaml_parser_parse(&imp->parser, &ev->ev) == 0) {
+		fprintf(stderr,
+			"Failed to parse yaml: %s (line %zu)\n",
+			imp->parser.problem != NULL ? imp->parser.problem : "unknown error",
+			imp->parser.problem_mark.line + 1);
+		errno = EINVAL;
+		return -1;
+	}
+
+	/* aliases are recorded once replaced by the anchored value */
+	if (is_event(ev, YAML_ALIAS_EVENT))
+		return 0;
+
+	for (i = 0; i < imp->recorders_len; i++) {
+		if (yevent_copy(&copy, ev) < 0)
 			goto fail;
-		config = ec_config_node(enode);
-		enode = NULL;
-		if (config == NULL) {
-			fprintf(stderr, "Failed to create config\n");
+		if (yevent_list_push(&imp->recorders[i], &copy) < 0) {
+			yevent_free(&copy);
 			goto fail;
 		}
-		break;
-	case EC_CONFIG_TYPE_LIST:
-		subschema = ec_config_schema_sub(schema_elt);
-		if (subschema == NULL) {
-			fprintf(stderr, "List has no subschema\n");
-			goto fail;
+	}
+
+	return 0;
+
+fail:
+	yevent_free(ev);
+	return -1;
+}
+
+/* Read the next event, replacing an alias by the events of its anchor. */
+static int next_value(struct yaml_importer *imp, struct yevent *ev)
+{
+	const struct yevent_list *anchor;
+
+	for (;;) {
+		if (next_event(imp, ev) < 0)
+			return -1;
+		if (!is_event(ev, YAML_ALIAS_EVENT))
+			return 0;
+
+		anchor = ec_dict_get(imp->anchors, (const char *)ev->ev.data.alias.anchor);
+		if (anchor == NULL) {
+			fprintf(stderr, "Unknown anchor %s\n", ev->ev.data.alias.anchor);
+			yevent_free(ev);
+			errno = EINVAL;
+			return -1;
 		}
-		config = parse_ec_config_list(table, subschema, document, ynode);
-		if (config == NULL)
-			goto fail;
-		break;
-	case EC_CONFIG_TYPE_DICT:
-		subschema = ec_config_schema_sub(schema_elt);
-		if (subschema == NULL) {
-			fprintf(stderr, "Dict has no subschema\n");
-			goto fail;
+		yevent_free(ev);
+		if (push_back_copy(imp, anchor) < 0)
+			return -1;
+	}
+}
+
+/*
+ * Read the events of the value starting with ev, without interpreting
+ * them. They are appended to the list if it is not NULL, else they are
+ * dropped. In both cases, ev is consumed.
+ */
+static int read_raw_value(struct yaml_importer *imp, struct yevent *ev, struct yevent_list *list)
+{
+	size_t depth = 0;
+
+	for (;;) {
+		if (is_event(ev, YAML_SEQUENCE_START_EVENT)
+		    || is_event(ev, YAML_MAPPING_START_EVENT))
+			depth++;
+		else if (is_event(ev, YAML_SEQUENCE_END_EVENT)
+			 || is_event(ev, YAML_MAPPING_END_EVENT))
+			depth--;
+
+		if (list == NULL) {
+			yevent_free(ev);
+		} else if (yevent_list_push(list, ev) < 0) {
+			yevent_free(ev);
+			return -1;
 		}
-		config = parse_ec_config_dict(table, subschema, document, ynode);
-		if (config == NULL)
-			goto fail;
-		break;
+		if (depth == 0)
+			return 0;
+		if (next_event(imp, ev) < 0)
+			return -1;
+	}
+}
+
+static const char *event_anchor(const struct yevent *ev)
+{
+	if (ev->node != NULL)
+		return NULL;
+
+	switch (ev->ev.type) {
+	case YAML_SCALAR_EVENT:
+		return (const char *)ev->ev.data.scalar.anchor;
+	case YAML_SEQUENCE_START_EVENT:
+		return (const char *)ev->ev.data.sequence_start.anchor;
+	case YAML_MAPPING_START_EVENT:
+		return (const char *)ev->ev.data.mapping_start.anchor;
 	default:
-		fprintf(stderr, "Invalid config type %d\n", type);
-		goto fail;
+		return NULL;
 	}
+}
 
-	return config;
+/* Define an anchor, taking the ownership of the events of the list. */
+static int set_anchor(struct yaml_importer *imp, const char *name, struct yevent_list *list)
+{
+	struct yevent_list *anchor;
 
-fail:
-	ec_node_free(enode);
-	ec_config_free(config);
-	return NULL;
+	anchor = malloc(sizeof(*anchor));
+	if (anchor == NULL) {
+		yevent_list_free(list);
+		return -1;
+	}
+	*anchor = *list;
+	memset(list, 0, sizeof(*list));
+
+	return ec_dict_set(imp->anchors, name, anchor, free_anchor);
+}
+
+static int set_node_anchor(struct yaml_importer *imp, const char *name, struct ec_node *enode)
+{
+	struct yevent_list list = {0};
+	struct yevent ev = {0};
+
+	ev.node = ec_node_clone(enode);
+	if (yevent_list_push(&list, &ev) < 0) {
+		yevent_free(&ev);
+		return -1;
+	}
+
+	return set_anchor(imp, name, &list);
+}
+
+/* Start recording the events of an anchored value, beginning with ev. */
+static int start_recording(struct yaml_importer *imp, const struct yevent *ev)
+{
+	struct yevent_list *recorders;
+	struct yevent copy;
+
+	recorders = realloc(
+		imp->recorders, (imp->recorders_len + 1) * sizeof(*imp->recorders)
+	);
+	if (recorders == NULL)
+		return -1;
+	imp->recorders = recorders;
+	memset(&recorders[imp->recorders_len], 0, sizeof(*recorders));
+
+	if (yevent_copy(&copy, ev) < 0)
+		return -1;
+	if (yevent_list_push(&recorders[imp->recorders_len], &copy) < 0) {
+		yevent_free(&copy);
+		return -1;
+	}
+	imp->recorders_len++;
+
+	return 0;
+}
+
+static void stop_recording(struct yaml_importer *imp, struct yevent_list *list)
+{
+	*list = imp->recorders[--imp->recorders_len];
+}
+
+/*
+ * In the anchored values being read, replace the events of a node by
+ * the node itself, so that an alias to one of these values references
+ * the same node. Return -1 on error (errno is set).
+ */
+static int record_node(struct yaml_importer *imp, size_t start, struct ec_node *enode)
+{
+	struct yevent ev;
+	size_t i, n;
+
+	if (imp->recorders_len == 0)
+		return 0;
+
+	n = imp->recorders[imp->recorders_len - 1].len - start;
+	for (i = 0; i < imp->recorders_len; i++) {
+		yevent_list_truncate(&imp->recorders[i], imp->recorders[i].len - n);
+		memset(&ev, 0, sizeof(ev));
+		ev.node = ec_node_clone(enode);
+		if (yevent_list_push(&imp->recorders[i], &ev) < 0) {
+			yevent_free(&ev);
+			return -1;
+		}
+	}
+
+	return 0;
 }
 
 static struct ec_config *parse_ec_config_list(
-	struct enode_table *table,
-	const struct ec_config_schema *schema,
-	const yaml_document_t *document,
-	const yaml_node_t *ynode
+	struct yaml_importer *imp,
+	const struct ec_config_schema *schema
 )
 {
 	struct ec_config *config = NULL, *subconfig = NULL;
-	const yaml_node_item_t *item;
-	const yaml_node_t *value;
-
-	if (ynode->type != YAML_SEQUENCE_NODE) {
-		fprintf(stderr, "Ecoli list config should be a yaml sequence\n");
-		goto fail;
-	}
+	struct yevent ev;
 
 	config = ec_config_list();
 	if (config == NULL) {
@@ -287,10 +488,14 @@ static struct ec_config *parse_ec_config_list(
 		goto fail;
 	}
 
-	for (item = ynode->data.sequence.items.start; item < ynode->data.sequence.items.top;
-	     item++) {
-		value = document->nodes.start + (*item) - 1; /* XXX -1 ? */
-		subconfig = parse_ec_config(table, schema, document, value);
+	for (;;) {
+		if (next_value(imp, &ev) < 0)
+			goto fail;
+		if (is_event(&ev, YAML_SEQUENCE_END_EVENT)) {
+			yevent_free(&ev);
+			break;
+		}
+		subconfig = parse_ec_config(imp, schema, &ev);
 		if (subconfig == NULL)
 			goto fail;
 		if (ec_config_list_add(config, subconfig) < 0) {
@@ -307,96 +512,182 @@ fail:
 }
 
 static struct ec_config *parse_ec_config_dict(
-	struct enode_table *table,
-	const struct ec_config_schema *schema,
-	const yaml_document_t *document,
-	const yaml_node_t *ynode
+	struct yaml_importer *imp,
+	const struct ec_config_schema *schema
 )
 {
 	const struct ec_config_schema *schema_elt;
 	struct ec_config *config = NULL, *subconfig = NULL;
-	const yaml_node_t *key, *value;
-	const yaml_node_pair_t *pair;
+	struct yevent key = {0}, value;
 	const char *key_str;
 
-	if (ynode->type != YAML_MAPPING_NODE) {
-		fprintf(stderr, "Ecoli config should be a yaml mapping node\n");
-		goto fail;
-	}
-
 	config = ec_config_dict();
 	if (config == NULL) {
 		fprintf(stderr, "Failed to allocate config\n");
 		goto fail;
 	}
 
-	for (pair = ynode->data.mapping.pairs.start; pair < ynode->data.mapping.pairs.top; pair++) {
-		key = document->nodes.start + pair->key - 1; /* XXX -1 ? */
-		value = document->nodes.start + pair->value - 1;
-		key_str = (const char *)key->data.scalar.value;
+	for (;;) {
+		if (next_value(imp, &key) < 0)
+			goto fail;
+		if (is_event(&key, YAML_MAPPING_END_EVENT)) {
+			yevent_free(&key);
+			break;
+		}
+		if (!is_event(&key, YAML_SCALAR_EVENT)) {
+			fprintf(stderr, "Config key should be a scalar\n");
+			goto fail;
+		}
+		key_str = (const char *)key.ev.data.scalar.value;
 
-		if (ec_config_key_is_reserved(key_str))
+		if (next_value(imp, &value) < 0)
+			goto fail;
+		if (ec_config_key_is_reserved(key_str)) {
+			if (read_raw_value(imp, &value, NULL) < 0)
+				goto fail;
+			yevent_free(&key);
 			continue;
+		}
 		schema_elt = ec_config_schema_lookup(schema, key_str);
 		if (schema_elt == NULL) {
 			fprintf(stderr, "No such config %s\n", key_str);
+			yevent_free(&value);
 			goto fail;
 		}
-		subconfig = parse_ec_config(table, schema_elt, document, value);
+		subconfig = parse_ec_config(imp, schema_elt, &value);
 		if (subconfig == NULL)
 			goto fail;
 		if (ec_config_dict_set(config, key_str, subconfig) < 0) {
 			fprintf(stderr, "Failed to set dict entry\n");
 			goto fail;
 		}
+		yevent_free(&key);
 	}
 
 	return config;
 
 fail:
+	yevent_free(&key);
 	ec_config_free(config);
 	return NULL;
 }
 
-static struct ec_node *
-parse_ec_node(struct enode_table *table, const yaml_document_t *document, const yaml_node_t *ynode)
+static int parse_attrs(struct yaml_importer *imp, struct ec_node *enode)
 {
-	const struct ec_config_schema *schema;
+	struct yevent key = {0}, value = {0};
+	char *value_dup = NULL;
+
+	for (;;) {
+		if (next_value(imp, &key) < 0)
+			goto fail;
+		if (is_event(&key, YAML_MAPPING_END_EVENT)) {
+			yevent_free(&key);
+			break;
+		}
+		if (next_value(imp, &value) < 0)
+			goto fail;
+		if (!is_event(&key, YAML_SCALAR_EVENT) || !is_event(&value, YAML_SCALAR_EVENT)) {
+			fprintf(stderr, "Attributes should be scalars\n");
+			goto fail;
+		}
+		value_dup = strdup((const char *)value.ev.data.scalar.value);
+		if (value_dup == NULL)
+			goto fail;
+		if (ec_dict_set(
+			    ec_node_attrs(enode),
+			    (const char *)key.ev.data.scalar.value,
+			    value_dup,
+			    free
+		    )
+		    < 0)
+			goto fail;
+		yevent_free(&key);
+		yevent_free(&value);
+	}
+
+	return 0;
+
+fail:
+	yevent_free(&key);
+	yevent_free(&value);
+	return -1;
+}
+
+/*
+ * Parse a node from its mapping, starting with the ev event (consumed).
+ * The keys preceding the type are stored, and read again once the node
+ * is created.
+ */
+static struct ec_node *parse_ec_node(struct yaml_importer *imp, struct yevent *ev)
+{
+	const struct ec_config_schema *schema = NULL, *schema_elt;
 	const struct ec_node_type *type = NULL;
-	const char *id = NULL;
-	char *help = NULL;
-	struct ec_config *config = NULL;
-	const yaml_node_t *attrs = NULL;
-	const yaml_node_t *key, *value;
-	const yaml_node_pair_t *pair;
+	struct yevent_list buffer = {0};
+	struct yevent key = {0}, value = {0};
+	struct ec_config *config = NULL, *subconfig;
+	bool has_id = false, has_help = false, has_attrs = false;
 	const char *key_str, *value_str;
 	struct ec_node *enode = NULL;
-	char *value_dup = NULL;
-	size_t i;
+	char *anchor = NULL;
+	char *help = NULL;
+	size_t start = 0;
+
+	/* an alias to a node that is already built */
+	if (ev->node != NULL) {
+		enode = ev->node;
+		ev->node = NULL;
+		return enode;
+	}
 
-	if (ynode->type != YAML_MAPPING_NODE) {
+	if (!is_event(ev, YAML_MAPPING_START_EVENT)) {
 		fprintf(stderr, "Ecoli node should be a yaml mapping node\n");
 		goto fail;
 	}
-
-	/* if it's an anchor, the node may be already parsed, reuse it */
-	for (i = 0; i < table->len; i++) {
-		if (table->pair[i].ynode == ynode)
-			return ec_node_clone(table->pair[i].enode);
+	if (event_anchor(ev) != NULL) {
+		anchor = strdup(event_anchor(ev));
+		if (anchor == NULL)
+			goto fail;
 	}
+	yevent_free(ev);
+	if (imp->recorders_len > 0)
+		start = imp->recorders[imp->recorders_len - 1].len - 1;
+
+	for (;;) {
+		if (next_value(imp, &key) < 0)
+			goto fail;
+		if (is_event(&key, YAML_MAPPING_END_EVENT)) {
+			yevent_free(&key);
+			break;
+		}
+		if (!is_event(&key, YAML_SCALAR_EVENT)) {
+			fprintf(stderr, "Ecoli node key should be a scalar\n");
+			goto fail;
+		}
+		key_str = (const char *)key.ev.data.scalar.value;
+
+		/* the node cannot be created before its type is known */
+		if (enode == NULL && strcmp(key_str, "type")) {
+			if (yevent_list_push(&buffer, &key) < 0)
+				goto fail;
+			if (next_event(imp, &value) < 0)
+				goto fail;
+			if (read_raw_value(imp, &value, &buffer) < 0)
+				goto fail;
+			continue;
+		}
 
-	for (pair = ynode->data.mapping.pairs.start; pair < ynode->data.mapping.pairs.top; pair++) {
-		key = document->nodes.start + pair->key - 1; /* XXX -1 ? */
-		value = document->nodes.start + pair->value - 1;
-		key_str = (const char *)key->data.scalar.value;
-		value_str = (const char *)value->data.scalar.value;
+		if (next_value(imp, &value) < 0)
+			goto fail;
+		value_str = NULL;
+		if (is_event(&value, YAML_SCALAR_EVENT))
+			value_str = (const char *)value.ev.data.scalar.value;
 
 		if (!strcmp(key_str, "type")) {
 			if (type != NULL) {
 				fprintf(stderr, "Duplicate type\n");
 				goto fail;
 			}
-			if (value->type != YAML_SCALAR_NODE) {
+			if (value_str == NULL) {
 				fprintf(stderr, "Type must be a string\n");
 				goto fail;
 			}
@@ -405,178 +696,431 @@ parse_ec_node(struct enode_table *table, const yaml_document_t *document, const
 				fprintf(stderr, "Cannot find type %s\n", value_str);
 				goto fail;
 			}
+			schema = ec_node_type_schema(type);
+			if (schema == NULL) {
+				fprintf(stderr,
+					"No configuration schema for type %s\n",
+					ec_node_type_name(type));
+				goto fail;
+			}
+			enode = ec_node_from_type(type, EC_NO_ID);
+			if (enode == NULL) {
+				fprintf(stderr, "Cannot create ecoli node\n");
+				goto fail;
+			}
+			config = ec_config_dict();
+			if (config == NULL) {
+				fprintf(stderr, "Failed to allocate config\n");
+				goto fail;
+			}
+			/* the anchor is usable in the config, to create loops */
+			if (anchor != NULL && set_node_anchor(imp, anchor, enode) < 0)
+				goto fail;
+			if (push_back(imp, &buffer) < 0)
+				goto fail;
 		} else if (!strcmp(key_str, "attrs")) {
-			if (attrs != NULL) {
+			if (has_attrs) {
 				fprintf(stderr, "Duplicate attrs\n");
 				goto fail;
 			}
-			if (value->type != YAML_MAPPING_NODE) {
+			if (!is_event(&value, YAML_MAPPING_START_EVENT)) {
 				fprintf(stderr, "Attrs must be a mapping\n");
 				goto fail;
 			}
-			attrs = value;
+			has_attrs = true;
+			if (parse_attrs(imp, enode) < 0)
+				goto fail;
 		} else if (!strcmp(key_str, "id")) {
-			if (id != NULL) {
+			if (has_id) {
 				fprintf(stderr, "Duplicate id\n");
 				goto fail;
 			}
-			if (value->type != YAML_SCALAR_NODE) {
+			if (value_str == NULL) {
 				fprintf(stderr, "Id must be a scalar\n");
 				goto fail;
 			}
-			id = value_str;
+			has_id = true;
+			if (ec_node_set_id(enode, value_str) < 0)
+				goto fail;
 		} else if (!strcmp(key_str, "help")) {
-			if (help != NULL) {
+			if (has_help) {
 				fprintf(stderr, "Duplicate help\n");
 				goto fail;
 			}
-			if (value->type != YAML_SCALAR_NODE) {
+			if (value_str == NULL) {
 				fprintf(stderr, "Help must be a scalar\n");
 				goto fail;
 			}
+			has_help = true;
 			help = strdup(value_str);
 			if (help == NULL) {
 				fprintf(stderr, "Failed to allocate help\n");
 				goto fail;
 			}
+			if (ec_dict_set(ec_node_attrs(enode), EC_INTERACT_HELP_ATTR, help, free)
+			    < 0) {
+				fprintf(stderr, "Failed to set help\n");
+				goto fail;
+			}
+		} else {
+			schema_elt = ec_config_schema_lookup(schema, key_str);
+			if (schema_elt == NULL) {
+				fprintf(stderr, "No such config %s\n", key_str);
+				goto fail;
+			}
+			subconfig = parse_ec_config(imp, schema_elt, &value);
+			if (subconfig == NULL)
+				goto fail;
+			if (ec_config_dict_set(config, key_str, subconfig) < 0) {
+				fprintf(stderr, "Failed to set dict entry\n");
+				goto fail;
+			}
 		}
+		yevent_free(&key);
+		yevent_free(&value);
 	}
 
-	/* create the ecoli node */
-	if (id == NULL)
-		id = EC_NO_ID;
-	enode = ec_node_from_type(type, id);
 	if (enode == NULL) {
-		fprintf(stderr, "Cannot create ecoli node\n");
+		fprintf(stderr, "Missing node type\n");
 		goto fail;
 	}
-	if (add_in_table(table, ynode, enode) < 0) {
-		fprintf(stderr, "Cannot add node in table\n");
+
+	if (ec_node_set_config(enode, config) < 0) {
+		config = NULL; /* freed */
+		fprintf(stderr, "Failed to set config\n");
 		goto fail;
 	}
+	config = NULL; /* freed */
 
-	/* create its config */
-	schema = ec_node_type_schema(type);
-	if (schema == NULL) {
-		fprintf(stderr, "No configuration schema for type %s\n", ec_node_type_name(type));
+	if (record_node(imp, start, enode) < 0)
 		goto fail;
+
+	yevent_list_free(&buffer);
+	free(anchor);
+	return enode;
+
+fail:
+	if (errno == 0)
+		errno = EINVAL;
+	yevent_free(ev);
+	yevent_free(&key);
+	yevent_free(&value);
+	yevent_list_free(&buffer);
+	ec_config_free(config);
+	ec_node_free(enode);
+	free(anchor);
+
+	return NULL;
+}
+
+/* Parse a config value, starting with the ev event (consumed). */
+static struct ec_config *parse_ec_config(
+	struct yaml_importer *imp,
+	const struct ec_config_schema *schema_elt,
+	struct yevent *ev
+)
+{
+	const struct ec_config_schema *subschema;
+	struct yevent_list recorded = {0};
+	struct ec_config *config = NULL;
+	struct ec_node *enode = NULL;
+	enum ec_config_type type;
+	const char *value_str = NULL;
+	char *anchor = NULL;
+	bool recording = false;
+	uint64_t u64;
+	int64_t i64;
+	bool boolean;
+
+	type = ec_config_schema_type(schema_elt);
+
+	if (type == EC_CONFIG_TYPE_NODE) {
+		enode = parse_ec_node(imp, ev);
+		if (enode == NULL)
+			goto fail;
+		config = ec_config_node(enode);
+		if (config == NULL) {
+			fprintf(stderr, "Failed to create config\n");
+			goto fail;
+		}
+		return config;
 	}
 
-	config = parse_ec_config_dict(table, schema, document, ynode);
-	if (config == NULL)
+	if (ev->node != NULL) {
+		fprintf(stderr, "Unexpected alias to an ecoli node\n");
 		goto fail;
+	}
+	if (is_event(ev, YAML_SCALAR_EVENT))
+		value_str = (const char *)ev->ev.data.scalar.value;
 
-	if (ec_node_set_config(enode, config) < 0) {
-		config = NULL; /* freed */
-		fprintf(stderr, "Failed to set config\n");
-		goto fail;
+	/* the events of an anchored value are kept to replay its aliases */
+	if (event_anchor(ev) != NULL) {
+		anchor = strdup(event_anchor(ev));
+		if (anchor == NULL)
+			goto fail;
+		if (start_recording(imp, ev) < 0)
+			goto fail;
+		recording = true;
 	}
-	config = NULL; /* freed */
 
-	if (help != NULL) {
-		if (ec_dict_set(ec_node_attrs(enode), EC_INTERACT_HELP_ATTR, help, free) < 0) {
-			fprintf(stderr, "Failed to set help\n");
-			help = NULL;
+	switch (type) {
+	case EC_CONFIG_TYPE_BOOL:
+		if (value_str == NULL) {
+			fprintf(stderr, "Boolean should be scalar\n");
+			goto fail;
+		}
+		if (parse_bool(value_str, &boolean) < 0) {
+			fprintf(stderr, "Failed to parse boolean\n");
+			goto fail;
+		}
+		config = ec_config_bool(boolean);
+		if (config == NULL) {
+			fprintf(stderr, "Failed to create config\n");
+			goto fail;
+		}
+		break;
+	case EC_CONFIG_TYPE_INT64:
+		if (value_str == NULL) {
+			fprintf(stderr, "Int64 should be scalar\n");
+			goto fail;
+		}
+		if (parse_llint(value_str, &i64) < 0) {
+			fprintf(stderr, "Failed to parse i64\n");
+			goto fail;
+		}
+		config = ec_config_i64(i64);
+		if (config == NULL) {
+			fprintf(stderr, "Failed to create config\n");
+			goto fail;
+		}
+		break;
+	case EC_CONFIG_TYPE_UINT64:
+		if (value_str == NULL) {
+			fprintf(stderr, "Uint64 should be scalar\n");
+			goto fail;
+		}
+		if (parse_ullint(value_str, &u64) < 0) {
+			fprintf(stderr, "Failed to parse u64\n");
+			goto fail;
+		}
+		config = ec_config_u64(u64);
+		if (config == NULL) {
+			fprintf(stderr, "Failed to create config\n");
+			goto fail;
+		}
+		break;
+	case EC_CONFIG_TYPE_STRING:
+		if (value_str == NULL) {
+			fprintf(stderr, "String should be scalar\n");
+			goto fail;
+		}
+		config = ec_config_string(value_str);
+		if (config == NULL) {
+			fprintf(stderr, "Failed to create config\n");
+			goto fail;
+		}
+		break;
+	case EC_CONFIG_TYPE_LIST:
+		subschema = ec_config_schema_sub(schema_elt);
+		if (subschema == NULL) {
+			fprintf(stderr, "List has no subschema\n");
+			goto fail;
+		}
+		if (!is_event(ev, YAML_SEQUENCE_START_EVENT)) {
+			fprintf(stderr, "Ecoli list config should be a yaml sequence\n");
 			goto fail;
 		}
-		help = NULL;
+		config = parse_ec_config_list(imp, subschema);
+		if (config == NULL)
+			goto fail;
+		break;
+	case EC_CONFIG_TYPE_DICT:
+		subschema = ec_config_schema_sub(schema_elt);
+		if (subschema == NULL) {
+			fprintf(stderr, "Dict has no subschema\n");
+			goto fail;
+		}
+		if (!is_event(ev, YAML_MAPPING_START_EVENT)) {
+			fprintf(stderr, "Ecoli config should be a yaml mapping node\n");
+			goto fail;
+		}
+		config = parse_ec_config_dict(imp, subschema);
+		if (config == NULL)
+			goto fail;
+		break;
+	default:
+		fprintf(stderr, "Invalid config type %d\n", type);
+		goto fail;
 	}
 
-	/* add attributes (all as string) */
-	if (attrs != NULL) {
-		for (pair = attrs->data.mapping.pairs.start; pair < attrs->data.mapping.pairs.top;
-		     pair++) {
-			key = document->nodes.start + pair->key - 1;
-			value = document->nodes.start + pair->value - 1;
-			key_str = (const char *)key->data.scalar.value;
-			value_str = (const char *)value->data.scalar.value;
-			value_dup = strdup(value_str);
-			if (value_dup == NULL)
-				goto fail;
-			if (ec_dict_set(ec_node_attrs(enode), key_str, value_dup, free) < 0) {
-				value_dup = NULL;
-				goto fail;
-			}
-			value_dup = NULL;
-		}
+	if (recording) {
+		recording = false;
+		stop_recording(imp, &recorded);
+		if (set_anchor(imp, anchor, &recorded) < 0)
+			goto fail;
 	}
+	free(anchor);
+	yevent_free(ev);
 
-	return enode;
+	return config;
 
 fail:
-	ec_node_free(enode);
+	if (errno == 0)
+		errno = EINVAL;
+	if (recording)
+		stop_recording(imp, &recorded);
+	yevent_list_free(&recorded);
+	free(anchor);
+	yevent_free(ev);
 	ec_config_free(config);
-	free(help);
-	free(value_dup);
+	return NULL;
+}
+
+static struct ec_node *parse_document(struct yaml_importer *imp)
+{
+	struct ec_node *root = NULL;
+	struct yevent ev = {0};
+
+	imp->anchors = ec_dict();
+	if (imp->anchors == NULL)
+		goto fail;
+
+	if (next_event(imp, &ev) < 0)
+		goto fail;
+	if (!is_event(&ev, YAML_STREAM_START_EVENT)) {
+		fprintf(stderr, "Failed to load yaml document\n");
+		goto fail;
+	}
+	yevent_free(&ev);
+	if (next_event(imp, &ev) < 0)
+		goto fail;
+	if (!is_event(&ev, YAML_DOCUMENT_START_EVENT)) {
+		fprintf(stderr, "Incomplete document\n");
+		goto fail;
+	}
+	yevent_free(&ev);
+
+	if (next_value(imp, &ev) < 0)
+		goto fail;
+	if (is_event(&ev, YAML_DOCUMENT_END_EVENT)) {
+		fprintf(stderr, "Incomplete document\n");
+		goto fail;
+	}
+	root = parse_ec_node(imp, &ev);
+	if (root == NULL)
+		goto fail;
 
+	/* check that the end of the document is valid */
+	if (next_event(imp, &ev) < 0)
+		goto fail;
+	if (!is_event(&ev, YAML_DOCUMENT_END_EVENT)) {
+		fprintf(stderr, "Unexpected content at the end of the document\n");
+		goto fail;
+	}
+	yevent_free(&ev);
+
+	return root;
+
+fail:
+	if (errno == 0)
+		errno = EINVAL;
+	yevent_free(&ev);
+	ec_node_free(root);
 	return NULL;
 }
 
-static struct ec_node *parse_document(struct enode_table *table, const yaml_document_t *document)
+/* Import a document from an initialized parser, and delete the parser. */
+static struct ec_node *import_document(struct yaml_importer *imp)
 {
-	yaml_node_t *node;
+	struct ec_node *root;
+	int save_errno;
+
+	errno = 0;
+	root = parse_document(imp);
+	save_errno = errno;
+	if (root == NULL)
+		fprintf(stderr, "Failed to parse document\n");
 
-	node = document->nodes.start;
-	return parse_ec_node(table, document, node);
+	yevent_list_free(&imp->pending);
+	while (imp->recorders_len > 0)
+		yevent_list_free(&imp->recorders[--imp->recorders_len]);
+	free(imp->recorders);
+	ec_dict_free(imp->anchors);
+	yaml_parser_delete(&imp->parser);
+
+	errno = save_errno;
+	return root;
 }
 
-struct ec_node *ec_yaml_import(const char *filename)
+static int read_fd(void *data, unsigned char *buffer, size_t size, size_t *size_read)
 {
-	FILE *file;
-	yaml_parser_t parser;
-	yaml_document_t document;
-	struct ec_node *root = NULL;
-	struct enode_table table;
+	int fd = *(int *)data;
+	ssize_t n;
 
-	memset(&table, 0, sizeof(table));
+	do {
+		n = read(fd, buffer, size);
+	} while (n < 0 && errno == EINTR);
 
-	file = fopen(filename, "rb");
-	if (file == NULL) {
-		fprintf(stderr, "Failed to open file %s\n", filename);
-		goto fail_no_parser;
-	}
+	if (n < 0)
+		return 0;
+	*size_read = n;
+
+	return 1;
+}
 
-	if (yaml_parser_initialize(&parser) == 0) {
+struct ec_node *ec_yaml_import_fd(int fd)
+{
+	struct yaml_importer imp;
+
+	memset(&imp, 0, sizeof(imp));
+	if (yaml_parser_initialize(&imp.parser) == 0) {
 		fprintf(stderr, "Failed to initialize yaml parser\n");
-		goto fail_no_parser;
+		errno = ENOMEM;
+		return NULL;
 	}
+	yaml_parser_set_input(&imp.parser, read_fd, &fd);
 
-	yaml_parser_set_input_file(&parser, file);
+	return import_document(&imp);
+}
 
-	if (yaml_parser_load(&parser, &document) == 0) {
-		fprintf(stderr, "Failed to load yaml document\n");
-		goto fail_no_doc;
-	}
+struct ec_node *ec_yaml_import_mem(const char *buf, size_t len)
+{
+	struct yaml_importer imp;
 
-	if (yaml_document_get_root_node(&document) == NULL) {
-		fprintf(stderr, "Incomplete document\n"); /* XXX check err */
-		goto fail;
+	if (buf == NULL) {
+		errno = EINVAL;
+		return NULL;
 	}
 
-	root = parse_document(&table, &document);
-	if (root == NULL) {
-		fprintf(stderr, "Failed to parse document\n");
-		goto fail;
+	memset(&imp, 0, sizeof(imp));
+	if (yaml_parser_initialize(&imp.parser) == 0) {
+		fprintf(stderr, "Failed to initialize yaml parser\n");
+		errno = ENOMEM;
+		return NULL;
 	}
+	yaml_parser_set_input_string(&imp.parser, (const unsigned char *)buf, len);
 
-	yaml_document_delete(&document);
-	yaml_parser_delete(&parser);
-	fclose(file);
-	free_table(&table);
+	return import_document(&imp);
+}
 
-	return root;
+struct ec_node *ec_yaml_import(const char *filename)
+{
+	struct ec_node *root;
+	int save_errno;
+	int fd;
 
-fail:
-	yaml_document_delete(&document);
-fail_no_doc:
-	yaml_parser_delete(&parser);
-fail_no_parser:
-	if (file != NULL)
-		fclose(file);
-	free_table(&table);
-	ec_node_free(root);
+	fd = open(filename, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		fprintf(stderr, "Failed to open file %s\n", filename);
+		return NULL;
+	}
 
-	return NULL;
+	root = ec_yaml_import_fd(fd);
+	save_errno = errno;
+	close(fd);
+	errno = save_errno;
+
+	return root;
 }
 
 /* export functions */
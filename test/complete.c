@@ -8,9 +8,87 @@
 
 #include "test.h"
 
+/* check that a session returns the same completions as ec_complete() */
+static int
+check_session(struct ec_comp_session *session, const struct ec_node *node, const char *str)
+{
+	const struct ec_comp *session_comp;
+	struct ec_comp *comp = NULL;
+	char *buf1 = NULL, *buf2 = NULL;
+	size_t buflen;
+	FILE *f;
+	int ret = -1;
+
+	session_comp = ec_comp_session_complete(session, str);
+	comp = ec_complete(node, str);
+	if (session_comp == NULL || comp == NULL)
+		goto out;
+
+	f = open_memstream(&buf1, &buflen);
+	if (f == NULL)
+		goto out;
+	ec_comp_dump(f, session_comp);
+	fclose(f);
+	f = open_memstream(&buf2, &buflen);
+	if (f == NULL)
+		goto out;
+	ec_comp_dump(f, comp);
+	fclose(f);
+
+	if (strcmp(buf1, buf2) == 0)
+		ret = 0;
+
+out:
+	ec_comp_free(comp);
+	free(buf1);
+	free(buf2);
+	return ret;
+}
+
+/* check the expansion of a line, the strvecs are freed */
+static int
+check_expand(const struct ec_node *node, struct ec_strvec *line, struct ec_strvec *expected)
+{
+	struct ec_strvec *expanded = NULL;
+	int ret = -1;
+
+	if (line == NULL || expected == NULL)
+		goto out;
+
+	expanded = ec_complete_strvec_expand(node, EC_COMP_FULL, line);
+	if (expanded == NULL)
+		goto out;
+
+	if (ec_strvec_cmp(expanded, expected) == 0)
+		ret = 0;
+
+out:
+	ec_strvec_free(expanded);
+	ec_strvec_free(expected);
+	ec_strvec_free(line);
+	return ret;
+}
+
 EC_TEST_MAIN()
 {
 	struct ec_strvec *vec1 = NULL, *vec2 = NULL;
+	struct ec_comp_session *session = NULL;
+	const struct ec_comp *c1, *c2;
+	const char *session_inputs[] = {
+		"",
+		"f",
+		"foo",
+		"foo ",
+		"foo b",
+		"foo ba",
+		"foo bax",
+		"foo b",
+		"foo 'ba",
+		"foo 'baz",
+		"foo baz ",
+		"fo",
+	};
+	size_t i;
 	struct ec_node *node = NULL;
 	struct ec_comp *c = NULL;
 	struct ec_comp_item *item;
@@ -114,12 +192,89 @@ EC_TEST_MAIN()
 	ec_strvec_free(vec2);
 	ec_node_free(node);
 
+	node = EC_NODE_SEQ(
+		EC_NO_ID,
+		EC_NODE_OR(EC_NO_ID, ec_node_str(EC_NO_ID, "show"), ec_node_str(EC_NO_ID, "set")),
+		EC_NODE_OR(
+			EC_NO_ID,
+			ec_node_str(EC_NO_ID, "ip"),
+			ec_node_str(EC_NO_ID, "ipv6"),
+			ec_node_str(EC_NO_ID, "interface")
+		),
+		EC_NODE_OR(EC_NO_ID, ec_node_str(EC_NO_ID, "route"), ec_node_re(EC_NO_ID, "[a-z]+"))
+	);
+	testres |= EC_TEST_CHECK(node != NULL, "null node");
+	vec1 = EC_STRVEC("sh", "ip", "ro");
+	vec2 = EC_STRVEC("show", "ip", "route");
+	testres |= EC_TEST_CHECK(check_expand(node, vec1, vec2) == 0, "expand invalid");
+	vec1 = EC_STRVEC("se", "in", "r");
+	vec2 = EC_STRVEC("set", "interface", "route");
+	testres |= EC_TEST_CHECK(check_expand(node, vec1, vec2) == 0, "expand invalid");
+	/* ambiguous tokens are not expanded, nor the ones after them */
+	vec1 = EC_STRVEC("s", "in", "r");
+	vec2 = EC_STRVEC("s", "in", "r");
+	testres |= EC_TEST_CHECK(check_expand(node, vec1, vec2) == 0, "expand invalid");
+	vec1 = EC_STRVEC("sh", "i", "r");
+	vec2 = EC_STRVEC("show", "i", "r");
+	testres |= EC_TEST_CHECK(check_expand(node, vec1, vec2) == 0, "expand invalid");
+	vec1 = EC_STRVEC("sh", "ipv6", "x", "y");
+	vec2 = EC_STRVEC("show", "ipv6", "x", "y");
+	testres |= EC_TEST_CHECK(check_expand(node, vec1, vec2) == 0, "expand invalid");
+	vec1 = ec_strvec();
+	vec2 = ec_strvec();
+	testres |= EC_TEST_CHECK(check_expand(node, vec1, vec2) == 0, "expand invalid");
+	vec1 = NULL;
+	vec2 = NULL;
+	ec_node_free(node);
+
+	node = ec_node_sh_lex(
+		EC_NO_ID,
+		EC_NODE_SEQ(
+			EC_NO_ID,
+			ec_node_str(EC_NO_ID, "foo"),
+			EC_NODE_OR(
+				EC_NO_ID,
+				ec_node_str(EC_NO_ID, "bar"),
+				ec_node_str(EC_NO_ID, "baz"),
+				ec_node_str(EC_NO_ID, "qux")
+			)
+		)
+	);
+	if (node == NULL)
+		goto fail;
+	session = ec_comp_session(node);
+	if (session == NULL)
+		goto fail;
+
+	for (i = 0; i < EC_COUNT_OF(session_inputs); i++) {
+		testres |= EC_TEST_CHECK(
+			check_session(session, node, session_inputs[i]) == 0,
+			"bad session completion for <%s>\n",
+			session_inputs[i]
+		);
+	}
+
+	c1 = ec_comp_session_complete(session, "foo b");
+	c2 = ec_comp_session_complete(session, "foo b");
+	testres |= EC_TEST_CHECK(
+		c1 != NULL && c1 == c2 && ec_comp_count(c2, EC_COMP_FULL) == 2,
+		"same input should return the last completion\n"
+	);
+	ec_comp_session_reset(session);
+	testres |= EC_TEST_CHECK(
+		check_session(session, node, "foo ba") == 0, "bad session completion after reset\n"
+	);
+
+	ec_comp_session_free(session);
+	ec_node_free(node);
+
 	return testres;
 
 fail:
 	ec_strvec_free(vec1);
 	ec_strvec_free(vec2);
 	ec_comp_free(c);
+	ec_comp_session_free(session);
 	ec_node_free(node);
 	if (f != NULL)
 		fclose(f);
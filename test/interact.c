@@ -0,0 +1,111 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2025, Olivier MATZ <zer0@droids-corp.org>
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "test.h"
+
+EC_TEST_MAIN()
+{
+	struct ec_interact_query *query = NULL;
+	struct ec_interact_help *helps = NULL;
+	struct ec_node *node = NULL;
+	struct ec_node *john, *mike;
+	const struct ec_comp *comp;
+	int testres = 0;
+	size_t char_idx;
+	ssize_t n = 0;
+
+	john = ec_node_str(EC_NO_ID, "john");
+	mike = ec_node_str(EC_NO_ID, "mike");
+	if (ec_interact_set_help(john, "John") < 0 || ec_interact_set_help(mike, "Mike") < 0)
+		goto fail;
+	node = ec_node_sh_lex(
+		EC_NO_ID,
+		EC_NODE_OR(
+			EC_NO_ID,
+			EC_NODE_SEQ(
+				EC_NO_ID,
+				ec_node_str(EC_NO_ID, "hello"),
+				EC_NODE_OR(EC_NO_ID, john, mike)
+			),
+			ec_node_str(EC_NO_ID, "bye")
+		)
+	);
+	if (node == NULL)
+		goto fail;
+
+	query = ec_interact_query(node, "hello j");
+	if (query == NULL)
+		goto fail;
+	testres |= EC_TEST_CHECK(!ec_interact_query_matches(query), "should not match\n");
+	comp = ec_interact_query_get_comp(query);
+	testres |= EC_TEST_CHECK(
+		comp != NULL && ec_comp_count(comp, EC_COMP_FULL) == 1, "bad completion\n"
+	);
+	n = ec_interact_query_get_helps(query, &helps);
+	testres |= EC_TEST_CHECK(
+		n == 1 && !strcmp(helps[0].desc, "john") && !strcmp(helps[0].help, "John"),
+		"bad helps\n"
+	);
+	ec_interact_free_helps(helps, n);
+	helps = NULL;
+	ec_interact_query_free(query);
+
+	query = ec_interact_query(node, "hello john");
+	if (query == NULL)
+		goto fail;
+	testres |= EC_TEST_CHECK(ec_interact_query_matches(query), "should match\n");
+	testres |= EC_TEST_CHECK(
+		ec_pnode_len(ec_interact_query_get_pnode(query)) == 1, "bad parse tree\n"
+	);
+	n = ec_interact_query_get_helps(query, &helps);
+	testres |= EC_TEST_CHECK(
+		n == 2 && !strcmp(helps[0].desc, "<return>") && !strcmp(helps[1].desc, "john"),
+		"bad helps\n"
+	);
+	ec_interact_free_helps(helps, n);
+	helps = NULL;
+	ec_interact_query_free(query);
+
+	query = ec_interact_query(node, "hello bob");
+	if (query == NULL)
+		goto fail;
+	n = ec_interact_query_get_helps(query, &helps);
+	testres |= EC_TEST_CHECK(n == 0, "should have no help\n");
+	ec_interact_free_helps(helps, n);
+	helps = NULL;
+	n = ec_interact_query_get_error_helps(query, &helps, &char_idx);
+	testres |= EC_TEST_CHECK(
+		n == 2 && char_idx == 6 && !strcmp(helps[0].desc, "john")
+			&& !strcmp(helps[1].desc, "mike"),
+		"bad error helps\n"
+	);
+	ec_interact_free_helps(helps, n);
+	helps = NULL;
+	ec_interact_query_free(query);
+	query = NULL;
+
+	n = ec_interact_get_error_helps(node, "hello mike foo", &helps, &char_idx);
+	testres |= EC_TEST_CHECK(
+		n == 1 && char_idx == 11 && !strcmp(helps[0].desc, "<return>"),
+		"bad error helps\n"
+	);
+	ec_interact_free_helps(helps, n);
+	helps = NULL;
+
+	n = ec_interact_get_helps(node, "", &helps);
+	testres |= EC_TEST_CHECK(n == 2, "bad helps count\n");
+	ec_interact_free_helps(helps, n);
+
+	ec_node_free(node);
+
+	return testres;
+
+fail:
+	ec_interact_query_free(query);
+	ec_node_free(node);
+	return -1;
+}
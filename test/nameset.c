@@ -0,0 +1,67 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2025, Olivier MATZ <zer0@droids-corp.org>
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include "test.h"
+
+EC_TEST_MAIN()
+{
+	struct ec_nameset *set, *ref;
+	size_t first, count;
+	int ret, testres = 0;
+
+	set = ec_nameset();
+	if (set == NULL) {
+		EC_LOG(EC_LOG_ERR, "cannot create name set\n");
+		return -1;
+	}
+
+	testres |= EC_TEST_CHECK(ec_nameset_len(set) == 0, "bad set len");
+	testres |= EC_TEST_CHECK(!ec_nameset_has(set, "foo"), "empty set has foo");
+	count = ec_nameset_prefix(set, "", &first);
+	testres |= EC_TEST_CHECK(count == 0, "bad prefix count");
+
+	/* add names out of order, with a duplicate */
+	ret = ec_nameset_add(set, "eth1");
+	ret |= ec_nameset_add(set, "eth10");
+	ret |= ec_nameset_add(set, "bond0");
+	ret |= ec_nameset_add(set, "eth0");
+	ret |= ec_nameset_add(set, "eth1");
+	ret |= ec_nameset_add(set, "lo");
+	testres |= EC_TEST_CHECK(ret == 0, "cannot add names");
+	testres |= EC_TEST_CHECK(ec_nameset_len(set) == 5, "bad set len");
+	testres |= EC_TEST_CHECK(!strcmp(ec_nameset_get(set, 0), "bond0"), "bad first name");
+	testres |= EC_TEST_CHECK(!strcmp(ec_nameset_get(set, 4), "lo"), "bad last name");
+	testres |= EC_TEST_CHECK(ec_nameset_get(set, 5) == NULL, "index out of bounds");
+
+	testres |= EC_TEST_CHECK(ec_nameset_has(set, "eth10"), "set should have eth10");
+	testres |= EC_TEST_CHECK(!ec_nameset_has(set, "eth"), "set should not have eth");
+	testres |= EC_TEST_CHECK(!ec_nameset_has(set, "eth100"), "set should not have eth100");
+
+	count = ec_nameset_prefix(set, "eth", &first);
+	testres |= EC_TEST_CHECK(first == 1 && count == 3, "bad prefix range for eth");
+	count = ec_nameset_prefix(set, "eth1", &first);
+	testres |= EC_TEST_CHECK(first == 2 && count == 2, "bad prefix range for eth1");
+	count = ec_nameset_prefix(set, "", &first);
+	testres |= EC_TEST_CHECK(first == 0 && count == 5, "bad prefix range for empty prefix");
+	count = ec_nameset_prefix(set, "x", &first);
+	testres |= EC_TEST_CHECK(count == 0, "bad prefix count for x");
+
+	/* remove a name, through another reference */
+	ref = ec_nameset_clone(set);
+	testres |= EC_TEST_CHECK(ec_nameset_del(ref, "eth1") == 0, "cannot remove eth1");
+	ec_nameset_free(ref);
+	testres |= EC_TEST_CHECK(
+		ec_nameset_del(set, "eth1") < 0 && errno == ENOENT, "eth1 removed twice"
+	);
+	testres |= EC_TEST_CHECK(!ec_nameset_has(set, "eth1"), "set should not have eth1");
+	count = ec_nameset_prefix(set, "eth1", &first);
+	testres |= EC_TEST_CHECK(first == 2 && count == 1, "bad prefix range after removal");
+
+	ec_nameset_free(set);
+
+	return testres;
+}
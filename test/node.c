@@ -24,13 +24,57 @@ static unsigned int test_iter(struct ec_node *node)
 	return count;
 }
 
+struct visit_count {
+	unsigned int pre;
+	unsigned int post;
+	unsigned int stop; /* stop at this pre-order call */
+	struct ec_node *skip; /* skip the children of this node */
+	struct ec_node *last; /* last node visited in post-order */
+};
+
+static int test_visit_pre(struct ec_node *node, struct ec_node *parent, void *opaque)
+{
+	struct visit_count *count = opaque;
+
+	(void)parent;
+
+	count->pre++;
+	if (count->pre == count->stop)
+		return EC_NODE_VISIT_STOP;
+	if (node == count->skip)
+		return EC_NODE_VISIT_SKIP;
+	return EC_NODE_VISIT_CONTINUE;
+}
+
+static int test_visit_post(struct ec_node *node, struct ec_node *parent, void *opaque)
+{
+	struct visit_count *count = opaque;
+
+	(void)parent;
+
+	count->post++;
+	count->last = node;
+	return EC_NODE_VISIT_CONTINUE;
+}
+
+static struct ec_node_type test_type = {
+	.name = "test_type",
+};
+
+static struct ec_node_type test_type_override = {
+	.name = "test_type",
+};
+
 EC_TEST_MAIN()
 {
+	struct ec_node_index *index = NULL;
+	struct visit_count visit;
 	struct ec_node *node = NULL, *expr = NULL;
 	struct ec_node *expr2 = NULL, *val = NULL, *op = NULL, *seq = NULL;
 	const struct ec_node_type *type;
+	const struct ec_config *config, *value;
 	struct ec_node *child;
-	unsigned int count;
+	unsigned int count, i;
 	FILE *f = NULL;
 	char *buf = NULL;
 	char *desc = NULL;
@@ -105,6 +149,17 @@ EC_TEST_MAIN()
 	child = ec_node_find(node, "id_dezdex");
 	testres |= EC_TEST_CHECK(child == NULL, "child with wrong id should be NULL");
 
+	index = ec_node_index(node);
+	if (index == NULL)
+		goto fail;
+	child = ec_node_index_find(index, "id_y");
+	testres |= EC_TEST_CHECK(child == ec_node_find(node, "id_y"), "bad index lookup\n");
+	testres |= EC_TEST_CHECK(
+		ec_node_index_find(index, "id_dezdex") == NULL, "bad index lookup of missing id\n"
+	);
+	ec_node_index_free(index);
+	index = NULL;
+
 	ret = ec_dict_set(ec_node_attrs(node), "key", "val", NULL);
 	testres |= EC_TEST_CHECK(ret == 0, "cannot set node attribute\n");
 
@@ -123,6 +178,25 @@ EC_TEST_MAIN()
 	node = ec_node("deznuindez", EC_NO_ID);
 	testres |= EC_TEST_CHECK(node == NULL, "should not be able to create node\n");
 
+	/* register a type after init, then override it */
+	ret = ec_node_type_register(&test_type, false);
+	testres |= EC_TEST_CHECK(ret == 0, "cannot register type\n");
+	testres |= EC_TEST_CHECK(ec_node_type_lookup("test_type") == &test_type, "bad lookup\n");
+	ret = ec_node_type_register(&test_type_override, false);
+	testres |= EC_TEST_CHECK(ret < 0 && errno == EEXIST, "type should already exist\n");
+	ret = ec_node_type_register(&test_type_override, true);
+	testres |= EC_TEST_CHECK(ret == 0, "cannot override type\n");
+	type = ec_node_type_lookup("test_type");
+	testres |= EC_TEST_CHECK(type == &test_type_override, "bad lookup after override\n");
+	node = ec_node("test_type", EC_NO_ID);
+	if (node == NULL)
+		goto fail;
+	testres |= EC_TEST_CHECK(
+		ec_node_check_type(node, &test_type) == 0, "overridden type should match\n"
+	);
+	ec_node_free(node);
+	node = NULL;
+
 	/* test loop */
 	expr = ec_node("or", EC_NO_ID);
 	val = ec_node_int(EC_NO_ID, 0, 10, 0);
@@ -141,11 +215,47 @@ EC_TEST_MAIN()
 	val = NULL;
 
 	count = test_iter(expr);
-	testres |= EC_TEST_CHECK(count == 5, "invalid node count (%u instead if %u)", count, 5);
+	testres |= EC_TEST_CHECK(count == 4, "invalid node count (%u instead if %u)", count, 4);
 
 	child = ec_node_find(expr, "id_dezdex");
 	testres |= EC_TEST_CHECK(child == NULL, "child with wrong id should be NULL");
 
+	/* each node of the loop is visited once */
+	memset(&visit, 0, sizeof(visit));
+	ret = ec_node_visit(expr, test_visit_pre, test_visit_post, &visit);
+	testres |= EC_TEST_CHECK(
+		ret == 0 && visit.pre == 4 && visit.post == 4 && visit.last == expr, "bad visit\n"
+	);
+	memset(&visit, 0, sizeof(visit));
+	if (ec_node_get_child(expr, 0, &visit.skip) < 0)
+		goto fail;
+	ret = ec_node_visit(expr, test_visit_pre, test_visit_post, &visit);
+	testres |= EC_TEST_CHECK(
+		ret == 0 && visit.pre == 3 && visit.post == 3, "bad visit with skip\n"
+	);
+	memset(&visit, 0, sizeof(visit));
+	visit.stop = 2;
+	ret = ec_node_visit(expr, test_visit_pre, test_visit_post, &visit);
+	testres |= EC_TEST_CHECK(
+		ret == 1 && visit.pre == 2 && visit.post == 0, "bad visit with stop\n"
+	);
+
+	/* deep grammar */
+	node = ec_node_str("leaf", "x");
+	for (i = 0; i < 1000; i++)
+		node = EC_NODE_SEQ(EC_NO_ID, node);
+	if (node == NULL)
+		goto fail;
+	memset(&visit, 0, sizeof(visit));
+	ret = ec_node_visit(node, test_visit_pre, test_visit_post, &visit);
+	testres |= EC_TEST_CHECK(
+		ret == 0 && visit.pre == 1001 && visit.post == 1001, "bad visit of deep grammar\n"
+	);
+	child = ec_node_find(node, "leaf");
+	testres |= EC_TEST_CHECK(child != NULL, "cannot find leaf of deep grammar\n");
+	ec_node_free(node);
+	node = NULL;
+
 	testres |= EC_TEST_CHECK_PARSE(expr, 1, "1");
 	testres |= EC_TEST_CHECK_PARSE(expr, 3, "!", "!", "1");
 	testres |= EC_TEST_CHECK_PARSE(expr, -1, "!", "!", "!");
@@ -174,7 +284,7 @@ EC_TEST_MAIN()
 	testres |= EC_TEST_CHECK_PARSE(expr, -1, "!", "!", "!");
 
 	count = test_iter(expr);
-	testres |= EC_TEST_CHECK(count == 5, "invalid node count (%u instead if %u)", count, 5);
+	testres |= EC_TEST_CHECK(count == 4, "invalid node count (%u instead if %u)", count, 4);
 
 	ec_node_free(expr2);
 	expr2 = NULL;
@@ -183,9 +293,84 @@ EC_TEST_MAIN()
 	ec_node_free(expr);
 	expr = NULL;
 
+	/* config of nodes built by constructors is built on demand */
+	node = EC_NODE_SEQ(EC_NO_ID, ec_node_str(EC_NO_ID, "x"), ec_node_int(EC_NO_ID, -1, 9, 10));
+	if (node == NULL)
+		goto fail;
+	config = ec_node_get_config(node);
+	value = ec_config_dict_get(config, "children");
+	testres |= EC_TEST_CHECK(ec_config_count(value) == 2, "bad seq config\n");
+	if (ec_node_get_child(node, 1, &child) < 0)
+		goto fail;
+	config = ec_node_get_config(child);
+	value = ec_config_dict_get(config, "min");
+	testres |= EC_TEST_CHECK(value != NULL && value->i64 == -1, "bad int config\n");
+	value = ec_config_dict_get(config, "base");
+	testres |= EC_TEST_CHECK(value != NULL && value->u64 == 10, "bad int config\n");
+	if (ec_node_get_child(node, 0, &child) < 0)
+		goto fail;
+	value = ec_config_dict_get(ec_node_get_config(child), "string");
+	testres |= EC_TEST_CHECK(value != NULL && !strcmp(value->string, "x"), "bad str config\n");
+
+	/* the config is updated when a child is added */
+	if (ec_node_seq_add(node, ec_node_str(EC_NO_ID, "y")) < 0)
+		goto fail;
+	value = ec_config_dict_get(ec_node_get_config(node), "children");
+	testres |= EC_TEST_CHECK(ec_config_count(value) == 3, "bad seq config\n");
+	testres |= EC_TEST_CHECK_PARSE(node, 3, "x", "3", "y");
+	ec_node_free(node);
+	node = NULL;
+
+	/* loop whose config is built before it is freed */
+	expr = ec_node("or", EC_NO_ID);
+	if (expr == NULL)
+		goto fail;
+	seq = EC_NODE_SEQ(EC_NO_ID, ec_node_str(EC_NO_ID, "!"), ec_node_clone(expr));
+	if (seq == NULL)
+		goto fail;
+	if (ec_node_or_add(expr, seq) < 0)
+		goto fail;
+	seq = NULL;
+	if (ec_node_or_add(expr, ec_node_int(EC_NO_ID, 0, 10, 0)) < 0)
+		goto fail;
+	if (ec_node_get_config(expr) == NULL || ec_node_get_child(expr, 0, &child) < 0)
+		goto fail;
+	if (ec_node_get_config(child) == NULL)
+		goto fail;
+	testres |= EC_TEST_CHECK_PARSE(expr, 3, "!", "!", "1");
+	ec_node_free(expr);
+	expr = NULL;
+
+	/* loop referenced by another grammar, freed before it */
+	expr = ec_node("or", EC_NO_ID);
+	val = ec_node_int(EC_NO_ID, 0, 10, 0);
+	seq = EC_NODE_SEQ(EC_NO_ID, ec_node_str(EC_NO_ID, "eval"), ec_node_clone(expr));
+	if (expr == NULL || val == NULL || seq == NULL)
+		goto fail;
+	op = EC_NODE_SEQ(EC_NO_ID, ec_node_clone(seq), ec_node_clone(expr));
+	ret = ec_node_or_add(expr, op);
+	op = NULL;
+	if (ret < 0)
+		goto fail;
+	if (ec_node_or_add(expr, ec_node_clone(val)) < 0)
+		goto fail;
+	node = EC_NODE_SEQ(EC_NO_ID, ec_node_str(EC_NO_ID, "print"), val);
+	val = NULL;
+	node = EC_NODE_OR(EC_NO_ID, seq, node);
+	seq = NULL;
+	if (node == NULL)
+		goto fail;
+	ec_node_free(expr);
+	expr = NULL;
+	testres |= EC_TEST_CHECK_PARSE(node, 2, "eval", "1");
+	testres |= EC_TEST_CHECK_PARSE(node, 2, "print", "1");
+	ec_node_free(node);
+	node = NULL;
+
 	return testres;
 
 fail:
+	ec_node_index_free(index);
 	ec_node_free(expr);
 	ec_node_free(expr2);
 	ec_node_free(val);
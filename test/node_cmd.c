@@ -2,12 +2,179 @@
  * Copyright 2016, Olivier MATZ <zer0@droids-corp.org>
  */
 
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include "test.h"
 
+/* check that two graphs have the same shape, types, ids and parameters */
+static bool same_graph(const struct ec_node *a, const struct ec_node *b)
+{
+	const struct ec_config *min_a, *min_b;
+	struct ec_node *child_a, *child_b;
+	char *desc_a, *desc_b;
+	bool same;
+	size_t i;
+
+	if (strcmp(ec_node_get_type_name(a), ec_node_get_type_name(b)))
+		return false;
+	if ((ec_node_id(a) == NULL) != (ec_node_id(b) == NULL))
+		return false;
+	if (ec_node_id(a) != NULL && strcmp(ec_node_id(a), ec_node_id(b)))
+		return false;
+	if (ec_node_get_children_count(a) != ec_node_get_children_count(b))
+		return false;
+
+	desc_a = ec_node_desc(a);
+	desc_b = ec_node_desc(b);
+	same = desc_a != NULL && desc_b != NULL && !strcmp(desc_a, desc_b);
+	free(desc_a);
+	free(desc_b);
+	if (!same)
+		return false;
+
+	if (!strcmp(ec_node_get_type_name(a), "subset")
+	    && ec_node_subset_get_min(a) != ec_node_subset_get_min(b))
+		return false;
+	if (!strcmp(ec_node_get_type_name(a), "many")) {
+		min_a = ec_config_dict_get(ec_node_get_config(a), "min");
+		min_b = ec_config_dict_get(ec_node_get_config(b), "min");
+		if (min_a == NULL || min_b == NULL || min_a->u64 != min_b->u64)
+			return false;
+	}
+
+	for (i = 0; i < ec_node_get_children_count(a); i++) {
+		if (ec_node_get_child(a, i, &child_a) < 0 || ec_node_get_child(b, i, &child_b) < 0)
+			return false;
+		if (!same_graph(child_a, child_b))
+			return false;
+	}
+
+	return true;
+}
+
+/* build a command node and compare its graph with the expected one */
+static bool check_graph(const char *cmd_str, struct ec_node *expected)
+{
+	struct ec_node *node, *child;
+	bool same = false;
+
+	node = EC_NODE_CMD(EC_NO_ID, cmd_str);
+	if (node != NULL && expected != NULL && ec_node_get_child(node, 0, &child) == 0)
+		same = same_graph(child, expected);
+	ec_node_free(node);
+	ec_node_free(expected);
+
+	return same;
+}
+
+/* write the graph as "type(children)", strings as their value */
+static void write_graph(FILE *f, const struct ec_node *node)
+{
+	const struct ec_config *min;
+	struct ec_node *child;
+	const char *type;
+	char *desc;
+	size_t i;
+
+	type = ec_node_get_type_name(node);
+	if (!strcmp(type, "str")) {
+		desc = ec_node_desc(node);
+		fprintf(f, "%s", desc != NULL ? desc : "?");
+		free(desc);
+		return;
+	}
+
+	fprintf(f, "%s", type);
+	if (ec_node_id(node) != NULL && ec_node_id(node)[0] != '\0')
+		fprintf(f, "#%s", ec_node_id(node));
+	if (!strcmp(type, "subset"))
+		fprintf(f, "/%u", ec_node_subset_get_min(node));
+	if (!strcmp(type, "many")) {
+		min = ec_config_dict_get(ec_node_get_config(node), "min");
+		fprintf(f, "/%" PRIu64, min != NULL ? min->u64 : 0);
+	}
+	if (ec_node_get_children_count(node) == 0)
+		return;
+
+	fprintf(f, "(");
+	for (i = 0; i < ec_node_get_children_count(node); i++) {
+		if (i > 0)
+			fprintf(f, " ");
+		if (ec_node_get_child(node, i, &child) == 0)
+			write_graph(f, child);
+	}
+	fprintf(f, ")");
+}
+
+/* build a command node with a child "x", and return its graph as a string */
+static char *cmd_graph_str(const char *cmd_str)
+{
+	struct ec_node *node, *child;
+	char *buf = NULL;
+	size_t buflen = 0;
+	FILE *f;
+
+	node = EC_NODE_CMD(EC_NO_ID, cmd_str, ec_node_int("x", 0, 10, 10));
+	if (node == NULL || ec_node_get_child(node, 0, &child) < 0)
+		goto fail;
+
+	f = open_memstream(&buf, &buflen);
+	if (f == NULL)
+		goto fail;
+	write_graph(f, child);
+	fclose(f);
+	ec_node_free(node);
+
+	return buf;
+
+fail:
+	ec_node_free(node);
+	return NULL;
+}
+
+/* operator combinations, folded as the former expr evaluation did */
+static const struct {
+	const char *cmd_str;
+	const char *graph;
+} cmd_graphs[] = {
+	{"[a]", "option(a)"},
+	{"[a] [b]", "seq(option(a) option(b))"},
+	{"[a b]", "option(seq(a b))"},
+	{"[[a] b]", "option(seq(option(a) b))"},
+	{"a|b", "or(a b)"},
+	{"a|b|c|d", "or(b c d a)"},
+	{"(a|b)|(c|d)", "or(c d or(a b))"},
+	{"a b|c d", "seq(a seq(or(b c) d))"},
+	{"a|[b]", "or(a option(b))"},
+	{"a, b", "subset/1(a b)"},
+	{"a, b, c", "subset/1(b c a)"},
+	{"(a, b), c", "subset/1(a b c)"},
+	{"a, b|c", "or(subset/1(a b) c)"},
+	{"a, b c", "seq(subset/1(a b) c)"},
+	{"a & b, c", "subset/1(subset/2(a b) c)"},
+	{"a+", "many/1(a)"},
+	{"a*", "many/0(a)"},
+	{"(a b)+", "many/1(seq(a b))"},
+	{"[a]*", "many/0(option(a))"},
+	{"(a|b)* c+", "seq(many/0(or(a b)) many/1(c))"},
+	{"a (b (c d)) e", "seq(a seq(b seq(c d) e))"},
+	{"((a))", "a"},
+	{"[a, b]+ (c|d)*", "seq(many/1(option(subset/1(a b))) many/0(or(c d)))"},
+	{"x [x|a]", "seq(int#x option(or(int#x a)))"},
+	{"(a & b) & c", "subset/3(a b c)"},
+	{"a & (b & c)", "subset/3(b c a)"},
+};
+
 EC_TEST_MAIN()
 {
-	struct ec_node *node;
+	struct ec_node *node, *node2, *child, *child2, *x;
 	int testres = 0;
+	bool same;
+	size_t i;
+	char *str;
 
 	node = EC_NODE_CMD(
 		EC_NO_ID,
@@ -87,5 +254,124 @@ EC_TEST_MAIN()
 	testres |= EC_TEST_CHECK_PARSE(node, 0, "x");
 	ec_node_free(node);
 
+	/* invalid expressions */
+	node = EC_NODE_CMD(EC_NO_ID, "");
+	testres |= EC_TEST_CHECK(node == NULL, "empty expression should be rejected");
+	node = EC_NODE_CMD(EC_NO_ID, "foo |");
+	testres |= EC_TEST_CHECK(node == NULL, "missing operand should be rejected");
+	node = EC_NODE_CMD(EC_NO_ID, "(foo bar");
+	testres |= EC_TEST_CHECK(node == NULL, "unbalanced parenthesis should be rejected");
+	node = EC_NODE_CMD(EC_NO_ID, "foo ! bar");
+	testres |= EC_TEST_CHECK(node == NULL, "invalid character should be rejected");
+	node = EC_NODE_CMD(EC_NO_ID, "foo**");
+	testres |= EC_TEST_CHECK(node == NULL, "stacked operators should be rejected");
+
+	/* shape of the built graphs, the merged nodes give the order of children */
+	same = check_graph(
+		"a b c",
+		EC_NODE_SEQ(
+			EC_NO_ID,
+			ec_node_str(EC_NO_ID, "a"),
+			EC_NODE_SEQ(
+				EC_NO_ID, ec_node_str(EC_NO_ID, "b"), ec_node_str(EC_NO_ID, "c")
+			)
+		)
+	);
+	testres |= EC_TEST_CHECK(same, "unexpected graph for <%s>", "a b c");
+	same = check_graph(
+		"a|b|c",
+		EC_NODE_OR(
+			EC_NO_ID,
+			ec_node_str(EC_NO_ID, "b"),
+			ec_node_str(EC_NO_ID, "c"),
+			ec_node_str(EC_NO_ID, "a")
+		)
+	);
+	testres |= EC_TEST_CHECK(same, "unexpected graph for <%s>", "a|b|c");
+	node = EC_NODE_SUBSET(
+		EC_NO_ID,
+		ec_node_str(EC_NO_ID, "a"),
+		EC_NODE_SUBSET(EC_NO_ID, ec_node_str(EC_NO_ID, "b"), ec_node_str(EC_NO_ID, "c"))
+	);
+	if (node != NULL) {
+		ec_node_subset_set_min(node, 1);
+		ec_node_get_child(node, 1, &child);
+		ec_node_subset_set_min(child, 2);
+	}
+	same = check_graph("a, b & c", node);
+	testres |= EC_TEST_CHECK(same, "unexpected graph for <%s>", "a, b & c");
+	same = check_graph(
+		"x [y|z]* (w)+",
+		EC_NODE_SEQ(
+			EC_NO_ID,
+			ec_node_str(EC_NO_ID, "x"),
+			EC_NODE_SEQ(
+				EC_NO_ID,
+				ec_node_many(
+					EC_NO_ID,
+					ec_node_option(
+						EC_NO_ID,
+						EC_NODE_OR(
+							EC_NO_ID,
+							ec_node_str(EC_NO_ID, "y"),
+							ec_node_str(EC_NO_ID, "z")
+						)
+					),
+					0,
+					0
+				),
+				ec_node_many(EC_NO_ID, ec_node_str(EC_NO_ID, "w"), 1, 0)
+			)
+		)
+	);
+	testres |= EC_TEST_CHECK(same, "unexpected graph for <%s>", "x [y|z]* (w)+");
+
+	for (i = 0; i < sizeof(cmd_graphs) / sizeof(cmd_graphs[0]); i++) {
+		str = cmd_graph_str(cmd_graphs[i].cmd_str);
+		testres |= EC_TEST_CHECK(
+			str != NULL && !strcmp(str, cmd_graphs[i].graph),
+			"unexpected graph for <%s>: <%s>",
+			cmd_graphs[i].cmd_str,
+			str != NULL ? str : "NULL"
+		);
+		free(str);
+	}
+
+	/* the cache shares the graphs built from the same string and children */
+	testres |= EC_TEST_CHECK(ec_node_cmd_set_cache(true) == 0, "cannot enable cache");
+	x = ec_node_int("x", 0, 10, 10);
+	node = EC_NODE_CMD(EC_NO_ID, "foo x [bar]", ec_node_clone(x));
+	node2 = EC_NODE_CMD(EC_NO_ID, "foo x [bar]", ec_node_clone(x));
+	if (node == NULL || node2 == NULL) {
+		EC_LOG(EC_LOG_ERR, "cannot create node\n");
+		ec_node_free(node);
+		ec_node_free(node2);
+		ec_node_free(x);
+		return -1;
+	}
+	testres |= EC_TEST_CHECK(
+		ec_node_get_child(node, 0, &child) == 0 && ec_node_get_child(node2, 0, &child2) == 0
+			&& child == child2,
+		"graph should be shared"
+	);
+	testres |= EC_TEST_CHECK_PARSE(node2, 3, "foo", "1", "bar");
+	ec_node_free(node2);
+	node2 = EC_NODE_CMD(EC_NO_ID, "foo x [bar]", ec_node_int("x", 0, 10, 10));
+	if (node2 == NULL) {
+		EC_LOG(EC_LOG_ERR, "cannot create node\n");
+		ec_node_free(node);
+		ec_node_free(x);
+		return -1;
+	}
+	testres |= EC_TEST_CHECK(
+		ec_node_get_child(node2, 0, &child2) == 0 && child != child2,
+		"graph should not be shared with other children"
+	);
+	testres |= EC_TEST_CHECK_PARSE(node2, 2, "foo", "1");
+	ec_node_free(node2);
+	ec_node_free(node);
+	ec_node_free(x);
+	testres |= EC_TEST_CHECK(ec_node_cmd_set_cache(false) == 0, "cannot disable cache");
+
 	return testres;
 }
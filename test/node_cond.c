@@ -25,6 +25,37 @@ EC_TEST_MAIN()
 	testres |= EC_TEST_CHECK_PARSE(node, -1, "foo", "foo", "foo", "foo");
 	ec_node_free(node);
 
+	node = ec_node_cond(
+		EC_NO_ID,
+		"or(cmp(eq, count(find(root(), id_a)), 2), "
+		"and(bool(find(current(), id_b)), "
+		"cmp(ne, find(root(), id_b), first_child(root()))))",
+		ec_node_many(
+			EC_NO_ID,
+			EC_NODE_OR(EC_NO_ID, ec_node_str("id_a", "a"), ec_node_str("id_b", "b")),
+			0,
+			0
+		)
+	);
+	if (node == NULL) {
+		EC_LOG(EC_LOG_ERR, "cannot create node\n");
+		return -1;
+	}
+	testres |= EC_TEST_CHECK_PARSE(node, 0);
+	testres |= EC_TEST_CHECK_PARSE(node, -1, "a");
+	testres |= EC_TEST_CHECK_PARSE(node, 2, "a", "a");
+	testres |= EC_TEST_CHECK_PARSE(node, 1, "b");
+	testres |= EC_TEST_CHECK_PARSE(node, 3, "a", "b", "b");
+	ec_node_free(node);
+
+	/* invalid conditions are rejected when the node is built */
+	node = ec_node_cond(EC_NO_ID, "foo(root())", ec_node_str(EC_NO_ID, "foo"));
+	testres |= EC_TEST_CHECK(node == NULL, "unknown function should be rejected");
+	ec_node_free(node);
+	node = ec_node_cond(EC_NO_ID, "count(root(), root())", ec_node_str(EC_NO_ID, "foo"));
+	testres |= EC_TEST_CHECK(node == NULL, "bad number of arguments should be rejected");
+	ec_node_free(node);
+
 	/* XXX test completion */
 
 	return testres;
@@ -2,6 +2,8 @@
  * Copyright 2016, Olivier MATZ <zer0@droids-corp.org>
  */
 
+#include <inttypes.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -26,8 +28,109 @@ static struct ec_node *build_counter(struct ec_pnode *parse, void *opaque)
 	return ec_node_str("my-id", buf);
 }
 
+struct cached_state {
+	uint64_t gen;
+	unsigned int builds;
+};
+
+static struct ec_node *build_cached(struct ec_pnode *parse, void *opaque)
+{
+	struct cached_state *state = opaque;
+	char buf[32];
+
+	(void)parse;
+	state->builds++;
+	snprintf(buf, sizeof(buf), "gen-%" PRIu64, state->gen);
+
+	return ec_node_str("my-id", buf);
+}
+
+static uint64_t get_generation(void *opaque)
+{
+	struct cached_state *state = opaque;
+
+	return state->gen;
+}
+
+/* D = seq(str("x"), option(D)) */
+static struct ec_node *build_recursive(struct ec_pnode *parse, void *opaque)
+{
+	struct ec_node **self = opaque;
+
+	(void)parse;
+
+	return EC_NODE_SEQ(
+		EC_NO_ID,
+		ec_node_str(EC_NO_ID, "x"),
+		ec_node_option(EC_NO_ID, ec_node_clone(*self))
+	);
+}
+
+static uint64_t get_constant_generation(void *opaque)
+{
+	(void)opaque;
+
+	return 0;
+}
+
+#define N_THREADS 4
+#define N_PARSES 500
+
+struct threaded_state {
+	struct ec_node *node;
+	uint64_t gen;
+	int ret;
+};
+
+static struct ec_node *build_threaded(struct ec_pnode *parse, void *opaque)
+{
+	(void)parse;
+	(void)opaque;
+
+	return EC_NODE_SEQ(EC_NO_ID, ec_node_str(EC_NO_ID, "x"), ec_node_str(EC_NO_ID, "y"));
+}
+
+static uint64_t get_threaded_generation(void *opaque)
+{
+	struct threaded_state *state = opaque;
+
+	return __atomic_load_n(&state->gen, __ATOMIC_RELAXED);
+}
+
+/* parse and complete while the other threads replace the cached child */
+static void *parse_thread(void *arg)
+{
+	struct threaded_state *state = arg;
+	struct ec_pnode *pnode;
+	struct ec_comp *comp;
+	unsigned int i;
+
+	for (i = 0; i < N_PARSES; i++) {
+		if (i % 8 == 0)
+			__atomic_add_fetch(&state->gen, 1, __ATOMIC_RELAXED);
+		pnode = ec_parse(state->node, "x");
+		comp = ec_complete(state->node, "x ");
+		if (pnode == NULL || comp == NULL || ec_comp_count(comp, EC_COMP_FULL) != 1) {
+			ec_pnode_free(pnode);
+			ec_comp_free(comp);
+			return NULL;
+		}
+		ec_pnode_free(pnode);
+		ec_comp_free(comp);
+	}
+
+	return arg;
+}
+
 EC_TEST_MAIN()
 {
+	struct threaded_state threaded = {0};
+	pthread_t threads[N_THREADS];
+	unsigned int i;
+	void *ret;
+	struct ec_node *recursive = NULL;
+	struct cached_state state = {0};
+	struct ec_pnode *pnode;
 	struct ec_node *node;
 	int testres = 0;
 
@@ -48,5 +151,71 @@ EC_TEST_MAIN()
 	);
 	ec_node_free(node);
 
+	/* the cached child is only rebuilt when the generation changes */
+	node = ec_node_many(
+		EC_NO_ID,
+		ec_node_dynamic_cached(EC_NO_ID, build_cached, get_generation, &state),
+		1,
+		3
+	);
+	if (node == NULL) {
+		EC_LOG(EC_LOG_ERR, "cannot create node\n");
+		return -1;
+	}
+	testres |= EC_TEST_CHECK_PARSE(node, 3, "gen-0", "gen-0", "gen-0");
+	testres |= EC_TEST_CHECK_COMPLETE(node, "g", EC_VA_END, "gen-0", EC_VA_END);
+	testres |= EC_TEST_CHECK(state.builds == 1, "child built %u times", state.builds);
+
+	/* a parse tree keeps the child it was built with */
+	pnode = ec_parse(node, "gen-0");
+	testres |= EC_TEST_CHECK(ec_pnode_matches(pnode), "parse should match");
+	state.gen++;
+	testres |= EC_TEST_CHECK_PARSE(node, -1, "gen-0");
+	testres |= EC_TEST_CHECK_PARSE(node, 2, "gen-1", "gen-1");
+	testres |= EC_TEST_CHECK(state.builds == 2, "child built %u times", state.builds);
+	testres |= EC_TEST_CHECK(
+		!strcmp(ec_node_id(ec_pnode_get_node(ec_pnode_find(pnode, "my-id"))), "my-id"),
+		"child of the parse tree should be valid"
+	);
+	ec_pnode_free(pnode);
+	ec_node_free(node);
+
+	/* the cached child references the dynamic node: the loop is freed
+	 * with the grammar */
+	recursive = ec_node_dynamic_cached(
+		EC_NO_ID, build_recursive, get_constant_generation, &recursive
+	);
+	node = EC_NODE_SEQ(EC_NO_ID, ec_node_str(EC_NO_ID, "a"), recursive);
+	if (node == NULL) {
+		EC_LOG(EC_LOG_ERR, "cannot create node\n");
+		return -1;
+	}
+	testres |= EC_TEST_CHECK_PARSE(node, 2, "a", "x");
+	testres |= EC_TEST_CHECK_PARSE(node, 4, "a", "x", "x", "x");
+	testres |= EC_TEST_CHECK_PARSE(node, -1, "a");
+	testres |= EC_TEST_CHECK_COMPLETE(node, "a", "x", "", EC_VA_END, "x", EC_VA_END);
+	ec_node_free(node);
+
+	/* the cached child is shared by the threads using the grammar */
+	threaded.node = ec_node_sh_lex(
+		EC_NO_ID,
+		ec_node_dynamic_cached(EC_NO_ID, build_threaded, get_threaded_generation, &threaded)
+	);
+	if (threaded.node == NULL) {
+		EC_LOG(EC_LOG_ERR, "cannot create node\n");
+		return -1;
+	}
+	for (i = 0; i < N_THREADS; i++) {
+		if (pthread_create(&threads[i], NULL, parse_thread, &threaded) != 0) {
+			EC_LOG(EC_LOG_ERR, "cannot create thread\n");
+			return -1;
+		}
+	}
+	for (i = 0; i < N_THREADS; i++) {
+		pthread_join(threads[i], &ret);
+		testres |= EC_TEST_CHECK(ret != NULL, "parse failed in thread %u", i);
+	}
+	ec_node_free(threaded.node);
+
 	return testres;
 }
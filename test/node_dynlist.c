@@ -14,8 +14,41 @@ static struct ec_strvec *get_names(struct ec_pnode *pstate, void *opaque)
 	return EC_STRVEC("foo", "bar", "baz");
 }
 
+static int lookup_name(struct ec_pnode *pstate, const char *name, void *opaque)
+{
+	(void)pstate;
+	(void)opaque;
+	return !strcmp(name, "foo") || !strcmp(name, "bar") || !strcmp(name, "baz");
+}
+
+static int iter_names(
+	struct ec_pnode *pstate,
+	const char *prefix,
+	ec_node_dynlist_iter_cb_t cb,
+	void *cb_arg,
+	void *opaque
+)
+{
+	const char *names[] = {"bar", "baz", "foo"};
+	size_t i;
+
+	(void)pstate;
+	(void)opaque;
+	for (i = 0; i < EC_COUNT_OF(names); i++) {
+		if (ec_str_startswith(names[i], prefix) && cb(names[i], cb_arg) < 0)
+			return -1;
+	}
+	return 0;
+}
+
+static const struct ec_node_dynlist_ops ops = {
+	.lookup = lookup_name,
+	.iter_prefix = iter_names,
+};
+
 EC_TEST_MAIN()
 {
+	struct ec_nameset *set;
 	struct ec_node *node;
 	int testres = 0;
 
@@ -73,5 +106,54 @@ EC_TEST_MAIN()
 	testres |= EC_TEST_CHECK_COMPLETE(node, "b", EC_VA_END, "bar", "baz", EC_VA_END);
 	ec_node_free(node);
 
+	/* test with lookup callbacks */
+	node = ec_node_dynlist_indexed(
+		EC_NO_ID, &ops, NULL, "[a-z]+", DYNLIST_MATCH_REGEXP | DYNLIST_EXCLUDE_LIST
+	);
+	if (node == NULL) {
+		EC_LOG(EC_LOG_ERR, "cannot create node\n");
+		return -1;
+	}
+	testres |= EC_TEST_CHECK_PARSE(node, -1, "foo");
+	testres |= EC_TEST_CHECK_PARSE(node, 1, "pouet");
+	ec_node_free(node);
+
+	node = ec_node_dynlist_indexed(EC_NO_ID, &ops, NULL, "[a-z]+", DYNLIST_MATCH_LIST);
+	if (node == NULL) {
+		EC_LOG(EC_LOG_ERR, "cannot create node\n");
+		return -1;
+	}
+	testres |= EC_TEST_CHECK_PARSE(node, 1, "foo");
+	testres |= EC_TEST_CHECK_PARSE(node, -1, "pouet");
+	testres |= EC_TEST_CHECK_COMPLETE(node, "", EC_VA_END, "foo", "bar", "baz", EC_VA_END);
+	testres |= EC_TEST_CHECK_COMPLETE(node, "b", EC_VA_END, "bar", "baz", EC_VA_END);
+	ec_node_free(node);
+
+	/* test with a name set, updated after the node is created */
+	set = ec_nameset();
+	if (set == NULL) {
+		EC_LOG(EC_LOG_ERR, "cannot create name set\n");
+		return -1;
+	}
+	node = ec_node_dynlist_nameset(EC_NO_ID, set, "[a-z]+", DYNLIST_MATCH_LIST);
+	if (node == NULL) {
+		EC_LOG(EC_LOG_ERR, "cannot create node\n");
+		ec_nameset_free(set);
+		return -1;
+	}
+	testres |= EC_TEST_CHECK_PARSE(node, -1, "foo");
+	testres |= EC_TEST_CHECK(
+		ec_nameset_add(set, "foo") == 0 && ec_nameset_add(set, "bar") == 0
+			&& ec_nameset_add(set, "baz") == 0,
+		"cannot add names"
+	);
+	ec_nameset_free(set); /* the node holds a reference */
+	testres |= EC_TEST_CHECK_PARSE(node, 1, "foo");
+	testres |= EC_TEST_CHECK_PARSE(node, -1, "pouet");
+	testres |= EC_TEST_CHECK_COMPLETE(node, "", EC_VA_END, "foo", "bar", "baz", EC_VA_END);
+	testres |= EC_TEST_CHECK_COMPLETE(node, "b", EC_VA_END, "bar", "baz", EC_VA_END);
+	testres |= EC_TEST_CHECK_COMPLETE(node, "x", EC_VA_END, EC_VA_END);
+	ec_node_free(node);
+
 	return testres;
 }
@@ -6,12 +6,18 @@
 #include <errno.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/inotify.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 
 #include "test.h"
 
+static unsigned int test_open_count;
+static unsigned int test_dirent_idx;
+static bool test_baz_created;
+static bool test_event_pending;
+
 static int test_lstat(const char *pathname, struct stat *buf)
 {
 	if (!strcmp(pathname, "/tmp/toto/")) {
@@ -24,55 +30,72 @@ static int test_lstat(const char *pathname, struct stat *buf)
 	return -1;
 }
 
-static DIR *test_opendir(const char *name)
+static int test_open(const char *pathname, int flags)
 {
-	int *p;
+	(void)flags;
 
-	if (strcmp(name, "/tmp/toto/")) {
+	if (strcmp(pathname, "/tmp/toto/")) {
 		errno = ENOENT;
-		return NULL;
+		return -1;
 	}
 
-	p = malloc(sizeof(int));
-	if (p)
-		*p = 0;
+	test_open_count++;
+	test_dirent_idx = 0;
 
-	return (DIR *)p;
+	return 3;
 }
 
-static struct dirent *test_readdir(DIR *dirp)
+struct test_dirent64 {
+	uint64_t d_ino;
+	int64_t d_off;
+	unsigned short d_reclen;
+	unsigned char d_type;
+	char d_name[];
+};
+
+/* return at most 3 entries per call */
+static ssize_t test_getdents64(int fd, void *dirp, size_t count)
 {
-	static struct dirent de[] = {
-		{.d_type = DT_DIR, .d_name = ".."},
-		{.d_type = DT_DIR, .d_name = "."},
-		{.d_type = DT_REG, .d_name = "bar"},
-		{.d_type = DT_UNKNOWN, .d_name = "bar2"},
-		{.d_type = DT_REG, .d_name = "foo"},
-		{.d_type = DT_DIR, .d_name = "titi"},
-		{.d_type = DT_UNKNOWN, .d_name = "tutu"},
-		{.d_name = ""},
+	static const struct {
+		unsigned char type;
+		const char *name;
+	} de[] = {
+		{DT_DIR, ".."},
+		{DT_DIR, "."},
+		{DT_REG, "bar"},
+		{DT_UNKNOWN, "bar2"},
+		{DT_REG, "foo"},
+		{DT_DIR, "titi"},
+		{DT_UNKNOWN, "tutu"},
+		{DT_LNK, "tata"},
+		{DT_LNK, "dangling"},
+		{DT_REG, "baz"},
 	};
-	int *p = (int *)dirp;
-	struct dirent *ret = &de[*p];
-
-	if (!strcmp(ret->d_name, ""))
-		return NULL;
+	struct test_dirent64 *ent;
+	size_t len = 0, reclen;
+	unsigned int n;
 
-	*p = *p + 1;
-
-	return ret;
-}
+	(void)fd;
 
-static int test_closedir(DIR *dirp)
-{
-	free(dirp);
-	return 0;
-}
+	for (n = 0; n < 3 && test_dirent_idx < EC_COUNT_OF(de); test_dirent_idx++) {
+		if (!strcmp(de[test_dirent_idx].name, "baz") && !test_baz_created)
+			continue;
+		reclen = sizeof(*ent) + strlen(de[test_dirent_idx].name) + 1;
+		reclen = (reclen + 7) & ~(size_t)7;
+		if (len + reclen > count) {
+			errno = EINVAL;
+			return -1;
+		}
+		ent = (struct test_dirent64 *)((char *)dirp + len);
+		memset(ent, 0, reclen);
+		ent->d_reclen = reclen;
+		ent->d_type = de[test_dirent_idx].type;
+		strcpy(ent->d_name, de[test_dirent_idx].name);
+		len += reclen;
+		n++;
+	}
 
-static int test_dirfd(DIR *dirp)
-{
-	int *p = (int *)dirp;
-	return *p;
+	return len;
 }
 
 static int test_fstatat(int dirfd, const char *pathname, struct stat *buf, int flags)
@@ -84,7 +107,7 @@ static int test_fstatat(int dirfd, const char *pathname, struct stat *buf, int f
 		struct stat st = {.st_mode = S_IFREG};
 		memcpy(buf, &st, sizeof(*buf));
 		return 0;
-	} else if (!strcmp(pathname, "tutu")) {
+	} else if (!strcmp(pathname, "tutu") || !strcmp(pathname, "tata")) {
 		struct stat st = {.st_mode = S_IFDIR};
 		memcpy(buf, &st, sizeof(*buf));
 		return 0;
@@ -94,13 +117,65 @@ static int test_fstatat(int dirfd, const char *pathname, struct stat *buf, int f
 	return -1;
 }
 
+static int test_inotify_init1(int flags)
+{
+	(void)flags;
+	return 100;
+}
+
+static int test_inotify_add_watch(int fd, const char *pathname, uint32_t mask)
+{
+	(void)fd;
+	(void)mask;
+
+	if (strcmp(pathname, "/tmp/toto/")) {
+		errno = ENOENT;
+		return -1;
+	}
+
+	return 1;
+}
+
+static int test_inotify_rm_watch(int fd, int wd)
+{
+	(void)fd;
+	(void)wd;
+	return 0;
+}
+
+static ssize_t test_read(int fd, void *buf, size_t count)
+{
+	struct inotify_event ev = {.wd = 1, .mask = IN_CREATE};
+
+	(void)fd;
+
+	if (!test_event_pending || count < sizeof(ev)) {
+		errno = EAGAIN;
+		return -1;
+	}
+
+	test_event_pending = false;
+	memcpy(buf, &ev, sizeof(ev));
+
+	return sizeof(ev);
+}
+
+static int test_close(int fd)
+{
+	(void)fd;
+	return 0;
+}
+
 static struct ec_node_file_ops test_ops = {
 	.lstat = test_lstat,
-	.opendir = test_opendir,
-	.readdir = test_readdir,
-	.closedir = test_closedir,
-	.dirfd = test_dirfd,
+	.open = test_open,
+	.getdents64 = test_getdents64,
 	.fstatat = test_fstatat,
+	.inotify_init1 = test_inotify_init1,
+	.inotify_add_watch = test_inotify_add_watch,
+	.inotify_rm_watch = test_inotify_rm_watch,
+	.read = test_read,
+	.close = test_close,
 };
 
 EC_TEST_MAIN()
@@ -125,7 +200,13 @@ EC_TEST_MAIN()
 	testres |= EC_TEST_CHECK_COMPLETE(node, EC_VA_END, EC_VA_END);
 	testres |= EC_TEST_CHECK_COMPLETE(node, "/tmp/toto/t", EC_VA_END, EC_VA_END);
 	testres |= EC_TEST_CHECK_COMPLETE_PARTIAL(
-		node, "/tmp/toto/t", EC_VA_END, "/tmp/toto/titi/", "/tmp/toto/tutu/", EC_VA_END
+		node,
+		"/tmp/toto/t",
+		EC_VA_END,
+		"/tmp/toto/titi/",
+		"/tmp/toto/tutu/",
+		"/tmp/toto/tata/",
+		EC_VA_END
 	);
 	testres |= EC_TEST_CHECK_COMPLETE(
 		node, "/tmp/toto/f", EC_VA_END, "/tmp/toto/foo", EC_VA_END
@@ -133,8 +214,52 @@ EC_TEST_MAIN()
 	testres |= EC_TEST_CHECK_COMPLETE(
 		node, "/tmp/toto/b", EC_VA_END, "/tmp/toto/bar", "/tmp/toto/bar2", EC_VA_END
 	);
+	testres |= EC_TEST_CHECK_COMPLETE(
+		node, "/tmp/toto/d", EC_VA_END, "/tmp/toto/dangling", EC_VA_END
+	);
+	testres |= EC_TEST_CHECK_COMPLETE_PARTIAL(
+		node, "/tmp/toto/.", EC_VA_END, "/tmp/toto/./", "/tmp/toto/../", EC_VA_END
+	);
+
+	/* test the directory cache, invalidated by an inotify event */
+	if (ec_node_file_set_cache(true) < 0) {
+		EC_LOG(EC_LOG_ERR, "cannot enable cache\n");
+		testres = -1;
+	}
+	test_open_count = 0;
+	testres |= EC_TEST_CHECK_COMPLETE(
+		node, "/tmp/toto/b", EC_VA_END, "/tmp/toto/bar", "/tmp/toto/bar2", EC_VA_END
+	);
+	testres |= EC_TEST_CHECK_COMPLETE_PARTIAL(
+		node,
+		"/tmp/toto/t",
+		EC_VA_END,
+		"/tmp/toto/titi/",
+		"/tmp/toto/tutu/",
+		"/tmp/toto/tata/",
+		EC_VA_END
+	);
+	testres |= EC_TEST_CHECK(test_open_count == 1, "directory was read again");
+	test_baz_created = true;
+	testres |= EC_TEST_CHECK_COMPLETE(
+		node, "/tmp/toto/b", EC_VA_END, "/tmp/toto/bar", "/tmp/toto/bar2", EC_VA_END
+	);
+	test_event_pending = true;
+	testres |= EC_TEST_CHECK_COMPLETE(
+		node,
+		"/tmp/toto/b",
+		EC_VA_END,
+		"/tmp/toto/bar",
+		"/tmp/toto/bar2",
+		"/tmp/toto/baz",
+		EC_VA_END
+	);
+	testres |= EC_TEST_CHECK(test_open_count == 2, "directory was not read again");
+	ec_node_file_set_cache(false);
+	test_baz_created = false;
 
 	ec_node_free(node);
+	ec_node_file_set_ops(NULL);
 
 	return testres;
 }
@@ -0,0 +1,132 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2025, Olivier MATZ <zer0@droids-corp.org>
+ */
+
+#include <assert.h>
+#include <errno.h>
+
+#include "test.h"
+
+static struct ec_node *vlan_cmd(const char *name)
+{
+	struct ec_node *detail;
+
+	detail = ec_node_intern(ec_node_str(EC_NO_ID, "detail"));
+
+	return ec_node_intern(EC_NODE_SEQ(
+		EC_NO_ID,
+		ec_node_intern(ec_node_str(EC_NO_ID, name)),
+		ec_node_intern(ec_node_int("vlan", 0, 4094, 10)),
+		ec_node_intern(ec_node_option(EC_NO_ID, detail))
+	));
+}
+
+EC_TEST_MAIN()
+{
+	struct ec_node *node1 = NULL, *node2 = NULL, *node3 = NULL;
+	struct ec_node *child1, *child2;
+	int testres = 0;
+
+	/* identical leaves are shared */
+	node1 = ec_node_intern(ec_node_str(EC_NO_ID, "foo"));
+	node2 = ec_node_intern(ec_node_str(EC_NO_ID, "foo"));
+	node3 = ec_node_intern(ec_node_str(EC_NO_ID, "bar"));
+	if (node1 == NULL || node2 == NULL || node3 == NULL)
+		goto fail;
+	testres |= EC_TEST_CHECK(node1 == node2, "identical nodes are not shared\n");
+	testres |= EC_TEST_CHECK(node1 != node3, "different nodes are shared\n");
+	testres |= EC_TEST_CHECK(ec_node_intern(node1) == node1, "bad intern of interned node\n");
+	ec_node_free(node1);
+	ec_node_free(node2);
+	ec_node_free(node3);
+	node1 = NULL;
+	node2 = NULL;
+	node3 = NULL;
+
+	/* the id and the attributes are part of the key */
+	node1 = ec_node_intern(ec_node_int(EC_NO_ID, 0, 10, 10));
+	node2 = ec_node_intern(ec_node_int("id", 0, 10, 10));
+	node3 = ec_node_intern(ec_node_int(EC_NO_ID, 0, 10, 16));
+	if (node1 == NULL || node2 == NULL || node3 == NULL)
+		goto fail;
+	testres |= EC_TEST_CHECK(node1 != node2, "nodes with different ids are shared\n");
+	testres |= EC_TEST_CHECK(node1 != node3, "nodes with different configs are shared\n");
+	ec_node_free(node2);
+	ec_node_free(node3);
+	node2 = ec_node_int(EC_NO_ID, 0, 10, 10);
+	node3 = ec_node_int(EC_NO_ID, 0, 10, 10);
+	if (node2 == NULL || node3 == NULL)
+		goto fail;
+	if (ec_interact_set_help(node2, "help") < 0 || ec_interact_set_help(node3, "help") < 0)
+		goto fail;
+	node2 = ec_node_intern(node2);
+	node3 = ec_node_intern(node3);
+	if (node2 == NULL || node3 == NULL)
+		goto fail;
+	testres |= EC_TEST_CHECK(node1 != node2, "nodes with different attributes are shared\n");
+	testres |= EC_TEST_CHECK(node2 == node3, "nodes with the same help are not shared\n");
+	ec_node_free(node1);
+	ec_node_free(node2);
+	ec_node_free(node3);
+	node1 = NULL;
+	node2 = NULL;
+	node3 = NULL;
+
+	/* identical subtrees are shared if their children are interned */
+	node1 = vlan_cmd("vlan");
+	node2 = vlan_cmd("vlan");
+	node3 = vlan_cmd("vlan-id");
+	if (node1 == NULL || node2 == NULL || node3 == NULL)
+		goto fail;
+	testres |= EC_TEST_CHECK(node1 == node2, "identical subtrees are not shared\n");
+	testres |= EC_TEST_CHECK(node1 != node3, "different subtrees are shared\n");
+	if (ec_node_get_child(node1, 1, &child1) < 0 || ec_node_get_child(node3, 1, &child2) < 0)
+		goto fail;
+	testres |= EC_TEST_CHECK(child1 == child2, "identical children are not shared\n");
+	testres |= EC_TEST_CHECK_PARSE(node1, 3, "vlan", "42", "detail");
+	testres |= EC_TEST_CHECK_PARSE(node3, 2, "vlan-id", "4094");
+	testres |= EC_TEST_CHECK_PARSE(node3, -1, "vlan-id", "4095");
+	ec_node_free(node1);
+	ec_node_free(node2);
+	ec_node_free(node3);
+	node1 = NULL;
+	node2 = NULL;
+	node3 = NULL;
+
+	/* a modified node is not interned anymore */
+	node1 = ec_node_intern(EC_NODE_OR(EC_NO_ID, ec_node_intern(ec_node_str(EC_NO_ID, "x"))));
+	if (node1 == NULL)
+		goto fail;
+	node2 = node1;
+	node1 = NULL;
+	if (ec_node_or_add(node2, ec_node_str(EC_NO_ID, "y")) < 0)
+		goto fail;
+	node1 = ec_node_intern(EC_NODE_OR(EC_NO_ID, ec_node_intern(ec_node_str(EC_NO_ID, "x"))));
+	if (node1 == NULL)
+		goto fail;
+	testres |= EC_TEST_CHECK(node1 != node2, "modified node is still interned\n");
+	ec_node_free(node1);
+	ec_node_free(node2);
+	node1 = NULL;
+	node2 = NULL;
+
+	/* nodes without configuration are not interned */
+	node1 = ec_node_intern(ec_node("space", EC_NO_ID));
+	node2 = ec_node_intern(ec_node("space", EC_NO_ID));
+	if (node1 == NULL || node2 == NULL)
+		goto fail;
+	testres |= EC_TEST_CHECK(node1 != node2, "nodes without config are shared\n");
+	ec_node_free(node1);
+	ec_node_free(node2);
+	node1 = NULL;
+	node2 = NULL;
+
+	return testres;
+
+fail:
+	ec_node_free(node1);
+	ec_node_free(node2);
+	ec_node_free(node3);
+	assert(errno != 0);
+	return -1;
+}
@@ -0,0 +1,89 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2025, Olivier MATZ <zer0@droids-corp.org>
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include "test.h"
+
+EC_TEST_MAIN()
+{
+	struct ec_node *node;
+	const char *keyword;
+	int testres = 0;
+
+	node = EC_NODE_KEYWORDS(EC_NO_ID, false, "foo", "bar", "bar2", "toto", "titi", "foo");
+	if (node == NULL) {
+		EC_LOG(EC_LOG_ERR, "cannot create node\n");
+		return -1;
+	}
+	testres |= EC_TEST_CHECK_PARSE(node, 1, "foo");
+	testres |= EC_TEST_CHECK_PARSE(node, 1, "bar");
+	testres |= EC_TEST_CHECK_PARSE(node, 1, "bar2", "foo");
+	testres |= EC_TEST_CHECK_PARSE(node, -1, "fo");
+	testres |= EC_TEST_CHECK_PARSE(node, -1, "foox");
+	testres |= EC_TEST_CHECK_PARSE(node, -1, "zzz");
+	testres |= EC_TEST_CHECK_PARSE(node, -1, "");
+	testres |= EC_TEST_CHECK_PARSE(node, -1);
+
+	/* duplicates are only completed once */
+	testres |= EC_TEST_CHECK_COMPLETE(
+		node, "", EC_VA_END, "foo", "bar", "bar2", "toto", "titi", EC_VA_END
+	);
+	testres |= EC_TEST_CHECK_COMPLETE(node, "f", EC_VA_END, "foo", EC_VA_END);
+	testres |= EC_TEST_CHECK_COMPLETE(node, "b", EC_VA_END, "bar", "bar2", EC_VA_END);
+	testres |= EC_TEST_CHECK_COMPLETE(node, "bar", EC_VA_END, "bar", "bar2", EC_VA_END);
+	testres |= EC_TEST_CHECK_COMPLETE(node, "t", EC_VA_END, "toto", "titi", EC_VA_END);
+	testres |= EC_TEST_CHECK_COMPLETE(node, "to", EC_VA_END, "toto", EC_VA_END);
+	testres |= EC_TEST_CHECK_COMPLETE(node, "x", EC_VA_END, EC_VA_END);
+	testres |= EC_TEST_CHECK_COMPLETE(node, "zzz", EC_VA_END, EC_VA_END);
+	testres |= EC_TEST_CHECK_COMPLETE(node, "bar", "b", EC_VA_END, EC_VA_END);
+
+	keyword = ec_node_keywords_match(node, "fo");
+	testres |= EC_TEST_CHECK(keyword == NULL && errno == ENOENT, "fo should not match");
+	ec_node_free(node);
+
+	node = EC_NODE_KEYWORDS(EC_NO_ID, true, "interface", "ip", "ipv6", "route", "rib");
+	if (node == NULL) {
+		EC_LOG(EC_LOG_ERR, "cannot create node\n");
+		return -1;
+	}
+	testres |= EC_TEST_CHECK_PARSE(node, 1, "interface");
+	testres |= EC_TEST_CHECK_PARSE(node, 1, "int");
+	testres |= EC_TEST_CHECK_PARSE(node, 1, "ip");
+	testres |= EC_TEST_CHECK_PARSE(node, 1, "ipv");
+	testres |= EC_TEST_CHECK_PARSE(node, 1, "ro", "foo");
+	testres |= EC_TEST_CHECK_PARSE(node, -1, "i");
+	testres |= EC_TEST_CHECK_PARSE(node, -1, "r");
+	testres |= EC_TEST_CHECK_PARSE(node, -1, "routes");
+	testres |= EC_TEST_CHECK_PARSE(node, -1, "");
+	testres |= EC_TEST_CHECK_COMPLETE(
+		node, "i", EC_VA_END, "interface", "ip", "ipv6", EC_VA_END
+	);
+	testres |= EC_TEST_CHECK_COMPLETE(node, "ip", EC_VA_END, "ip", "ipv6", EC_VA_END);
+	testres |= EC_TEST_CHECK_COMPLETE(node, "ri", EC_VA_END, "rib", EC_VA_END);
+
+	keyword = ec_node_keywords_match(node, "in");
+	testres |= EC_TEST_CHECK(
+		keyword != NULL && strcmp(keyword, "interface") == 0, "bad match for in"
+	);
+	keyword = ec_node_keywords_match(node, "ip");
+	testres |= EC_TEST_CHECK(keyword != NULL && strcmp(keyword, "ip") == 0, "bad match for ip");
+	keyword = ec_node_keywords_match(node, "i");
+	testres |= EC_TEST_CHECK(keyword == NULL, "i should not match");
+	ec_node_free(node);
+
+	/* an empty keywords node never matches */
+	node = ec_node_keywords(EC_NO_ID, NULL, 0, true);
+	if (node == NULL) {
+		EC_LOG(EC_LOG_ERR, "cannot create node\n");
+		return -1;
+	}
+	testres |= EC_TEST_CHECK_PARSE(node, -1, "foo");
+	testres |= EC_TEST_CHECK_PARSE(node, -1, "");
+	testres |= EC_TEST_CHECK_COMPLETE(node, "", EC_VA_END, EC_VA_END);
+	ec_node_free(node);
+
+	return testres;
+}
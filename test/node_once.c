@@ -6,7 +6,7 @@
 
 EC_TEST_MAIN()
 {
-	struct ec_node *node;
+	struct ec_node *node, *child;
 	int testres = 0;
 
 	node = ec_node_many(
@@ -40,5 +40,27 @@ EC_TEST_MAIN()
 	testres |= EC_TEST_CHECK_COMPLETE(node, "bar", "", EC_VA_END, "foo", "bar", EC_VA_END);
 	ec_node_free(node);
 
+	/* an occurrence that was parsed then discarded is not counted */
+	child = ec_node_str(EC_NO_ID, "foo");
+	node = EC_NODE_OR(
+		EC_NO_ID,
+		EC_NODE_SEQ(EC_NO_ID, ec_node_once(EC_NO_ID, child), ec_node_str(EC_NO_ID, "bar")),
+		EC_NODE_SEQ(
+			EC_NO_ID,
+			ec_node_once(EC_NO_ID, ec_node_clone(child)),
+			ec_node_once(EC_NO_ID, ec_node_clone(child))
+		),
+		ec_node_once(EC_NO_ID, ec_node_clone(child))
+	);
+	if (node == NULL) {
+		EC_LOG(EC_LOG_ERR, "cannot create node\n");
+		return -1;
+	}
+	testres |= EC_TEST_CHECK_PARSE(node, 2, "foo", "bar");
+	testres |= EC_TEST_CHECK_PARSE(node, 1, "foo", "foo");
+	testres |= EC_TEST_CHECK_PARSE(node, 1, "foo");
+	testres |= EC_TEST_CHECK_COMPLETE(node, "foo", "", EC_VA_END, "bar", EC_VA_END);
+	ec_node_free(node);
+
 	return testres;
 }
@@ -0,0 +1,381 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2025, Olivier MATZ <zer0@droids-corp.org>
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "test.h"
+
+/* the inputs on which the original and optimized grammars are compared */
+static const char *const corpus[] = {
+	"",
+	"show",
+	"show ",
+	"show i",
+	"show ip",
+	"show ip ",
+	"show ip red",
+	"show ip red ",
+	"show ip green 12",
+	"show ip blue 12 4",
+	"show ip cyan 12 4",
+	"show ip gr",
+	"show ip magenta",
+	"show ip magenta 3",
+	"show ip 42",
+	"show ip 42 ",
+	"show ip yellow",
+	"show ip yellow yellow",
+	"show ip black 1",
+	"show ip y",
+	"show ip red red",
+	"show ip red 1 2 3",
+	"show route",
+	"show route ",
+	"show route all",
+	"show route all verbose",
+	"show route 10.0.0.1",
+	"show route all 10.0.0.1 v",
+	"vlan",
+	"vlan ",
+	"vlan add",
+	"vlan add 12",
+	"vlan add 12 ",
+	"vlan add 12 detail",
+	"vlan del name x",
+	"vlan del name x brief full",
+	"vlan show 4095",
+	"vlan show 3 v",
+	"vlan show 3 verbose",
+	"vlan show 3 verbose ",
+	"x",
+};
+
+static struct ec_node *build_grammar(void)
+{
+	struct ec_node *red = NULL, *color = NULL, *args = NULL, *route = NULL, *cmd = NULL;
+
+	red = ec_node_str(EC_NO_ID, "red");
+	if (red == NULL || ec_interact_set_help(red, "the red color") < 0)
+		goto fail;
+
+	color = EC_NODE_OR(
+		"color",
+		EC_NODE_OR(
+			EC_NO_ID,
+			red,
+			ec_node_str(EC_NO_ID, "green"),
+			ec_node_str(EC_NO_ID, "blue")
+		),
+		ec_node_str(EC_NO_ID, "cyan"),
+		ec_node_str(EC_NO_ID, "magenta"),
+		ec_node_bypass(EC_NO_ID, ec_node_int("num", 0, 100, 10)),
+		ec_node_str(EC_NO_ID, "yellow"),
+		ec_node_str(EC_NO_ID, "black"),
+		ec_node_str(EC_NO_ID, "yellow")
+	);
+	red = NULL;
+	if (color == NULL)
+		goto fail;
+
+	args = ec_node_option(
+		EC_NO_ID,
+		ec_node_option(
+			EC_NO_ID,
+			EC_NODE_SEQ(
+				EC_NO_ID,
+				EC_NODE_SEQ(EC_NO_ID, ec_node_int("a", 0, 100, 10)),
+				ec_node_option(EC_NO_ID, ec_node_int("b", 0, 100, 10))
+			)
+		)
+	);
+	if (args == NULL)
+		goto fail;
+
+	route = ec_node_many(
+		EC_NO_ID,
+		EC_NODE_OR(
+			EC_NO_ID,
+			ec_node_bypass(EC_NO_ID, ec_node_str(EC_NO_ID, "all")),
+			ec_node_re("ip", "[0-9.]+"),
+			ec_node_str(EC_NO_ID, "verbose")
+		),
+		0,
+		3
+	);
+	if (route == NULL)
+		goto fail;
+
+	cmd = EC_NODE_CMD(
+		"vlan",
+		"vlan (add|del|show) (id|name x) [detail|brief|full] [verbose]",
+		ec_node_int("id", 0, 4094, 10),
+		ec_node_str("name", "name")
+	);
+	if (cmd == NULL)
+		goto fail;
+
+	return EC_NODE_OR(
+		EC_NO_ID,
+		EC_NODE_SEQ(
+			EC_NO_ID,
+			ec_node_str(EC_NO_ID, "show"),
+			EC_NODE_OR(
+				EC_NO_ID,
+				EC_NODE_SEQ(EC_NO_ID, ec_node_str(EC_NO_ID, "ip"), color, args),
+				EC_NODE_SEQ(EC_NO_ID, ec_node_str(EC_NO_ID, "route"), route)
+			)
+		),
+		cmd
+	);
+
+fail:
+	ec_node_free(red);
+	ec_node_free(color);
+	ec_node_free(args);
+	ec_node_free(route);
+	ec_node_free(cmd);
+	return NULL;
+}
+
+/* Describe a parse tree, keeping only the nodes with an identifier. */
+static void pnode_desc(FILE *f, const struct ec_pnode *pnode)
+{
+	const struct ec_strvec *strvec = ec_pnode_get_strvec(pnode);
+	const char *id = ec_node_id(ec_pnode_get_node(pnode));
+	const struct ec_pnode *child;
+	size_t i;
+
+	if (strcmp(id, EC_NO_ID)) {
+		fprintf(f, "%s[", id);
+		for (i = 0; i < ec_strvec_len(strvec); i++)
+			fprintf(f, " %s", ec_strvec_val(strvec, i));
+		fprintf(f, " ](");
+	}
+	EC_PNODE_FOREACH_CHILD (child, pnode)
+		pnode_desc(f, child);
+	if (strcmp(id, EC_NO_ID))
+		fprintf(f, ")");
+}
+
+static int cmp_item(const void *p1, const void *p2)
+{
+	return strcmp(*(char *const *)p1, *(char *const *)p2);
+}
+
+/* Describe the parse tree and the completions of an input. */
+static char *input_desc(struct ec_node *node, const char *line)
+{
+	struct ec_strvec *strvec = NULL;
+	struct ec_pnode *pnode = NULL;
+	struct ec_comp *comp = NULL;
+	struct ec_comp_item *item;
+	const char **items = NULL;
+	char *buf = NULL;
+	size_t len, i;
+	FILE *f;
+
+	f = open_memstream(&buf, &len);
+	if (f == NULL)
+		return NULL;
+
+	strvec = ec_strvec_sh_lex_str(line, EC_STRVEC_TRAILSP, NULL);
+	if (strvec == NULL)
+		goto fail;
+
+	pnode = ec_parse_strvec(node, strvec);
+	if (pnode == NULL)
+		goto fail;
+	if (ec_pnode_matches(pnode)) {
+		fprintf(f, "match %zu: ", ec_pnode_len(pnode));
+		pnode_desc(f, pnode);
+	} else {
+		fprintf(f, "no match");
+	}
+
+	/* the completions are sorted, a keywords node returns them in order */
+	if (ec_strvec_len(strvec) > 0) {
+		comp = ec_complete_strvec(node, strvec);
+		if (comp == NULL)
+			goto fail;
+		len = ec_comp_count(comp, EC_COMP_ALL);
+		items = calloc(len + 1, sizeof(*items));
+		if (items == NULL)
+			goto fail;
+		i = 0;
+		EC_COMP_FOREACH(item, comp, EC_COMP_ALL)
+		{
+			items[i] = ec_comp_item_get_str(item);
+			if (items[i] == NULL)
+				items[i] = "<unknown>";
+			i++;
+		}
+		qsort(items, len, sizeof(*items), cmp_item);
+		fprintf(f, ", complete:");
+		for (i = 0; i < len; i++)
+			fprintf(f, " %s", items[i]);
+	}
+
+	free(items);
+	ec_comp_free(comp);
+	ec_pnode_free(pnode);
+	ec_strvec_free(strvec);
+	if (fclose(f) != 0) {
+		free(buf);
+		return NULL;
+	}
+	return buf;
+
+fail:
+	free(items);
+	ec_comp_free(comp);
+	ec_pnode_free(pnode);
+	ec_strvec_free(strvec);
+	fclose(f);
+	free(buf);
+	return NULL;
+}
+
+struct count_arg {
+	const char *type_name;
+	size_t count;
+};
+
+static int count_cb(struct ec_node *node, struct ec_node *parent, void *opaque)
+{
+	struct count_arg *arg = opaque;
+
+	(void)parent;
+
+	if (arg->type_name == NULL || !strcmp(ec_node_get_type_name(node), arg->type_name))
+		arg->count++;
+	return EC_NODE_VISIT_CONTINUE;
+}
+
+/* Count the nodes of a grammar, or the nodes of a given type. */
+static size_t count_nodes(struct ec_node *node, const char *type_name)
+{
+	struct count_arg arg = {
+		.type_name = type_name,
+		.count = 0,
+	};
+
+	if (ec_node_visit(node, count_cb, NULL, &arg) < 0)
+		return 0;
+	return arg.count;
+}
+
+EC_TEST_MAIN()
+{
+	struct ec_node *node = NULL, *optimized = NULL, *child;
+	char *desc1, *desc2;
+	int testres = 0;
+	size_t i;
+
+	testres |= EC_TEST_CHECK(ec_node_optimize(NULL) == NULL, "bad optimization of NULL\n");
+
+	/* the optimized grammar parses and completes like the original one */
+	node = build_grammar();
+	optimized = ec_node_optimize(build_grammar());
+	if (node == NULL || optimized == NULL)
+		goto fail;
+	testres |= EC_TEST_CHECK(
+		count_nodes(optimized, NULL) < count_nodes(node, NULL), "grammar is not optimized\n"
+	);
+	testres |= EC_TEST_CHECK(count_nodes(optimized, "bypass") == 0, "bypass is not removed\n");
+	testres |= EC_TEST_CHECK(count_nodes(optimized, "keywords") == 3, "str are not merged\n");
+
+	for (i = 0; i < EC_COUNT_OF(corpus); i++) {
+		desc1 = input_desc(node, corpus[i]);
+		desc2 = input_desc(optimized, corpus[i]);
+		if (desc1 == NULL || desc2 == NULL) {
+			free(desc1);
+			free(desc2);
+			goto fail;
+		}
+		testres |= EC_TEST_CHECK(
+			!strcmp(desc1, desc2),
+			"<%s>: <%s> != <%s>\n",
+			corpus[i],
+			desc1,
+			desc2
+		);
+		free(desc1);
+		free(desc2);
+	}
+
+	/* the identifiers and attributes are kept */
+	testres |= EC_TEST_CHECK(ec_node_find(optimized, "color") != NULL, "color not found\n");
+	testres |= EC_TEST_CHECK(ec_node_find(optimized, "num") != NULL, "num not found\n");
+	testres |= EC_TEST_CHECK(ec_node_find(optimized, "name") != NULL, "name not found\n");
+	testres |= EC_TEST_CHECK_COMPLETE(
+		optimized, "show", "ip", "r", EC_VA_END, "red", EC_VA_END
+	);
+	ec_node_free(node);
+	ec_node_free(optimized);
+	node = NULL;
+	optimized = NULL;
+
+	/* the root is replaced by its child */
+	optimized = ec_node_optimize(
+		ec_node_bypass(EC_NO_ID, EC_NODE_SEQ(EC_NO_ID, ec_node_str("foo", "foo")))
+	);
+	if (optimized == NULL)
+		goto fail;
+	testres |= EC_TEST_CHECK(!strcmp(ec_node_id(optimized), "foo"), "root is not replaced\n");
+	testres |= EC_TEST_CHECK_PARSE(optimized, 1, "foo");
+	ec_node_free(optimized);
+	optimized = NULL;
+
+	/* the nodes below a once node are not modified */
+	optimized = ec_node_optimize(EC_NODE_SEQ(
+		EC_NO_ID,
+		ec_node_once(
+			EC_NO_ID,
+			EC_NODE_SEQ(EC_NO_ID, EC_NODE_SEQ(EC_NO_ID, ec_node_str(EC_NO_ID, "foo")))
+		),
+		ec_node_str(EC_NO_ID, "bar")
+	));
+	if (optimized == NULL)
+		goto fail;
+	testres |= EC_TEST_CHECK(
+		ec_node_get_child(optimized, 0, &child) == 0
+			&& ec_node_get_child(child, 0, &child) == 0
+			&& ec_node_get_child(child, 0, &child) == 0
+			&& !strcmp(ec_node_get_type_name(child), "seq"),
+		"child of once node is modified\n"
+	);
+	testres |= EC_TEST_CHECK_PARSE(optimized, 2, "foo", "bar");
+	ec_node_free(optimized);
+	optimized = NULL;
+
+	/* loops are supported */
+	node = ec_node_or(EC_NO_ID);
+	if (node == NULL)
+		goto fail;
+	child = EC_NODE_SEQ(EC_NO_ID, ec_node_str(EC_NO_ID, "x"), ec_node_clone(node));
+	if (ec_node_or_add(node, child) < 0)
+		goto fail;
+	if (ec_node_or_add(node, ec_node_bypass(EC_NO_ID, ec_node_str(EC_NO_ID, "y"))) < 0)
+		goto fail;
+	optimized = ec_node_optimize(node);
+	node = NULL;
+	if (optimized == NULL)
+		goto fail;
+	testres |= EC_TEST_CHECK_PARSE(optimized, 3, "x", "x", "y");
+	testres |= EC_TEST_CHECK_PARSE(optimized, -1, "x", "x");
+	ec_node_free(optimized);
+	optimized = NULL;
+
+	return testres;
+
+fail:
+	ec_node_free(node);
+	ec_node_free(optimized);
+	assert(errno != 0);
+	return -1;
+}
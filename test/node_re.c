@@ -2,6 +2,8 @@
  * Copyright 2016, Olivier MATZ <zer0@droids-corp.org>
  */
 
+#include <errno.h>
+
 #include "test.h"
 
 EC_TEST_MAIN()
@@ -22,5 +24,39 @@ EC_TEST_MAIN()
 	testres |= EC_TEST_CHECK_PARSE(node, -1, "");
 	ec_node_free(node);
 
+	/* the whole string must match, whatever the alternative order */
+	node = ec_node_re(EC_NO_ID, "a|ab|b");
+	if (node == NULL) {
+		EC_LOG(EC_LOG_ERR, "cannot create node\n");
+		return -1;
+	}
+	testres |= EC_TEST_CHECK_PARSE(node, 1, "a");
+	testres |= EC_TEST_CHECK_PARSE(node, 1, "ab");
+	testres |= EC_TEST_CHECK_PARSE(node, 1, "b");
+	testres |= EC_TEST_CHECK_PARSE(node, -1, "ba");
+	testres |= EC_TEST_CHECK_PARSE(node, -1, "abb");
+	ec_node_free(node);
+
+	node = ec_node_re(
+		EC_NO_ID,
+		"((25[0-5]|2[0-4][0-9]|1[0-9][0-9]|[1-9][0-9]|[0-9])\\.){3}"
+		"(25[0-5]|2[0-4][0-9]|1[0-9][0-9]|[1-9][0-9]|[0-9])"
+	);
+	if (node == NULL) {
+		EC_LOG(EC_LOG_ERR, "cannot create node\n");
+		return -1;
+	}
+	testres |= EC_TEST_CHECK_PARSE(node, 1, "192.168.0.1");
+	testres |= EC_TEST_CHECK_PARSE(node, 1, "255.255.255.255");
+	testres |= EC_TEST_CHECK_PARSE(node, -1, "256.0.0.1");
+	testres |= EC_TEST_CHECK_PARSE(node, -1, "1.2.3.4.5");
+	testres |= EC_TEST_CHECK_PARSE(node, -1, "1.2.3");
+	ec_node_free(node);
+
+	/* invalid pattern */
+	node = ec_node_re(EC_NO_ID, "a(b");
+	testres |= EC_TEST_CHECK(node == NULL && errno == EINVAL, "invalid pattern accepted");
+	ec_node_free(node);
+
 	return testres;
 }
@@ -56,5 +56,81 @@ EC_TEST_MAIN()
 
 	ec_node_free(node);
 
+	/* the first matching pattern wins, with its longest match */
+	node = ec_node_re_lex(
+		EC_NO_ID,
+		ec_node_many(
+			EC_NO_ID,
+			EC_NODE_OR(
+				EC_NO_ID, ec_node_str(EC_NO_ID, "ab"), ec_node_int(EC_NO_ID, 0, 9, 0)
+			),
+			0,
+			0
+		)
+	);
+	if (node == NULL) {
+		EC_LOG(EC_LOG_ERR, "cannot create node\n");
+		return -1;
+	}
+	ret = ec_node_re_lex_add(node, "[a-z]+", 1, NULL);
+	testres |= EC_TEST_CHECK(ret == 0, "cannot add regexp");
+	ret = ec_node_re_lex_add(node, "[a-z0-9]+", 1, NULL);
+	testres |= EC_TEST_CHECK(ret == 0, "cannot add regexp");
+	ret = ec_node_re_lex_add(node, "a|[ ]+", 0, NULL);
+	testres |= EC_TEST_CHECK(ret == 0, "cannot add regexp");
+	testres |= EC_TEST_CHECK_PARSE(node, 1, "ab1");
+	testres |= EC_TEST_CHECK_PARSE(node, 1, "ab 1 ab");
+	testres |= EC_TEST_CHECK_PARSE(node, -1, "abc");
+	testres |= EC_TEST_CHECK_PARSE(node, -1, "ab 12");
+	testres |= EC_TEST_CHECK_PARSE(node, -1, "ab!");
+	ret = ec_node_re_lex_add(node, "[a-", 1, NULL);
+	testres |= EC_TEST_CHECK(ret < 0, "invalid regexp should be rejected");
+	testres |= EC_TEST_CHECK_PARSE(node, 1, "ab1");
+	ec_node_free(node);
+
+	/* attributes attached to tokens */
+	node = ec_node_re_lex(
+		EC_NO_ID, ec_node_many(EC_NO_ID, ec_node_any(EC_NO_ID, "word"), 0, 0)
+	);
+	if (node == NULL) {
+		EC_LOG(EC_LOG_ERR, "cannot create node\n");
+		return -1;
+	}
+	ret = ec_node_re_lex_add(node, "[a-z]+", 1, "word");
+	testres |= EC_TEST_CHECK(ret == 0, "cannot add regexp");
+	ret = ec_node_re_lex_add(node, "[0-9]+", 1, NULL);
+	testres |= EC_TEST_CHECK(ret == 0, "cannot add regexp");
+	ret = ec_node_re_lex_add(node, "[ ]+", 0, NULL);
+	testres |= EC_TEST_CHECK(ret == 0, "cannot add regexp");
+	testres |= EC_TEST_CHECK_PARSE(node, 1, "foo bar baz");
+	testres |= EC_TEST_CHECK_PARSE(node, -1, "foo 12");
+	ec_node_free(node);
+
+	/* patterns that cannot be merged into one automaton */
+	node = ec_node_re_lex(
+		EC_NO_ID,
+		ec_node_many(
+			EC_NO_ID,
+			EC_NODE_OR(
+				EC_NO_ID, ec_node_str(EC_NO_ID, "aa"), ec_node_str(EC_NO_ID, "b")
+			),
+			0,
+			0
+		)
+	);
+	if (node == NULL) {
+		EC_LOG(EC_LOG_ERR, "cannot create node\n");
+		return -1;
+	}
+	ret = ec_node_re_lex_add(node, "([a-z])\\1", 1, NULL);
+	testres |= EC_TEST_CHECK(ret == 0, "cannot add regexp");
+	ret = ec_node_re_lex_add(node, "[a-z]", 1, NULL);
+	testres |= EC_TEST_CHECK(ret == 0, "cannot add regexp");
+	ret = ec_node_re_lex_add(node, "[ ]+", 0, NULL);
+	testres |= EC_TEST_CHECK(ret == 0, "cannot add regexp");
+	testres |= EC_TEST_CHECK_PARSE(node, 1, "aab b");
+	testres |= EC_TEST_CHECK_PARSE(node, -1, "ab");
+	ec_node_free(node);
+
 	return testres;
 }
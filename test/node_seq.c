@@ -4,9 +4,15 @@
 
 #include "test.h"
 
+/* a sequence of "z" and a child */
+static struct ec_node *z_then(struct ec_node *child)
+{
+	return EC_NODE_SEQ(EC_NO_ID, ec_node_str(EC_NO_ID, "z"), child);
+}
+
 EC_TEST_MAIN()
 {
-	struct ec_node *node = NULL;
+	struct ec_node *node = NULL, *child;
 	int testres = 0;
 
 	node = EC_NODE_SEQ(EC_NO_ID, ec_node_str(EC_NO_ID, "foo"), ec_node_str(EC_NO_ID, "bar"));
@@ -49,5 +55,69 @@ EC_TEST_MAIN()
 	testres |= EC_TEST_CHECK_COMPLETE(node, "foobarx", EC_VA_END, EC_VA_END);
 	ec_node_free(node);
 
+	/* a child reached at the same offset by several paths is completed for
+	 * each of them */
+	node = EC_NODE_SEQ(
+		EC_NO_ID,
+		ec_node_option(EC_NO_ID, ec_node_str(EC_NO_ID, "a")),
+		ec_node_option(
+			EC_NO_ID,
+			EC_NODE_OR(EC_NO_ID, ec_node_str(EC_NO_ID, "a"), ec_node_str(EC_NO_ID, "b"))
+		),
+		ec_node_str(EC_NO_ID, "end")
+	);
+	if (node == NULL) {
+		EC_LOG(EC_LOG_ERR, "cannot create node\n");
+		return -1;
+	}
+	testres |= EC_TEST_CHECK_COMPLETE(node, "", EC_VA_END, "a", "a", "b", "end", EC_VA_END);
+	testres |= EC_TEST_CHECK_COMPLETE(
+		node, "a", "", EC_VA_END, "a", "b", "end", "end", EC_VA_END
+	);
+	testres |= EC_TEST_CHECK_COMPLETE(node, "a", "b", "", EC_VA_END, "end", EC_VA_END);
+	testres |= EC_TEST_CHECK_COMPLETE(node, "b", "e", EC_VA_END, "end", EC_VA_END);
+	ec_node_free(node);
+
+	/* children depending on the ones matched before them on each path */
+	child = ec_node_str(EC_NO_ID, "a");
+	if (child == NULL) {
+		EC_LOG(EC_LOG_ERR, "cannot create node\n");
+		return -1;
+	}
+	node = EC_NODE_SEQ(
+		EC_NO_ID,
+		ec_node_option(EC_NO_ID, z_then(ec_node_str(EC_NO_ID, "a"))),
+		ec_node_option(EC_NO_ID, z_then(ec_node_clone(child))),
+		ec_node_once(EC_NO_ID, ec_node_clone(child))
+	);
+	ec_node_free(child);
+	if (node == NULL) {
+		EC_LOG(EC_LOG_ERR, "cannot create node\n");
+		return -1;
+	}
+	testres |= EC_TEST_CHECK_PARSE(node, 3, "z", "a", "a");
+	testres |= EC_TEST_CHECK_COMPLETE(node, "z", "a", "", EC_VA_END, "z", "a", EC_VA_END);
+	ec_node_free(node);
+
+	node = EC_NODE_SEQ(
+		EC_NO_ID,
+		ec_node_option(EC_NO_ID, z_then(ec_node_str("id_a", "a"))),
+		ec_node_option(EC_NO_ID, z_then(ec_node_str(EC_NO_ID, "a"))),
+		ec_node_cond(
+			EC_NO_ID,
+			"cmp(eq, count(find(root(), id_a)), 1)",
+			ec_node_str(EC_NO_ID, "b")
+		),
+		ec_node_str(EC_NO_ID, "c")
+	);
+	if (node == NULL) {
+		EC_LOG(EC_LOG_ERR, "cannot create node\n");
+		return -1;
+	}
+	testres |= EC_TEST_CHECK_PARSE(node, 4, "z", "a", "b", "c");
+	testres |= EC_TEST_CHECK_COMPLETE(node, "z", "a", "", EC_VA_END, "z", "b", "b", EC_VA_END);
+	testres |= EC_TEST_CHECK_COMPLETE(node, "z", "a", "b", "", EC_VA_END, "c", EC_VA_END);
+	ec_node_free(node);
+
 	return testres;
 }
@@ -6,7 +6,7 @@
 
 EC_TEST_MAIN()
 {
-	struct ec_node *node;
+	struct ec_node *node, *child;
 	int testres = 0;
 
 	node = EC_NODE_SUBSET(
@@ -129,5 +129,95 @@ EC_TEST_MAIN()
 	testres |= EC_TEST_CHECK_COMPLETE(node, "x", EC_VA_END, EC_VA_END);
 	ec_node_free(node);
 
+	/* a child is completed once at a given offset, whatever the children
+	 * matched before it, and in which order */
+	node = EC_NODE_SUBSET(
+		EC_NO_ID,
+		EC_NODE_OR(EC_NO_ID, ec_node_str(EC_NO_ID, "x"), ec_node_str(EC_NO_ID, "y")),
+		EC_NODE_OR(EC_NO_ID, ec_node_str(EC_NO_ID, "x"), ec_node_str(EC_NO_ID, "y")),
+		ec_node_str(EC_NO_ID, "z")
+	);
+	if (node == NULL) {
+		EC_LOG(EC_LOG_ERR, "cannot create node\n");
+		return -1;
+	}
+	testres |= EC_TEST_CHECK_PARSE(node, 3, "x", "y", "z");
+	testres |= EC_TEST_CHECK_COMPLETE(node, "x", "y", "", EC_VA_END, "z", EC_VA_END);
+	testres |= EC_TEST_CHECK_COMPLETE(
+		node, "x", "", EC_VA_END, "x", "y", "x", "y", "z", EC_VA_END
+	);
+	ec_node_free(node);
+
+	/* test with children matching an empty strvec, reached in many orders */
+	node = EC_NODE_SUBSET(
+		EC_NO_ID,
+		ec_node_option(EC_NO_ID, ec_node_str(EC_NO_ID, "a")),
+		ec_node_option(EC_NO_ID, ec_node_str(EC_NO_ID, "b")),
+		ec_node_option(EC_NO_ID, ec_node_str(EC_NO_ID, "c")),
+		ec_node_option(EC_NO_ID, ec_node_str(EC_NO_ID, "d")),
+		ec_node_option(EC_NO_ID, ec_node_str(EC_NO_ID, "e")),
+		ec_node_option(EC_NO_ID, ec_node_str(EC_NO_ID, "f")),
+		ec_node_option(EC_NO_ID, ec_node_str(EC_NO_ID, "g")),
+		ec_node_option(EC_NO_ID, ec_node_str(EC_NO_ID, "h")),
+		ec_node_option(EC_NO_ID, ec_node_str(EC_NO_ID, "i")),
+		ec_node_option(EC_NO_ID, ec_node_str(EC_NO_ID, "j")),
+		ec_node_option(EC_NO_ID, ec_node_str(EC_NO_ID, "k")),
+		ec_node_option(EC_NO_ID, ec_node_str(EC_NO_ID, "l"))
+	);
+	if (node == NULL) {
+		EC_LOG(EC_LOG_ERR, "cannot create node\n");
+		return -1;
+	}
+	ec_node_subset_set_min(node, 12);
+	testres |= EC_TEST_CHECK_PARSE(node, 0);
+	testres |= EC_TEST_CHECK_PARSE(node, 3, "a", "b", "c", "x");
+	testres |= EC_TEST_CHECK_PARSE(node, 2, "b", "c", "b");
+	/* the first child matches the empty strvec before "a" is reached */
+	testres |= EC_TEST_CHECK_PARSE(node, 1, "l", "a");
+	testres |= EC_TEST_CHECK_COMPLETE(
+		node,
+		"l",
+		"a",
+		"",
+		EC_VA_END,
+		"b",
+		"c",
+		"d",
+		"e",
+		"f",
+		"g",
+		"h",
+		"i",
+		"j",
+		"k",
+		EC_VA_END
+	);
+	ec_node_free(node);
+
+	/* test with children depending on the ones matched before them */
+	child = ec_node_str(EC_NO_ID, "x");
+	if (child == NULL) {
+		EC_LOG(EC_LOG_ERR, "cannot create node\n");
+		return -1;
+	}
+	node = EC_NODE_SUBSET(
+		EC_NO_ID,
+		ec_node_once(EC_NO_ID, ec_node_clone(child)),
+		ec_node_once(EC_NO_ID, ec_node_clone(child)),
+		ec_node_str(EC_NO_ID, "y")
+	);
+	ec_node_free(child);
+	if (node == NULL) {
+		EC_LOG(EC_LOG_ERR, "cannot create node\n");
+		return -1;
+	}
+	testres |= EC_TEST_CHECK_PARSE(node, 1, "x", "x");
+	testres |= EC_TEST_CHECK_PARSE(node, 2, "x", "y", "x");
+	testres |= EC_TEST_CHECK_PARSE(node, 2, "y", "x", "x");
+	/* each order of the matching children is completed */
+	testres |= EC_TEST_CHECK_COMPLETE(node, "x", "", EC_VA_END, "y", "y", EC_VA_END);
+	testres |= EC_TEST_CHECK_COMPLETE(node, "y", "", EC_VA_END, "x", "x", EC_VA_END);
+	ec_node_free(node);
+
 	return testres;
 }
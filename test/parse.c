@@ -9,9 +9,14 @@
 
 EC_TEST_MAIN()
 {
+	const struct ec_parse_failure *failure;
+	const struct ec_node *const *path;
+	struct ec_strvec *vec = NULL;
 	struct ec_node *node = NULL;
 	struct ec_pnode *p = NULL, *p2 = NULL;
 	const struct ec_pnode *pc;
+	struct ec_node *child;
+	size_t len;
 	FILE *f = NULL;
 	char *buf = NULL;
 	size_t buflen = 0;
@@ -80,10 +85,74 @@ EC_TEST_MAIN()
 	buf = NULL;
 
 	ec_pnode_free(p);
+
+	/* the failure is only tracked when a report is requested */
+	p = ec_parse(node, "x z");
+	testres |= EC_TEST_CHECK(
+		p != NULL && ec_pnode_get_failure(p) == NULL, "unexpected failure report\n"
+	);
+	ec_pnode_free(p);
+
+	p = ec_parse_report(node, "x z");
+	failure = ec_pnode_get_failure(p);
+	testres |= EC_TEST_CHECK(
+		failure != NULL && ec_parse_failure_get_offset(failure) == 1
+			&& ec_strvec_len(ec_parse_failure_get_strvec(failure)) == 2
+			&& !ec_parse_failure_prefix_matches(failure)
+			&& ec_parse_failure_get_count(failure) == 1,
+		"bad failure report\n"
+	);
+	path = ec_parse_failure_get_path(failure, 0, &len);
+	testres |= EC_TEST_CHECK(
+		path != NULL && len == 3 && !strcmp(ec_node_id(path[0]), "id_y") && path[2] == node,
+		"bad expected node\n"
+	);
+	ec_pnode_free(p);
+
+	p = ec_parse_report(node, "x");
+	failure = ec_pnode_get_failure(p);
+	testres |= EC_TEST_CHECK(
+		failure != NULL && ec_parse_failure_get_offset(failure) == 1
+			&& ec_parse_failure_get_count(failure) == 1,
+		"bad failure report\n"
+	);
+	ec_pnode_free(p);
+
+	p = ec_parse_report(node, "x y z");
+	failure = ec_pnode_get_failure(p);
+	testres |= EC_TEST_CHECK(
+		failure != NULL && ec_parse_failure_get_offset(failure) == 2
+			&& ec_parse_failure_prefix_matches(failure)
+			&& ec_parse_failure_get_count(failure) == 0,
+		"bad failure report\n"
+	);
+	ec_pnode_free(p);
+
+	if (ec_node_get_child(node, 0, &child) < 0)
+		goto fail;
+	vec = EC_STRVEC("z");
+	if (vec == NULL)
+		goto fail;
+	p = ec_parse_strvec_report(child, vec);
+	failure = ec_pnode_get_failure(p);
+	testres |= EC_TEST_CHECK(
+		failure != NULL && ec_parse_failure_get_offset(failure) == 0
+			&& ec_parse_failure_get_count(failure) == 1,
+		"bad failure report\n"
+	);
+	path = ec_parse_failure_get_path(failure, 0, &len);
+	testres |= EC_TEST_CHECK(
+		path != NULL && len == 2 && !strcmp(ec_node_id(path[0]), "id_x"),
+		"bad expected node\n"
+	);
+	ec_strvec_free(vec);
+	ec_pnode_free(p);
+
 	ec_node_free(node);
 	return testres;
 
 fail:
+	ec_strvec_free(vec);
 	ec_pnode_free(p2);
 	ec_pnode_free(p);
 	ec_node_free(node);
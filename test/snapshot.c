@@ -0,0 +1,297 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright 2025, Olivier MATZ <zer0@droids-corp.org>
+ */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "test.h"
+
+/* export a grammar in a buffer allocated with malloc */
+static char *export_mem(const struct ec_node *node, size_t *len)
+{
+	char *buf = NULL;
+	FILE *f;
+
+	f = open_memstream(&buf, len);
+	if (f == NULL)
+		return NULL;
+	if (ec_snapshot_export(f, node) < 0) {
+		fclose(f);
+		free(buf);
+		return NULL;
+	}
+	fclose(f);
+
+	return buf;
+}
+
+/*
+ * Build a snapshot of a seq node whose children list contains n nested
+ * lists. If overlap is true, each list contains all the next ones, so
+ * reading them without checks would take an exponential time.
+ */
+static uint32_t *build_nested(uint32_t n, bool overlap, size_t *len)
+{
+	static const char strings[] = "seq\0children\0\0\0";
+	uint32_t configs_off, strings_off, k;
+	uint32_t *buf;
+
+	configs_off = 56 + 20;
+	strings_off = configs_off + (n + 2) * 16;
+	*len = strings_off + sizeof(strings);
+	buf = calloc(1, *len);
+	if (buf == NULL)
+		return NULL;
+
+	/* header */
+	memcpy(buf, "ECSNAP01", 8);
+	buf[2] = 0x01020304;
+	buf[3] = *len;
+	buf[4] = 0; /* root */
+	buf[5] = 56; /* nodes */
+	buf[6] = 1;
+	buf[7] = configs_off; /* attrs */
+	buf[8] = 0;
+	buf[9] = configs_off;
+	buf[10] = n + 2;
+	buf[11] = strings_off;
+	buf[12] = sizeof(strings);
+	buf[13] = 0; /* padding */
+
+	/* the seq node, configured with the dict in record 0 */
+	buf[14] = 0;
+	buf[15] = UINT32_MAX;
+	buf[16] = 0;
+	buf[17] = 0;
+	buf[18] = 0;
+
+	/* record 0: {children: record 1} */
+	buf[19] = EC_CONFIG_TYPE_DICT;
+	buf[20] = UINT32_MAX;
+	buf[21] = 1;
+	buf[22] = 1;
+	/* records 1 to n: lists */
+	for (k = 1; k <= n; k++) {
+		buf[19 + k * 4] = EC_CONFIG_TYPE_LIST;
+		buf[20 + k * 4] = k == 1 ? 4 : UINT32_MAX;
+		buf[21 + k * 4] = k + 1;
+		buf[22 + k * 4] = overlap ? n + 1 - k : 1;
+	}
+	/* record n + 1: an empty list */
+	buf[19 + (n + 1) * 4] = EC_CONFIG_TYPE_LIST;
+	buf[20 + (n + 1) * 4] = UINT32_MAX;
+	buf[21 + (n + 1) * 4] = n + 2;
+	buf[22 + (n + 1) * 4] = 0;
+
+	memcpy((char *)buf + strings_off, strings, sizeof(strings));
+
+	return buf;
+}
+
+/* a grammar with a loop, a shared node, attributes and various config types */
+static struct ec_node *build_grammar(void)
+{
+	struct ec_node *expr = NULL, *seq = NULL, *val = NULL, *root = NULL;
+
+	expr = ec_node("or", "expr");
+	val = ec_node_int("val", -10, 10, 0);
+	if (expr == NULL || val == NULL)
+		goto fail;
+	seq = EC_NODE_SEQ(EC_NO_ID, ec_node_str("op", "!"), ec_node_clone(expr));
+	if (seq == NULL)
+		goto fail;
+	if (ec_node_or_add(expr, seq) < 0) {
+		seq = NULL;
+		goto fail;
+	}
+	if (ec_node_or_add(expr, ec_node_clone(val)) < 0)
+		goto fail;
+	if (ec_interact_set_help(val, "a value") < 0)
+		goto fail;
+	if (ec_dict_set(ec_node_attrs(val), "flag", NULL, NULL) < 0)
+		goto fail;
+	/* not saved in the snapshot */
+	if (ec_dict_set(ec_node_attrs(val), "ptr", &build_grammar, NULL) < 0)
+		goto fail;
+
+	root = EC_NODE_OR(
+		"root",
+		EC_NODE_SEQ(EC_NO_ID, ec_node_str(EC_NO_ID, "eval"), ec_node_clone(expr)),
+		EC_NODE_SEQ(EC_NO_ID, ec_node_str(EC_NO_ID, "print"), ec_node_clone(val)),
+		EC_NODE_CMD(EC_NO_ID, "set val [verbose] x*", ec_node_clone(val)),
+		ec_node_many(EC_NO_ID, ec_node_re(EC_NO_ID, "[a-z]+"), 2, 3)
+	);
+	if (root == NULL)
+		goto fail;
+
+	ec_node_free(expr);
+	ec_node_free(val);
+	return root;
+
+fail:
+	ec_node_free(expr);
+	ec_node_free(val);
+	return NULL;
+}
+
+EC_TEST_MAIN()
+{
+	char *buf = NULL, *buf2 = NULL, *corrupt = NULL;
+	char tmpfile[] = "/tmp/ecoli_snapshot_test_XXXXXX";
+	struct ec_node *node = NULL, *node2 = NULL;
+	struct ec_node *val, *child, *shared;
+	size_t len, len2, i;
+	const char *help;
+	int testres = 0;
+	FILE *f = NULL;
+	int fd;
+
+	node = build_grammar();
+	if (node == NULL) {
+		EC_LOG(EC_LOG_ERR, "cannot create node\n");
+		return -1;
+	}
+	buf = export_mem(node, &len);
+	if (buf == NULL) {
+		EC_LOG(EC_LOG_ERR, "cannot export node\n");
+		goto fail;
+	}
+	node2 = ec_snapshot_import_mem(buf, len);
+	if (node2 == NULL) {
+		EC_LOG(EC_LOG_ERR, "cannot import snapshot\n");
+		goto fail;
+	}
+
+	testres |= EC_TEST_CHECK_PARSE(node2, 2, "eval", "1");
+	testres |= EC_TEST_CHECK_PARSE(node2, 4, "eval", "!", "!", "-3");
+	testres |= EC_TEST_CHECK_PARSE(node2, 2, "print", "2");
+	testres |= EC_TEST_CHECK_PARSE(node2, 4, "set", "2", "verbose", "x");
+	testres |= EC_TEST_CHECK_PARSE(node2, 3, "foo", "bar", "baz", "qux");
+	testres |= EC_TEST_CHECK_PARSE(node2, -1, "foo");
+	testres |= EC_TEST_CHECK_PARSE(node2, -1, "print", "11");
+	testres |= EC_TEST_CHECK_PARSE(node2, -1, "eval", "!", "!");
+
+	/* the node is shared again, and the string attributes are restored */
+	val = ec_node_find(node2, "val");
+	testres |= EC_TEST_CHECK(val != NULL, "val node not found");
+	if (val != NULL) {
+		/* root -> seq(print, val) */
+		shared = NULL;
+		if (ec_node_get_child(node2, 1, &child) == 0)
+			ec_node_get_child(child, 1, &shared);
+		testres |= EC_TEST_CHECK(shared == val, "val node is not shared");
+		help = ec_dict_get(ec_node_attrs(val), EC_INTERACT_HELP_ATTR);
+		testres |= EC_TEST_CHECK(
+			help != NULL && !strcmp(help, "a value"), "invalid help attribute"
+		);
+		testres |= EC_TEST_CHECK(
+			ec_dict_has_key(ec_node_attrs(val), "flag"), "flag attribute not found"
+		);
+		testres |= EC_TEST_CHECK(
+			!ec_dict_has_key(ec_node_attrs(val), "ptr"), "ptr attribute not skipped"
+		);
+	}
+
+	/* the export of the imported grammar is identical */
+	buf2 = export_mem(node2, &len2);
+	testres |= EC_TEST_CHECK(
+		buf2 != NULL && len2 == len && !memcmp(buf, buf2, len), "export is not stable"
+	);
+	ec_node_free(node2);
+	node2 = NULL;
+
+	/* import from a file */
+	fd = mkstemp(tmpfile);
+	if (fd < 0) {
+		EC_LOG(EC_LOG_ERR, "cannot create temp file\n");
+		goto fail;
+	}
+	f = fdopen(fd, "w");
+	if (f == NULL) {
+		close(fd);
+		unlink(tmpfile);
+		goto fail;
+	}
+	testres |= EC_TEST_CHECK(ec_snapshot_export(f, node) == 0, "cannot export to file");
+	fclose(f);
+	f = NULL;
+	node2 = ec_snapshot_import(tmpfile);
+	unlink(tmpfile);
+	testres |= EC_TEST_CHECK(node2 != NULL, "cannot import file");
+	testres |= EC_TEST_CHECK_PARSE(node2, 4, "eval", "!", "!", "-3");
+	ec_node_free(node2);
+	node2 = NULL;
+
+	/* invalid snapshots */
+	node2 = ec_snapshot_import("/nonexistent/snapshot");
+	testres |= EC_TEST_CHECK(node2 == NULL, "should fail on missing file");
+	testres |= EC_TEST_CHECK(ec_snapshot_export(NULL, node) < 0, "should fail with NULL");
+	/* the children of a subset node are not in its config */
+	node2 = EC_NODE_SUBSET(EC_NO_ID, ec_node_str(EC_NO_ID, "foo"));
+	f = fopen("/dev/null", "w");
+	if (node2 == NULL || f == NULL)
+		goto fail;
+	testres |= EC_TEST_CHECK(
+		ec_snapshot_export(f, node2) < 0 && errno == ENOTSUP, "should fail on subset"
+	);
+	fclose(f);
+	f = NULL;
+	ec_node_free(node2);
+	for (i = 0; i < len; i += 4) {
+		node2 = ec_snapshot_import_mem(buf, i);
+		testres |= EC_TEST_CHECK(node2 == NULL, "should fail on truncated snapshot");
+		ec_node_free(node2);
+	}
+	node2 = NULL;
+	corrupt = malloc(len);
+	if (corrupt == NULL)
+		goto fail;
+	/* out of range indexes or offsets in any field must never crash */
+	for (i = 0; i < len; i += 4) {
+		memcpy(corrupt, buf, len);
+		memset(&corrupt[i], 0xfe, 4);
+		ec_node_free(ec_snapshot_import_mem(corrupt, len));
+	}
+	memcpy(corrupt, buf, len);
+	corrupt[0] = 'X';
+	node2 = ec_snapshot_import_mem(corrupt, len);
+	testres |= EC_TEST_CHECK(node2 == NULL && errno == EINVAL, "should fail on bad magic");
+	free(corrupt);
+
+	/* overlapping or too deeply nested lists are rejected quickly */
+	corrupt = (char *)build_nested(64, true, &len2);
+	if (corrupt == NULL)
+		goto fail;
+	node2 = ec_snapshot_import_mem(corrupt, len2);
+	testres |= EC_TEST_CHECK(
+		node2 == NULL && errno == EINVAL, "should fail on overlapping lists"
+	);
+	free(corrupt);
+	corrupt = (char *)build_nested(100000, false, &len2);
+	if (corrupt == NULL)
+		goto fail;
+	node2 = ec_snapshot_import_mem(corrupt, len2);
+	testres |= EC_TEST_CHECK(node2 == NULL && errno == EINVAL, "should fail on deep lists");
+
+	free(corrupt);
+	free(buf);
+	free(buf2);
+	ec_node_free(node);
+	return testres;
+
+fail:
+	if (f != NULL)
+		fclose(f);
+	free(corrupt);
+	free(buf);
+	free(buf2);
+	ec_node_free(node);
+	ec_node_free(node2);
+	return -1;
+}
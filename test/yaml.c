@@ -2,6 +2,7 @@
  * Copyright 2026, Free Mobile, Vincent Jardin <vjardin@free.fr>
  */
 
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -18,14 +19,51 @@
  * 3. The re-imported node parses the same inputs
  */
 
+/* x, x + x, -x + x, ... with keys in any order and a list of children reused */
+static const char loop_yaml[] = "--- &term\n"
+				"children:\n"
+				"- children: &binop\n"
+				"  - &value\n"
+				"    string: x\n"
+				"    type: str\n"
+				"  - type: str\n"
+				"    string: +\n"
+				"    attrs:\n"
+				"      key: val\n"
+				"  - *term\n"
+				"  type: seq\n"
+				"- type: seq\n"
+				"  children: *binop\n"
+				"- type: seq\n"
+				"  children:\n"
+				"  - {type: str, string: \"-\"}\n"
+				"  - *term\n"
+				"- *value\n"
+				"id: term\n"
+				"help: A term.\n"
+				"type: or\n";
+
+static const char *const invalid_yaml[] = {
+	"",
+	"type: or\nchildren: [*unknown]\n",
+	"type: unknown_type\n",
+	"id: no_type\n",
+	"type: str\nstring: [x]\n",
+	"type: str\nstring: x\nfoo: bar\n",
+	"type: or\nchildren:\n- type: str\n string: x\n",
+	"type: str\nstring: x\nid: a\nid: b\n",
+	"type: or\nchildren: [{type: str, string: a}, *]\n",
+};
+
 EC_TEST_MAIN()
 {
 	struct ec_node *node1 = NULL, *node2 = NULL;
 	struct ec_pnode *p1 = NULL, *p2 = NULL;
 	char tmpfile[] = "/tmp/ecoli_yaml_test_XXXXXX";
 	FILE *fp = NULL;
-	int fd = -1;
+	int fd = -1, pipefd[2];
 	int testres = 0;
+	size_t i, len;
 
 	/* Test 1: export/import roundtrip */
 
@@ -111,5 +149,70 @@ EC_TEST_MAIN()
 		ec_yaml_export(NULL, NULL) < 0, "export should fail with NULL arguments"
 	);
 
+	/* Test 3: import from memory, with anchors and keys in any order */
+	node1 = ec_yaml_import_mem(loop_yaml, strlen(loop_yaml));
+	testres |= EC_TEST_CHECK(node1 != NULL, "cannot import yaml from memory");
+	testres |= EC_TEST_CHECK_PARSE(node1, 1, "x");
+	testres |= EC_TEST_CHECK_PARSE(node1, 3, "x", "+", "x");
+	testres |= EC_TEST_CHECK_PARSE(node1, 2, "-", "x");
+	testres |= EC_TEST_CHECK_PARSE(node1, 4, "-", "x", "+", "x");
+	testres |= EC_TEST_CHECK_PARSE(node1, -1, "+");
+	if (node1 != NULL) {
+		struct ec_node *seq1 = NULL, *seq2 = NULL, *op1 = NULL, *op2 = NULL;
+		const char *help;
+
+		testres |= EC_TEST_CHECK(!strcmp(ec_node_id(node1), "term"), "invalid id");
+		help = ec_dict_get(ec_node_attrs(node1), EC_INTERACT_HELP_ATTR);
+		testres |= EC_TEST_CHECK(help != NULL && !strcmp(help, "A term."), "invalid help");
+		/* the aliased list of children references the same nodes */
+		ec_node_get_child(node1, 0, &seq1);
+		ec_node_get_child(node1, 1, &seq2);
+		if (seq1 != NULL)
+			ec_node_get_child(seq1, 1, &op1);
+		if (seq2 != NULL)
+			ec_node_get_child(seq2, 1, &op2);
+		testres |= EC_TEST_CHECK(
+			seq1 != seq2 && op1 != NULL && op1 == op2, "children are not shared"
+		);
+		testres |= EC_TEST_CHECK(
+			op1 != NULL && ec_dict_has_key(ec_node_attrs(op1), "key"),
+			"attribute not found"
+		);
+	}
+	ec_node_free(node1);
+
+	/* Test 4: import from a file descriptor */
+	fd = open("/dev/null", O_RDONLY);
+	if (fd >= 0) {
+		node1 = ec_yaml_import_fd(fd);
+		testres |= EC_TEST_CHECK(node1 == NULL, "empty document should fail");
+		close(fd);
+	}
+	if (pipe(pipefd) < 0) {
+		EC_LOG(EC_LOG_ERR, "cannot create pipe\n");
+		testres = -1;
+	} else {
+		/* the document fits in the pipe buffer */
+		len = strlen(loop_yaml);
+		testres |= EC_TEST_CHECK(
+			write(pipefd[1], loop_yaml, len) == (ssize_t)len, "cannot write to pipe"
+		);
+		close(pipefd[1]);
+		node1 = ec_yaml_import_fd(pipefd[0]);
+		close(pipefd[0]);
+		testres |= EC_TEST_CHECK(node1 != NULL, "cannot import yaml from fd");
+		testres |= EC_TEST_CHECK_PARSE(node1, 1, "x");
+		testres |= EC_TEST_CHECK_PARSE(node1, 4, "-", "x", "+", "x");
+		testres |= EC_TEST_CHECK_PARSE(node1, -1, "+");
+		ec_node_free(node1);
+	}
+
+	/* Test 5: invalid documents */
+	for (i = 0; i < EC_COUNT_OF(invalid_yaml); i++) {
+		node1 = ec_yaml_import_mem(invalid_yaml[i], strlen(invalid_yaml[i]));
+		testres |= EC_TEST_CHECK(node1 == NULL, "should fail: %s", invalid_yaml[i]);
+		ec_node_free(node1);
+	}
+
 	return testres;
 }